@@ -15,6 +15,17 @@ typedef struct _TGenActionStartData {
     guint64 stalloutNanos;
     guint64 heartbeatPeriodNanos;
     GLogLevelFlags loglevel;
+    TGenLogBackend logbackend;
+    gchar* logFilePath;
+    gchar* eventLogPath;
+    TGenIOBackend iobackend;
+    guint numThreads;
+    guint64 ioBudgetBytes;
+    guint64 ioBudgetSyscalls;
+    TGenPayloadContent content;
+    gboolean zeroCopy;
+    TGenTransferFraming framing;
+    guint64 statusIntervalNanos;
     guint16 serverport;
     TGenPeer* socksproxy;
     TGenPool* peers;
@@ -43,8 +54,9 @@ typedef struct _TGenActionTransferData {
     guint64 stalloutNanos;
     gboolean stalloutIsSet;
     TGenPool* peers;
-    gchar* localSchedule;
-    gchar* remoteSchedule;
+    TGenSchedule* localSchedule;
+    TGenSchedule* remoteSchedule;
+    TGenChecksumType checksumType;
     gchar* socksUsernameStr;
     gchar* socksPasswordStr;
 } TGenActionTransferData;
@@ -53,6 +65,7 @@ typedef struct _TGenActionModelData {
     TGenTransferType type;
     gchar* streamModelPath;
     gchar* packetModelPath;
+    TGenChecksumType checksumType;
     gchar* socksUsernameStr;
     gchar* socksPasswordStr;
     TGenPool* peers;
@@ -323,6 +336,19 @@ static GError* _tgenaction_handleTime(const gchar* attributeName, const gchar* t
     return error;
 }
 
+static GError* _tgenaction_handleChecksum(const gchar* attributeName, const gchar* checksumStr,
+        TGenChecksumType* checksumTypeOut) {
+    g_assert(attributeName && checksumStr && checksumTypeOut);
+
+    if (!tgenchecksum_typeFromString(checksumStr, checksumTypeOut)) {
+        return g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                "invalid content in string '%s' for attribute '%s', "
+                "expected 'md5', 'crc32c', 'xxh3', 'xxh64', or 'none'", checksumStr, attributeName);
+    }
+
+    return NULL;
+}
+
 static GError* _tgenaction_handleTimeList(const gchar* attributeName, const gchar* timeStr,
         TGenPool* pauseTimesOut) {
     g_assert(attributeName && timeStr && pauseTimesOut);
@@ -424,6 +450,150 @@ static GError* _tgenaction_handleLogLevel(const gchar* attributeName, const gcha
     return error;
 }
 
+static GError* _tgenaction_handleLogBackend(const gchar* attributeName, const gchar* backendStr, TGenLogBackend* backendOut){
+    g_assert(attributeName && backendStr);
+
+    GError* error = NULL;
+    TGenLogBackend backend = TGEN_LOG_BACKEND_SYNC;
+
+    if (g_ascii_strcasecmp(backendStr, "sync") == 0) {
+        backend = TGEN_LOG_BACKEND_SYNC;
+    } else if (g_ascii_strcasecmp(backendStr, "async") == 0) {
+        backend = TGEN_LOG_BACKEND_ASYNC;
+    } else {
+        error = g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                        "invalid content in string '%s' for attribute '%s', "
+                        "expected one of: 'sync' or 'async'",
+                        backendStr, attributeName);
+    }
+
+    if(!error && backendOut) {
+        *backendOut = backend;
+    }
+
+    return error;
+}
+
+static GError* _tgenaction_handleIOBackend(const gchar* attributeName, const gchar* backendStr, TGenIOBackend* backendOut){
+    g_assert(attributeName && backendStr);
+
+    GError* error = NULL;
+    TGenIOBackend backend = TGEN_IO_BACKEND_EPOLL;
+
+    if (g_ascii_strcasecmp(backendStr, "epoll") == 0) {
+        backend = TGEN_IO_BACKEND_EPOLL;
+    } else if (g_ascii_strcasecmp(backendStr, "uring") == 0 ||
+            g_ascii_strcasecmp(backendStr, "io_uring") == 0) {
+        backend = TGEN_IO_BACKEND_URING;
+    } else {
+        error = g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                        "invalid content in string '%s' for attribute '%s', "
+                        "expected one of: 'epoll' or 'uring'",
+                        backendStr, attributeName);
+    }
+
+    if(!error && backendOut) {
+        *backendOut = backend;
+    }
+
+    return error;
+}
+
+static GError* _tgenaction_handleIOBudget(const gchar* attributeName, const gchar* budgetStr,
+        guint64* bytesOut, guint64* syscallsOut) {
+    g_assert(attributeName && budgetStr);
+
+    GError* error = NULL;
+    guint64 bytes = 0, syscalls = 0;
+
+    /* a budget is either a number of bytes (format example: "1 MiB")
+     * or a number of syscalls (format example: "16 syscalls") */
+    gchar** tokens = g_strsplit(budgetStr, (const gchar*) " ", 2);
+
+    if(tokens[0] && tokens[1] && (!g_ascii_strcasecmp(tokens[1], "syscalls") ||
+            !g_ascii_strcasecmp(tokens[1], "syscall"))) {
+        gchar* end = NULL;
+        syscalls = g_ascii_strtoull(tokens[0], &end, 10);
+        if(!end || end == tokens[0] || *end != '\0') {
+            error = g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                    "invalid content in string '%s' for attribute '%s', "
+                    "expected format like '16 syscalls' or '1 MiB'",
+                    budgetStr, attributeName);
+        }
+    } else {
+        error = _tgenaction_handleBytes(attributeName, budgetStr, &bytes);
+    }
+
+    g_strfreev(tokens);
+
+    if(!error && bytes == 0 && syscalls == 0) {
+        error = g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                "invalid content in string '%s' for attribute '%s', "
+                "the budget must be greater than zero", budgetStr, attributeName);
+    }
+
+    if(!error) {
+        if(bytesOut) {
+            *bytesOut = bytes;
+        }
+        if(syscallsOut) {
+            *syscallsOut = syscalls;
+        }
+    }
+
+    return error;
+}
+
+static GError* _tgenaction_handleFraming(const gchar* attributeName, const gchar* framingStr,
+        TGenTransferFraming* framingOut) {
+    g_assert(attributeName && framingStr);
+
+    GError* error = NULL;
+    TGenTransferFraming framing = TGEN_FRAMING_TEXT;
+
+    if (g_ascii_strcasecmp(framingStr, "text") == 0) {
+        framing = TGEN_FRAMING_TEXT;
+    } else if (g_ascii_strcasecmp(framingStr, "binary") == 0) {
+        framing = TGEN_FRAMING_BINARY;
+    } else {
+        error = g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                        "invalid content in string '%s' for attribute '%s', "
+                        "expected one of: 'text' or 'binary'",
+                        framingStr, attributeName);
+    }
+
+    if(!error && framingOut) {
+        *framingOut = framing;
+    }
+
+    return error;
+}
+
+static GError* _tgenaction_handleContent(const gchar* attributeName, const gchar* contentStr,
+        TGenPayloadContent* contentOut) {
+    g_assert(attributeName && contentStr);
+
+    GError* error = NULL;
+    TGenPayloadContent content = TGEN_PAYLOAD_CONSTANT;
+
+    if (g_ascii_strcasecmp(contentStr, "constant") == 0) {
+        content = TGEN_PAYLOAD_CONSTANT;
+    } else if (g_ascii_strcasecmp(contentStr, "random") == 0) {
+        content = TGEN_PAYLOAD_RANDOM;
+    } else {
+        error = g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                        "invalid content in string '%s' for attribute '%s', "
+                        "expected one of: 'constant' or 'random'",
+                        contentStr, attributeName);
+    }
+
+    if(!error && contentOut) {
+        *contentOut = content;
+    }
+
+    return error;
+}
+
 static void _tgenaction_free(TGenAction* action) {
     TGEN_ASSERT(action);
     g_assert(action->refcount <= 0);
@@ -433,17 +603,25 @@ static void _tgenaction_free(TGenAction* action) {
         if(data->peers) {
             tgenpool_unref(data->peers);
         }
+        if(data->logFilePath) {
+            g_free(data->logFilePath);
+            data->logFilePath = NULL;
+        }
+        if(data->eventLogPath) {
+            g_free(data->eventLogPath);
+            data->eventLogPath = NULL;
+        }
     } else if(action->type == TGEN_ACTION_TRANSFER) {
         TGenActionTransferData* data = (TGenActionTransferData*) action->data;
         if(data->peers) {
             tgenpool_unref(data->peers);
         }
         if(data->localSchedule) {
-            g_free(data->localSchedule);
+            tgenschedule_unref(data->localSchedule);
             data->localSchedule = NULL;
         }
         if(data->remoteSchedule) {
-            g_free(data->remoteSchedule);
+            tgenschedule_unref(data->remoteSchedule);
             data->remoteSchedule = NULL;
         }
     } else if(action->type == TGEN_ACTION_MODEL) {
@@ -480,7 +658,10 @@ void tgenaction_unref(TGenAction* action) {
 
 TGenAction* tgenaction_newStartAction(const gchar* timeStr, const gchar* timeoutStr,
         const gchar* stalloutStr, const gchar* heartbeatStr,
-        const gchar* loglevelStr, const gchar* serverPortStr,
+        const gchar* loglevelStr, const gchar* logbackendStr, const gchar* logfileStr,
+        const gchar* eventlogStr, const gchar* iobackendStr, const gchar* threadsStr,
+        const gchar* iobudgetStr, const gchar* contentStr, const gchar* zerocopyStr,
+        const gchar* framingStr, const gchar* statusintervalStr, const gchar* serverPortStr,
         const gchar* peersStr, const gchar* socksProxyStr, GError** error) {
     g_assert(error);
 
@@ -534,6 +715,96 @@ TGenAction* tgenaction_newStartAction(const gchar* timeStr, const gchar* timeout
         }
     }
 
+    /* the log backend is optional, default is to print lines as we log them */
+    TGenLogBackend logbackend = TGEN_LOG_BACKEND_SYNC;
+    if(logbackendStr && g_ascii_strncasecmp(logbackendStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleLogBackend("logbackend", logbackendStr, &logbackend);
+        if (*error) {
+            return NULL;
+        }
+    }
+
+    /* the log file is optional, default is stdout, and we only check the path when we open it */
+    const gchar* logFilePath = NULL;
+    if(logfileStr && g_ascii_strncasecmp(logfileStr, "\0", (gsize) 1)) {
+        logFilePath = logfileStr;
+    }
+
+    /* the binary event log is optional, and we only check the path when we open it */
+    const gchar* eventLogPath = NULL;
+    if(eventlogStr && g_ascii_strncasecmp(eventlogStr, "\0", (gsize) 1)) {
+        eventLogPath = eventlogStr;
+    }
+
+    /* the event loop backend is optional, default is epoll */
+    TGenIOBackend iobackend = TGEN_IO_BACKEND_EPOLL;
+    if(iobackendStr && g_ascii_strncasecmp(iobackendStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleIOBackend("iobackend", iobackendStr, &iobackend);
+        if (*error) {
+            return NULL;
+        }
+    }
+
+    /* the number of worker threads is optional, default is to run in the main thread */
+    guint numThreads = 1;
+    if(threadsStr && g_ascii_strncasecmp(threadsStr, "\0", (gsize) 1)) {
+        gchar* end = NULL;
+        guint64 threads = g_ascii_strtoull(threadsStr, &end, 10);
+        if(!end || *end != '\0' || threads < 1 || threads > TGEN_MAX_THREADS) {
+            *error = g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+                    "invalid content in string '%s' for attribute 'threads', "
+                    "expected an integer between 1 and %i", threadsStr, TGEN_MAX_THREADS);
+            return NULL;
+        }
+        numThreads = (guint)threads;
+    }
+
+    /* an io budget is optional, default is one read or write per event */
+    guint64 ioBudgetBytes = 0, ioBudgetSyscalls = 0;
+    if(iobudgetStr && g_ascii_strncasecmp(iobudgetStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleIOBudget("iobudget", iobudgetStr, &ioBudgetBytes, &ioBudgetSyscalls);
+        if (*error) {
+            return NULL;
+        }
+    }
+
+    /* the payload content is optional, default is a constant byte */
+    TGenPayloadContent content = TGEN_PAYLOAD_CONSTANT;
+    if(contentStr && g_ascii_strncasecmp(contentStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleContent("content", contentStr, &content);
+        if (*error) {
+            return NULL;
+        }
+    }
+
+    /* sending payload without copying it is optional, default is to write it */
+    gboolean zeroCopy = FALSE;
+    if(zerocopyStr && g_ascii_strncasecmp(zerocopyStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleBoolean("zerocopy", zerocopyStr, &zeroCopy, NULL);
+        if (*error) {
+            return NULL;
+        }
+    }
+
+    /* the framing of transfer control messages is optional, default is text */
+    TGenTransferFraming framing = TGEN_FRAMING_TEXT;
+    if(framingStr && g_ascii_strncasecmp(framingStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleFraming("framing", framingStr, &framing);
+        if (*error) {
+            return NULL;
+        }
+    }
+
+    /* transfers log their status at most once per interval. the default of 0
+     * logs on every progress event, as we always did. */
+    guint64 statusIntervalNanos = 0;
+    if(statusintervalStr && g_ascii_strncasecmp(statusintervalStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleTime("statusinterval", statusintervalStr, &statusIntervalNanos);
+        if (*error) {
+            return NULL;
+        }
+    }
+
     /* a socks proxy address is optional */
     TGenPeer* socksproxy = NULL;
     if (socksProxyStr && g_ascii_strncasecmp(socksProxyStr, "\0", (gsize) 1)) {
@@ -569,6 +840,17 @@ TGenAction* tgenaction_newStartAction(const gchar* timeStr, const gchar* timeout
     data->stalloutNanos = defaultStalloutNanos;
     data->heartbeatPeriodNanos = heartbeatPeriodNanos;
     data->loglevel = loglevel;
+    data->logbackend = logbackend;
+    data->logFilePath = g_strdup(logFilePath);
+    data->eventLogPath = g_strdup(eventLogPath);
+    data->iobackend = iobackend;
+    data->numThreads = numThreads;
+    data->ioBudgetBytes = ioBudgetBytes;
+    data->ioBudgetSyscalls = ioBudgetSyscalls;
+    data->content = content;
+    data->zeroCopy = zeroCopy;
+    data->framing = framing;
+    data->statusIntervalNanos = statusIntervalNanos;
     guint64 longport = g_ascii_strtoull(serverPortStr, NULL, 10);
     data->serverport = htons((guint16)longport);
     data->peers = peerPool;
@@ -655,7 +937,7 @@ TGenAction* tgenaction_newTransferAction(const gchar* typeStr, const gchar* prot
         const gchar* sizeStr, const gchar *ourSizeStr, const gchar *theirSizeStr,
         const gchar* peersStr, const gchar* timeoutStr, const gchar* stalloutStr,
         const gchar* localscheduleStr, const gchar* remotescheduleStr,
-        const gchar* socksUsernameStr, const gchar* socksPasswordStr,
+        const gchar* checksumStr, const gchar* socksUsernameStr, const gchar* socksPasswordStr,
         GError** error) {
     g_assert(error);
 
@@ -795,6 +1077,15 @@ TGenAction* tgenaction_newTransferAction(const gchar* typeStr, const gchar* prot
         }
     }
 
+    /* the payload checksum is optional, default is md5 */
+    TGenChecksumType checksumType = TGEN_CHECKSUM_MD5;
+    if (checksumStr && g_ascii_strncasecmp(checksumStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleChecksum("checksum", checksumStr, &checksumType);
+        if(*error) {
+            return NULL;
+        }
+    }
+
     TGenAction* action = g_new0(TGenAction, 1);
     action->magic = TGEN_MAGIC;
     action->refcount = 1;
@@ -812,12 +1103,14 @@ TGenAction* tgenaction_newTransferAction(const gchar* typeStr, const gchar* prot
     data->timeoutIsSet = timeoutIsSet;
     data->stalloutNanos = stalloutNanos;
     data->stalloutIsSet = stalloutIsSet;
+    /* parse the schedules once here instead of for every transfer */
     if(type == TGEN_TYPE_SCHEDULE && localscheduleStr) {
-        data->localSchedule = g_strdup(localscheduleStr);
+        data->localSchedule = tgenschedule_newFromString(localscheduleStr);
     }
     if(type == TGEN_TYPE_SCHEDULE && remotescheduleStr) {
-        data->remoteSchedule = g_strdup(remotescheduleStr);
+        data->remoteSchedule = tgenschedule_newFromString(remotescheduleStr);
     }
+    data->checksumType = checksumType;
     data->socksUsernameStr = socksUsernameStr ? g_strdup(socksUsernameStr) : NULL;
     data->socksPasswordStr = socksPasswordStr ? g_strdup(socksPasswordStr) : NULL;
 
@@ -828,7 +1121,7 @@ TGenAction* tgenaction_newTransferAction(const gchar* typeStr, const gchar* prot
 }
 
 TGenAction* tgenaction_newModelAction(const gchar* streamModelPath,
-        const gchar* packetModelPath, const gchar* peersStr,
+        const gchar* packetModelPath, const gchar* peersStr, const gchar* checksumStr,
         const gchar* socksUsernameStr, const gchar* socksPasswordStr, GError** error) {
     g_assert(error);
 
@@ -869,6 +1162,18 @@ TGenAction* tgenaction_newModelAction(const gchar* streamModelPath,
         }
     }
 
+    /* the checksum of the generated streams is optional, default is md5 */
+    TGenChecksumType checksumType = TGEN_CHECKSUM_MD5;
+    if (checksumStr && g_ascii_strncasecmp(checksumStr, "\0", (gsize) 1)) {
+        *error = _tgenaction_handleChecksum("checksum", checksumStr, &checksumType);
+        if(*error) {
+            if(peerPool) {
+                tgenpool_unref(peerPool);
+            }
+            return NULL;
+        }
+    }
+
     TGenAction* action = g_new0(TGenAction, 1);
     action->magic = TGEN_MAGIC;
     action->refcount = 1;
@@ -878,6 +1183,7 @@ TGenAction* tgenaction_newModelAction(const gchar* streamModelPath,
     TGenActionModelData* data = g_new0(TGenActionModelData, 1);
     data->streamModelPath = g_strdup(streamModelPath);
     data->packetModelPath = g_strdup(packetModelPath);
+    data->checksumType = checksumType;
     data->socksUsernameStr = socksUsernameStr ? g_strdup(socksUsernameStr) : NULL;
     data->socksPasswordStr = socksPasswordStr ? g_strdup(socksPasswordStr) : NULL;
     data->peers = peerPool;
@@ -946,10 +1252,76 @@ GLogLevelFlags tgenaction_getLogLevel(TGenAction* action) {
     return ((TGenActionStartData*)action->data)->loglevel;
 }
 
+TGenLogBackend tgenaction_getLogBackend(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->logbackend;
+}
+
+const gchar* tgenaction_getLogFilePath(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->logFilePath;
+}
+
+const gchar* tgenaction_getEventLogPath(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->eventLogPath;
+}
+
+TGenIOBackend tgenaction_getIOBackend(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->iobackend;
+}
+
+guint tgenaction_getNumThreads(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->numThreads;
+}
+
+guint64 tgenaction_getIOBudgetBytes(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->ioBudgetBytes;
+}
+
+guint64 tgenaction_getIOBudgetSyscalls(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->ioBudgetSyscalls;
+}
+
+TGenPayloadContent tgenaction_getPayloadContent(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->content;
+}
+
+gboolean tgenaction_getZeroCopy(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->zeroCopy;
+}
+
+TGenTransferFraming tgenaction_getFraming(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return ((TGenActionStartData*)action->data)->framing;
+}
+
+guint64 tgenaction_getStatusIntervalMillis(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data && action->type == TGEN_ACTION_START);
+    return (guint64)(((TGenActionStartData*)action->data)->statusIntervalNanos / 1000000);
+}
+
 void tgenaction_getTransferParameters(TGenAction* action, TGenTransferType* typeOut,
         TGenTransportProtocol* protocolOut, guint64* sizeOut, guint64 *ourSizeOut,
         guint64 *theirSizeOut, guint64* timeoutOut, guint64* stalloutOut,
-        gchar** localSchedule, gchar** remoteSchedule) {
+        TGenSchedule** localSchedule, TGenSchedule** remoteSchedule) {
     TGEN_ASSERT(action);
     g_assert(action->data && action->type == TGEN_ACTION_TRANSFER);
 
@@ -990,6 +1362,18 @@ void tgenaction_getTransferParameters(TGenAction* action, TGenTransferType* type
     }
 }
 
+TGenChecksumType tgenaction_getChecksumType(TGenAction* action) {
+    TGEN_ASSERT(action);
+    g_assert(action->data);
+    g_assert(action->type == TGEN_ACTION_MODEL || action->type == TGEN_ACTION_TRANSFER);
+
+    if(action->type == TGEN_ACTION_MODEL) {
+        return ((TGenActionModelData*)action->data)->checksumType;
+    } else {
+        return ((TGenActionTransferData*)action->data)->checksumType;
+    }
+}
+
 void tgenaction_getModelPaths(TGenAction* action,
         gchar** streamModelPathStr, gchar** packetModelPathStr) {
     TGEN_ASSERT(action);
@@ -7,6 +7,9 @@
 
 #include "tgen.h"
 
+/* the most worker threads (each with its own event loop) that we will run */
+#define TGEN_MAX_THREADS 1024
+
 typedef enum _TGenActionType {
     TGEN_ACTION_START,
     TGEN_ACTION_END,
@@ -18,8 +21,12 @@ typedef enum _TGenActionType {
 typedef struct _TGenAction TGenAction;
 
 TGenAction* tgenaction_newStartAction(const gchar* timeStr, const gchar* timeoutStr,
-        const gchar* stalloutStr, const gchar* heartbeatStr, const gchar* loglevelStr, const gchar* serverPortStr,
-        const gchar* peersStr, const gchar* socksProxyStr, GError** error);
+        const gchar* stalloutStr, const gchar* heartbeatStr, const gchar* loglevelStr,
+        const gchar* logbackendStr, const gchar* logfileStr, const gchar* eventlogStr,
+        const gchar* iobackendStr, const gchar* threadsStr,
+        const gchar* iobudgetStr, const gchar* contentStr, const gchar* zerocopyStr, const gchar* framingStr,
+        const gchar* statusintervalStr, const gchar* serverPortStr, const gchar* peersStr, const gchar* socksProxyStr,
+        GError** error);
 TGenAction* tgenaction_newEndAction(const gchar* timeStr, const gchar* countStr,
         const gchar* sizeStr, GError** error);
 TGenAction* tgenaction_newPauseAction(const gchar* timeStr, glong totalIncoming, GError** error);
@@ -27,10 +34,10 @@ TGenAction* tgenaction_newTransferAction(const gchar* typeStr, const gchar* prot
         const gchar* sizeStr, const gchar *ourSizeStr, const gchar *theirSizeStr,
         const gchar* peersStr, const gchar* timeoutStr, const gchar* stalloutStr,
         const gchar* localscheduleStr, const gchar* remotescheduleStr,
-        const gchar* socksUsernameStr, const gchar* socksPasswordStr,
+        const gchar* checksumStr, const gchar* socksUsernameStr, const gchar* socksPasswordStr,
         GError** error);
 TGenAction* tgenaction_newModelAction(const gchar* streamModelPath,
-        const gchar* packetModelPath, const gchar* peersStr,
+        const gchar* packetModelPath, const gchar* peersStr, const gchar* checksumStr,
         const gchar* socksUsernameStr, const gchar* socksPasswordStr, GError** error);
 
 void tgenaction_ref(TGenAction* action);
@@ -47,11 +54,23 @@ guint64 tgenaction_getDefaultTimeoutMillis(TGenAction* action);
 guint64 tgenaction_getDefaultStalloutMillis(TGenAction* action);
 guint64 tgenaction_getHeartbeatPeriodMillis(TGenAction* action);
 GLogLevelFlags tgenaction_getLogLevel(TGenAction* action);
+TGenLogBackend tgenaction_getLogBackend(TGenAction* action);
+const gchar* tgenaction_getLogFilePath(TGenAction* action);
+const gchar* tgenaction_getEventLogPath(TGenAction* action);
+TGenIOBackend tgenaction_getIOBackend(TGenAction* action);
+guint tgenaction_getNumThreads(TGenAction* action);
+guint64 tgenaction_getIOBudgetBytes(TGenAction* action);
+guint64 tgenaction_getIOBudgetSyscalls(TGenAction* action);
+TGenPayloadContent tgenaction_getPayloadContent(TGenAction* action);
+gboolean tgenaction_getZeroCopy(TGenAction* action);
+TGenTransferFraming tgenaction_getFraming(TGenAction* action);
+guint64 tgenaction_getStatusIntervalMillis(TGenAction* action);
 
 void tgenaction_getTransferParameters(TGenAction* action, TGenTransferType* typeOut,
         TGenTransportProtocol* protocolOut, guint64* sizeOut, guint64 *ourSizeOut,
         guint64 *theirSizeOut, guint64* timeoutOut, guint64* stalloutOut,
-        gchar** localSchedule, gchar** remoteSchedule);
+        TGenSchedule** localSchedule, TGenSchedule** remoteSchedule);
+TGenChecksumType tgenaction_getChecksumType(TGenAction* action);
 
 void tgenaction_getModelPaths(TGenAction* action,
         gchar** streamModelPathStr, gchar** packetModelPathStr);
@@ -0,0 +1,738 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#include "tgen.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TGEN_CHECKSUM_HAVE_X86 1
+#endif
+
+/* the xxh3 state keeps this many bytes buffered between updates */
+#define XXH3_BUFFER_LENGTH 256
+#define XXH3_STRIPE_LENGTH 64
+#define XXH3_SECRET_LENGTH 192
+#define XXH3_SECRET_CONSUME_RATE 8
+#define XXH3_STRIPES_PER_BLOCK ((XXH3_SECRET_LENGTH - XXH3_STRIPE_LENGTH) / XXH3_SECRET_CONSUME_RATE)
+#define XXH3_SECRET_LIMIT (XXH3_SECRET_LENGTH - XXH3_STRIPE_LENGTH)
+#define XXH3_MIDSIZE_MAX 240
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+/* the default xxh3 secret, so that our sums match the reference implementation */
+static const guchar xxh3Secret[XXH3_SECRET_LENGTH] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+typedef struct _TGenXXH64State {
+    guint64 acc[4];
+    guchar buffer[32];
+    gsize bufferedLength;
+    guint64 totalLength;
+} TGenXXH64State;
+
+typedef struct _TGenXXH3State {
+    guint64 acc[8];
+    guchar buffer[XXH3_BUFFER_LENGTH];
+    gsize bufferedLength;
+    gsize numStripesInBlock;
+    guint64 totalLength;
+} TGenXXH3State;
+
+/* the fastest implementation of each kernel that this cpu supports */
+typedef struct _TGenChecksumKernels {
+    guint32 (*crc32c)(guint32 crc, const guchar* data, gsize length);
+    void (*xxh3Accumulate)(guint64* acc, const guchar* input, const guchar* secret, gsize numStripes);
+} TGenChecksumKernels;
+
+struct _TGenChecksum {
+    TGenChecksumType type;
+    const TGenChecksumKernels* kernels;
+
+    union {
+        GChecksum* md5;
+        guint32 crc32c;
+        TGenXXH64State xxh64;
+        TGenXXH3State xxh3;
+    } state;
+
+    /* the digest in big-endian byte order and as a hex string, valid once
+     * the checksum was closed */
+    guint8 digest[TGEN_CHECKSUM_MAX_DIGEST_LENGTH];
+    gsize digestLength;
+    gchar digestString[2*TGEN_CHECKSUM_MAX_DIGEST_LENGTH + 1];
+    gboolean isClosed;
+
+    guint magic;
+};
+
+static TGenChecksumKernels tgenChecksumKernels;
+static TGenChecksumKernels tgenChecksumPortableKernels;
+static guint32 crc32cTable[256];
+
+static inline guint64 _tgenchecksum_read64(const guchar* p) {
+    guint64 value;
+    memcpy(&value, p, sizeof(guint64));
+    return GUINT64_FROM_LE(value);
+}
+
+static inline guint32 _tgenchecksum_read32(const guchar* p) {
+    guint32 value;
+    memcpy(&value, p, sizeof(guint32));
+    return GUINT32_FROM_LE(value);
+}
+
+static inline guint64 _tgenchecksum_rotl64(guint64 x, gint r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64 _tgenchecksum_mul128Fold64(guint64 a, guint64 b) {
+    unsigned __int128 product = (unsigned __int128)a * (unsigned __int128)b;
+    return (guint64)product ^ (guint64)(product >> 64);
+}
+
+/*
+ * crc32c (castagnoli)
+ */
+
+static guint32 _tgenchecksum_crc32cSoftware(guint32 crc, const guchar* data, gsize length) {
+    for(gsize i = 0; i < length; i++) {
+        crc = crc32cTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef TGEN_CHECKSUM_HAVE_X86
+__attribute__((target("sse4.2")))
+static guint32 _tgenchecksum_crc32cSSE42(guint32 crc, const guchar* data, gsize length) {
+    guint64 crc64 = crc;
+    while(length >= sizeof(guint64)) {
+        guint64 word;
+        memcpy(&word, data, sizeof(guint64));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += sizeof(guint64);
+        length -= sizeof(guint64);
+    }
+
+    crc = (guint32)crc64;
+    while(length > 0) {
+        crc = _mm_crc32_u8(crc, *data);
+        data++;
+        length--;
+    }
+    return crc;
+}
+#endif
+
+/*
+ * xxh64
+ */
+
+static inline guint64 _tgenchecksum_xxh64Round(guint64 acc, guint64 input) {
+    acc += input * XXH_PRIME64_2;
+    acc = _tgenchecksum_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline guint64 _tgenchecksum_xxh64MergeRound(guint64 acc, guint64 value) {
+    acc ^= _tgenchecksum_xxh64Round(0, value);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline guint64 _tgenchecksum_xxh64Avalanche(guint64 h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static void _tgenchecksum_xxh64Init(TGenXXH64State* state) {
+    state->acc[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+    state->acc[1] = XXH_PRIME64_2;
+    state->acc[2] = 0;
+    state->acc[3] = -XXH_PRIME64_1;
+}
+
+static void _tgenchecksum_xxh64Consume(TGenXXH64State* state, const guchar* p) {
+    state->acc[0] = _tgenchecksum_xxh64Round(state->acc[0], _tgenchecksum_read64(p));
+    state->acc[1] = _tgenchecksum_xxh64Round(state->acc[1], _tgenchecksum_read64(p + 8));
+    state->acc[2] = _tgenchecksum_xxh64Round(state->acc[2], _tgenchecksum_read64(p + 16));
+    state->acc[3] = _tgenchecksum_xxh64Round(state->acc[3], _tgenchecksum_read64(p + 24));
+}
+
+static void _tgenchecksum_xxh64Update(TGenXXH64State* state, const guchar* data, gsize length) {
+    state->totalLength += length;
+
+    if(state->bufferedLength + length < sizeof(state->buffer)) {
+        memcpy(&state->buffer[state->bufferedLength], data, length);
+        state->bufferedLength += length;
+        return;
+    }
+
+    if(state->bufferedLength > 0) {
+        gsize fill = sizeof(state->buffer) - state->bufferedLength;
+        memcpy(&state->buffer[state->bufferedLength], data, fill);
+        _tgenchecksum_xxh64Consume(state, state->buffer);
+        data += fill;
+        length -= fill;
+        state->bufferedLength = 0;
+    }
+
+    while(length >= sizeof(state->buffer)) {
+        _tgenchecksum_xxh64Consume(state, data);
+        data += sizeof(state->buffer);
+        length -= sizeof(state->buffer);
+    }
+
+    memcpy(state->buffer, data, length);
+    state->bufferedLength = length;
+}
+
+static guint64 _tgenchecksum_xxh64Digest(TGenXXH64State* state) {
+    guint64 h;
+
+    if(state->totalLength >= sizeof(state->buffer)) {
+        h = _tgenchecksum_rotl64(state->acc[0], 1) + _tgenchecksum_rotl64(state->acc[1], 7) +
+                _tgenchecksum_rotl64(state->acc[2], 12) + _tgenchecksum_rotl64(state->acc[3], 18);
+        for(gint i = 0; i < 4; i++) {
+            h = _tgenchecksum_xxh64MergeRound(h, state->acc[i]);
+        }
+    } else {
+        h = state->acc[2] + XXH_PRIME64_5;
+    }
+
+    h += state->totalLength;
+
+    const guchar* p = state->buffer;
+    gsize length = state->bufferedLength;
+    while(length >= 8) {
+        h ^= _tgenchecksum_xxh64Round(0, _tgenchecksum_read64(p));
+        h = _tgenchecksum_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+        length -= 8;
+    }
+    if(length >= 4) {
+        h ^= (guint64)_tgenchecksum_read32(p) * XXH_PRIME64_1;
+        h = _tgenchecksum_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+        length -= 4;
+    }
+    while(length > 0) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = _tgenchecksum_rotl64(h, 11) * XXH_PRIME64_1;
+        p++;
+        length--;
+    }
+
+    return _tgenchecksum_xxh64Avalanche(h);
+}
+
+/*
+ * xxh3 (64 bit, default secret, no seed)
+ */
+
+static inline guint64 _tgenchecksum_xxh3Avalanche(guint64 h) {
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline guint64 _tgenchecksum_xxh3Rrmxmx(guint64 h, guint64 length) {
+    h ^= _tgenchecksum_rotl64(h, 49) ^ _tgenchecksum_rotl64(h, 24);
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + length;
+    h *= XXH_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static inline guint64 _tgenchecksum_xxh3Mix16(const guchar* input, const guchar* secret) {
+    return _tgenchecksum_mul128Fold64(_tgenchecksum_read64(input) ^ _tgenchecksum_read64(secret),
+            _tgenchecksum_read64(input + 8) ^ _tgenchecksum_read64(secret + 8));
+}
+
+/* the whole input is at most XXH3_MIDSIZE_MAX bytes */
+static guint64 _tgenchecksum_xxh3Short(const guchar* input, gsize length) {
+    const guchar* secret = xxh3Secret;
+
+    if(length == 0) {
+        return _tgenchecksum_xxh64Avalanche(_tgenchecksum_read64(secret + 56) ^ _tgenchecksum_read64(secret + 64));
+    } else if(length <= 3) {
+        guint32 combined = ((guint32)input[0] << 16) | ((guint32)input[length >> 1] << 24) |
+                (guint32)input[length - 1] | ((guint32)length << 8);
+        guint64 bitflip = (guint64)(_tgenchecksum_read32(secret) ^ _tgenchecksum_read32(secret + 4));
+        return _tgenchecksum_xxh64Avalanche((guint64)combined ^ bitflip);
+    } else if(length <= 8) {
+        guint64 bitflip = _tgenchecksum_read64(secret + 8) ^ _tgenchecksum_read64(secret + 16);
+        guint64 input64 = (guint64)_tgenchecksum_read32(input + length - 4) +
+                ((guint64)_tgenchecksum_read32(input) << 32);
+        return _tgenchecksum_xxh3Rrmxmx(input64 ^ bitflip, length);
+    } else if(length <= 16) {
+        guint64 low = _tgenchecksum_read64(input) ^
+                (_tgenchecksum_read64(secret + 24) ^ _tgenchecksum_read64(secret + 32));
+        guint64 high = _tgenchecksum_read64(input + length - 8) ^
+                (_tgenchecksum_read64(secret + 40) ^ _tgenchecksum_read64(secret + 48));
+        guint64 acc = length + GUINT64_SWAP_LE_BE(low) + high + _tgenchecksum_mul128Fold64(low, high);
+        return _tgenchecksum_xxh3Avalanche(acc);
+    } else if(length <= 128) {
+        guint64 acc = length * XXH_PRIME64_1;
+        if(length > 32) {
+            if(length > 64) {
+                if(length > 96) {
+                    acc += _tgenchecksum_xxh3Mix16(input + 48, secret + 96);
+                    acc += _tgenchecksum_xxh3Mix16(input + length - 64, secret + 112);
+                }
+                acc += _tgenchecksum_xxh3Mix16(input + 32, secret + 64);
+                acc += _tgenchecksum_xxh3Mix16(input + length - 48, secret + 80);
+            }
+            acc += _tgenchecksum_xxh3Mix16(input + 16, secret + 32);
+            acc += _tgenchecksum_xxh3Mix16(input + length - 32, secret + 48);
+        }
+        acc += _tgenchecksum_xxh3Mix16(input, secret);
+        acc += _tgenchecksum_xxh3Mix16(input + length - 16, secret + 16);
+        return _tgenchecksum_xxh3Avalanche(acc);
+    } else {
+        guint64 acc = length * XXH_PRIME64_1;
+        gsize numRounds = length / 16;
+        for(gsize i = 0; i < 8; i++) {
+            acc += _tgenchecksum_xxh3Mix16(input + (16 * i), secret + (16 * i));
+        }
+        acc = _tgenchecksum_xxh3Avalanche(acc);
+        for(gsize i = 8; i < numRounds; i++) {
+            acc += _tgenchecksum_xxh3Mix16(input + (16 * i), secret + (16 * (i - 8)) + 3);
+        }
+        acc += _tgenchecksum_xxh3Mix16(input + length - 16, secret + 136 - 17);
+        return _tgenchecksum_xxh3Avalanche(acc);
+    }
+}
+
+static void _tgenchecksum_xxh3AccumulateScalar(guint64* acc, const guchar* input,
+        const guchar* secret, gsize numStripes) {
+    for(gsize n = 0; n < numStripes; n++) {
+        const guchar* stripe = input + (n * XXH3_STRIPE_LENGTH);
+        const guchar* key = secret + (n * XXH3_SECRET_CONSUME_RATE);
+        for(gint i = 0; i < 8; i++) {
+            guint64 value = _tgenchecksum_read64(stripe + (8 * i));
+            guint64 keyed = value ^ _tgenchecksum_read64(key + (8 * i));
+            acc[i ^ 1] += value;
+            acc[i] += (guint64)(guint32)keyed * (keyed >> 32);
+        }
+    }
+}
+
+#ifdef TGEN_CHECKSUM_HAVE_X86
+__attribute__((target("avx2")))
+static inline __m256i _tgenchecksum_xxh3AccumulateLane(__m256i acc, const guchar* input, const guchar* key) {
+    __m256i value = _mm256_loadu_si256((const __m256i*)input);
+    __m256i keyed = _mm256_xor_si256(value, _mm256_loadu_si256((const __m256i*)key));
+    __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+    __m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_add_epi64(product, _mm256_add_epi64(acc, swapped));
+}
+
+__attribute__((target("avx2")))
+static void _tgenchecksum_xxh3AccumulateAVX2(guint64* acc, const guchar* input,
+        const guchar* secret, gsize numStripes) {
+    __m256i acc0 = _mm256_loadu_si256((const __m256i*)acc);
+    __m256i acc1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+
+    for(gsize n = 0; n < numStripes; n++) {
+        const guchar* stripe = input + (n * XXH3_STRIPE_LENGTH);
+        const guchar* key = secret + (n * XXH3_SECRET_CONSUME_RATE);
+        acc0 = _tgenchecksum_xxh3AccumulateLane(acc0, stripe, key);
+        acc1 = _tgenchecksum_xxh3AccumulateLane(acc1, stripe + 32, key + 32);
+    }
+
+    _mm256_storeu_si256((__m256i*)acc, acc0);
+    _mm256_storeu_si256((__m256i*)(acc + 4), acc1);
+}
+#endif
+
+static void _tgenchecksum_xxh3Scramble(guint64* acc, const guchar* secret) {
+    for(gint i = 0; i < 8; i++) {
+        guint64 value = acc[i];
+        value ^= value >> 47;
+        value ^= _tgenchecksum_read64(secret + (8 * i));
+        acc[i] = value * XXH_PRIME32_1;
+    }
+}
+
+static void _tgenchecksum_xxh3Init(TGenXXH3State* state) {
+    state->acc[0] = XXH_PRIME32_3;
+    state->acc[1] = XXH_PRIME64_1;
+    state->acc[2] = XXH_PRIME64_2;
+    state->acc[3] = XXH_PRIME64_3;
+    state->acc[4] = XXH_PRIME64_4;
+    state->acc[5] = XXH_PRIME32_2;
+    state->acc[6] = XXH_PRIME64_5;
+    state->acc[7] = XXH_PRIME32_1;
+}
+
+/* accumulates the stripes into the current block, scrambling when the block fills up */
+static void _tgenchecksum_xxh3ConsumeStripes(TGenChecksum* checksum, guint64* acc,
+        gsize* numStripesInBlock, const guchar* input, gsize numStripes) {
+    if(XXH3_STRIPES_PER_BLOCK - *numStripesInBlock <= numStripes) {
+        gsize toEndOfBlock = XXH3_STRIPES_PER_BLOCK - *numStripesInBlock;
+        gsize afterBlock = numStripes - toEndOfBlock;
+        checksum->kernels->xxh3Accumulate(acc, input,
+                xxh3Secret + (*numStripesInBlock * XXH3_SECRET_CONSUME_RATE), toEndOfBlock);
+        _tgenchecksum_xxh3Scramble(acc, xxh3Secret + XXH3_SECRET_LIMIT);
+        checksum->kernels->xxh3Accumulate(acc, input + (toEndOfBlock * XXH3_STRIPE_LENGTH),
+                xxh3Secret, afterBlock);
+        *numStripesInBlock = afterBlock;
+    } else {
+        checksum->kernels->xxh3Accumulate(acc, input,
+                xxh3Secret + (*numStripesInBlock * XXH3_SECRET_CONSUME_RATE), numStripes);
+        *numStripesInBlock += numStripes;
+    }
+}
+
+static void _tgenchecksum_xxh3Update(TGenChecksum* checksum, const guchar* data, gsize length) {
+    TGenXXH3State* state = &checksum->state.xxh3;
+    const gsize bufferStripes = XXH3_BUFFER_LENGTH / XXH3_STRIPE_LENGTH;
+    const guchar* end = data + length;
+
+    state->totalLength += length;
+
+    if(state->bufferedLength + length <= XXH3_BUFFER_LENGTH) {
+        memcpy(&state->buffer[state->bufferedLength], data, length);
+        state->bufferedLength += length;
+        return;
+    }
+
+    /* we keep the last bytes buffered, so the final stripe is always in the buffer */
+    if(state->bufferedLength > 0) {
+        gsize fill = XXH3_BUFFER_LENGTH - state->bufferedLength;
+        memcpy(&state->buffer[state->bufferedLength], data, fill);
+        data += fill;
+        _tgenchecksum_xxh3ConsumeStripes(checksum, state->acc, &state->numStripesInBlock,
+                state->buffer, bufferStripes);
+        state->bufferedLength = 0;
+    }
+
+    if(end - data > XXH3_BUFFER_LENGTH) {
+        const guchar* limit = end - XXH3_BUFFER_LENGTH;
+        do {
+            _tgenchecksum_xxh3ConsumeStripes(checksum, state->acc, &state->numStripesInBlock,
+                    data, bufferStripes);
+            data += XXH3_BUFFER_LENGTH;
+        } while(data < limit);
+
+        /* the digest may need the bytes before the buffered ones for the last stripe */
+        memcpy(&state->buffer[XXH3_BUFFER_LENGTH - XXH3_STRIPE_LENGTH],
+                data - XXH3_STRIPE_LENGTH, XXH3_STRIPE_LENGTH);
+    }
+
+    memcpy(state->buffer, data, (gsize)(end - data));
+    state->bufferedLength = (gsize)(end - data);
+}
+
+static guint64 _tgenchecksum_xxh3Digest(TGenChecksum* checksum) {
+    TGenXXH3State* state = &checksum->state.xxh3;
+
+    if(state->totalLength <= XXH3_MIDSIZE_MAX) {
+        return _tgenchecksum_xxh3Short(state->buffer, (gsize)state->totalLength);
+    }
+
+    guint64 acc[8];
+    memcpy(acc, state->acc, sizeof(acc));
+
+    guchar lastStripe[XXH3_STRIPE_LENGTH];
+    const guchar* lastStripePosition;
+
+    if(state->bufferedLength >= XXH3_STRIPE_LENGTH) {
+        gsize numStripes = (state->bufferedLength - 1) / XXH3_STRIPE_LENGTH;
+        gsize numStripesInBlock = state->numStripesInBlock;
+        _tgenchecksum_xxh3ConsumeStripes(checksum, acc, &numStripesInBlock, state->buffer, numStripes);
+        lastStripePosition = &state->buffer[state->bufferedLength - XXH3_STRIPE_LENGTH];
+    } else {
+        gsize catchup = XXH3_STRIPE_LENGTH - state->bufferedLength;
+        memcpy(lastStripe, &state->buffer[XXH3_BUFFER_LENGTH - catchup], catchup);
+        memcpy(&lastStripe[catchup], state->buffer, state->bufferedLength);
+        lastStripePosition = lastStripe;
+    }
+
+    checksum->kernels->xxh3Accumulate(acc, lastStripePosition, xxh3Secret + XXH3_SECRET_LIMIT - 7, 1);
+
+    guint64 result = state->totalLength * XXH_PRIME64_1;
+    for(gint i = 0; i < 4; i++) {
+        result += _tgenchecksum_mul128Fold64(acc[2 * i] ^ _tgenchecksum_read64(xxh3Secret + 11 + (16 * i)),
+                acc[(2 * i) + 1] ^ _tgenchecksum_read64(xxh3Secret + 11 + (16 * i) + 8));
+    }
+    return _tgenchecksum_xxh3Avalanche(result);
+}
+
+/*
+ * generic interface
+ */
+
+static void _tgenchecksum_initKernels(void) {
+    for(guint32 i = 0; i < 256; i++) {
+        guint32 crc = i;
+        for(gint bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78U : (crc >> 1);
+        }
+        crc32cTable[i] = crc;
+    }
+
+    tgenChecksumPortableKernels.crc32c = _tgenchecksum_crc32cSoftware;
+    tgenChecksumPortableKernels.xxh3Accumulate = _tgenchecksum_xxh3AccumulateScalar;
+    tgenChecksumKernels = tgenChecksumPortableKernels;
+
+#ifdef TGEN_CHECKSUM_HAVE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse4.2")) {
+        tgenChecksumKernels.crc32c = _tgenchecksum_crc32cSSE42;
+    }
+    if(__builtin_cpu_supports("avx2")) {
+        tgenChecksumKernels.xxh3Accumulate = _tgenchecksum_xxh3AccumulateAVX2;
+    }
+#endif
+
+    tgen_info("checksum kernels: crc32c=%s xxh3=%s",
+            tgenChecksumKernels.crc32c == _tgenchecksum_crc32cSoftware ? "table" : "sse4.2",
+            tgenChecksumKernels.xxh3Accumulate == _tgenchecksum_xxh3AccumulateScalar ? "scalar" : "avx2");
+}
+
+static const TGenChecksumKernels* _tgenchecksum_getKernels(gboolean isPortable) {
+    static gsize isInitialized = 0;
+    if(g_once_init_enter(&isInitialized)) {
+        _tgenchecksum_initKernels();
+        g_once_init_leave(&isInitialized, 1);
+    }
+    return isPortable ? &tgenChecksumPortableKernels : &tgenChecksumKernels;
+}
+
+static TGenChecksum* _tgenchecksum_new(TGenChecksumType type, gboolean isPortable) {
+    g_assert(type != TGEN_CHECKSUM_NONE);
+
+    TGenChecksum* checksum = g_new0(TGenChecksum, 1);
+    checksum->magic = TGEN_MAGIC;
+    checksum->type = type;
+    checksum->kernels = _tgenchecksum_getKernels(isPortable);
+
+    switch(type) {
+        case TGEN_CHECKSUM_MD5: {
+            checksum->state.md5 = g_checksum_new(G_CHECKSUM_MD5);
+            break;
+        }
+        case TGEN_CHECKSUM_CRC32C: {
+            checksum->state.crc32c = 0xFFFFFFFFU;
+            break;
+        }
+        case TGEN_CHECKSUM_XXH64: {
+            _tgenchecksum_xxh64Init(&checksum->state.xxh64);
+            break;
+        }
+        case TGEN_CHECKSUM_XXH3: {
+            _tgenchecksum_xxh3Init(&checksum->state.xxh3);
+            break;
+        }
+        default: {
+            g_assert_not_reached();
+            break;
+        }
+    }
+
+    return checksum;
+}
+
+TGenChecksum* tgenchecksum_new(TGenChecksumType type) {
+    return _tgenchecksum_new(type, FALSE);
+}
+
+/* like tgenchecksum_new, but uses the portable kernels even if the cpu supports
+ * faster ones, so that the tests can check both give the same sums */
+TGenChecksum* tgenchecksum_newPortable(TGenChecksumType type) {
+    return _tgenchecksum_new(type, TRUE);
+}
+
+void tgenchecksum_free(TGenChecksum* checksum) {
+    TGEN_ASSERT(checksum);
+
+    if(checksum->type == TGEN_CHECKSUM_MD5 && checksum->state.md5) {
+        g_checksum_free(checksum->state.md5);
+    }
+
+    checksum->magic = 0;
+    g_free(checksum);
+}
+
+void tgenchecksum_update(TGenChecksum* checksum, const guchar* data, gsize length) {
+    TGEN_ASSERT(checksum);
+    g_assert(!checksum->isClosed);
+
+    switch(checksum->type) {
+        case TGEN_CHECKSUM_MD5: {
+            g_checksum_update(checksum->state.md5, data, (gssize)length);
+            break;
+        }
+        case TGEN_CHECKSUM_CRC32C: {
+            checksum->state.crc32c = checksum->kernels->crc32c(checksum->state.crc32c, data, length);
+            break;
+        }
+        case TGEN_CHECKSUM_XXH64: {
+            _tgenchecksum_xxh64Update(&checksum->state.xxh64, data, length);
+            break;
+        }
+        case TGEN_CHECKSUM_XXH3: {
+            _tgenchecksum_xxh3Update(checksum, data, length);
+            break;
+        }
+        default: {
+            g_assert_not_reached();
+            break;
+        }
+    }
+}
+
+static void _tgenchecksum_storeDigest64(TGenChecksum* checksum, guint64 value) {
+    value = GUINT64_TO_BE(value);
+    memcpy(checksum->digest, &value, sizeof(guint64));
+    checksum->digestLength = sizeof(guint64);
+}
+
+static void _tgenchecksum_close(TGenChecksum* checksum) {
+    if(checksum->isClosed) {
+        return;
+    }
+    checksum->isClosed = TRUE;
+
+    switch(checksum->type) {
+        case TGEN_CHECKSUM_MD5: {
+            checksum->digestLength = sizeof(checksum->digest);
+            g_checksum_get_digest(checksum->state.md5, checksum->digest, &checksum->digestLength);
+            break;
+        }
+        case TGEN_CHECKSUM_CRC32C: {
+            guint32 value = GUINT32_TO_BE(checksum->state.crc32c ^ 0xFFFFFFFFU);
+            memcpy(checksum->digest, &value, sizeof(guint32));
+            checksum->digestLength = sizeof(guint32);
+            break;
+        }
+        case TGEN_CHECKSUM_XXH64: {
+            _tgenchecksum_storeDigest64(checksum, _tgenchecksum_xxh64Digest(&checksum->state.xxh64));
+            break;
+        }
+        case TGEN_CHECKSUM_XXH3: {
+            _tgenchecksum_storeDigest64(checksum, _tgenchecksum_xxh3Digest(checksum));
+            break;
+        }
+        default: {
+            g_assert_not_reached();
+            break;
+        }
+    }
+
+    tgenchecksum_digestToString(checksum->digest, checksum->digestLength,
+            checksum->digestString, sizeof(checksum->digestString));
+}
+
+/* closes the checksum and returns its lowercase hex digest. the checksum
+ * can not be updated after this, and the string belongs to the checksum. */
+const gchar* tgenchecksum_getString(TGenChecksum* checksum) {
+    TGEN_ASSERT(checksum);
+    _tgenchecksum_close(checksum);
+    return checksum->digestString;
+}
+
+/* closes the checksum like tgenchecksum_getString, but returns the digest bytes
+ * in big-endian order, so that their hex encoding is the digest string */
+const guint8* tgenchecksum_getDigest(TGenChecksum* checksum, gsize* lengthOut) {
+    TGEN_ASSERT(checksum);
+    _tgenchecksum_close(checksum);
+    if(lengthOut) {
+        *lengthOut = checksum->digestLength;
+    }
+    return checksum->digest;
+}
+
+/* writes the lowercase hex encoding of the digest bytes into the string buffer,
+ * truncating it if the buffer is too short */
+void tgenchecksum_digestToString(const guint8* digest, gsize length, gchar* buffer, gsize bufferLength) {
+    static const gchar hexDigits[] = "0123456789abcdef";
+    g_assert(buffer && bufferLength > 0);
+
+    gsize i = 0;
+    for(; i < length && 2*i + 2 < bufferLength; i++) {
+        buffer[2*i] = hexDigits[digest[i] >> 4];
+        buffer[2*i + 1] = hexDigits[digest[i] & 0x0F];
+    }
+    buffer[2*i] = '\0';
+}
+
+TGenChecksumType tgenchecksum_getType(TGenChecksum* checksum) {
+    TGEN_ASSERT(checksum);
+    return checksum->type;
+}
+
+gboolean tgenchecksum_typeFromString(const gchar* typeStr, TGenChecksumType* typeOut) {
+    g_assert(typeStr);
+
+    TGenChecksumType type;
+    if(!g_ascii_strcasecmp(typeStr, "none")) {
+        type = TGEN_CHECKSUM_NONE;
+    } else if(!g_ascii_strcasecmp(typeStr, "md5")) {
+        type = TGEN_CHECKSUM_MD5;
+    } else if(!g_ascii_strcasecmp(typeStr, "crc32c")) {
+        type = TGEN_CHECKSUM_CRC32C;
+    } else if(!g_ascii_strcasecmp(typeStr, "xxh64")) {
+        type = TGEN_CHECKSUM_XXH64;
+    } else if(!g_ascii_strcasecmp(typeStr, "xxh3")) {
+        type = TGEN_CHECKSUM_XXH3;
+    } else {
+        return FALSE;
+    }
+
+    if(typeOut) {
+        *typeOut = type;
+    }
+    return TRUE;
+}
+
+/* the name we use on the wire */
+const gchar* tgenchecksum_typeToString(TGenChecksumType type) {
+    switch(type) {
+        case TGEN_CHECKSUM_NONE: {
+            return "NONE";
+        }
+        case TGEN_CHECKSUM_MD5: {
+            return "MD5";
+        }
+        case TGEN_CHECKSUM_CRC32C: {
+            return "CRC32C";
+        }
+        case TGEN_CHECKSUM_XXH64: {
+            return "XXH64";
+        }
+        case TGEN_CHECKSUM_XXH3: {
+            return "XXH3";
+        }
+        default: {
+            return "UNKNOWN";
+        }
+    }
+}
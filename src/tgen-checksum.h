@@ -0,0 +1,38 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_CHECKSUM_H_
+#define TGEN_CHECKSUM_H_
+
+#include <glib.h>
+
+/* the longest digest of any checksum type, in bytes */
+#define TGEN_CHECKSUM_MAX_DIGEST_LENGTH 16
+
+/* the values are sent on the wire by the binary transfer protocol, so
+ * new types must be added at the end */
+typedef enum _TGenChecksumType {
+    TGEN_CHECKSUM_NONE,
+    TGEN_CHECKSUM_MD5,
+    TGEN_CHECKSUM_CRC32C,
+    TGEN_CHECKSUM_XXH64,
+    TGEN_CHECKSUM_XXH3,
+} TGenChecksumType;
+
+typedef struct _TGenChecksum TGenChecksum;
+
+TGenChecksum* tgenchecksum_new(TGenChecksumType type);
+TGenChecksum* tgenchecksum_newPortable(TGenChecksumType type);
+void tgenchecksum_free(TGenChecksum* checksum);
+
+void tgenchecksum_update(TGenChecksum* checksum, const guchar* data, gsize length);
+const gchar* tgenchecksum_getString(TGenChecksum* checksum);
+const guint8* tgenchecksum_getDigest(TGenChecksum* checksum, gsize* lengthOut);
+TGenChecksumType tgenchecksum_getType(TGenChecksum* checksum);
+
+gboolean tgenchecksum_typeFromString(const gchar* typeStr, TGenChecksumType* typeOut);
+const gchar* tgenchecksum_typeToString(TGenChecksumType type);
+void tgenchecksum_digestToString(const guint8* digest, gsize length, gchar* buffer, gsize bufferLength);
+
+#endif /* TGEN_CHECKSUM_H_ */
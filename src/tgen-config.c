@@ -9,6 +9,21 @@ gint tgenconfig_gethostname(gchar* name, size_t len) {
     }
 }
 
+/* our hostname does not change, so we look it up once and share the interned
+ * string. returns NULL if we could not get it. */
+const gchar* tgenconfig_getHostname() {
+    static gsize hostname = 0;
+    if(g_once_init_enter(&hostname)) {
+        gchar nameBuffer[256];
+        memset(nameBuffer, 0, 256);
+        const gchar* name = (0 == tgenconfig_gethostname(nameBuffer, 255)) ?
+                g_intern_string(nameBuffer) : NULL;
+        /* g_once needs a non-zero value */
+        g_once_init_leave(&hostname, name ? (gsize)name : (gsize)1);
+    }
+    return hostname == 1 ? NULL : (const gchar*)hostname;
+}
+
 gchar* tgenconfig_getIP() {
     return getenv("TGENIP");
 }
@@ -4,6 +4,7 @@
 #include <glib.h>
 
 gint tgenconfig_gethostname(gchar* name, size_t len);
+const gchar* tgenconfig_getHostname();
 gchar* tgenconfig_getIP();
 gchar* tgenconfig_getSOCKS();
 
@@ -3,6 +3,7 @@
  */
 
 #include <string.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <glib/gstdio.h>
 
@@ -10,6 +11,43 @@
 
 #define MAX_EVENTS_PER_IO_LOOP 100
 
+/* the counters reported in a heartbeat. when we run several worker drivers,
+ * each of them adds its counters here with atomic operations on its own
+ * heartbeat, and the main thread logs and resets them for the process. */
+struct _TGenDriverStats {
+    guint64 bytesRead;
+    guint64 bytesWritten;
+    guint64 transfersCompleted;
+    guint64 transferErrors;
+    guint64 totalTransfersCompleted;
+    guint64 totalTransferErrors;
+    gint64 numTimers;
+    guint64 timersExpired;
+    guint64 timerLatenessTotalMicros;
+    guint64 timerLatenessMaxMicros;
+    guint64 epollModsIssued;
+    guint64 epollModsAvoided;
+    guint64 ioSyscalls;
+    guint64 cpuMicros;
+    /* only in the shared stats. the workers add the latencies of their
+     * heartbeat period, and the main thread folds them into the totals. */
+    GMutex latencyLock;
+    TGenHistogram* latencyHistograms[TGEN_LATENCY_NUM_TYPES];
+    TGenHistogram* totalLatencyHistograms[TGEN_LATENCY_NUM_TYPES];
+    /* only in the shared stats. the workers add their progress when they
+     * reach an end action, so the end conditions hold for the whole process,
+     * and the first worker to meet one ends the client for all of them. */
+    guint64 endTransfersCompleted;
+    guint64 endBytes;
+    gboolean clientHasEnded;
+    gboolean serverHasEnded;
+    /* a walk through an acyclic graph is done once, by the first worker */
+    gboolean clientWalkClaimed;
+};
+
+/* each transfer has a unique id, even across worker drivers */
+static gsize globalTransferCounter = 0;
+
 struct _TGenDriver {
     /* our graphml dependency graph */
     TGenGraph* actionGraph;
@@ -27,8 +65,14 @@ struct _TGenDriver {
      * and notifies them of I/O events on the underlying transports */
     TGenIO* io;
 
-    /* each transfer has a unique id */
-    gsize globalTransferCounter;
+    /* if we are one of several workers, where we publish our heartbeat
+     * counters and our progress toward the end conditions */
+    TGenDriverStats* sharedStats;
+    gint64 publishedNumTimers;
+    guint64 publishedEndTransfersCompleted;
+    guint64 publishedEndBytes;
+    /* the cpu time our thread used up to the last heartbeat */
+    guint64 heartbeatCPUMicros;
 
     /* traffic statistics */
     guint64 heartbeatTransfersCompleted;
@@ -39,6 +83,10 @@ struct _TGenDriver {
     guint64 totalTransferErrors;
     gsize totalBytesRead;
     gsize totalBytesWritten;
+    /* the latencies of the transfers that finished since the last heartbeat,
+     * indexed by TGenTransferLatency, and of all of them if we log them ourselves */
+    TGenHistogram* latencyHistograms[TGEN_LATENCY_NUM_TYPES];
+    TGenHistogram* totalLatencyHistograms[TGEN_LATENCY_NUM_TYPES];
 
     gint refcount;
     guint magic;
@@ -50,10 +98,24 @@ static gboolean _tgendriver_onPauseTimerExpired(TGenDriver* driver, TGenAction*
 static gboolean _tgendriver_onGeneratorTimerExpired(TGenDriver* driver, TGenGenerator* generator);
 static void _tgendriver_continueNextActions(TGenDriver* driver, TGenAction* action);
 
+/* picks up an end that another worker reached */
+static gboolean _tgendriver_hasClientEnded(TGenDriver* driver) {
+    if(!driver->clientHasEnded && driver->sharedStats &&
+            __atomic_load_n(&driver->sharedStats->clientHasEnded, __ATOMIC_RELAXED)) {
+        driver->clientHasEnded = TRUE;
+        driver->serverHasEnded = __atomic_load_n(&driver->sharedStats->serverHasEnded, __ATOMIC_RELAXED);
+    }
+    return driver->clientHasEnded;
+}
+
 static gint64 _tgendriver_getCurrentTimeMillis() {
     return g_get_monotonic_time()/1000;
 }
 
+static gsize _tgendriver_getNextTransferCount() {
+    return __atomic_add_fetch(&globalTransferCounter, 1, __ATOMIC_RELAXED);
+}
+
 static void _tgendriver_onTransferComplete(TGenDriver* driver, TGenAction* action, gboolean wasSuccess) {
     TGEN_ASSERT(driver);
 
@@ -96,22 +158,179 @@ static void _tgendriver_onBytesTransferred(TGenDriver* driver, gsize bytesRead,
     driver->heartbeatBytesWritten += bytesWritten;
 }
 
+/* the cpu time used by the calling thread, so that each worker measures itself */
+static guint64 _tgendriver_getThreadCPUMicros() {
+    struct timespec ts;
+    memset(&ts, 0, sizeof(struct timespec));
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return ((guint64)ts.tv_sec * G_USEC_PER_SEC) + ((guint64)ts.tv_nsec / 1000);
+}
+
+static void _tgendriver_logHeartbeat(TGenDriverStats* stats) {
+    guint64 timerLatenessMean = stats->timersExpired > 0 ?
+            stats->timerLatenessTotalMicros / stats->timersExpired : 0;
+
+    /* the slabs are shared by all workers, so this covers the whole process. the
+     * bytes include the transports, peers, and schedule and getput blocks that
+     * the transfers hold, but not their i/o buffers. */
+    gsize liveTransfers = tgenslab_getNumLive(TGEN_SLAB_TRANSFER);
+    gsize bytesPerTransfer = liveTransfers > 0 ? tgenslab_getLiveBytes() / liveTransfers : 0;
+
+    tgen_message("[driver-heartbeat] bytes-read=%"G_GUINT64_FORMAT" bytes-written=%"G_GUINT64_FORMAT
+            " current-transfers-succeeded=%"G_GUINT64_FORMAT" current-transfers-failed=%"G_GUINT64_FORMAT
+            " total-transfers-succeeded=%"G_GUINT64_FORMAT" total-transfers-failed=%"G_GUINT64_FORMAT
+            " timers=%"G_GINT64_FORMAT" timers-expired=%"G_GUINT64_FORMAT
+            " timer-lateness-mean-usec=%"G_GUINT64_FORMAT" timer-lateness-max-usec=%"G_GUINT64_FORMAT
+            " epoll-mods-issued=%"G_GUINT64_FORMAT" epoll-mods-avoided=%"G_GUINT64_FORMAT
+            " io-syscalls=%"G_GUINT64_FORMAT" cpu-usec=%"G_GUINT64_FORMAT
+            " live-transfers=%"G_GSIZE_FORMAT" bytes-per-transfer=%"G_GSIZE_FORMAT
+            " slab-bytes-reserved=%"G_GSIZE_FORMAT" log-lines-dropped=%"G_GUINT64_FORMAT
+            " generator-queue-empty=%"G_GUINT64_FORMAT,
+            stats->bytesRead, stats->bytesWritten,
+            stats->transfersCompleted, stats->transferErrors,
+            stats->totalTransfersCompleted, stats->totalTransferErrors,
+            stats->numTimers, stats->timersExpired,
+            timerLatenessMean, stats->timerLatenessMaxMicros,
+            stats->epollModsIssued, stats->epollModsAvoided, stats->ioSyscalls,
+            stats->cpuMicros, liveTransfers, bytesPerTransfer, tgenslab_getReservedBytes(),
+            tgenlog_getNumDropped(), tgengenerator_getNumQueueEmpty());
+
+    tgeneventlog_writeHeartbeat(stats->bytesRead, stats->bytesWritten,
+            stats->transfersCompleted, stats->transferErrors);
+}
+
+static const gchar* _tgendriver_latencyToString(TGenTransferLatency latency) {
+    switch(latency) {
+        case TGEN_LATENCY_CONNECT:
+            return "connect";
+        case TGEN_LATENCY_PROXY_RESPONSE:
+            return "proxy-response";
+        case TGEN_LATENCY_FIRST_BYTE:
+            return "first-byte";
+        case TGEN_LATENCY_LAST_BYTE:
+            return "last-byte";
+        default:
+            return "unknown";
+    }
+}
+
+static void _tgendriver_logLatencies(const gchar* tag, TGenHistogram** histograms) {
+    if(!tgenlog_isLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+        return;
+    }
+
+    GString* buffer = g_string_new(NULL);
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        const gchar* name = _tgendriver_latencyToString(i);
+        TGenHistogram* histogram = histograms[i];
+        g_string_append_printf(buffer, "%s%s-count=%"G_GUINT64_FORMAT
+                " %s-usecs-p50=%"G_GUINT64_FORMAT" %s-usecs-p90=%"G_GUINT64_FORMAT
+                " %s-usecs-p99=%"G_GUINT64_FORMAT" %s-usecs-p99.9=%"G_GUINT64_FORMAT
+                " %s-usecs-max=%"G_GUINT64_FORMAT, i > 0 ? " " : "",
+                name, tgenhistogram_getCount(histogram),
+                name, tgenhistogram_getPercentile(histogram, 50.0f),
+                name, tgenhistogram_getPercentile(histogram, 90.0f),
+                name, tgenhistogram_getPercentile(histogram, 99.0f),
+                name, tgenhistogram_getPercentile(histogram, 99.9f),
+                name, tgenhistogram_getMax(histogram));
+    }
+
+    tgen_message("[%s] %s", tag, buffer->str);
+    g_string_free(buffer, TRUE);
+}
+
+/* adds the period's latencies to the totals, and starts a new period */
+static void _tgendriver_foldLatencies(TGenHistogram** histograms, TGenHistogram** totalHistograms) {
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        tgenhistogram_add(totalHistograms[i], histograms[i]);
+        tgenhistogram_reset(histograms[i]);
+    }
+}
+
+static void _tgendriver_publishLatencies(TGenDriver* driver) {
+    TGenDriverStats* shared = driver->sharedStats;
+
+    g_mutex_lock(&shared->latencyLock);
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        tgenhistogram_add(shared->latencyHistograms[i], driver->latencyHistograms[i]);
+    }
+    g_mutex_unlock(&shared->latencyLock);
+
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        tgenhistogram_reset(driver->latencyHistograms[i]);
+    }
+}
+
+static void _tgendriver_publishHeartbeat(TGenDriver* driver, TGenDriverStats* stats) {
+    TGenDriverStats* shared = driver->sharedStats;
+
+    __atomic_add_fetch(&shared->bytesRead, stats->bytesRead, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->bytesWritten, stats->bytesWritten, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->transfersCompleted, stats->transfersCompleted, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->transferErrors, stats->transferErrors, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->totalTransfersCompleted, stats->transfersCompleted, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->totalTransferErrors, stats->transferErrors, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->timersExpired, stats->timersExpired, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->timerLatenessTotalMicros, stats->timerLatenessTotalMicros, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->epollModsIssued, stats->epollModsIssued, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->epollModsAvoided, stats->epollModsAvoided, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->ioSyscalls, stats->ioSyscalls, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shared->cpuMicros, stats->cpuMicros, __ATOMIC_RELAXED);
+
+    /* the number of timers is a gauge, so we only publish how ours changed */
+    __atomic_add_fetch(&shared->numTimers, stats->numTimers - driver->publishedNumTimers, __ATOMIC_RELAXED);
+    driver->publishedNumTimers = stats->numTimers;
+
+    guint64 max = __atomic_load_n(&shared->timerLatenessMaxMicros, __ATOMIC_RELAXED);
+    while(stats->timerLatenessMaxMicros > max &&
+            !__atomic_compare_exchange_n(&shared->timerLatenessMaxMicros, &max,
+                    stats->timerLatenessMaxMicros, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
 static gboolean _tgendriver_onHeartbeat(TGenDriver* driver, gpointer nullData) {
     TGEN_ASSERT(driver);
 
-    tgen_message("[driver-heartbeat] bytes-read=%"G_GSIZE_FORMAT" bytes-written=%"G_GSIZE_FORMAT
-            " current-transfers-succeeded=%"G_GUINT64_FORMAT" current-transfers-failed=%"G_GUINT64_FORMAT
-            " total-transfers-succeeded=%"G_GUINT64_FORMAT" total-transfers-failed=%"G_GUINT64_FORMAT,
-            driver->heartbeatBytesRead, driver->heartbeatBytesWritten,
-            driver->heartbeatTransfersCompleted, driver->heartbeatTransferErrors,
-            driver->totalTransfersCompleted, driver->totalTransferErrors);
+    TGenDriverStats stats;
+    memset(&stats, 0, sizeof(TGenDriverStats));
+
+    stats.bytesRead = driver->heartbeatBytesRead;
+    stats.bytesWritten = driver->heartbeatBytesWritten;
+    stats.transfersCompleted = driver->heartbeatTransfersCompleted;
+    stats.transferErrors = driver->heartbeatTransferErrors;
+    stats.totalTransfersCompleted = driver->totalTransfersCompleted;
+    stats.totalTransferErrors = driver->totalTransferErrors;
+    stats.numTimers = (gint64)tgenio_getNumTimers(driver->io);
+
+    guint64 timerLatenessMean = 0;
+    tgenio_collectTimerLateness(driver->io, &stats.timersExpired, &timerLatenessMean,
+            &stats.timerLatenessMaxMicros);
+    stats.timerLatenessTotalMicros = timerLatenessMean * stats.timersExpired;
+    tgenio_collectEpollModCounts(driver->io, &stats.epollModsIssued, &stats.epollModsAvoided);
+    stats.ioSyscalls = tgenio_collectNumSyscalls(driver->io);
+
+    /* divide by bytes-written to compare the cost of sending a byte */
+    guint64 cpuMicros = _tgendriver_getThreadCPUMicros();
+    stats.cpuMicros = cpuMicros > driver->heartbeatCPUMicros ? cpuMicros - driver->heartbeatCPUMicros : 0;
+    driver->heartbeatCPUMicros = cpuMicros;
+
+    if(driver->sharedStats) {
+        _tgendriver_publishHeartbeat(driver, &stats);
+        _tgendriver_publishLatencies(driver);
+    } else {
+        _tgendriver_logHeartbeat(&stats);
+        _tgendriver_logLatencies("driver-latency-heartbeat", driver->latencyHistograms);
+        _tgendriver_foldLatencies(driver->latencyHistograms, driver->totalLatencyHistograms);
+    }
 
     driver->heartbeatTransfersCompleted = 0;
     driver->heartbeatTransferErrors = 0;
     driver->heartbeatBytesRead = 0;
     driver->heartbeatBytesWritten = 0;
 
-    tgenio_checkTimeouts(driver->io);
+    /* every event loop hands its event log records to the writer at its heartbeat */
+    tgeneventlog_flush();
 
     /* even if the client ended, we keep serving requests.
      * we are still running and the heartbeat timer still owns a driver ref.
@@ -123,7 +342,7 @@ static void _tgendriver_onNewPeer(TGenDriver* driver, gint socketD, gint64 start
     TGEN_ASSERT(driver);
 
     /* we have a new peer connecting to our listening socket */
-    if(driver->clientHasEnded) {
+    if(_tgendriver_hasClientEnded(driver)) {
         close(socketD);
         return;
     }
@@ -147,7 +366,7 @@ static void _tgendriver_onNewPeer(TGenDriver* driver, gint socketD, gint64 start
     guint64 defaultStallout = tgenaction_getDefaultStalloutMillis(driver->startAction);
 
     /* a new transfer will be coming in on this transport */
-    gsize count = ++(driver->globalTransferCounter);
+    gsize count = _tgendriver_getNextTransferCount();
     TGenTransfer* transfer = tgentransfer_new(NULL, count, TGEN_TYPE_NONE, 0, 0, 0,
             defaultTimeout, defaultStallout, NULL, NULL, driver->io, transport,
             (TGenTransfer_notifyCompleteFunc)_tgendriver_onTransferComplete, driver, NULL,
@@ -160,6 +379,13 @@ static void _tgendriver_onNewPeer(TGenDriver* driver, gint socketD, gint64 start
         return;
     }
 
+    tgentransfer_setIOBudget(transfer, tgenaction_getIOBudgetBytes(driver->startAction),
+            tgenaction_getIOBudgetSyscalls(driver->startAction));
+    tgentransfer_setPayloadContent(transfer, tgenaction_getPayloadContent(driver->startAction));
+    tgentransfer_setZeroCopy(transfer, tgenaction_getZeroCopy(driver->startAction));
+    tgentransfer_setStatusInterval(transfer, tgenaction_getStatusIntervalMillis(driver->startAction));
+    tgentransfer_setLatencyHistograms(transfer, driver->latencyHistograms);
+
     /* ref++ the driver for the transfer notify func */
     tgendriver_ref(driver);
 
@@ -167,7 +393,6 @@ static void _tgendriver_onNewPeer(TGenDriver* driver, gint socketD, gint64 start
      * will be held by the IO object */
     tgenio_register(driver->io, tgentransport_getDescriptor(transport),
             (TGenIO_notifyEventFunc)tgentransfer_onEvent,
-            (TGenIO_notifyCheckTimeoutFunc) tgentransfer_onCheckTimeout,
             transfer, (GDestroyNotify)tgentransfer_unref);
 
     /* release our transport pointer reference, the transfer should hold one */
@@ -198,7 +423,8 @@ static gboolean _tgendriver_createNewActiveTransfer(TGenDriver* driver,
         TGenTransferType type, TGenPeer* peer,
         guint64 size, guint64 ourSize, guint64 theirSize,
         guint64 timeout, guint64 stallout,
-        gchar* localSchedule, gchar* remoteSchedule,
+        TGenSchedule* localSchedule, TGenSchedule* remoteSchedule,
+        TGenChecksumType checksumType,
         gchar* socksUsername, gchar* socksPassword,
         const gchar* actionIDStr,
         TGenTransfer_notifyCompleteFunc onComplete,
@@ -229,7 +455,7 @@ static gboolean _tgendriver_createNewActiveTransfer(TGenDriver* driver,
     }
 
     /* get transfer counter id */
-    gsize count = ++(driver->globalTransferCounter);
+    gsize count = _tgendriver_getNextTransferCount();
 
     /* a new transfer will be coming in on this transport. the transfer
      * takes control of the transport pointer reference. */
@@ -253,11 +479,19 @@ static gboolean _tgendriver_createNewActiveTransfer(TGenDriver* driver,
         return FALSE;
     }
 
+    tgentransfer_setIOBudget(transfer, tgenaction_getIOBudgetBytes(driver->startAction),
+            tgenaction_getIOBudgetSyscalls(driver->startAction));
+    tgentransfer_setPayloadContent(transfer, tgenaction_getPayloadContent(driver->startAction));
+    tgentransfer_setZeroCopy(transfer, tgenaction_getZeroCopy(driver->startAction));
+    tgentransfer_setStatusInterval(transfer, tgenaction_getStatusIntervalMillis(driver->startAction));
+    tgentransfer_setLatencyHistograms(transfer, driver->latencyHistograms);
+    tgentransfer_setChecksumType(transfer, checksumType);
+    tgentransfer_setFraming(transfer, tgenaction_getFraming(driver->startAction));
+
     /* now let the IO handler manage the transfer. our transfer pointer reference
      * will be held by the IO object */
     tgenio_register(driver->io, tgentransport_getDescriptor(transport),
             (TGenIO_notifyEventFunc)tgentransfer_onEvent,
-            (TGenIO_notifyCheckTimeoutFunc) tgentransfer_onCheckTimeout,
             transfer, (GDestroyNotify)tgentransfer_unref);
 
     /* release our local transport pointer ref (from when we initialized the new transport)
@@ -280,8 +514,8 @@ static void _tgendriver_initiateTransfer(TGenDriver* driver, TGenAction* action)
     guint64 timeout = 0;
     guint64 stallout = 0;
 
-    gchar* localSchedule = NULL;
-    gchar* remoteSchedule = NULL;
+    TGenSchedule* localSchedule = NULL;
+    TGenSchedule* remoteSchedule = NULL;
 
     /* if timeout is 0, we fall back to the start action timeout in the
      * _tgendriver_createNewActiveTransfer function */
@@ -297,8 +531,8 @@ static void _tgendriver_initiateTransfer(TGenDriver* driver, TGenAction* action)
 
     gboolean isSuccess = _tgendriver_createNewActiveTransfer(driver, type, peer,
             size, ourSize, theirSize, timeout, stallout,
-            localSchedule, remoteSchedule, socksUsername, socksPassword,
-            actionIDStr,
+            localSchedule, remoteSchedule, tgenaction_getChecksumType(action),
+            socksUsername, socksPassword, actionIDStr,
             (TGenTransfer_notifyCompleteFunc)_tgendriver_onTransferComplete,
             driver, action,
             (GDestroyNotify)tgendriver_unref, (GDestroyNotify)tgenaction_unref);
@@ -335,10 +569,8 @@ static gboolean _tgendriver_setGeneratorDelayTimer(TGenDriver* driver, TGenGener
     tgendriver_ref(driver);
     tgengenerator_ref(generator);
 
-    /* let the IO module handle timer reads, transfer the timer pointer reference */
-    tgenio_register(driver->io, tgentimer_getDescriptor(generatorTimer),
-            (TGenIO_notifyEventFunc)tgentimer_onEvent, NULL, generatorTimer,
-            (GDestroyNotify)tgentimer_unref);
+    /* let the IO module handle timer expirations, transfer the timer pointer reference */
+    tgenio_registerTimer(driver->io, generatorTimer);
 
     return TRUE;
 }
@@ -348,14 +580,28 @@ static void _tgendriver_generateNextTransfer(TGenDriver* driver, TGenGenerator*
 
     TGenAction* action = tgengenerator_getModelAction(generator);
 
-    /* if these strings are non-null following this call, we own and must free them */
-    gchar* localSchedule = NULL;
-    gchar* remoteSchedule = NULL;
+    /* if these schedules are non-null following this call, we own and must unref them */
+    TGenSchedule* localSchedule = NULL;
+    TGenSchedule* remoteSchedule = NULL;
     guint64 delayTimeUSec = 0;
-    gboolean shouldCreateStream = tgengenerator_generateStream(generator,
+    TGenGeneratorStatus status = tgengenerator_takeStream(generator,
             &localSchedule, &remoteSchedule, &delayTimeUSec);
 
-    if(!shouldCreateStream) {
+    if(status == TGEN_GENERATOR_STREAM_PENDING) {
+        /* the background thread did not finish the next stream yet. we check
+         * again soon rather than run the models in the event loop. */
+        if(!_tgendriver_setGeneratorDelayTimer(driver, generator, TGEN_GENERATOR_RETRY_USEC)) {
+            tgen_warning("Failed to set generator retry timer. "
+                    "Stopping generator now and skipping to next action.");
+            if(tgengenerator_getNumOutstandingTransfers(generator) <= 0) {
+                _tgendriver_continueNextActions(driver, action);
+            }
+            tgengenerator_unref(generator);
+        }
+        return;
+    }
+
+    if(status == TGEN_GENERATOR_END) {
        /* the generator reached the end of the streams for this flow,
         * so the action is now complete. */
         tgen_info("Generator reached end state after generating %u streams and %u packets",
@@ -392,7 +638,7 @@ static void _tgendriver_generateNextTransfer(TGenDriver* driver, TGenGenerator*
      * when this transfer completes (we continue when the generator is done). */
     gboolean isSuccess = _tgendriver_createNewActiveTransfer(driver, TGEN_TYPE_SCHEDULE, peer,
             0, 0, 0, 0, 0,
-            localSchedule, remoteSchedule,
+            localSchedule, remoteSchedule, tgenaction_getChecksumType(action),
             socksUsername, socksPassword,
             actionIDStr,
             (TGenTransfer_notifyCompleteFunc)_tgendriver_onGeneratorTransferComplete,
@@ -429,10 +675,10 @@ static void _tgendriver_generateNextTransfer(TGenDriver* driver, TGenGenerator*
     tgen_info("successfully generated new transfer to peer %s", tgenpeer_toString(peer));
 
     if(localSchedule) {
-        g_free(localSchedule);
+        tgenschedule_unref(localSchedule);
     }
     if(remoteSchedule) {
-        g_free(remoteSchedule);
+        tgenschedule_unref(remoteSchedule);
     }
 }
 
@@ -480,10 +726,8 @@ static gboolean _tgendriver_initiatePause(TGenDriver* driver, TGenAction* action
     tgendriver_ref(driver);
     tgenaction_ref(action);
 
-    /* let the IO module handle timer reads, transfer the timer pointer reference */
-    tgenio_register(driver->io, tgentimer_getDescriptor(pauseTimer),
-            (TGenIO_notifyEventFunc)tgentimer_onEvent, NULL, pauseTimer,
-            (GDestroyNotify)tgentimer_unref);
+    /* let the IO module handle timer expirations, transfer the timer pointer reference */
+    tgenio_registerTimer(driver->io, pauseTimer);
 
     return TRUE;
 }
@@ -514,13 +758,28 @@ static void _tgendriver_checkEndConditions(TGenDriver* driver, TGenAction* actio
     guint64 count = tgenaction_getEndCount(action);
     guint64 time = tgenaction_getEndTimeMillis(action);
 
-    gsize totalBytes = driver->totalBytesRead + driver->totalBytesWritten;
+    guint64 totalBytes = driver->totalBytesRead + driver->totalBytesWritten;
+    guint64 totalTransfersCompleted = driver->totalTransfersCompleted;
+
+    /* the workers walk the action graph at the same time, so we compare the
+     * limits with the progress of the whole process */
+    TGenDriverStats* shared = driver->sharedStats;
+    if(shared) {
+        totalBytes = __atomic_add_fetch(&shared->endBytes,
+                totalBytes - driver->publishedEndBytes, __ATOMIC_RELAXED);
+        driver->publishedEndBytes = driver->totalBytesRead + driver->totalBytesWritten;
+
+        totalTransfersCompleted = __atomic_add_fetch(&shared->endTransfersCompleted,
+                totalTransfersCompleted - driver->publishedEndTransfersCompleted, __ATOMIC_RELAXED);
+        driver->publishedEndTransfersCompleted = driver->totalTransfersCompleted;
+    }
+
     gint64 nowMillis = _tgendriver_getCurrentTimeMillis();
     gint64 timeLimit = (driver->startTimeMicros/1000) + (gint64)time;
 
-    if(size > 0 && totalBytes >= (gsize)size) {
+    if(size > 0 && totalBytes >= size) {
         driver->clientHasEnded = TRUE;
-    } else if(count > 0 && driver->totalTransfersCompleted >= count) {
+    } else if(count > 0 && totalTransfersCompleted >= count) {
         driver->clientHasEnded = TRUE;
     } else if(time > 0) {
         if(nowMillis >= timeLimit) {
@@ -529,11 +788,18 @@ static void _tgendriver_checkEndConditions(TGenDriver* driver, TGenAction* actio
         }
     }
 
+    if(shared && driver->clientHasEnded) {
+        if(driver->serverHasEnded) {
+            __atomic_store_n(&shared->serverHasEnded, TRUE, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&shared->clientHasEnded, TRUE, __ATOMIC_RELAXED);
+    }
+
     tgen_debug("checked end conditions: hasEnded=%i "
             "bytes=%"G_GUINT64_FORMAT" limit=%"G_GUINT64_FORMAT" "
             "count=%"G_GUINT64_FORMAT" limit=%"G_GUINT64_FORMAT" "
             "time=%"G_GUINT64_FORMAT" limit=%"G_GUINT64_FORMAT,
-            driver->clientHasEnded, totalBytes, size, driver->totalTransfersCompleted, count,
+            driver->clientHasEnded, totalBytes, size, totalTransfersCompleted, count,
             nowMillis, timeLimit);
 }
 
@@ -573,7 +839,7 @@ static void _tgendriver_processAction(TGenDriver* driver, TGenAction* action) {
 static void _tgendriver_continueNextActions(TGenDriver* driver, TGenAction* action) {
     TGEN_ASSERT(driver);
 
-    if(driver->clientHasEnded) {
+    if(_tgendriver_hasClientEnded(driver)) {
         return;
     }
 
@@ -606,6 +872,32 @@ void tgendriver_activate(TGenDriver* driver) {
     tgen_debug("tgenio loop complete");
 }
 
+/* runs our event loop until the client ends. this blocks in the io module
+ * until descriptors are ready or the next timer expires, so it should not
+ * be mixed with tgendriver_activate on the epoll descriptor. */
+void tgendriver_run(TGenDriver* driver) {
+    TGEN_ASSERT(driver);
+
+    tgen_message("entering main loop to watch descriptors");
+
+    /* another worker may end the client while we wait, and we notice
+     * at the latest on our next heartbeat */
+    while(!_tgendriver_hasClientEnded(driver)) {
+        gint numEventsProcessed = tgenio_loopWait(driver->io, MAX_EVENTS_PER_IO_LOOP);
+        tgen_debug("processed %i events out of the max allowed of %i", numEventsProcessed, MAX_EVENTS_PER_IO_LOOP);
+    }
+
+    tgen_message("finished main loop, cleaning up");
+
+    /* the transfers since the last heartbeat count toward the summary */
+    if(driver->sharedStats) {
+        _tgendriver_publishLatencies(driver);
+    } else {
+        _tgendriver_foldLatencies(driver->latencyHistograms, driver->totalLatencyHistograms);
+        _tgendriver_logLatencies("driver-latency-summary", driver->totalLatencyHistograms);
+    }
+}
+
 static void _tgendriver_free(TGenDriver* driver) {
     TGEN_ASSERT(driver);
     g_assert(driver->refcount <= 0);
@@ -618,6 +910,10 @@ static void _tgendriver_free(TGenDriver* driver) {
     if(driver->actionGraph) {
         tgengraph_unref(driver->actionGraph);
     }
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        tgenhistogram_free(driver->latencyHistograms[i]);
+        tgenhistogram_free(driver->totalLatencyHistograms[i]);
+    }
 
     driver->magic = 0;
     g_free(driver);
@@ -662,7 +958,7 @@ static gboolean _tgendriver_startServerHelper(TGenDriver* driver) {
     /* create the server that will listen for incoming connections */
     in_port_t serverPort = (in_port_t)tgenaction_getServerPort(driver->startAction);
 
-    TGenServer* server = tgenserver_new(serverPort,
+    TGenServer* server = tgenserver_new(serverPort, driver->io,
             (TGenServer_notifyNewPeerFunc)_tgendriver_onNewPeer, driver,
             (GDestroyNotify)tgendriver_unref);
 
@@ -673,7 +969,7 @@ static gboolean _tgendriver_startServerHelper(TGenDriver* driver) {
         /* now let the IO handler manage the server. transfer our server pointer reference
          * because it will be stored as a param in the IO object */
         gint socketD = tgenserver_getDescriptor(server);
-        tgenio_register(driver->io, socketD, (TGenIO_notifyEventFunc)tgenserver_onEvent, NULL,
+        tgenio_register(driver->io, socketD, (TGenIO_notifyEventFunc)tgenserver_onEvent,
                 server, (GDestroyNotify) tgenserver_unref);
 
         tgen_info("started server using descriptor %i", socketD);
@@ -699,25 +995,30 @@ static gboolean _tgendriver_setStartClientTimerHelper(TGenDriver* driver) {
         /* ref++ the driver since the timer is now holding a reference */
         tgendriver_ref(driver);
 
-        /* let the IO module handle timer reads, transfer the timer pointer reference */
-        gint timerD = tgentimer_getDescriptor(startTimer);
-        tgenio_register(driver->io, timerD, (TGenIO_notifyEventFunc)tgentimer_onEvent, NULL,
-                startTimer, (GDestroyNotify)tgentimer_unref);
+        /* let the IO module handle timer expirations, transfer the timer pointer reference */
+        tgenio_registerTimer(driver->io, startTimer);
 
-        tgen_info("set startClient timer using descriptor %i", timerD);
+        tgen_info("set startClient timer for %"G_GUINT64_FORMAT" milliseconds", delayMillis);
         return TRUE;
     } else {
         return FALSE;
     }
 }
 
-static gboolean _tgendriver_setHeartbeatTimerHelper(TGenDriver* driver) {
+guint64 tgendriver_getHeartbeatPeriodMillis(TGenDriver* driver) {
     TGEN_ASSERT(driver);
 
     guint64 heartbeatPeriod = tgenaction_getHeartbeatPeriodMillis(driver->startAction);
     if(heartbeatPeriod == 0) {
         heartbeatPeriod = 1000;
     }
+    return heartbeatPeriod;
+}
+
+static gboolean _tgendriver_setHeartbeatTimerHelper(TGenDriver* driver) {
+    TGEN_ASSERT(driver);
+
+    guint64 heartbeatPeriod = tgendriver_getHeartbeatPeriodMillis(driver);
     guint64 microsecondsPause = heartbeatPeriod * 1000;
 
     /* start the heartbeat as a persistent timer event */
@@ -729,30 +1030,116 @@ static gboolean _tgendriver_setHeartbeatTimerHelper(TGenDriver* driver) {
         /* ref++ the driver since the timer is now holding a reference */
         tgendriver_ref(driver);
 
-        /* let the IO module handle timer reads, transfer the timer pointer reference */
-        gint timerD = tgentimer_getDescriptor(heartbeatTimer);
-        tgenio_register(driver->io, timerD, (TGenIO_notifyEventFunc)tgentimer_onEvent, NULL,
-                heartbeatTimer, (GDestroyNotify)tgentimer_unref);
+        /* let the IO module handle timer expirations, transfer the timer pointer reference */
+        tgenio_registerTimer(driver->io, heartbeatTimer);
 
-        tgen_info("set heartbeat timer using descriptor %i", timerD);
+        tgen_info("set heartbeat timer for %"G_GUINT64_FORMAT" milliseconds", heartbeatPeriod);
         return TRUE;
     } else {
         return FALSE;
     }
 }
 
-TGenDriver* tgendriver_new(TGenGraph* graph) {
+TGenDriverStats* tgendriver_newSharedStats() {
+    TGenDriverStats* stats = g_new0(TGenDriverStats, 1);
+    g_mutex_init(&stats->latencyLock);
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        stats->latencyHistograms[i] = tgenhistogram_new();
+        stats->totalLatencyHistograms[i] = tgenhistogram_new();
+    }
+    return stats;
+}
+
+void tgendriver_freeSharedStats(TGenDriverStats* stats) {
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        tgenhistogram_free(stats->latencyHistograms[i]);
+        tgenhistogram_free(stats->totalLatencyHistograms[i]);
+    }
+    g_mutex_clear(&stats->latencyLock);
+    g_free(stats);
+}
+
+/* ends the client and the server of every worker driver sharing the stats.
+ * each worker leaves tgendriver_run at the latest on its next heartbeat. */
+void tgendriver_endShared(TGenDriverStats* stats) {
+    __atomic_store_n(&stats->serverHasEnded, TRUE, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->clientHasEnded, TRUE, __ATOMIC_RELAXED);
+}
+
+/* logs the heartbeat counters that the worker drivers published since the
+ * last call, and resets them */
+void tgendriver_logSharedStats(TGenDriverStats* stats) {
+    TGenDriverStats snapshot;
+    memset(&snapshot, 0, sizeof(TGenDriverStats));
+
+    snapshot.bytesRead = __atomic_exchange_n(&stats->bytesRead, 0, __ATOMIC_RELAXED);
+    snapshot.bytesWritten = __atomic_exchange_n(&stats->bytesWritten, 0, __ATOMIC_RELAXED);
+    snapshot.transfersCompleted = __atomic_exchange_n(&stats->transfersCompleted, 0, __ATOMIC_RELAXED);
+    snapshot.transferErrors = __atomic_exchange_n(&stats->transferErrors, 0, __ATOMIC_RELAXED);
+    snapshot.totalTransfersCompleted = __atomic_load_n(&stats->totalTransfersCompleted, __ATOMIC_RELAXED);
+    snapshot.totalTransferErrors = __atomic_load_n(&stats->totalTransferErrors, __ATOMIC_RELAXED);
+    snapshot.numTimers = __atomic_load_n(&stats->numTimers, __ATOMIC_RELAXED);
+    snapshot.timersExpired = __atomic_exchange_n(&stats->timersExpired, 0, __ATOMIC_RELAXED);
+    snapshot.timerLatenessTotalMicros = __atomic_exchange_n(&stats->timerLatenessTotalMicros, 0, __ATOMIC_RELAXED);
+    snapshot.timerLatenessMaxMicros = __atomic_exchange_n(&stats->timerLatenessMaxMicros, 0, __ATOMIC_RELAXED);
+    snapshot.epollModsIssued = __atomic_exchange_n(&stats->epollModsIssued, 0, __ATOMIC_RELAXED);
+    snapshot.epollModsAvoided = __atomic_exchange_n(&stats->epollModsAvoided, 0, __ATOMIC_RELAXED);
+    snapshot.ioSyscalls = __atomic_exchange_n(&stats->ioSyscalls, 0, __ATOMIC_RELAXED);
+    snapshot.cpuMicros = __atomic_exchange_n(&stats->cpuMicros, 0, __ATOMIC_RELAXED);
+
+    _tgendriver_logHeartbeat(&snapshot);
+
+    g_mutex_lock(&stats->latencyLock);
+    _tgendriver_logLatencies("driver-latency-heartbeat", stats->latencyHistograms);
+    _tgendriver_foldLatencies(stats->latencyHistograms, stats->totalLatencyHistograms);
+    g_mutex_unlock(&stats->latencyLock);
+}
+
+/* logs the latencies of all transfers that the workers published, once they are done */
+void tgendriver_logSharedSummary(TGenDriverStats* stats) {
+    g_mutex_lock(&stats->latencyLock);
+    _tgendriver_foldLatencies(stats->latencyHistograms, stats->totalLatencyHistograms);
+    _tgendriver_logLatencies("driver-latency-summary", stats->totalLatencyHistograms);
+    g_mutex_unlock(&stats->latencyLock);
+}
+
+/* with more than one worker, the drivers publish their heartbeat counters to
+ * the shared stats instead of logging them, and check the end action
+ * conditions against the progress of all of the workers */
+TGenDriver* tgendriver_new(TGenGraph* graph, TGenDriverStats* sharedStats) {
     /* create the main driver object */
     TGenDriver* driver = g_new0(TGenDriver, 1);
     driver->magic = TGEN_MAGIC;
     driver->refcount = 1;
 
-    driver->io = tgenio_new();
+    driver->sharedStats = sharedStats;
+
+    for(gint i = 0; i < TGEN_LATENCY_NUM_TYPES; i++) {
+        driver->latencyHistograms[i] = tgenhistogram_new();
+        driver->totalLatencyHistograms[i] = tgenhistogram_new();
+    }
 
     tgengraph_ref(graph);
     driver->actionGraph = graph;
     driver->startAction = tgengraph_getStartAction(graph);
 
+    driver->io = tgenio_new(tgenaction_getIOBackend(driver->startAction));
+    if(!driver->io) {
+        tgendriver_unref(driver);
+        return NULL;
+    }
+    tgen_message("using the %s event loop backend",
+            tgenio_getBackend(driver->io) == TGEN_IO_BACKEND_URING ? "io_uring" : "epoll");
+
+    /* transfers with an io budget drain their sockets, so they do not need level-triggered events */
+    guint64 ioBudgetBytes = tgenaction_getIOBudgetBytes(driver->startAction);
+    guint64 ioBudgetSyscalls = tgenaction_getIOBudgetSyscalls(driver->startAction);
+    if(ioBudgetBytes > 0 || ioBudgetSyscalls > 0) {
+        tgenio_setEdgeTriggered(driver->io, TRUE);
+        tgen_message("using an io budget of %"G_GUINT64_FORMAT" bytes and %"G_GUINT64_FORMAT
+                " syscalls per event (0 means no limit)", ioBudgetBytes, ioBudgetSyscalls);
+    }
+
     /* start a heartbeat status message every second */
     if(!_tgendriver_setHeartbeatTimerHelper(driver)) {
         tgendriver_unref(driver);
@@ -785,7 +1172,7 @@ gint tgendriver_getEpollDescriptor(TGenDriver* driver) {
 
 gboolean tgendriver_hasEnded(TGenDriver* driver) {
     TGEN_ASSERT(driver);
-    return driver->clientHasEnded;
+    return _tgendriver_hasClientEnded(driver);
 }
 
 static gboolean _tgendriver_onStartClientTimerExpired(TGenDriver* driver, gpointer nullData) {
@@ -793,6 +1180,15 @@ static gboolean _tgendriver_onStartClientTimerExpired(TGenDriver* driver, gpoint
 
     driver->startTimeMicros = g_get_monotonic_time();
 
+    /* a walk through an acyclic graph ends after one pass, so more workers would
+     * only repeat it. a cyclic graph is walked by every worker at once, and the
+     * end actions stop all of them. */
+    if(driver->sharedStats && tgengraph_isAcyclic(driver->actionGraph) &&
+            __atomic_exchange_n(&driver->sharedStats->clientWalkClaimed, TRUE, __ATOMIC_RELAXED)) {
+        tgen_info("another worker walks the acyclic action graph, we only serve");
+        return TRUE;
+    }
+
     tgen_message("starting client using action graph '%s'",
             tgengraph_getGraphPath(driver->actionGraph));
     _tgendriver_continueNextActions(driver, driver->startAction);
@@ -10,13 +10,24 @@
 /* opaque struct containing trafficgenerator data */
 typedef struct _TGenDriver TGenDriver;
 
-TGenDriver* tgendriver_new(TGenGraph* graph);
+/* heartbeat counters aggregated across worker drivers */
+typedef struct _TGenDriverStats TGenDriverStats;
+
+TGenDriverStats* tgendriver_newSharedStats();
+void tgendriver_freeSharedStats(TGenDriverStats* stats);
+void tgendriver_logSharedStats(TGenDriverStats* stats);
+void tgendriver_logSharedSummary(TGenDriverStats* stats);
+void tgendriver_endShared(TGenDriverStats* stats);
+
+TGenDriver* tgendriver_new(TGenGraph* graph, TGenDriverStats* sharedStats);
 void tgendriver_ref(TGenDriver* driver);
 void tgendriver_unref(TGenDriver* driver);
 
 void tgendriver_activate(TGenDriver* driver);
+void tgendriver_run(TGenDriver* driver);
 
 gboolean tgendriver_hasEnded(TGenDriver* driver);
 gint tgendriver_getEpollDescriptor(TGenDriver* driver);
+guint64 tgendriver_getHeartbeatPeriodMillis(TGenDriver* driver);
 
 #endif /* TGEN_DRIVER_H_ */
@@ -0,0 +1,392 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#include <fcntl.h>
+
+#include "tgen.h"
+
+/* all numbers in the file are little-endian */
+#define TGEN_EVENTLOG_MAGIC "TGENEVTS"
+#define TGEN_EVENTLOG_VERSION 1
+
+/* every record starts with its type and its length, including this header */
+#define TGEN_EVENTLOG_RECORD_HEADER_LENGTH 4
+#define TGEN_EVENTLOG_NODE_LENGTH 20
+#define TGEN_EVENTLOG_TRANSFER_LENGTH 208
+#define TGEN_EVENTLOG_HEARTBEAT_LENGTH 48
+#define TGEN_EVENTLOG_STRING_MAX_LENGTH (G_MAXUINT16 - 8)
+
+/* each thread fills buffers of this size and hands them to the writer thread */
+#define TGEN_EVENTLOG_BUFFER_LENGTH 65536
+/* a thread forgets the strings it wrote once it holds this many, and writes
+ * them again under new ids, since remote names have no bound */
+#define TGEN_EVENTLOG_MAX_STRINGS 4096
+
+typedef enum _TGenEventLogRecordType {
+    TGEN_EVENTLOG_RECORD_STRING = 1,
+    TGEN_EVENTLOG_RECORD_NODE = 2,
+    TGEN_EVENTLOG_RECORD_TRANSFER = 3,
+    TGEN_EVENTLOG_RECORD_HEARTBEAT = 4,
+} TGenEventLogRecordType;
+
+typedef struct _TGenEventLogBuffer {
+    guint8 bytes[TGEN_EVENTLOG_BUFFER_LENGTH];
+    gsize length;
+} TGenEventLogBuffer;
+
+/* each thread writes records into its own buffer and keeps its own string
+ * table. the writer writes the buffers of a thread in the order the thread
+ * handed them over, so a string always comes before the records of the same
+ * thread that refer to it. */
+typedef struct _TGenEventLogThread TGenEventLogThread;
+struct _TGenEventLogThread {
+    /* only the owner takes it while we run, so it is only contended at exit */
+    GMutex lock;
+    TGenEventLogBuffer* buffer;
+    /* the id we gave each string we wrote, keyed by our copy of the string */
+    GHashTable* stringIDs;
+    TGenEventLogThread* next;
+};
+
+/* there is one event log for the process, and all workers write to it */
+typedef struct _TGenEventLog {
+    gint fd;
+    /* the writer thread pops the full buffers, and pushes them back empty */
+    GThread* writer;
+    GAsyncQueue* fullBuffers;
+    GAsyncQueue* emptyBuffers;
+    /* string ids are unique across threads */
+    guint32 nextStringID;
+    /* all the threads that ever wrote, so we can flush them at exit */
+    GMutex threadsLock;
+    TGenEventLogThread* threads;
+    /* set by the writer when it can not write anymore */
+    gboolean hadError;
+} TGenEventLog;
+
+static TGenEventLog* eventLog = NULL;
+static __thread TGenEventLogThread* eventLogThread = NULL;
+
+/* tells the writer thread to stop once it wrote the buffers queued before it */
+#define TGEN_EVENTLOG_STOP ((gpointer)&eventLog)
+
+static guint8* _tgeneventlog_put16(guint8* position, guint16 value) {
+    value = GUINT16_TO_LE(value);
+    memcpy(position, &value, sizeof(value));
+    return position + sizeof(value);
+}
+
+static guint8* _tgeneventlog_put32(guint8* position, guint32 value) {
+    value = GUINT32_TO_LE(value);
+    memcpy(position, &value, sizeof(value));
+    return position + sizeof(value);
+}
+
+static guint8* _tgeneventlog_put64(guint8* position, guint64 value) {
+    value = GUINT64_TO_LE(value);
+    memcpy(position, &value, sizeof(value));
+    return position + sizeof(value);
+}
+
+static guint8* _tgeneventlog_putHeader(guint8* position, TGenEventLogRecordType type, gsize length) {
+    position = _tgeneventlog_put16(position, (guint16)type);
+    return _tgeneventlog_put16(position, (guint16)length);
+}
+
+static gboolean _tgeneventlog_hadError(TGenEventLog* log) {
+    return __atomic_load_n(&log->hadError, __ATOMIC_ACQUIRE);
+}
+
+/* the only place we write to the file, so the event loops never wait for it */
+static gpointer _tgeneventlog_runWriter(gpointer logPointer) {
+    TGenEventLog* log = logPointer;
+
+    while(TRUE) {
+        gpointer item = g_async_queue_pop(log->fullBuffers);
+        if(item == TGEN_EVENTLOG_STOP) {
+            break;
+        }
+
+        TGenEventLogBuffer* buffer = item;
+        gsize offset = 0;
+        while(!_tgeneventlog_hadError(log) && offset < buffer->length) {
+            gssize written = write(log->fd, &buffer->bytes[offset], buffer->length - offset);
+            if(written < 0 && errno == EINTR) {
+                continue;
+            } else if(written <= 0) {
+                tgen_warning("write(): event log fd %i error %i: %s, we stop writing the event log",
+                        log->fd, errno, g_strerror(errno));
+                __atomic_store_n(&log->hadError, TRUE, __ATOMIC_RELEASE);
+            } else {
+                offset += (gsize)written;
+            }
+        }
+
+        buffer->length = 0;
+        g_async_queue_push(log->emptyBuffers, buffer);
+    }
+
+    return NULL;
+}
+
+/* must hold the thread lock. hands what the thread buffered to the writer. */
+static void _tgeneventlog_flush(TGenEventLog* log, TGenEventLogThread* thread) {
+    if(thread->buffer->length == 0) {
+        return;
+    }
+
+    g_async_queue_push(log->fullBuffers, thread->buffer);
+
+    thread->buffer = g_async_queue_try_pop(log->emptyBuffers);
+    if(!thread->buffer) {
+        thread->buffer = g_new(TGenEventLogBuffer, 1);
+        thread->buffer->length = 0;
+    }
+}
+
+/* must hold the thread lock. returns where to put the record. */
+static guint8* _tgeneventlog_reserve(TGenEventLog* log, TGenEventLogThread* thread, gsize length) {
+    g_assert(length <= TGEN_EVENTLOG_BUFFER_LENGTH);
+    if(thread->buffer->length + length > TGEN_EVENTLOG_BUFFER_LENGTH) {
+        _tgeneventlog_flush(log, thread);
+    }
+    guint8* position = &thread->buffer->bytes[thread->buffer->length];
+    thread->buffer->length += length;
+    return position;
+}
+
+/* returns the buffer and string table of the calling thread, locked */
+static TGenEventLogThread* _tgeneventlog_lockThread(TGenEventLog* log) {
+    if(!eventLogThread) {
+        TGenEventLogThread* thread = g_new0(TGenEventLogThread, 1);
+        g_mutex_init(&thread->lock);
+        thread->buffer = g_new(TGenEventLogBuffer, 1);
+        thread->buffer->length = 0;
+        thread->stringIDs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+        g_mutex_lock(&log->threadsLock);
+        thread->next = log->threads;
+        log->threads = thread;
+        g_mutex_unlock(&log->threadsLock);
+
+        eventLogThread = thread;
+    }
+
+    g_mutex_lock(&eventLogThread->lock);
+    return eventLogThread;
+}
+
+/* must hold the thread lock. the first time the thread sees a string, it
+ * writes it to the string table. returns 0 for NULL. */
+static guint32 _tgeneventlog_getStringID(TGenEventLog* log, TGenEventLogThread* thread,
+        const gchar* string) {
+    if(!string) {
+        return 0;
+    }
+
+    gpointer id = g_hash_table_lookup(thread->stringIDs, string);
+    if(id) {
+        return GPOINTER_TO_UINT(id);
+    }
+
+    if(g_hash_table_size(thread->stringIDs) >= TGEN_EVENTLOG_MAX_STRINGS) {
+        g_hash_table_remove_all(thread->stringIDs);
+    }
+
+    guint32 newID = __atomic_add_fetch(&log->nextStringID, 1, __ATOMIC_RELAXED);
+    g_hash_table_insert(thread->stringIDs, g_strdup(string), GUINT_TO_POINTER(newID));
+
+    gsize stringLength = MIN(strlen(string), TGEN_EVENTLOG_STRING_MAX_LENGTH);
+    gsize length = TGEN_EVENTLOG_RECORD_HEADER_LENGTH + 4 + stringLength;
+    guint8* position = _tgeneventlog_reserve(log, thread, length);
+    position = _tgeneventlog_putHeader(position, TGEN_EVENTLOG_RECORD_STRING, length);
+    position = _tgeneventlog_put32(position, newID);
+    memcpy(position, string, stringLength);
+
+    return newID;
+}
+
+static void _tgeneventlog_close() {
+    TGenEventLog* log = eventLog;
+    if(!log || !log->writer) {
+        return;
+    }
+
+    /* hand over what every thread still buffers, and wait until it is written */
+    g_mutex_lock(&log->threadsLock);
+    for(TGenEventLogThread* thread = log->threads; thread != NULL; thread = thread->next) {
+        g_mutex_lock(&thread->lock);
+        _tgeneventlog_flush(log, thread);
+        g_mutex_unlock(&thread->lock);
+    }
+    g_mutex_unlock(&log->threadsLock);
+
+    g_async_queue_push(log->fullBuffers, TGEN_EVENTLOG_STOP);
+    g_thread_join(log->writer);
+    log->writer = NULL;
+
+    close(log->fd);
+    log->fd = -1;
+    __atomic_store_n(&log->hadError, TRUE, __ATOMIC_RELEASE);
+}
+
+/* creates the event log file and writes the record for this node. we only
+ * open one event log per process, before the workers start. */
+gboolean tgeneventlog_open(const gchar* path) {
+    g_assert(path);
+    g_assert(!eventLog);
+
+    gint fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if(fd < 0) {
+        tgen_critical("open(): event log path '%s' error %i: %s", path, errno, g_strerror(errno));
+        return FALSE;
+    }
+
+    TGenEventLog* log = g_new0(TGenEventLog, 1);
+    log->fd = fd;
+    log->fullBuffers = g_async_queue_new();
+    log->emptyBuffers = g_async_queue_new();
+    g_mutex_init(&log->threadsLock);
+
+    GError* error = NULL;
+    log->writer = g_thread_try_new("tgen-eventlog", _tgeneventlog_runWriter, log, &error);
+    if(!log->writer) {
+        tgen_critical("failed to start the event log writer thread: %s", error->message);
+        g_error_free(error);
+        g_async_queue_unref(log->fullBuffers);
+        g_async_queue_unref(log->emptyBuffers);
+        g_mutex_clear(&log->threadsLock);
+        g_free(log);
+        close(fd);
+        return FALSE;
+    }
+
+    /* the header is the first thing any thread hands over, so it comes first */
+    TGenEventLogThread* thread = _tgeneventlog_lockThread(log);
+
+    guint8* position = _tgeneventlog_reserve(log, thread, 16);
+    memcpy(position, TGEN_EVENTLOG_MAGIC, 8);
+    position = _tgeneventlog_put32(position + 8, TGEN_EVENTLOG_VERSION);
+    _tgeneventlog_put32(position, 0);
+
+    guint32 hostnameID = _tgeneventlog_getStringID(log, thread, tgenconfig_getHostname());
+    position = _tgeneventlog_reserve(log, thread, TGEN_EVENTLOG_NODE_LENGTH);
+    position = _tgeneventlog_putHeader(position, TGEN_EVENTLOG_RECORD_NODE, TGEN_EVENTLOG_NODE_LENGTH);
+    position = _tgeneventlog_put32(position, hostnameID);
+    position = _tgeneventlog_put32(position, (guint32)getpid());
+    _tgeneventlog_put64(position, (guint64)g_get_real_time());
+
+    _tgeneventlog_flush(log, thread);
+    g_mutex_unlock(&thread->lock);
+
+    eventLog = log;
+    atexit(_tgeneventlog_close);
+
+    tgen_message("writing the binary event log to '%s'", path);
+    return TRUE;
+}
+
+gboolean tgeneventlog_isOpen() {
+    return eventLog ? TRUE : FALSE;
+}
+
+static guint8* _tgeneventlog_putEndpoint(guint8* position,
+        const TGenEventLogEndpoint* endpoint, guint32 nameID) {
+    position = _tgeneventlog_put32(position, nameID);
+    /* the address stays in network order, like in the socket */
+    memcpy(position, &endpoint->networkIP, 4);
+    position += 4;
+    position = _tgeneventlog_put16(position, ntohs(endpoint->networkPort));
+    return _tgeneventlog_put16(position, 0);
+}
+
+void tgeneventlog_writeTransfer(const TGenEventLogTransfer* transfer) {
+    TGenEventLog* log = eventLog;
+    if(!log || _tgeneventlog_hadError(log)) {
+        return;
+    }
+
+    gint64 now = g_get_real_time();
+    guint8 flags = (transfer->wasSuccess ? 0x01 : 0) | (transfer->isCommander ? 0x02 : 0);
+
+    TGenEventLogThread* thread = _tgeneventlog_lockThread(log);
+
+    /* the strings must come before the record that refers to them */
+    guint32 idID = _tgeneventlog_getStringID(log, thread, transfer->id);
+    guint32 hostnameID = _tgeneventlog_getStringID(log, thread, transfer->hostname);
+    guint32 remoteNameID = _tgeneventlog_getStringID(log, thread, transfer->remoteName);
+    guint32 localEndpointID = _tgeneventlog_getStringID(log, thread, transfer->local.name);
+    guint32 proxyEndpointID = _tgeneventlog_getStringID(log, thread, transfer->proxy.name);
+    guint32 remoteEndpointID = _tgeneventlog_getStringID(log, thread, transfer->remote.name);
+
+    guint8* position = _tgeneventlog_reserve(log, thread, TGEN_EVENTLOG_TRANSFER_LENGTH);
+    guint8* start = position;
+
+    position = _tgeneventlog_putHeader(position, TGEN_EVENTLOG_RECORD_TRANSFER,
+            TGEN_EVENTLOG_TRANSFER_LENGTH);
+    position = _tgeneventlog_put64(position, (guint64)now);
+    position = _tgeneventlog_put32(position, idID);
+    position = _tgeneventlog_put32(position, hostnameID);
+    position = _tgeneventlog_put32(position, remoteNameID);
+    *position++ = transfer->type;
+    *position++ = transfer->error;
+    *position++ = flags;
+    *position++ = 0;
+    position = _tgeneventlog_put64(position, transfer->count);
+    position = _tgeneventlog_put64(position, transfer->remoteCount);
+    position = _tgeneventlog_put64(position, transfer->size);
+    position = _tgeneventlog_put64(position, transfer->totalBytesRead);
+    position = _tgeneventlog_put64(position, transfer->totalBytesWritten);
+    position = _tgeneventlog_put64(position, transfer->payloadBytesRead);
+    position = _tgeneventlog_put64(position, transfer->payloadBytesWritten);
+    position = _tgeneventlog_putEndpoint(position, &transfer->local, localEndpointID);
+    position = _tgeneventlog_putEndpoint(position, &transfer->proxy, proxyEndpointID);
+    position = _tgeneventlog_putEndpoint(position, &transfer->remote, remoteEndpointID);
+    for(gint i = 0; i < TGEN_EVENTLOG_NUM_STEPS; i++) {
+        position = _tgeneventlog_put64(position, (guint64)transfer->stepMicros[i]);
+    }
+
+    g_assert(position - start == TGEN_EVENTLOG_TRANSFER_LENGTH);
+
+    g_mutex_unlock(&thread->lock);
+}
+
+/* the heartbeat counters for the whole process */
+void tgeneventlog_writeHeartbeat(guint64 bytesRead, guint64 bytesWritten,
+        guint64 transfersCompleted, guint64 transferErrors) {
+    TGenEventLog* log = eventLog;
+    if(!log || _tgeneventlog_hadError(log)) {
+        return;
+    }
+
+    gint64 now = g_get_real_time();
+
+    TGenEventLogThread* thread = _tgeneventlog_lockThread(log);
+
+    guint8* position = _tgeneventlog_reserve(log, thread, TGEN_EVENTLOG_HEARTBEAT_LENGTH);
+    position = _tgeneventlog_putHeader(position, TGEN_EVENTLOG_RECORD_HEARTBEAT,
+            TGEN_EVENTLOG_HEARTBEAT_LENGTH);
+    position = _tgeneventlog_put32(position, 0);
+    position = _tgeneventlog_put64(position, (guint64)now);
+    position = _tgeneventlog_put64(position, bytesRead);
+    position = _tgeneventlog_put64(position, bytesWritten);
+    position = _tgeneventlog_put64(position, transfersCompleted);
+    _tgeneventlog_put64(position, transferErrors);
+
+    g_mutex_unlock(&thread->lock);
+}
+
+/* hands what the calling thread buffered to the writer. every event loop
+ * calls this at its heartbeat, so the file is never more than a heartbeat
+ * behind. */
+void tgeneventlog_flush() {
+    TGenEventLog* log = eventLog;
+    if(!log || !eventLogThread) {
+        return;
+    }
+
+    TGenEventLogThread* thread = _tgeneventlog_lockThread(log);
+    _tgeneventlog_flush(log, thread);
+    g_mutex_unlock(&thread->lock);
+}
@@ -0,0 +1,68 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_EVENTLOG_H_
+#define TGEN_EVENTLOG_H_
+
+#include <glib.h>
+
+/* the binary event log holds fixed-size records about finished transfers and
+ * heartbeats, and a table of the strings they refer to. tgentools reads it
+ * instead of parsing the text log. see doc/TGen-EventLog.md for the format. */
+
+/* where a transfer was, relative to its start, when each step completed.
+ * steps that did not happen are -1. the order is the order of the text log. */
+typedef enum _TGenEventLogStep {
+    TGEN_EVENTLOG_STEP_SOCKET_CREATE,
+    TGEN_EVENTLOG_STEP_SOCKET_CONNECT,
+    TGEN_EVENTLOG_STEP_PROXY_INIT,
+    TGEN_EVENTLOG_STEP_PROXY_CHOICE,
+    TGEN_EVENTLOG_STEP_PROXY_REQUEST,
+    TGEN_EVENTLOG_STEP_PROXY_RESPONSE,
+    TGEN_EVENTLOG_STEP_COMMAND,
+    TGEN_EVENTLOG_STEP_RESPONSE,
+    TGEN_EVENTLOG_STEP_FIRST_BYTE,
+    TGEN_EVENTLOG_STEP_LAST_BYTE,
+    TGEN_EVENTLOG_STEP_CHECKSUM,
+    TGEN_EVENTLOG_NUM_STEPS,
+} TGenEventLogStep;
+
+/* one end of a transport. the name may be NULL. */
+typedef struct _TGenEventLogEndpoint {
+    const gchar* name;
+    in_addr_t networkIP;
+    in_port_t networkPort;
+} TGenEventLogEndpoint;
+
+typedef struct _TGenEventLogTransfer {
+    gboolean wasSuccess;
+    gboolean isCommander;
+    guint8 type;
+    guint8 error;
+    /* the log copies the names it needs, and any of them may be NULL */
+    const gchar* id;
+    const gchar* hostname;
+    const gchar* remoteName;
+    guint64 count;
+    guint64 remoteCount;
+    guint64 size;
+    guint64 totalBytesRead;
+    guint64 totalBytesWritten;
+    guint64 payloadBytesRead;
+    guint64 payloadBytesWritten;
+    TGenEventLogEndpoint local;
+    TGenEventLogEndpoint proxy;
+    TGenEventLogEndpoint remote;
+    gint64 stepMicros[TGEN_EVENTLOG_NUM_STEPS];
+} TGenEventLogTransfer;
+
+gboolean tgeneventlog_open(const gchar* path);
+gboolean tgeneventlog_isOpen();
+
+void tgeneventlog_writeTransfer(const TGenEventLogTransfer* transfer);
+void tgeneventlog_writeHeartbeat(guint64 bytesRead, guint64 bytesWritten,
+        guint64 transfersCompleted, guint64 transferErrors);
+void tgeneventlog_flush();
+
+#endif /* TGEN_EVENTLOG_H_ */
@@ -4,45 +4,135 @@
 
 #include "tgen.h"
 
-struct _TGenGenerator {
+/* each generator keeps up to this many streams generated ahead of time.
+ * must be a power of 2. */
+#define TGEN_GENERATOR_QUEUE_LENGTH 8
+/* a stream that the background thread generated. the schedules are owned by
+ * whoever holds the stream. */
+typedef struct _TGenGeneratedStream {
+    gboolean isEnd;
+    TGenSchedule* localSchedule;
+    TGenSchedule* remoteSchedule;
+    guint64 pauseTimeUSec;
+    guint numPackets;
+} TGenGeneratedStream;
+
+/* the part of a generator that the background thread runs. only the
+ * background thread uses the models and timers once the queue is registered,
+ * and only the event loop thread dequeues, so the queue needs no lock. */
+typedef struct _TGenGeneratorQueue TGenGeneratorQueue;
+struct _TGenGeneratorQueue {
+    /* held by the generator and by the background thread */
     gint refcount;
 
     TGenMarkovModel* streamModel;
     TGenMarkovModel* packetModel;
+
+    guint numStreamsGenerated;
+    guint numPacketsGenerated;
+    gboolean generatedEnd;
+
+    GTimer* cumulativeStreamTimer;
+    GTimer* cumulativePacketTimer;
+    GTimer* packetScheduleTimer;
+
+    /* a single producer, single consumer ring. head and tail only grow, and
+     * wrap into the streams with a mask. */
+    TGenGeneratedStream streams[TGEN_GENERATOR_QUEUE_LENGTH];
+    gsize head;
+    gsize tail;
+
+    /* set when the generator is freed, so the background thread drops us */
+    gboolean isCancelled;
+
+    guint magic;
+};
+
+struct _TGenGenerator {
+    gint refcount;
+
+    TGenGeneratorQueue* queue;
     TGenAction* modelAction;
 
     guint numStreamsGenerated;
     guint numPacketsGenerated;
     gboolean reachedEndState;
+    /* set while we wait for the background thread to generate our next stream */
+    gboolean wasStarved;
 
     guint numTransfersCreated;
     guint numTransfersCompleted;
 
-    GTimer* cumulativeStreamTimer;
-    GTimer* cumulativePacketTimer;
-    GTimer* packetScheduleTimer;
-
     guint magic;
 };
 
-static void _tgengenerator_free(TGenGenerator* gen) {
-    TGEN_ASSERT(gen);
-    g_assert(gen->refcount == 0);
+/* the queues that the background thread fills, for all workers */
+static GMutex generatorQueuesLock;
+static GPtrArray* generatorQueues = NULL;
+static GThread* generatorProducer = NULL;
+static gboolean generatorProducerStopping = FALSE;
+/* the background thread waits on the cond when it has nothing to generate,
+ * until a queue is registered, gets space, or is cancelled. */
+static GCond generatorProducerCond;
+static gboolean generatorProducerHasWork = FALSE;
+/* how often the event loops found that the next stream was not ready */
+static guint64 generatorNumQueueEmpty = 0;
+
+/* tells the background thread that it may have something to generate */
+static void _tgengenerator_wakeProducer() {
+    g_mutex_lock(&generatorQueuesLock);
+    generatorProducerHasWork = TRUE;
+    g_cond_signal(&generatorProducerCond);
+    g_mutex_unlock(&generatorQueuesLock);
+}
+
+static void _tgengenerator_unrefQueue(TGenGeneratorQueue* queue) {
+    TGEN_ASSERT(queue);
 
-    if(gen->streamModel) {
-        tgenmarkovmodel_unref(gen->streamModel);
+    if(!g_atomic_int_dec_and_test(&queue->refcount)) {
+        return;
     }
-    if(gen->packetModel) {
-        tgenmarkovmodel_unref(gen->packetModel);
+
+    /* free the streams that nobody took */
+    for(gsize position = queue->tail; position < queue->head; position++) {
+        TGenGeneratedStream* stream = &queue->streams[position & (TGEN_GENERATOR_QUEUE_LENGTH - 1)];
+        if(stream->localSchedule) {
+            tgenschedule_unref(stream->localSchedule);
+        }
+        if(stream->remoteSchedule) {
+            tgenschedule_unref(stream->remoteSchedule);
+        }
+    }
+
+    if(queue->streamModel) {
+        tgenmarkovmodel_unref(queue->streamModel);
+    }
+    if(queue->packetModel) {
+        tgenmarkovmodel_unref(queue->packetModel);
+    }
+    if(queue->cumulativeStreamTimer) {
+        g_timer_destroy(queue->cumulativeStreamTimer);
     }
-    if(gen->cumulativeStreamTimer) {
-        g_timer_destroy(gen->cumulativeStreamTimer);
+    if(queue->cumulativePacketTimer) {
+        g_timer_destroy(queue->cumulativePacketTimer);
     }
-    if(gen->cumulativePacketTimer) {
-        g_timer_destroy(gen->cumulativePacketTimer);
+    if(queue->packetScheduleTimer) {
+        g_timer_destroy(queue->packetScheduleTimer);
     }
-    if(gen->packetScheduleTimer) {
-        g_timer_destroy(gen->packetScheduleTimer);
+
+    queue->magic = 0;
+    g_free(queue);
+}
+
+static void _tgengenerator_free(TGenGenerator* gen) {
+    TGEN_ASSERT(gen);
+    g_assert(gen->refcount == 0);
+
+    if(gen->queue) {
+        /* the background thread may still hold it, so it frees it later */
+        __atomic_store_n(&gen->queue->isCancelled, TRUE, __ATOMIC_RELEASE);
+        _tgengenerator_unrefQueue(gen->queue);
+        _tgengenerator_wakeProducer();
     }
 
     gen->magic = 0;
@@ -61,52 +151,6 @@ void tgengenerator_unref(TGenGenerator* gen) {
     }
 }
 
-TGenGenerator* tgengenerator_new(const gchar* streamModelPath, const gchar* packetModelPath,
-        TGenAction* modelAction) {
-
-    guint32 seed = g_random_int();
-
-    gchar* name = g_path_get_basename(streamModelPath);
-    TGenMarkovModel* streamModel = tgenmarkovmodel_newFromPath(name, seed, streamModelPath);
-    g_free(name);
-
-    if(!streamModel) {
-        tgen_warning("failed to parse stream markov model");
-        return NULL;
-    }
-
-    name = g_path_get_basename(packetModelPath);
-    TGenMarkovModel* packetModel = tgenmarkovmodel_newFromPath(name, seed, packetModelPath);
-    g_free(name);
-
-    if(!packetModel) {
-        tgen_warning("failed to parse packet markov model");
-        tgenmarkovmodel_unref(streamModel);
-        return NULL;
-    }
-
-    TGenGenerator* gen = g_new0(TGenGenerator, 1);
-    gen->magic = TGEN_MAGIC;
-
-    gen->streamModel = streamModel;
-    gen->packetModel = packetModel;
-    gen->modelAction = modelAction;
-
-    /* these timers store cumulative times */
-    gen->cumulativeStreamTimer = g_timer_new();
-    g_timer_stop(gen->cumulativeStreamTimer);
-    gen->cumulativePacketTimer = g_timer_new();
-    g_timer_stop(gen->cumulativePacketTimer);
-
-    /* this one is reset every time it's used */
-    gen->packetScheduleTimer = g_timer_new();
-    g_timer_stop(gen->packetScheduleTimer);
-
-    gen->refcount = 1;
-
-    return gen;
-}
-
 TGenAction* tgengenerator_getModelAction(TGenGenerator* gen) {
     TGEN_ASSERT(gen);
     return gen->modelAction;
@@ -142,11 +186,11 @@ guint tgengenerator_getNumPacketsGenerated(TGenGenerator* gen) {
     return gen->numPacketsGenerated;
 }
 
-static void _tgengenerator_generatePacketSchedules(TGenGenerator* gen,
-        GString* serverBuffer, GString* originBuffer) {
-    TGEN_ASSERT(gen);
-    g_assert(serverBuffer);
-    g_assert(originBuffer);
+static guint _tgengenerator_generatePacketSchedules(TGenGeneratorQueue* queue,
+        TGenSchedule* serverSchedule, TGenSchedule* originSchedule) {
+    TGEN_ASSERT(queue);
+    g_assert(serverSchedule);
+    g_assert(originSchedule);
 
     gint32 nextServerPacketDelay = 0;
     gint32 nextOriginpacketDelay = 0;
@@ -155,18 +199,18 @@ static void _tgengenerator_generatePacketSchedules(TGenGenerator* gen,
     guint numOriginPackets = 0;
 
     /* make sure the packet model is ready to generate more */
-    tgenmarkovmodel_reset(gen->packetModel);
+    tgenmarkovmodel_reset(queue->packetModel);
 
     /* track how long it takes to generate packet schedules.
      * the schedule timer is started to reset the clock,
      * but the cumulative timer is continued to increment it. */
-    g_timer_start(gen->packetScheduleTimer);
-    g_timer_continue(gen->cumulativePacketTimer);
+    g_timer_start(queue->packetScheduleTimer);
+    g_timer_continue(queue->cumulativePacketTimer);
 
     while(TRUE) {
         tgen_debug("Generating next packet observation");
         guint64 packetDelay = 0;
-        Observation obs = tgenmarkovmodel_getNextObservation(gen->packetModel, &packetDelay);
+        Observation obs = tgenmarkovmodel_getNextObservation(queue->packetModel, &packetDelay);
 
         /* keep track of cumulative delay for each packet. we need this because
          * we are actually computing independent delays for the server and the origin.
@@ -194,23 +238,21 @@ static void _tgengenerator_generatePacketSchedules(TGenGenerator* gen,
 
             /* packet to origin means the server sent it.
              * so add a packet to the server schedule. */
-            g_string_append_printf(serverBuffer, "%s%"G_GINT32_FORMAT,
-                    serverBuffer->len > 0 ? "," : "", nextServerPacketDelay);
+            tgenschedule_append(serverSchedule, nextServerPacketDelay);
 
             nextServerPacketDelay = 0;
             numServerPackets++;
-            gen->numPacketsGenerated++;
+            queue->numPacketsGenerated++;
         } else if(obs == OBSERVATION_PACKET_TO_SERVER) {
             tgen_debug("Found packet to server observation with packet delay %"G_GUINT64_FORMAT, packetDelay);
 
             /* packet to server means the origin sent it.
              * so add a packet to the origin schedule. */
-            g_string_append_printf(originBuffer, "%s%"G_GINT32_FORMAT,
-                    originBuffer->len > 0 ? "," : "", nextOriginpacketDelay);
+            tgenschedule_append(originSchedule, nextOriginpacketDelay);
 
             nextOriginpacketDelay = 0;
             numOriginPackets++;
-            gen->numPacketsGenerated++;
+            queue->numPacketsGenerated++;
         } else {
             /* we observed an end state, so the packet stream is done. */
             tgen_debug("Found packet end observation");
@@ -218,94 +260,319 @@ static void _tgengenerator_generatePacketSchedules(TGenGenerator* gen,
         }
     }
 
-    g_timer_stop(gen->cumulativePacketTimer);
-    g_timer_stop(gen->packetScheduleTimer);
-    gdouble scheduleTime = g_timer_elapsed(gen->packetScheduleTimer, NULL);
-
-    tgen_info("Generated origin packet schedule of size %"G_GSIZE_FORMAT" "
-            "with %u packets (%u bytes) "
-            "and server packet schedule of size %"G_GSIZE_FORMAT" "
-            "with %u packets (%u bytes) in %f seconds",
-            originBuffer->len, numOriginPackets,
-            numOriginPackets * TGEN_MMODEL_PACKET_DATA_SIZE,
-            serverBuffer->len, numServerPackets,
-            numServerPackets * TGEN_MMODEL_PACKET_DATA_SIZE,
+    g_timer_stop(queue->cumulativePacketTimer);
+    g_timer_stop(queue->packetScheduleTimer);
+    gdouble scheduleTime = g_timer_elapsed(queue->packetScheduleTimer, NULL);
+
+    tgen_info("Generated origin packet schedule with %u packets (%"G_GSIZE_FORMAT" bytes) "
+            "and server packet schedule with %u packets (%"G_GSIZE_FORMAT" bytes) "
+            "in %f seconds",
+            numOriginPackets, tgenschedule_getTotalBytes(originSchedule),
+            numServerPackets, tgenschedule_getTotalBytes(serverSchedule),
             scheduleTime);
+
+    return numServerPackets + numOriginPackets;
 }
 
-/**
- * Compute the packet schedules for the next stream using the configured
+/* compute the packet schedules for the next stream using the configured
  * markov models, and the pause time that we should wait after this stream
- * is created until we generate the next stream (in microseconds).
- *
- * Following a call to this function, and non-null strings returned to the
- * caller in localSchedule or remoteSchedule are owned and must be free'd
- * by the caller.
- *
- * returns TRUE if another stream should be created. In this case the output
- *         variables will be set appropriately.
- * returns FALSE if we have reached the end of the stream flow for this
- *         iteration of the model. The generator can be unref'd and free'd.
- */
-gboolean tgengenerator_generateStream(TGenGenerator* gen,
-        gchar** localSchedule, gchar** remoteSchedule, guint64* pauseTimeUSec) {
-    TGEN_ASSERT(gen);
-
-    if(gen->reachedEndState) {
-        return FALSE;
-    }
+ * is created until we generate the next stream (in microseconds). we run in
+ * the background thread. */
+static void _tgengenerator_generateStream(TGenGeneratorQueue* queue, TGenGeneratedStream* stream) {
+    TGEN_ASSERT(queue);
 
     tgen_debug("Generating next stream observation");
     guint64 streamDelay = 0;
 
     /* track how long it takes to generate a stream observation. */
-    g_timer_continue(gen->cumulativeStreamTimer);
+    g_timer_continue(queue->cumulativeStreamTimer);
 
-    Observation obs = tgenmarkovmodel_getNextObservation(gen->streamModel, &streamDelay);
+    Observation obs = tgenmarkovmodel_getNextObservation(queue->streamModel, &streamDelay);
 
-    g_timer_stop(gen->cumulativeStreamTimer);
+    g_timer_stop(queue->cumulativeStreamTimer);
 
     if(obs == OBSERVATION_STREAM) {
         tgen_debug("Found stream observation with a generated stream delay of "
                 "%"G_GUINT64_FORMAT" microseconds", streamDelay);
 
         /* we should create a new stream now, and then wait streamDelay before
-         * creating the next one. We need packet schedules for the stream.
-         * start the buffers with 10k to avoid too many reallocs.
-         * This is good for 10k bytes, which in the worst case can
-         * encode about 900 packet delays (which represents a transfer
-         * of about 900*1434 = ~1.3 MB. This should usually be more than enough.  */
-        GString* serverBuffer = g_string_sized_new(10000);
-        GString* originBuffer = g_string_sized_new(10000);
-        _tgengenerator_generatePacketSchedules(gen, serverBuffer, originBuffer);
-
-        if(localSchedule) {
-            *localSchedule = g_string_free(originBuffer, FALSE);
-        } else {
-            g_string_free(originBuffer, TRUE);
+         * creating the next one. We need packet schedules for the stream,
+         * which we hand to the transfer as they are, without formatting them
+         * as text. */
+        TGenSchedule* serverSchedule = tgenschedule_new();
+        TGenSchedule* originSchedule = tgenschedule_new();
+        stream->numPackets = _tgengenerator_generatePacketSchedules(queue, serverSchedule, originSchedule);
+
+        stream->isEnd = FALSE;
+        stream->localSchedule = originSchedule;
+        stream->remoteSchedule = serverSchedule;
+        stream->pauseTimeUSec = streamDelay;
+
+        queue->numStreamsGenerated++;
+    } else {
+        tgen_message("Found stream end observation. Total time spent generating %u streams "
+                "was %f seconds and total time spent generating %u packets was %f seconds.",
+                queue->numStreamsGenerated, g_timer_elapsed(queue->cumulativeStreamTimer, NULL),
+                queue->numPacketsGenerated, g_timer_elapsed(queue->cumulativePacketTimer, NULL));
+
+        /* we got to the end, we should not create a transfer */
+        stream->isEnd = TRUE;
+        stream->localSchedule = NULL;
+        stream->remoteSchedule = NULL;
+        stream->pauseTimeUSec = 0;
+        stream->numPackets = 0;
+
+        queue->generatedEnd = TRUE;
+    }
+}
+
+/* generates the next stream into the queue if there is space.
+ * returns TRUE if we generated one. */
+static gboolean _tgengenerator_fillQueue(TGenGeneratorQueue* queue) {
+    TGEN_ASSERT(queue);
+
+    if(queue->generatedEnd || __atomic_load_n(&queue->isCancelled, __ATOMIC_ACQUIRE)) {
+        return FALSE;
+    }
+
+    gsize head = queue->head;
+    if(head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) >= TGEN_GENERATOR_QUEUE_LENGTH) {
+        return FALSE;
+    }
+
+    _tgengenerator_generateStream(queue, &queue->streams[head & (TGEN_GENERATOR_QUEUE_LENGTH - 1)]);
+
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+static gpointer _tgengenerator_runProducer(gpointer unused) {
+    GPtrArray* snapshot = g_ptr_array_new();
+
+    while(!__atomic_load_n(&generatorProducerStopping, __ATOMIC_ACQUIRE)) {
+        /* we generate without the lock, so the event loops can register new
+         * generators while we work */
+        g_mutex_lock(&generatorQueuesLock);
+        generatorProducerHasWork = FALSE;
+        for(guint i = 0; i < generatorQueues->len; i++) {
+            g_ptr_array_add(snapshot, g_ptr_array_index(generatorQueues, i));
         }
+        g_mutex_unlock(&generatorQueuesLock);
 
-        if(remoteSchedule) {
-            *remoteSchedule = g_string_free(serverBuffer, FALSE);
-        } else {
-            g_string_free(serverBuffer, TRUE);
+        /* one stream per queue per round, so a long model does not hold up the others */
+        gboolean didGenerate = FALSE;
+        for(guint i = 0; i < snapshot->len; i++) {
+            TGenGeneratorQueue* queue = g_ptr_array_index(snapshot, i);
+
+            if(_tgengenerator_fillQueue(queue)) {
+                didGenerate = TRUE;
+            }
+
+            /* we are done with queues that ended or whose generator is gone */
+            if(queue->generatedEnd || __atomic_load_n(&queue->isCancelled, __ATOMIC_ACQUIRE)) {
+                g_mutex_lock(&generatorQueuesLock);
+                g_ptr_array_remove_fast(generatorQueues, queue);
+                g_mutex_unlock(&generatorQueuesLock);
+                _tgengenerator_unrefQueue(queue);
+            }
+        }
+        g_ptr_array_set_size(snapshot, 0);
+
+        if(!didGenerate) {
+            /* every queue is full or done. anything that changes that since
+             * we took the snapshot sets the flag, so we can not miss it. */
+            g_mutex_lock(&generatorQueuesLock);
+            while(!generatorProducerHasWork &&
+                    !__atomic_load_n(&generatorProducerStopping, __ATOMIC_ACQUIRE)) {
+                g_cond_wait(&generatorProducerCond, &generatorQueuesLock);
+            }
+            g_mutex_unlock(&generatorQueuesLock);
         }
+    }
 
-        if(pauseTimeUSec) {
-            *pauseTimeUSec = streamDelay;
+    g_ptr_array_free(snapshot, TRUE);
+    return NULL;
+}
+
+/* runs at exit, so the background thread does not use the models while they go away */
+static void _tgengenerator_stopProducer() {
+    if(generatorProducer) {
+        __atomic_store_n(&generatorProducerStopping, TRUE, __ATOMIC_RELEASE);
+        _tgengenerator_wakeProducer();
+        g_thread_join(generatorProducer);
+        generatorProducer = NULL;
+    }
+}
+
+/* hands the queue to the background thread, which we start the first time */
+static gboolean _tgengenerator_registerQueue(TGenGeneratorQueue* queue) {
+    TGEN_ASSERT(queue);
+
+    g_mutex_lock(&generatorQueuesLock);
+
+    if(!generatorProducer) {
+        GError* error = NULL;
+        generatorProducer = g_thread_try_new("tgen-generator", _tgengenerator_runProducer, NULL, &error);
+        if(!generatorProducer) {
+            g_mutex_unlock(&generatorQueuesLock);
+            tgen_warning("failed to start the stream generator thread: %s", error->message);
+            g_error_free(error);
+            return FALSE;
         }
+        generatorQueues = g_ptr_array_new();
+        atexit(_tgengenerator_stopProducer);
+    }
 
-        gen->numStreamsGenerated++;
-        return TRUE;
-    } else {
-        tgen_message("Found stream end observation. Total time spent generating %u streams "
-                "was %f seconds and total time spent generating %u packets was %f seconds.",
-                gen->numStreamsGenerated, g_timer_elapsed(gen->cumulativeStreamTimer, NULL),
-                gen->numPacketsGenerated, g_timer_elapsed(gen->cumulativePacketTimer, NULL));
+    /* the background thread holds a ref until it is done with the queue */
+    g_atomic_int_inc(&queue->refcount);
+    g_ptr_array_add(generatorQueues, queue);
 
-        /* we got to the end, we should not create a transfer */
+    generatorProducerHasWork = TRUE;
+    g_cond_signal(&generatorProducerCond);
+
+    g_mutex_unlock(&generatorQueuesLock);
+    return TRUE;
+}
+
+TGenGenerator* tgengenerator_new(const gchar* streamModelPath, const gchar* packetModelPath,
+        TGenAction* modelAction) {
+
+    guint32 seed = g_random_int();
+
+    gchar* name = g_path_get_basename(streamModelPath);
+    TGenMarkovModel* streamModel = tgenmarkovmodel_newFromPath(name, seed, streamModelPath);
+    g_free(name);
+
+    if(!streamModel) {
+        tgen_warning("failed to parse stream markov model");
+        return NULL;
+    }
+
+    name = g_path_get_basename(packetModelPath);
+    TGenMarkovModel* packetModel = tgenmarkovmodel_newFromPath(name, seed, packetModelPath);
+    g_free(name);
+
+    if(!packetModel) {
+        tgen_warning("failed to parse packet markov model");
+        tgenmarkovmodel_unref(streamModel);
+        return NULL;
+    }
+
+    TGenGeneratorQueue* queue = g_new0(TGenGeneratorQueue, 1);
+    queue->magic = TGEN_MAGIC;
+    queue->refcount = 1;
+
+    queue->streamModel = streamModel;
+    queue->packetModel = packetModel;
+
+    /* these timers store cumulative times */
+    queue->cumulativeStreamTimer = g_timer_new();
+    g_timer_stop(queue->cumulativeStreamTimer);
+    queue->cumulativePacketTimer = g_timer_new();
+    g_timer_stop(queue->cumulativePacketTimer);
+
+    /* this one is reset every time it's used */
+    queue->packetScheduleTimer = g_timer_new();
+    g_timer_stop(queue->packetScheduleTimer);
+
+    /* from now on, only the background thread runs the models */
+    if(!_tgengenerator_registerQueue(queue)) {
+        _tgengenerator_unrefQueue(queue);
+        return NULL;
+    }
+
+    TGenGenerator* gen = g_new0(TGenGenerator, 1);
+    gen->magic = TGEN_MAGIC;
+
+    gen->queue = queue;
+    gen->modelAction = modelAction;
+
+    gen->refcount = 1;
+
+    return gen;
+}
+
+/**
+ * Take the packet schedules for the next stream, and the pause time that we
+ * should wait after this stream is created until we take the next stream
+ * (in microseconds). The background thread generated them ahead of time, so
+ * this never runs the markov models in the event loop.
+ *
+ * Following a call to this function, any non-null schedules returned to the
+ * caller in localSchedule or remoteSchedule are owned and must be unref'd
+ * by the caller.
+ *
+ * returns TGEN_GENERATOR_STREAM_READY if another stream should be created.
+ *         In this case the output variables will be set appropriately.
+ * returns TGEN_GENERATOR_STREAM_PENDING if the background thread did not
+ *         generate the next stream yet. The caller should try again soon.
+ * returns TGEN_GENERATOR_END if we have reached the end of the stream flow
+ *         for this iteration of the model. The generator can be unref'd and free'd.
+ */
+TGenGeneratorStatus tgengenerator_takeStream(TGenGenerator* gen,
+        TGenSchedule** localSchedule, TGenSchedule** remoteSchedule, guint64* pauseTimeUSec) {
+    TGEN_ASSERT(gen);
+
+    if(gen->reachedEndState) {
+        return TGEN_GENERATOR_END;
+    }
+
+    TGenGeneratorQueue* queue = gen->queue;
+    gsize tail = queue->tail;
+    gsize head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    if(tail == head) {
+        /* every queue starts empty, so we only count it as running dry
+         * once it gave us a stream. we poll again until the stream is ready,
+         * but count each time we run dry only once. */
+        if(gen->numStreamsGenerated > 0 && !gen->wasStarved) {
+            __atomic_add_fetch(&generatorNumQueueEmpty, 1, __ATOMIC_RELAXED);
+        }
+        gen->wasStarved = TRUE;
+        return TGEN_GENERATOR_STREAM_PENDING;
+    }
+
+    gen->wasStarved = FALSE;
+
+    TGenGeneratedStream* stream = &queue->streams[tail & (TGEN_GENERATOR_QUEUE_LENGTH - 1)];
+    TGenGeneratedStream taken = *stream;
+    stream->localSchedule = NULL;
+    stream->remoteSchedule = NULL;
+
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+
+    if(head - tail >= TGEN_GENERATOR_QUEUE_LENGTH) {
+        /* the background thread may be waiting for space */
+        _tgengenerator_wakeProducer();
+    }
+
+    if(taken.isEnd) {
         gen->reachedEndState = TRUE;
-        return FALSE;
+        return TGEN_GENERATOR_END;
+    }
+
+    if(localSchedule) {
+        *localSchedule = taken.localSchedule;
+    } else if(taken.localSchedule) {
+        tgenschedule_unref(taken.localSchedule);
     }
+
+    if(remoteSchedule) {
+        *remoteSchedule = taken.remoteSchedule;
+    } else if(taken.remoteSchedule) {
+        tgenschedule_unref(taken.remoteSchedule);
+    }
+
+    if(pauseTimeUSec) {
+        *pauseTimeUSec = taken.pauseTimeUSec;
+    }
+
+    gen->numStreamsGenerated++;
+    gen->numPacketsGenerated += taken.numPackets;
+    return TGEN_GENERATOR_STREAM_READY;
 }
 
+/* the number of times, across all generators, that we had to wait for the next stream */
+guint64 tgengenerator_getNumQueueEmpty() {
+    return __atomic_load_n(&generatorNumQueueEmpty, __ATOMIC_RELAXED);
+}
@@ -7,6 +7,16 @@
 
 #include <glib.h>
 
+/* how long the event loop waits before it asks again for a stream that
+ * was not generated yet */
+#define TGEN_GENERATOR_RETRY_USEC 1000
+
+typedef enum _TGenGeneratorStatus {
+    TGEN_GENERATOR_STREAM_READY,
+    TGEN_GENERATOR_STREAM_PENDING,
+    TGEN_GENERATOR_END,
+} TGenGeneratorStatus;
+
 typedef struct _TGenGenerator TGenGenerator;
 
 TGenGenerator* tgengenerator_new(const gchar* streamModelPath, const gchar* packetModelPath,
@@ -14,8 +24,8 @@ TGenGenerator* tgengenerator_new(const gchar* streamModelPath, const gchar* pack
 void tgengenerator_ref(TGenGenerator* gen);
 void tgengenerator_unref(TGenGenerator* gen);
 
-gboolean tgengenerator_generateStream(TGenGenerator* gen,
-        gchar** localSchedule, gchar** remoteSchedule, guint64* pauseTimeUSec);
+TGenGeneratorStatus tgengenerator_takeStream(TGenGenerator* gen,
+        TGenSchedule** localSchedule, TGenSchedule** remoteSchedule, guint64* pauseTimeUSec);
 
 TGenAction* tgengenerator_getModelAction(TGenGenerator* gen);
 void tgengenerator_onTransferCreated(TGenGenerator* gen);
@@ -26,4 +36,6 @@ guint tgengenerator_getNumOutstandingTransfers(TGenGenerator* gen);
 guint tgengenerator_getNumStreamsGenerated(TGenGenerator* gen);
 guint tgengenerator_getNumPacketsGenerated(TGenGenerator* gen);
 
+guint64 tgengenerator_getNumQueueEmpty();
+
 #endif /* TGEN_GENERATOR_H_ */
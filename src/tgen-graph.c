@@ -30,6 +30,18 @@ typedef enum {
     TGEN_VA_PACKETMODELPATH = 1 << 20,
     TGEN_VA_SOCKSUSERNAME = 1 << 21,
     TGEN_VA_SOCKSPASSWORD = 1 << 22,
+    TGEN_VA_IOBACKEND = 1 << 23,
+    TGEN_VA_THREADS = 1 << 24,
+    TGEN_VA_IOBUDGET = 1 << 25,
+    TGEN_VA_CONTENT = 1 << 26,
+    TGEN_VA_ZEROCOPY = 1 << 27,
+    TGEN_VA_CHECKSUM = 1 << 28,
+    TGEN_VA_FRAMING = 1 << 29,
+    TGEN_VA_STATUSINTERVAL = 1 << 30,
+    TGEN_VA_LOGBACKEND = 1u << 31,
+    /* gcc widens the enum to 64 bits for the flags past bit 31 */
+    TGEN_VA_EVENTLOG = G_GUINT64_CONSTANT(1) << 32,
+    TGEN_VA_LOGFILE = G_GUINT64_CONSTANT(1) << 33,
 } AttributeFlags;
 
 struct _TGenGraph {
@@ -45,6 +57,8 @@ struct _TGenGraph {
     igraph_integer_t edgeCount;
     igraph_bool_t isConnected;
     igraph_bool_t isDirected;
+    /* without a cycle, a walk from the start action ends after one pass */
+    igraph_bool_t isAcyclic;
 
     GHashTable* actions;
     GHashTable* weights;
@@ -249,6 +263,26 @@ static GError* _tgengraph_parseStartVertex(TGenGraph* g, const gchar* idStr,
             VAS(g->graph, "peers", vertexIndex) : NULL;
     const gchar* loglevelStr = (g->knownAttributes&TGEN_VA_LOGLEVEL) ?
             VAS(g->graph, "loglevel", vertexIndex) : NULL;
+    const gchar* iobackendStr = (g->knownAttributes&TGEN_VA_IOBACKEND) ?
+            VAS(g->graph, "iobackend", vertexIndex) : NULL;
+    const gchar* threadsStr = (g->knownAttributes&TGEN_VA_THREADS) ?
+            VAS(g->graph, "threads", vertexIndex) : NULL;
+    const gchar* iobudgetStr = (g->knownAttributes&TGEN_VA_IOBUDGET) ?
+            VAS(g->graph, "iobudget", vertexIndex) : NULL;
+    const gchar* contentStr = (g->knownAttributes&TGEN_VA_CONTENT) ?
+            VAS(g->graph, "content", vertexIndex) : NULL;
+    const gchar* zerocopyStr = (g->knownAttributes&TGEN_VA_ZEROCOPY) ?
+            VAS(g->graph, "zerocopy", vertexIndex) : NULL;
+    const gchar* framingStr = (g->knownAttributes&TGEN_VA_FRAMING) ?
+            VAS(g->graph, "framing", vertexIndex) : NULL;
+    const gchar* statusintervalStr = (g->knownAttributes&TGEN_VA_STATUSINTERVAL) ?
+            VAS(g->graph, "statusinterval", vertexIndex) : NULL;
+    const gchar* logbackendStr = (g->knownAttributes&TGEN_VA_LOGBACKEND) ?
+            VAS(g->graph, "logbackend", vertexIndex) : NULL;
+    const gchar* eventlogStr = (g->knownAttributes&TGEN_VA_EVENTLOG) ?
+            VAS(g->graph, "eventlog", vertexIndex) : NULL;
+    const gchar* logfileStr = (g->knownAttributes&TGEN_VA_LOGFILE) ?
+            VAS(g->graph, "logfile", vertexIndex) : NULL;
     const gchar* socksProxyStr;
     if (tgenconfig_getSOCKS()) {
         socksProxyStr = tgenconfig_getSOCKS();
@@ -257,10 +291,11 @@ static GError* _tgengraph_parseStartVertex(TGenGraph* g, const gchar* idStr,
             VAS(g->graph, "socksproxy", vertexIndex) : NULL;
     }
     tgen_debug("validating action '%s' at vertex %li, time=%s timeout=%s "
-            "stallout=%s heartbeat=%s loglevel=%s serverport=%s socksproxy=%s "
-            "peers=%s",
+            "stallout=%s heartbeat=%s loglevel=%s logbackend=%s logfile=%s eventlog=%s iobackend=%s threads=%s iobudget=%s content=%s "
+            "zerocopy=%s framing=%s statusinterval=%s serverport=%s socksproxy=%s peers=%s",
             idStr, (glong)vertexIndex, timeStr, timeoutStr, stalloutStr,
-            heartbeatStr, loglevelStr, serverPortStr, socksProxyStr, peersStr);
+            heartbeatStr, loglevelStr, logbackendStr, logfileStr, eventlogStr, iobackendStr, threadsStr, iobudgetStr, contentStr,
+            zerocopyStr, framingStr, statusintervalStr, serverPortStr, socksProxyStr, peersStr);
 
     if(g->hasStartAction) {
         return g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
@@ -274,8 +309,8 @@ static GError* _tgengraph_parseStartVertex(TGenGraph* g, const gchar* idStr,
 
     GError* error = NULL;
     TGenAction* a = tgenaction_newStartAction(timeStr, timeoutStr, stalloutStr,
-            heartbeatStr, loglevelStr, serverPortStr, peersStr, socksProxyStr,
-            &error);
+            heartbeatStr, loglevelStr, logbackendStr, logfileStr, eventlogStr, iobackendStr, threadsStr, iobudgetStr, contentStr,
+            zerocopyStr, framingStr, statusintervalStr, serverPortStr, peersStr, socksProxyStr, &error);
 
     if(a) {
         _tgengraph_storeAction(g, a, vertexIndex);
@@ -364,6 +399,8 @@ static GError* _tgengraph_parseTransferVertex(TGenGraph* g, const gchar* idStr,
             VAS(g->graph, "localschedule", vertexIndex) : NULL;
     const gchar* remoteSchedStr = (g->knownAttributes&TGEN_VA_REMOTESCHED) ?
             VAS(g->graph, "remoteschedule", vertexIndex) : NULL;
+    const gchar* checksumStr = (g->knownAttributes&TGEN_VA_CHECKSUM) ?
+            VAS(g->graph, "checksum", vertexIndex) : NULL;
     const gchar* socksUsernameStr = (g->knownAttributes&TGEN_VA_SOCKSUSERNAME) ?
             VAS(g->graph, "socksusername", vertexIndex) : NULL;
     const gchar* socksPasswordStr = (g->knownAttributes&TGEN_VA_SOCKSPASSWORD) ?
@@ -371,15 +408,15 @@ static GError* _tgengraph_parseTransferVertex(TGenGraph* g, const gchar* idStr,
 
     tgen_debug("found vertex %li (%s), type=%s protocol=%s size=%s oursize=%s "
             "theirsize=%s peers=%s timeout=%s stallout=%s localschedule=%s remoteschedule=%s "
-            "socksusername=%s sockspassword=%s",
+            "checksum=%s socksusername=%s sockspassword=%s",
             (glong)vertexIndex, idStr, typeStr, protocolStr, sizeStr,
             ourSizeStr, theirSizeStr, peersStr, timeoutStr, stalloutStr,
-            localSchedStr, remoteSchedStr, socksUsernameStr, socksPasswordStr);
+            localSchedStr, remoteSchedStr, checksumStr, socksUsernameStr, socksPasswordStr);
 
     GError* error = NULL;
     TGenAction* a = tgenaction_newTransferAction(typeStr, protocolStr, sizeStr,
             ourSizeStr, theirSizeStr, peersStr, timeoutStr, stalloutStr,
-            localSchedStr, remoteSchedStr, socksUsernameStr, socksPasswordStr, &error);
+            localSchedStr, remoteSchedStr, checksumStr, socksUsernameStr, socksPasswordStr, &error);
 
     if(a) {
         _tgengraph_storeAction(g, a, vertexIndex);
@@ -401,20 +438,22 @@ static GError* _tgengraph_parseModelVertex(TGenGraph* g, const gchar* idStr,
             VAS(g->graph, "packetmodelpath", vertexIndex) : NULL;
     const gchar* peersStr = (g->knownAttributes&TGEN_VA_PEERS) ?
             VAS(g->graph, "peers", vertexIndex) : NULL;
+    const gchar* checksumStr = (g->knownAttributes&TGEN_VA_CHECKSUM) ?
+            VAS(g->graph, "checksum", vertexIndex) : NULL;
     const gchar* socksUsernameStr = (g->knownAttributes&TGEN_VA_SOCKSUSERNAME) ?
             VAS(g->graph, "socksusername", vertexIndex) : NULL;
     const gchar* socksPasswordStr = (g->knownAttributes&TGEN_VA_SOCKSPASSWORD) ?
             VAS(g->graph, "sockspassword", vertexIndex) : NULL;
 
     tgen_debug("found vertex %li (%s), streammodelpath=%s packetmodelpath=%s peers=%s "
-            "socksusername=%s sockspassword=%s",
+            "checksum=%s socksusername=%s sockspassword=%s",
             (glong)vertexIndex, idStr, streamModelPath, packetModelPath, peersStr,
-            socksUsernameStr, socksPasswordStr);
+            checksumStr, socksUsernameStr, socksPasswordStr);
 
     GError* error = NULL;
 
     TGenAction* a = tgenaction_newModelAction(streamModelPath, packetModelPath, peersStr,
-            socksUsernameStr, socksPasswordStr, &error);
+            checksumStr, socksUsernameStr, socksPasswordStr, &error);
     if(a) {
         _tgengraph_storeAction(g, a, vertexIndex);
     }
@@ -529,6 +568,28 @@ static AttributeFlags _tgengraph_vertexAttributeToFlag(const gchar* stringAttrib
             return TGEN_VA_HEARTBEAT;
         } else if(!g_ascii_strcasecmp(stringAttribute, "loglevel")) {
             return TGEN_VA_LOGLEVEL;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "logbackend")) {
+            return TGEN_VA_LOGBACKEND;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "eventlog")) {
+            return TGEN_VA_EVENTLOG;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "logfile")) {
+            return TGEN_VA_LOGFILE;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "iobackend")) {
+            return TGEN_VA_IOBACKEND;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "threads")) {
+            return TGEN_VA_THREADS;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "iobudget")) {
+            return TGEN_VA_IOBUDGET;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "content")) {
+            return TGEN_VA_CONTENT;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "zerocopy")) {
+            return TGEN_VA_ZEROCOPY;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "framing")) {
+            return TGEN_VA_FRAMING;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "statusinterval")) {
+            return TGEN_VA_STATUSINTERVAL;
+        } else if(!g_ascii_strcasecmp(stringAttribute, "checksum")) {
+            return TGEN_VA_CHECKSUM;
         } else if(!g_ascii_strcasecmp(stringAttribute, "localschedule")) {
             return TGEN_VA_LOCALSCHED;
         } else if(!g_ascii_strcasecmp(stringAttribute, "remoteschedule")) {
@@ -584,6 +645,12 @@ static GError* _tgengraph_parseGraphProperties(TGenGraph* g) {
 
     g->isDirected = igraph_is_directed(g->graph);
 
+    result = igraph_is_dag(g->graph, &(g->isAcyclic));
+    if(result != IGRAPH_SUCCESS) {
+        return g_error_new(G_MARKUP_ERROR, G_MARKUP_ERROR_PARSE,
+                "igraph_is_dag return non-success code %i", result);
+    }
+
     tgen_debug("checking graph attributes...");
 
     /* now check list of all attributes */
@@ -853,7 +920,7 @@ GQueue* tgengraph_getNextActions(TGenGraph* g, TGenAction* action) {
         gdouble cumulativeWeight = 0.0;
         guint nextChoicePosition = 0;
         /* do a weighted choice, this return a val in the range [0.0, totalWeight) */
-        gdouble randomWeight = g_random_double_range((gdouble)0.0, totalWeight);
+        gdouble randomWeight = tgenrandom_nextDouble(tgenrandom_getThreadLocal()) * totalWeight;
 
         do {
             gdouble* choiceWeightPtr = g_queue_pop_head(chooseWeights);
@@ -884,6 +951,11 @@ gboolean tgengraph_hasEdges(TGenGraph* g) {
     return (g->edgeCount > 0) ? TRUE : FALSE;
 }
 
+gboolean tgengraph_isAcyclic(TGenGraph* g) {
+    TGEN_ASSERT(g);
+    return g->isAcyclic ? TRUE : FALSE;
+}
+
 const gchar* tgengraph_getActionIDStr(TGenGraph* g, TGenAction* action) {
     TGEN_ASSERT(g);
 
@@ -16,6 +16,7 @@ void tgengraph_unref(TGenGraph* g);
 TGenAction* tgengraph_getStartAction(TGenGraph* g);
 GQueue* tgengraph_getNextActions(TGenGraph* g, TGenAction* action);
 gboolean tgengraph_hasEdges(TGenGraph* g);
+gboolean tgengraph_isAcyclic(TGenGraph* g);
 const gchar* tgengraph_getActionIDStr(TGenGraph* g, TGenAction* action);
 const gchar* tgengraph_getGraphPath(TGenGraph* g);
 
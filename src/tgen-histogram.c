@@ -0,0 +1,131 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#include "tgen.h"
+
+/* values below 2^LINEAR_BITS get their own bucket. above that, each power of
+ * two is split into 2^(LINEAR_BITS-1) buckets. */
+#define TGEN_HISTOGRAM_LINEAR_BITS 7
+#define TGEN_HISTOGRAM_LINEAR_BUCKETS (1 << TGEN_HISTOGRAM_LINEAR_BITS)
+#define TGEN_HISTOGRAM_SUB_BUCKETS (TGEN_HISTOGRAM_LINEAR_BUCKETS / 2)
+/* larger values are counted as this one, which is about 12 days in microseconds */
+#define TGEN_HISTOGRAM_MAX_BITS 40
+#define TGEN_HISTOGRAM_MAX_VALUE ((G_GUINT64_CONSTANT(1) << TGEN_HISTOGRAM_MAX_BITS) - 1)
+#define TGEN_HISTOGRAM_NUM_BUCKETS (TGEN_HISTOGRAM_LINEAR_BUCKETS + \
+        (TGEN_HISTOGRAM_MAX_BITS - TGEN_HISTOGRAM_LINEAR_BITS) * TGEN_HISTOGRAM_SUB_BUCKETS)
+
+struct _TGenHistogram {
+    guint64 count;
+    guint64 max;
+    guint64 buckets[TGEN_HISTOGRAM_NUM_BUCKETS];
+    guint magic;
+};
+
+static guint _tgenhistogram_getBucket(guint64 value) {
+    if(value < TGEN_HISTOGRAM_LINEAR_BUCKETS) {
+        return (guint)value;
+    }
+
+    /* the position of the highest bit picks the power of two, and the next
+     * bits below it pick the bucket within it */
+    guint highBit = 63 - (guint)__builtin_clzll(value);
+    guint shift = highBit - (TGEN_HISTOGRAM_LINEAR_BITS - 1);
+    guint subBucket = (guint)(value >> shift) - TGEN_HISTOGRAM_SUB_BUCKETS;
+    return TGEN_HISTOGRAM_LINEAR_BUCKETS +
+            (highBit - TGEN_HISTOGRAM_LINEAR_BITS) * TGEN_HISTOGRAM_SUB_BUCKETS + subBucket;
+}
+
+/* the highest value that is counted in the bucket */
+static guint64 _tgenhistogram_getBucketMax(guint bucket) {
+    if(bucket < TGEN_HISTOGRAM_LINEAR_BUCKETS) {
+        return bucket;
+    }
+
+    guint offset = bucket - TGEN_HISTOGRAM_LINEAR_BUCKETS;
+    guint highBit = TGEN_HISTOGRAM_LINEAR_BITS + offset / TGEN_HISTOGRAM_SUB_BUCKETS;
+    guint shift = highBit - (TGEN_HISTOGRAM_LINEAR_BITS - 1);
+    guint64 subBucket = TGEN_HISTOGRAM_SUB_BUCKETS + offset % TGEN_HISTOGRAM_SUB_BUCKETS;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+TGenHistogram* tgenhistogram_new() {
+    TGenHistogram* histogram = g_new0(TGenHistogram, 1);
+    histogram->magic = TGEN_MAGIC;
+    return histogram;
+}
+
+void tgenhistogram_free(TGenHistogram* histogram) {
+    TGEN_ASSERT(histogram);
+    histogram->magic = 0;
+    g_free(histogram);
+}
+
+void tgenhistogram_record(TGenHistogram* histogram, guint64 value) {
+    TGEN_ASSERT(histogram);
+
+    value = MIN(value, TGEN_HISTOGRAM_MAX_VALUE);
+    histogram->buckets[_tgenhistogram_getBucket(value)]++;
+    histogram->count++;
+    histogram->max = MAX(histogram->max, value);
+}
+
+/* adds the values counted in other to the histogram */
+void tgenhistogram_add(TGenHistogram* histogram, const TGenHistogram* other) {
+    TGEN_ASSERT(histogram);
+    TGEN_ASSERT(other);
+
+    if(other->count == 0) {
+        return;
+    }
+
+    for(guint i = 0; i < TGEN_HISTOGRAM_NUM_BUCKETS; i++) {
+        histogram->buckets[i] += other->buckets[i];
+    }
+    histogram->count += other->count;
+    histogram->max = MAX(histogram->max, other->max);
+}
+
+void tgenhistogram_reset(TGenHistogram* histogram) {
+    TGEN_ASSERT(histogram);
+
+    if(histogram->count > 0) {
+        memset(histogram->buckets, 0, sizeof(histogram->buckets));
+        histogram->count = 0;
+        histogram->max = 0;
+    }
+}
+
+guint64 tgenhistogram_getCount(const TGenHistogram* histogram) {
+    TGEN_ASSERT(histogram);
+    return histogram->count;
+}
+
+guint64 tgenhistogram_getMax(const TGenHistogram* histogram) {
+    TGEN_ASSERT(histogram);
+    return histogram->max;
+}
+
+/* the value below which the given percent of the values fall, as the highest
+ * value of its bucket, or 0 if nothing was recorded */
+guint64 tgenhistogram_getPercentile(const TGenHistogram* histogram, gdouble percentile) {
+    TGEN_ASSERT(histogram);
+
+    if(histogram->count == 0) {
+        return 0;
+    }
+
+    percentile = CLAMP(percentile, 0.0f, 100.0f);
+    guint64 rank = (guint64)((percentile / 100.0f) * (gdouble)histogram->count + 0.5f);
+    rank = CLAMP(rank, 1, histogram->count);
+
+    guint64 seen = 0;
+    for(guint i = 0; i < TGEN_HISTOGRAM_NUM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if(seen >= rank) {
+            return MIN(_tgenhistogram_getBucketMax(i), histogram->max);
+        }
+    }
+
+    return histogram->max;
+}
@@ -0,0 +1,27 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_HISTOGRAM_H_
+#define TGEN_HISTOGRAM_H_
+
+#include <glib.h>
+
+/* a histogram of non-negative integer values in the style of HdrHistogram.
+ * values are counted in buckets that are exact below 128 and otherwise
+ * within 1/64 of the value, so recording a value is a few instructions and
+ * never allocates, and the memory is fixed no matter how many we record. */
+typedef struct _TGenHistogram TGenHistogram;
+
+TGenHistogram* tgenhistogram_new();
+void tgenhistogram_free(TGenHistogram* histogram);
+
+void tgenhistogram_record(TGenHistogram* histogram, guint64 value);
+void tgenhistogram_add(TGenHistogram* histogram, const TGenHistogram* other);
+void tgenhistogram_reset(TGenHistogram* histogram);
+
+guint64 tgenhistogram_getCount(const TGenHistogram* histogram);
+guint64 tgenhistogram_getMax(const TGenHistogram* histogram);
+guint64 tgenhistogram_getPercentile(const TGenHistogram* histogram, gdouble percentile);
+
+#endif /* TGEN_HISTOGRAM_H_ */
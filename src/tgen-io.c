@@ -3,61 +3,313 @@
  * See LICENSE for licensing information
  */
 
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+
 #include "tgen.h"
 
-struct _TGenIO {
-    gint epollD;
+/* the number of submission entries in the io_uring, the completion ring is twice as large */
+#define TGEN_IO_URING_ENTRIES 4096
+/* the provided buffers that socket reads through the io_uring complete into */
+#define TGEN_IO_URING_BUFFERS 256
+#define TGEN_IO_URING_BUFFER_LENGTH 16384
+/* the most received buffers (or accepted sockets) a stream holds before it stops reading ahead */
+#define TGEN_IO_STREAM_MAX_QUEUED 8
+/* the bytes a stream stages for writing while its previous send is in flight */
+#define TGEN_IO_STREAM_SEND_LENGTH 65536
+/* the staging buffers of finished streams that we keep around for new ones */
+#define TGEN_IO_STREAM_MAX_SPARES 64
 
-    GHashTable* children;
+/* epoll event data (and io_uring user data) carries the descriptor in the low bits and the
+ * generation of the registration in the high bits. io_uring user data also carries the kind
+ * of request in the top bits, so the generation wraps before it reaches them. */
+#define TGEN_IO_GENERATION_MASK 0x1FFFFFFF
+#define TGEN_IO_HANDLE(descriptor, generation) \
+    ((((guint64)((generation) & TGEN_IO_GENERATION_MASK)) << 32) | ((guint32)(descriptor)))
+#define TGEN_IO_HANDLE_DESCRIPTOR(handle) ((gint)((handle) & 0xFFFFFFFF))
+#define TGEN_IO_HANDLE_GENERATION(handle) ((guint32)((handle) >> 32))
 
-    gint refcount;
-    guint magic;
-};
+#define TGEN_IO_OP_SHIFT 61
+#define TGEN_IO_USER_DATA(handle, op) ((guint64)(handle) | (((guint64)(op)) << TGEN_IO_OP_SHIFT))
+#define TGEN_IO_USER_DATA_HANDLE(userData) ((TGenIOHandle)((userData) & ((G_GUINT64_CONSTANT(1) << TGEN_IO_OP_SHIFT) - 1)))
+#define TGEN_IO_USER_DATA_OP(userData) ((TGenIOOp)((userData) >> TGEN_IO_OP_SHIFT))
+
+/* the io_uring requests we make for a registration. removals and
+ * cancellations use user data 0, and timeouts carry a sequence number
+ * instead of a handle. */
+typedef enum _TGenIOOp {
+    TGEN_IO_OP_POLL = 0,
+    TGEN_IO_OP_RECV = 1,
+    TGEN_IO_OP_SEND = 2,
+    TGEN_IO_OP_ACCEPT = 3,
+    TGEN_IO_OP_TIMEOUT = 4,
+} TGenIOOp;
+
+/* bytes that a socket read completed into one of the provided buffers */
+typedef struct _TGenIOReceived {
+    guint16 bufferID;
+    guint32 length;
+    guint32 offset;
+} TGenIOReceived;
+
+typedef struct _TGenIOAccepted {
+    gint descriptor;
+    struct sockaddr_in address;
+    socklen_t addressLength;
+} TGenIOAccepted;
+
+/* a socket whose reads, writes, or accepts go through the io_uring instead of
+ * readiness polls. reads complete into provided buffers ahead of time and are
+ * copied out by tgenio_read, and writes are staged and sent with one request
+ * per loop. the stream outlives its registration while requests are in flight. */
+typedef struct _TGenIOStream {
+    TGenIOHandle handle;
+    gint descriptor;
+    gboolean isListener;
+
+    /* the reads that completed and were not yet consumed, in order */
+    TGenIOReceived received[TGEN_IO_STREAM_MAX_QUEUED];
+    guint receivedHead;
+    guint numReceived;
+    gboolean isRecvArmed;
+    /* all provided buffers were in use, so we poll until the socket is readable */
+    gboolean isPollingRecv;
+    gboolean isEOF;
+    gint recvError;
+
+    /* bytes in [sendOffset, sendLength) are still to be sent */
+    guint8* sendBuffer;
+    gsize sendOffset;
+    gsize sendLength;
+    gboolean isSendArmed;
+    gint sendError;
+
+    /* listening sockets accept into the address, and queue the new sockets */
+    struct sockaddr_in acceptAddress;
+    socklen_t acceptAddressLength;
+    TGenIOAccepted accepted[TGEN_IO_STREAM_MAX_QUEUED];
+    guint acceptedHead;
+    guint numAccepted;
+    gboolean isAcceptArmed;
+    gint acceptError;
+    /* an accept completed, so more connections may be waiting in the backlog */
+    gboolean isAcceptDraining;
+
+    /* reads, writes, and accepts we have in flight */
+    guint numOpsArmed;
+} TGenIOStream;
 
 typedef struct _TGenIOChild {
     gint descriptor;
+    /* incremented every time the descriptor is registered, never 0 */
+    guint32 generation;
+    gboolean isRegistered;
+    /* edge-triggered children are notified again while they report pending work */
+    gboolean isEdgeTriggered;
+    gboolean isPending;
+    /* the events we currently have registered with epoll, or that we
+     * want the io_uring polls to watch */
+    TGenEvent events;
+    /* io_uring polls are one-shot: the number we have in flight, and the
+     * events that the most recently armed one is watching */
+    guint numPollsArmed;
+    TGenEvent pollEvents;
+    /* non-null once the owner reads, writes, or accepts through the io_uring */
+    TGenIOStream* stream;
     TGenIO_notifyEventFunc notify;
-    TGenIO_notifyCheckTimeoutFunc checkTimeout;
     gpointer data;
     GDestroyNotify destructData;
 } TGenIOChild;
 
-static TGenIOChild* _tgeniochild_new(gint descriptor, TGenIO_notifyEventFunc notify,
-        TGenIO_notifyCheckTimeoutFunc checkTimeout, gpointer data, GDestroyNotify destructData) {
-    TGenIOChild* child = g_new0(TGenIOChild, 1);
-    child->descriptor = descriptor;
-    child->notify = notify;
-    child->checkTimeout = checkTimeout;
-    child->data = data;
-    child->destructData = destructData;
-    return child;
-}
+struct _TGenIO {
+    TGenIOBackend backend;
+    gint epollD;
+    TGenURing* ring;
+    /* poll requests made while looping are batched until the loop ends */
+    gboolean isLooping;
+    /* TRUE once we block in epoll_wait or io_uring_enter with a timer-derived timeout */
+    gboolean isWaiting;
+    gboolean noPWait2;
+    /* register new descriptors with EPOLLET */
+    gboolean edgeTriggered;
+
+    /* handles of edge-triggered children that returned TGEN_EVENT_PENDING,
+     * and of streams with completed reads or room to write */
+    GArray* pendingHandles;
+    GArray* pendingHandlesSpare;
+
+    /* reused by every epoll_wait call */
+    struct epoll_event* epollEvents;
+    gint epollEventsLength;
+
+    /* a dense table of children indexed by descriptor */
+    TGenIOChild* children;
+    gint childrenLength;
+
+    /* TRUE if the ring supports socket io and our provided buffers are registered */
+    gboolean hasStreams;
+    /* streams that were deregistered with requests in flight, by handle */
+    GHashTable* orphanStreams;
+    /* staging buffers of finished streams */
+    GPtrArray* spareSendBuffers;
+    /* the handle of the child whose notify function is running, its writes
+     * are sent once it returns */
+    TGenIOHandle notifyingHandle;
+
+    /* the deadline of the io_uring timeout we have in flight, or 0 */
+    gint64 timeoutDeadlineMicros;
+    guint64 timeoutSequence;
+
+    /* drives all of our timers from a single descriptor */
+    TGenTimerWheel* timers;
 
-static void _tgeniochild_free(TGenIOChild* child) {
-    g_assert(child);
-    if(child->destructData && child->data) {
-        child->destructData(child->data);
+    /* epoll_ctl modifications since the last collection */
+    guint64 numModsIssued;
+    guint64 numModsAvoided;
+    /* epoll_wait, epoll_ctl, io_uring_enter, and socket io calls since the last collection */
+    guint64 numSyscalls;
+
+    gint refcount;
+    guint magic;
+};
+
+static TGenIOChild* _tgenio_getChild(TGenIO* io, gint descriptor) {
+    if(descriptor >= 0 && descriptor < io->childrenLength &&
+            io->children[descriptor].isRegistered) {
+        return &io->children[descriptor];
+    } else {
+        return NULL;
     }
-    memset(child, 0, sizeof(TGenIOChild));
-    g_free(child);
 }
 
-TGenIO* tgenio_new() {
-    /* create an epoll descriptor so we can manage events */
-    gint epollD = epoll_create(1);
-    if (epollD < 0) {
-        tgen_critical("epoll_create(): returned %i error %i: %s", epollD, errno, g_strerror(errno));
+static TGenIOChild* _tgenio_getChildFromHandle(TGenIO* io, TGenIOHandle handle) {
+    TGenIOChild* child = _tgenio_getChild(io, TGEN_IO_HANDLE_DESCRIPTOR(handle));
+    if(child && child->generation == TGEN_IO_HANDLE_GENERATION(handle)) {
+        return child;
+    } else {
         return NULL;
     }
+}
+
+static void _tgenio_growChildren(TGenIO* io, gint descriptor) {
+    gint oldLength = io->childrenLength;
+    gint newLength = MAX(oldLength, 64);
+    while(newLength <= descriptor) {
+        newLength *= 2;
+    }
+
+    /* the notify callbacks may register new descriptors, so child pointers
+     * must not be held across a call that may register */
+    io->children = g_renew(TGenIOChild, io->children, newLength);
+    memset(&io->children[oldLength], 0, sizeof(TGenIOChild) * (newLength - oldLength));
+    io->childrenLength = newLength;
+}
+
+static void _tgenio_freeStream(TGenIO* io, TGenIOStream* stream) {
+    /* once the ring is gone, the kernel no longer owns any of the buffers */
+    if(io->ring) {
+        for(guint i = 0; i < stream->numReceived; i++) {
+            TGenIOReceived* received = &stream->received[(stream->receivedHead + i) % TGEN_IO_STREAM_MAX_QUEUED];
+            tgenuring_recycleBuffer(io->ring, received->bufferID);
+        }
+    }
+
+    /* nobody will take the sockets we accepted ahead of time */
+    for(guint i = 0; i < stream->numAccepted; i++) {
+        close(stream->accepted[(stream->acceptedHead + i) % TGEN_IO_STREAM_MAX_QUEUED].descriptor);
+    }
+
+    if(stream->sendBuffer) {
+        if(io->spareSendBuffers->len < TGEN_IO_STREAM_MAX_SPARES) {
+            g_ptr_array_add(io->spareSendBuffers, stream->sendBuffer);
+        } else {
+            g_free(stream->sendBuffer);
+        }
+    }
+
+    g_free(stream);
+}
+
+static void _tgenio_clearChild(TGenIO* io, TGenIOChild* child) {
+    gpointer data = child->data;
+    GDestroyNotify destructData = child->destructData;
+
+    /* keep the generation so the next registration gets a new one */
+    child->isRegistered = FALSE;
+    child->isPending = FALSE;
+    child->numPollsArmed = 0;
+    child->notify = NULL;
+    child->data = NULL;
+    child->destructData = NULL;
+
+    if(child->stream) {
+        _tgenio_freeStream(io, child->stream);
+        child->stream = NULL;
+    }
+
+    /* the destructor may re-enter the io module, so the slot is cleared first */
+    if(destructData && data) {
+        destructData(data);
+    }
+}
+
+static TGenEvent _tgenio_onTimersExpired(TGenTimerWheel* timers, gint descriptor, TGenEvent events) {
+    g_assert(events & TGEN_EVENT_READ);
+    tgentimerwheel_onExpired(timers);
+    /* we will only ever read timer expirations and never write */
+    return TGEN_EVENT_READ;
+}
+
+TGenIO* tgenio_new(TGenIOBackend backend) {
+    TGenURing* ring = NULL;
+    gint epollD = -1;
+    gboolean hasStreams = FALSE;
+
+    if(backend == TGEN_IO_BACKEND_URING) {
+        ring = tgenuring_new(TGEN_IO_URING_ENTRIES);
+        if(!ring) {
+            tgen_warning("unable to use the io_uring backend, falling back to epoll");
+            backend = TGEN_IO_BACKEND_EPOLL;
+        } else if(tgenuring_supportsNetworkOps(ring) &&
+                tgenuring_registerBufferRing(ring, TGEN_IO_URING_BUFFERS, TGEN_IO_URING_BUFFER_LENGTH)) {
+            hasStreams = TRUE;
+        } else {
+            tgen_info("socket reads and writes will not go through the io_uring, only readiness polls");
+        }
+    }
+
+    if(backend == TGEN_IO_BACKEND_EPOLL) {
+        /* create an epoll descriptor so we can manage events */
+        epollD = epoll_create(1);
+        if (epollD < 0) {
+            tgen_critical("epoll_create(): returned %i error %i: %s", epollD, errno, g_strerror(errno));
+            return NULL;
+        }
+    }
 
     /* allocate the new server object and return it */
     TGenIO* io = g_new0(TGenIO, 1);
     io->magic = TGEN_MAGIC;
     io->refcount = 1;
 
-    io->children = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)_tgeniochild_free);
-
+    io->backend = backend;
     io->epollD = epollD;
+    io->ring = ring;
+    io->hasStreams = hasStreams;
+    io->pendingHandles = g_array_new(FALSE, FALSE, sizeof(TGenIOHandle));
+    io->pendingHandlesSpare = g_array_new(FALSE, FALSE, sizeof(TGenIOHandle));
+    io->orphanStreams = g_hash_table_new(g_int64_hash, g_int64_equal);
+    io->spareSendBuffers = g_ptr_array_new();
+
+    io->timers = tgentimerwheel_new();
+    if(!io->timers ||
+            !tgenio_register(io, tgentimerwheel_getDescriptor(io->timers),
+                    (TGenIO_notifyEventFunc)_tgenio_onTimersExpired, io->timers, NULL)) {
+        tgen_critical("unable to initialize the timer wheel");
+        tgenio_unref(io);
+        return NULL;
+    }
 
     return io;
 }
@@ -66,8 +318,53 @@ static void _tgenio_free(TGenIO* io) {
     TGEN_ASSERT(io);
     g_assert(io->refcount == 0);
 
+    /* closing the ring cancels everything in flight, so the streams
+     * and their buffers are ours again */
+    if(io->ring) {
+        tgenuring_free(io->ring);
+        io->ring = NULL;
+    }
+
     if(io->children) {
-        g_hash_table_destroy(io->children);
+        for(gint descriptor = 0; descriptor < io->childrenLength; descriptor++) {
+            TGenIOChild* child = _tgenio_getChild(io, descriptor);
+            if(child) {
+                _tgenio_clearChild(io, child);
+            }
+        }
+        g_free(io->children);
+    }
+
+    if(io->orphanStreams) {
+        GHashTableIter iter;
+        gpointer stream = NULL;
+        g_hash_table_iter_init(&iter, io->orphanStreams);
+        while(g_hash_table_iter_next(&iter, NULL, &stream)) {
+            _tgenio_freeStream(io, stream);
+        }
+        g_hash_table_destroy(io->orphanStreams);
+    }
+
+    if(io->spareSendBuffers) {
+        for(guint i = 0; i < io->spareSendBuffers->len; i++) {
+            g_free(g_ptr_array_index(io->spareSendBuffers, i));
+        }
+        g_ptr_array_free(io->spareSendBuffers, TRUE);
+    }
+
+    if(io->timers) {
+        tgentimerwheel_free(io->timers);
+    }
+
+    if(io->epollEvents) {
+        g_free(io->epollEvents);
+    }
+
+    if(io->pendingHandles) {
+        g_array_free(io->pendingHandles, TRUE);
+    }
+    if(io->pendingHandlesSpare) {
+        g_array_free(io->pendingHandlesSpare, TRUE);
     }
 
     io->magic = 0;
@@ -86,50 +383,359 @@ void tgenio_unref(TGenIO* io) {
     }
 }
 
+/* descriptors registered after this call use edge-triggered notifications.
+ * their notify functions must read and write until EAGAIN, or else return
+ * TGEN_EVENT_PENDING to be notified again. io_uring polls are one-shot and
+ * check the current readiness when armed, so this has no effect there. */
+void tgenio_setEdgeTriggered(TGenIO* io, gboolean edgeTriggered) {
+    TGEN_ASSERT(io);
+    io->edgeTriggered = (edgeTriggered && io->backend == TGEN_IO_BACKEND_EPOLL) ? TRUE : FALSE;
+}
+
+/* polls requested outside of the loop (e.g., at startup) must reach the
+ * kernel before anyone blocks on the ring descriptor */
+static void _tgenio_flushPolls(TGenIO* io) {
+    if(!io->isLooping) {
+        tgenuring_submit(io->ring, FALSE);
+    }
+}
+
+static void _tgenio_armPoll(TGenIO* io, TGenIOChild* child, TGenIOHandle handle) {
+    guint32 pollEvents = 0;
+    if(child->events & TGEN_EVENT_READ) {
+        pollEvents |= POLLIN;
+    }
+    if(child->events & TGEN_EVENT_WRITE) {
+        pollEvents |= POLLOUT;
+    }
+
+    if(tgenuring_pollAdd(io->ring, child->descriptor, pollEvents, handle)) {
+        child->numPollsArmed++;
+        child->pollEvents = child->events;
+    }
+}
+
+/* queues the child to be notified in the next turn of the loop */
+static void _tgenio_markPending(TGenIO* io, TGenIOChild* child, TGenIOHandle handle) {
+    if(!child->isPending) {
+        child->isPending = TRUE;
+        g_array_append_val(io->pendingHandles, handle);
+    }
+}
+
+/* the events that the stream can serve without waiting for the kernel */
+static TGenEvent _tgenio_getStreamReadyEvents(TGenIOStream* stream) {
+    TGenEvent events = TGEN_EVENT_NONE;
+
+    if(stream->numReceived > 0 || stream->isEOF || stream->recvError != 0 ||
+            stream->numAccepted > 0 || stream->acceptError != 0) {
+        events |= TGEN_EVENT_READ;
+    }
+    if(stream->sendError != 0 || stream->sendLength < TGEN_IO_STREAM_SEND_LENGTH) {
+        events |= TGEN_EVENT_WRITE;
+    }
+
+    return events;
+}
+
+/* keeps one read (or accept) in flight while there is room to queue what it returns */
+static void _tgenio_armStreamRead(TGenIO* io, TGenIOStream* stream, TGenIOHandle handle) {
+    if(stream->isListener) {
+        if(!stream->isAcceptArmed && stream->acceptError == 0 &&
+                stream->numAccepted < TGEN_IO_STREAM_MAX_QUEUED) {
+            stream->acceptAddressLength = (socklen_t)sizeof(struct sockaddr_in);
+            if(tgenuring_accept(io->ring, stream->descriptor, (struct sockaddr*)&stream->acceptAddress,
+                    &stream->acceptAddressLength, TGEN_IO_USER_DATA(handle, TGEN_IO_OP_ACCEPT))) {
+                stream->isAcceptArmed = TRUE;
+                stream->numOpsArmed++;
+            }
+        }
+    } else if(!stream->isRecvArmed && !stream->isPollingRecv && !stream->isEOF &&
+            stream->recvError == 0 && stream->numReceived < TGEN_IO_STREAM_MAX_QUEUED) {
+        if(tgenuring_recv(io->ring, stream->descriptor, TGEN_IO_USER_DATA(handle, TGEN_IO_OP_RECV))) {
+            stream->isRecvArmed = TRUE;
+            stream->numOpsArmed++;
+        }
+    }
+}
+
+/* sends everything staged so far, unless the previous send is still in flight */
+static void _tgenio_flushStream(TGenIO* io, TGenIOStream* stream, TGenIOHandle handle) {
+    if(stream->isSendArmed || stream->sendError != 0 || stream->sendOffset >= stream->sendLength) {
+        return;
+    }
+
+    /* nothing is in flight, so the staged bytes can move to the front */
+    if(stream->sendOffset > 0) {
+        memmove(stream->sendBuffer, stream->sendBuffer + stream->sendOffset,
+                stream->sendLength - stream->sendOffset);
+        stream->sendLength -= stream->sendOffset;
+        stream->sendOffset = 0;
+    }
+
+    if(tgenuring_send(io->ring, stream->descriptor, stream->sendBuffer, stream->sendLength,
+            TGEN_IO_USER_DATA(handle, TGEN_IO_OP_SEND))) {
+        stream->isSendArmed = TRUE;
+        stream->numOpsArmed++;
+    }
+}
+
+/* streams are only used by a waiting loop, because nothing would wake up a
+ * caller of tgenio_loopOnce for the reads that are already queued */
+static TGenIOStream* _tgenio_getStream(TGenIO* io, TGenIOChild* child, gboolean isListener) {
+    if(child->stream || !io->hasStreams || !io->isWaiting) {
+        return child->stream;
+    }
+
+    TGenIOHandle handle = TGEN_IO_HANDLE(child->descriptor, child->generation);
+
+    TGenIOStream* stream = g_new0(TGenIOStream, 1);
+    stream->handle = handle;
+    stream->descriptor = child->descriptor;
+    stream->isListener = isListener;
+    child->stream = stream;
+
+    /* from now on the reads and writes tell us when the socket is ready */
+    if(child->numPollsArmed > 0) {
+        tgenuring_pollRemove(io->ring, handle);
+    }
+
+    return stream;
+}
+
+static void _tgenio_setStreamEvents(TGenIO* io, TGenIOChild* child, TGenIOHandle handle, TGenEvent events) {
+    child->events = events;
+
+    if(events & TGEN_EVENT_READ) {
+        _tgenio_armStreamRead(io, child->stream, handle);
+    }
+
+    if(events & _tgenio_getStreamReadyEvents(child->stream)) {
+        _tgenio_markPending(io, child, handle);
+    }
+
+    _tgenio_flushPolls(io);
+}
+
 void tgenio_deregister(TGenIO* io, gint descriptor) {
     TGEN_ASSERT(io);
 
-    gint result = epoll_ctl(io->epollD, EPOLL_CTL_DEL, descriptor, NULL);
-    if(result != 0) {
-        tgen_warning("epoll_ctl(): epoll %i descriptor %i returned %i error %i: %s",
-                io->epollD, descriptor, result, errno, g_strerror(errno));
+    TGenIOChild* child = _tgenio_getChild(io, descriptor);
+
+    if(io->backend == TGEN_IO_BACKEND_URING) {
+        /* any completion of the canceled poll will carry a stale handle */
+        if(child && child->numPollsArmed > 0) {
+            tgenuring_pollRemove(io->ring, TGEN_IO_HANDLE(descriptor, child->generation));
+            _tgenio_flushPolls(io);
+        }
+
+        if(child && child->stream) {
+            TGenIOStream* stream = child->stream;
+            child->stream = NULL;
+
+            /* stop reading, but let the staged bytes reach the peer */
+            if(stream->isRecvArmed) {
+                tgenuring_cancel(io->ring, TGEN_IO_USER_DATA(stream->handle, TGEN_IO_OP_RECV));
+            }
+            if(stream->isAcceptArmed) {
+                tgenuring_cancel(io->ring, TGEN_IO_USER_DATA(stream->handle, TGEN_IO_OP_ACCEPT));
+            }
+            _tgenio_flushStream(io, stream, stream->handle);
+
+            if(stream->numOpsArmed > 0) {
+                g_hash_table_insert(io->orphanStreams, &stream->handle, stream);
+            } else {
+                _tgenio_freeStream(io, stream);
+            }
+
+            /* the caller may close the descriptor as soon as we return */
+            tgenuring_submit(io->ring, FALSE);
+        }
+    } else {
+        io->numSyscalls++;
+        gint result = epoll_ctl(io->epollD, EPOLL_CTL_DEL, descriptor, NULL);
+        if(result != 0) {
+            tgen_warning("epoll_ctl(): epoll %i descriptor %i returned %i error %i: %s",
+                    io->epollD, descriptor, result, errno, g_strerror(errno));
+        }
     }
 
-    g_hash_table_remove(io->children, GINT_TO_POINTER(descriptor));
+    if(child) {
+        _tgenio_clearChild(io, child);
+    }
 }
 
 gboolean tgenio_register(TGenIO* io, gint descriptor, TGenIO_notifyEventFunc notify,
-        TGenIO_notifyCheckTimeoutFunc checkTimeout, gpointer data, GDestroyNotify destructData) {
+        gpointer data, GDestroyNotify destructData) {
     TGEN_ASSERT(io);
 
-    if(g_hash_table_lookup(io->children, GINT_TO_POINTER(descriptor))) {
+    if(descriptor < 0) {
+        tgen_critical("refusing to register invalid descriptor %i", descriptor);
+        return FALSE;
+    }
+
+    if(_tgenio_getChild(io, descriptor)) {
         tgenio_deregister(io, descriptor);
         tgen_warning("removed existing entry at descriptor %i to make room for a new one", descriptor);
     }
 
+    if(descriptor >= io->childrenLength) {
+        _tgenio_growChildren(io, descriptor);
+    }
+
+    TGenIOChild* child = &io->children[descriptor];
+    guint32 generation = (child->generation + 1) & TGEN_IO_GENERATION_MASK;
+    if(generation == 0) {
+        generation = 1;
+    }
+
     /* start watching */
-    struct epoll_event ee;
-    memset(&ee, 0, sizeof(struct epoll_event));
-    ee.events = EPOLLIN|EPOLLOUT;
-    ee.data.fd = descriptor;
+    if(io->backend == TGEN_IO_BACKEND_EPOLL) {
+        struct epoll_event ee;
+        memset(&ee, 0, sizeof(struct epoll_event));
+        ee.events = EPOLLIN|EPOLLOUT;
+        if(io->edgeTriggered) {
+            ee.events |= EPOLLET;
+        }
+        ee.data.u64 = TGEN_IO_HANDLE(descriptor, generation);
 
-    gint result = epoll_ctl(io->epollD, EPOLL_CTL_ADD, descriptor, &ee);
+        io->numSyscalls++;
+        gint result = epoll_ctl(io->epollD, EPOLL_CTL_ADD, descriptor, &ee);
 
-    if (result != 0) {
-        tgen_critical("epoll_ctl(): epoll %i socket %i returned %i error %i: %s",
-                io->epollD, descriptor, result, errno, g_strerror(errno));
-        return FALSE;
+        if (result != 0) {
+            tgen_critical("epoll_ctl(): epoll %i socket %i returned %i error %i: %s",
+                    io->epollD, descriptor, result, errno, g_strerror(errno));
+            return FALSE;
+        }
     }
 
-    TGenIOChild* child = _tgeniochild_new(descriptor, notify, checkTimeout, data, destructData);
-    g_hash_table_replace(io->children, GINT_TO_POINTER(child->descriptor), child);
+    child->descriptor = descriptor;
+    child->generation = generation;
+    child->isRegistered = TRUE;
+    child->isEdgeTriggered = io->edgeTriggered;
+    child->isPending = FALSE;
+    child->events = TGEN_EVENT_READ|TGEN_EVENT_WRITE;
+    child->numPollsArmed = 0;
+    child->stream = NULL;
+    child->notify = notify;
+    child->data = data;
+    child->destructData = destructData;
+
+    if(io->backend == TGEN_IO_BACKEND_URING) {
+        _tgenio_armPoll(io, child, TGEN_IO_HANDLE(descriptor, generation));
+        _tgenio_flushPolls(io);
+    }
 
     return TRUE;
 }
 
-static void _tgenio_helper(TGenIO* io, TGenIOChild* child, gboolean in, gboolean out) {
+/* returns a handle for the current registration of the descriptor, or 0 if
+ * it is not registered. the handle goes stale once the descriptor is
+ * deregistered, even if the descriptor number is later reused. */
+TGenIOHandle tgenio_getHandle(TGenIO* io, gint descriptor) {
+    TGEN_ASSERT(io);
+    TGenIOChild* child = _tgenio_getChild(io, descriptor);
+    return child ? TGEN_IO_HANDLE(descriptor, child->generation) : 0;
+}
+
+/* arm the timer on our timer wheel. the caller's reference to the timer is
+ * transferred to the io module, and dropped once the timer is done. */
+void tgenio_registerTimer(TGenIO* io, TGenTimer* timer) {
+    TGEN_ASSERT(io);
+    tgentimerwheel_add(io->timers, timer);
+}
+
+void tgenio_deregisterTimer(TGenIO* io, TGenTimer* timer) {
+    TGEN_ASSERT(io);
+    tgentimerwheel_remove(io->timers, timer);
+}
+
+guint tgenio_getNumTimers(TGenIO* io) {
+    TGEN_ASSERT(io);
+    return tgentimerwheel_getNumTimers(io->timers);
+}
+
+void tgenio_collectTimerLateness(TGenIO* io, guint64* numExpired,
+        guint64* meanLatenessMicros, guint64* maxLatenessMicros) {
+    TGEN_ASSERT(io);
+    tgentimerwheel_collectLateness(io->timers, numExpired, meanLatenessMicros, maxLatenessMicros);
+}
+
+/* only replace an armed poll if the events actually changed. once a poll
+ * completed, a new one is armed with the events we want next. */
+static void _tgenio_setChildPoll(TGenIO* io, TGenIOChild* child, TGenIOHandle handle, TGenEvent events) {
+    child->events = events;
+
+    if(child->numPollsArmed > 0) {
+        if(events == child->pollEvents) {
+            io->numModsAvoided++;
+            return;
+        }
+        io->numModsIssued++;
+        tgenuring_pollRemove(io->ring, handle);
+    }
+
+    if(events != TGEN_EVENT_NONE) {
+        _tgenio_armPoll(io, child, handle);
+    }
+
+    _tgenio_flushPolls(io);
+}
+
+/* only modify the epoll registration if the events actually changed */
+static void _tgenio_setChildEvents(TGenIO* io, TGenIOChild* child, TGenIOHandle handle, TGenEvent events) {
+    events &= (TGEN_EVENT_READ|TGEN_EVENT_WRITE);
+
+    if(io->backend == TGEN_IO_BACKEND_URING) {
+        if(child->stream) {
+            _tgenio_setStreamEvents(io, child, handle, events);
+        } else {
+            _tgenio_setChildPoll(io, child, handle, events);
+        }
+        return;
+    }
+
+    if(events == child->events) {
+        io->numModsAvoided++;
+        return;
+    }
+
+    struct epoll_event ee;
+    memset(&ee, 0, sizeof(struct epoll_event));
+    if (events & TGEN_EVENT_READ) {
+        ee.events |= EPOLLIN;
+    }
+    if (events & TGEN_EVENT_WRITE) {
+        ee.events |= EPOLLOUT;
+    }
+    if (child->isEdgeTriggered) {
+        ee.events |= EPOLLET;
+    }
+    ee.data.u64 = handle;
+
+    io->numModsIssued++;
+    io->numSyscalls++;
+    gint result = epoll_ctl(io->epollD, EPOLL_CTL_MOD, child->descriptor, &ee);
+    if (result != 0) {
+        tgen_warning("epoll_ctl(): epoll %i descriptor %i returned %i error %i: %s",
+                io->epollD, child->descriptor, result, errno, g_strerror(errno));
+    } else {
+        child->events = events;
+    }
+}
+
+static void _tgenio_helper(TGenIO* io, TGenIOHandle handle, gboolean in, gboolean out) {
     TGEN_ASSERT(io);
-    g_assert(child);
+
+    TGenIOChild* child = _tgenio_getChildFromHandle(io, handle);
+    if(!child) {
+        /* an earlier event in this batch deregistered the descriptor */
+        tgen_debug("ignoring stale event for descriptor %i", TGEN_IO_HANDLE_DESCRIPTOR(handle));
+        return;
+    }
+
+    /* this notification serves any pending work too */
+    child->isPending = FALSE;
 
     TGenEvent inEvents = TGEN_EVENT_NONE;
 
@@ -146,49 +752,407 @@ static void _tgenio_helper(TGenIO* io, TGenIOChild* child, gboolean in, gboolean
     }
 
     /* activate the transfer */
-    TGenEvent outEvents = child->notify(child->data, child->descriptor, inEvents);
+    gint descriptor = child->descriptor;
+    io->notifyingHandle = handle;
+    TGenEvent outEvents = child->notify(child->data, descriptor, inEvents);
+    io->notifyingHandle = 0;
+
+    /* the callback may have grown the table or deregistered the descriptor */
+    child = _tgenio_getChildFromHandle(io, handle);
+    if(!child) {
+        return;
+    }
+
+    /* everything the callback wrote goes out in one request */
+    if(child->stream) {
+        _tgenio_flushStream(io, child->stream, handle);
+    }
 
     /* now check if we should update our epoll events */
     if(outEvents & TGEN_EVENT_DONE) {
-        tgenio_deregister(io, child->descriptor);
-    } else if(inEvents != outEvents) {
-        guint32 newEvents = 0;
-        if(outEvents & TGEN_EVENT_READ) {
-            newEvents |= EPOLLIN;
+        tgenio_deregister(io, descriptor);
+    } else {
+        _tgenio_setChildEvents(io, child, handle, outEvents);
+
+        /* the kernel will not tell us again about readiness we did not consume */
+        if((outEvents & TGEN_EVENT_PENDING) && child->isEdgeTriggered &&
+                (child->events & (TGEN_EVENT_READ|TGEN_EVENT_WRITE))) {
+            _tgenio_markPending(io, child, handle);
         }
-        if(outEvents & TGEN_EVENT_WRITE) {
-            newEvents |= EPOLLOUT;
+    }
+}
+
+/* notifies every child that was pending before this call once, for the
+ * events it is interested in. children that still have pending work after
+ * their turn are queued for the next call, so that they share the loop
+ * fairly with descriptors that the kernel reports as ready. */
+static gint _tgenio_runPending(TGenIO* io) {
+    GArray* handles = io->pendingHandles;
+    io->pendingHandles = io->pendingHandlesSpare;
+    io->pendingHandlesSpare = handles;
+
+    gint numEvents = 0;
+
+    for(guint i = 0; i < handles->len; i++) {
+        TGenIOHandle handle = g_array_index(handles, TGenIOHandle, i);
+
+        /* skip children that were deregistered or notified since they were queued */
+        TGenIOChild* child = _tgenio_getChildFromHandle(io, handle);
+        if(!child || !child->isPending) {
+            continue;
         }
 
-        struct epoll_event ee;
-        memset(&ee, 0, sizeof(struct epoll_event));
-        ee.events = newEvents;
-        ee.data.fd = child->descriptor;
+        /* streams are only notified for what they can serve right away */
+        TGenEvent events = child->events;
+        if(child->stream) {
+            events &= _tgenio_getStreamReadyEvents(child->stream);
+        }
 
-        gint result = epoll_ctl(io->epollD, EPOLL_CTL_MOD, child->descriptor, &ee);
-        if(result != 0) {
-            tgen_warning("epoll_ctl(): epoll %i descriptor %i returned %i error %i: %s",
-                    io->epollD, child->descriptor, result, errno, g_strerror(errno));
+        gboolean in = (events & TGEN_EVENT_READ) ? TRUE : FALSE;
+        gboolean out = (events & TGEN_EVENT_WRITE) ? TRUE : FALSE;
+        if(!in && !out) {
+            /* its events were cleared while it was queued */
+            child->isPending = FALSE;
+            continue;
         }
+
+        _tgenio_helper(io, handle, in, out);
+        numEvents++;
     }
+
+    g_array_set_size(handles, 0);
+    return numEvents;
 }
 
-gint tgenio_loopOnce(TGenIO* io, gint maxEvents) {
-    TGEN_ASSERT(io);
+static void _tgenio_onRecvCompleted(TGenIO* io, TGenIOStream* stream, gint32 result, gint32 bufferID) {
+    stream->isRecvArmed = FALSE;
+    stream->numOpsArmed--;
+
+    if(result > 0 && bufferID >= 0) {
+        TGenIOReceived* received =
+                &stream->received[(stream->receivedHead + stream->numReceived) % TGEN_IO_STREAM_MAX_QUEUED];
+        received->bufferID = (guint16)bufferID;
+        received->length = (guint32)result;
+        received->offset = 0;
+        stream->numReceived++;
+        return;
+    }
+
+    /* the kernel may pick a buffer before the read fails */
+    if(bufferID >= 0) {
+        tgenuring_recycleBuffer(io->ring, (guint16)bufferID);
+    }
+
+    if(result == 0) {
+        stream->isEOF = TRUE;
+    } else if(result == -ENOBUFS) {
+        /* all buffers are queued in other streams, so wait until the socket is
+         * readable and let the owner read it directly */
+        stream->isPollingRecv = TRUE;
+    } else if(result != -ECANCELED) {
+        stream->recvError = result < 0 ? -result : EIO;
+    }
+}
+
+static void _tgenio_onSendCompleted(TGenIO* io, TGenIOStream* stream, gint32 result) {
+    stream->isSendArmed = FALSE;
+    stream->numOpsArmed--;
+
+    if(result > 0) {
+        stream->sendOffset += (gsize)result;
+        if(stream->sendOffset >= stream->sendLength) {
+            stream->sendOffset = 0;
+            stream->sendLength = 0;
+        }
+    } else if(result != -ECANCELED) {
+        /* the staged bytes will never be sent, the next write reports the error */
+        stream->sendError = result < 0 ? -result : EPIPE;
+        stream->sendOffset = 0;
+        stream->sendLength = 0;
+    }
+}
+
+static void _tgenio_onAcceptCompleted(TGenIO* io, TGenIOStream* stream, gint32 result) {
+    stream->isAcceptArmed = FALSE;
+    stream->numOpsArmed--;
+
+    if(result >= 0) {
+        TGenIOAccepted* accepted =
+                &stream->accepted[(stream->acceptedHead + stream->numAccepted) % TGEN_IO_STREAM_MAX_QUEUED];
+        accepted->descriptor = result;
+        accepted->address = stream->acceptAddress;
+        accepted->addressLength = stream->acceptAddressLength;
+        stream->numAccepted++;
+        stream->isAcceptDraining = TRUE;
+    } else if(result != -ECANCELED) {
+        stream->acceptError = -result;
+    }
+}
+
+/* completions of requests that outlived their registration only give back
+ * what they hold, and finish the sends that were staged before it ended */
+static void _tgenio_onOrphanCompleted(TGenIO* io, TGenIOHandle handle, TGenIOOp op,
+        gint32 result, gint32 bufferID) {
+    TGenIOStream* stream = g_hash_table_lookup(io->orphanStreams, &handle);
+    if(!stream) {
+        tgen_warning("io_uring request %i for descriptor %i completed without a stream",
+                (gint)op, TGEN_IO_HANDLE_DESCRIPTOR(handle));
+        return;
+    }
+
+    if(op == TGEN_IO_OP_RECV) {
+        _tgenio_onRecvCompleted(io, stream, result, bufferID);
+    } else if(op == TGEN_IO_OP_SEND) {
+        _tgenio_onSendCompleted(io, stream, result);
+        _tgenio_flushStream(io, stream, handle);
+    } else if(op == TGEN_IO_OP_ACCEPT) {
+        _tgenio_onAcceptCompleted(io, stream, result);
+    }
+
+    if(stream->numOpsArmed == 0) {
+        g_hash_table_remove(io->orphanStreams, &handle);
+        _tgenio_freeStream(io, stream);
+    }
+}
+
+static void _tgenio_onStreamCompleted(TGenIO* io, TGenIOHandle handle, TGenIOOp op,
+        gint32 result, gint32 bufferID) {
+    TGenIOChild* child = _tgenio_getChildFromHandle(io, handle);
+    TGenIOStream* stream = child->stream;
+
+    if(op == TGEN_IO_OP_RECV) {
+        _tgenio_onRecvCompleted(io, stream, result, bufferID);
+        if(stream->isPollingRecv && child->numPollsArmed == 0) {
+            tgenuring_pollAdd(io->ring, child->descriptor, POLLIN, handle);
+            child->numPollsArmed++;
+            child->pollEvents = TGEN_EVENT_READ;
+        }
+    } else if(op == TGEN_IO_OP_SEND) {
+        _tgenio_onSendCompleted(io, stream, result);
+        /* a short send leaves bytes behind */
+        _tgenio_flushStream(io, stream, handle);
+    } else if(op == TGEN_IO_OP_ACCEPT) {
+        _tgenio_onAcceptCompleted(io, stream, result);
+    }
+
+    /* read ahead, and notify the owner if it can make progress */
+    _tgenio_setStreamEvents(io, child, handle, child->events);
+}
+
+static void _tgenio_onPollCompleted(TGenIO* io, TGenIOHandle handle, gint32 result) {
+    TGenIOChild* child = _tgenio_getChildFromHandle(io, handle);
+
+    if(child->numPollsArmed > 0) {
+        child->numPollsArmed--;
+    }
+
+    if(child->stream) {
+        /* the poll was armed before the owner switched to the stream, or
+         * because we ran out of provided buffers */
+        if(child->numPollsArmed == 0) {
+            child->stream->isPollingRecv = FALSE;
+        }
 
-    /* storage for collecting events from our epoll descriptor */
-    struct epoll_event* epevs = g_new(struct epoll_event, maxEvents);
+        if(result >= 0 && (result & (POLLIN|POLLERR|POLLHUP)) && (child->events & TGEN_EVENT_READ)) {
+            _tgenio_helper(io, handle, TRUE, FALSE);
+        } else {
+            /* read through the ring again */
+            _tgenio_setStreamEvents(io, child, handle, child->events);
+        }
+        return;
+    }
+
+    if(result >= 0) {
+        /* errors and hangups are surfaced by the next read or write */
+        gboolean in = (result & (POLLIN|POLLERR|POLLHUP)) &&
+                (child->pollEvents & TGEN_EVENT_READ) ? TRUE : FALSE;
+        gboolean out = (result & (POLLOUT|POLLERR|POLLHUP)) &&
+                (child->pollEvents & TGEN_EVENT_WRITE) ? TRUE : FALSE;
+
+        if(in || out) {
+            /* the helper arms the next poll */
+            _tgenio_helper(io, handle, in, out);
+            return;
+        }
+    } else if(result != -ECANCELED) {
+        tgen_warning("io_uring poll on descriptor %i returned error %i: %s",
+                child->descriptor, -result, g_strerror(-result));
+    }
+
+    /* nothing to dispatch, keep watching if no other poll is */
+    if(child->numPollsArmed == 0 && child->events != TGEN_EVENT_NONE) {
+        _tgenio_armPoll(io, child, handle);
+    }
+}
+
+/* wakes a waiting loop at the deadline. a timeout that is already in
+ * flight for an earlier deadline is kept, we simply arm again after it. */
+static void _tgenio_armTimeout(TGenIO* io, gint64 timeoutMicros) {
+    gint64 deadlineMicros = g_get_monotonic_time() + timeoutMicros;
+
+    if(io->timeoutDeadlineMicros != 0) {
+        if(io->timeoutDeadlineMicros <= deadlineMicros) {
+            return;
+        }
+        tgenuring_timeoutRemove(io->ring, TGEN_IO_USER_DATA(io->timeoutSequence, TGEN_IO_OP_TIMEOUT));
+    }
+
+    io->timeoutSequence++;
+    if(tgenuring_timeout(io->ring, timeoutMicros, TGEN_IO_USER_DATA(io->timeoutSequence, TGEN_IO_OP_TIMEOUT))) {
+        io->timeoutDeadlineMicros = deadlineMicros;
+    } else {
+        io->timeoutDeadlineMicros = 0;
+    }
+}
+
+/* returns the time until the next timer expiration, or -1 if there is none */
+static gint64 _tgenio_getTimeoutMicros(TGenIO* io) {
+    gint64 expireMicros = tgentimerwheel_getNextExpireMicros(io->timers);
+    if(expireMicros == 0) {
+        return -1;
+    }
+    return MAX(expireMicros - g_get_monotonic_time(), 0);
+}
+
+static gint _tgenio_loopOnceURing(TGenIO* io, gint maxEvents, gboolean wait) {
+    gint numEvents = 0;
+    guint64 userData = 0;
+    gint32 result = 0;
+    gint32 bufferID = -1;
+
+    io->isLooping = TRUE;
+
+    /* streams that can make progress go first, and we must not block while any remain */
+    if(io->pendingHandles->len > 0) {
+        numEvents += _tgenio_runPending(io);
+        if(io->pendingHandles->len > 0) {
+            wait = FALSE;
+        }
+    }
+
+    if(wait && tgenuring_getNumCompletions(io->ring) == 0) {
+        gint64 timeoutMicros = io->isWaiting ? _tgenio_getTimeoutMicros(io) : -1;
+        if(timeoutMicros > 0) {
+            _tgenio_armTimeout(io, timeoutMicros);
+        }
+        if(timeoutMicros != 0) {
+            /* without a timeout, timers wake us through the timer wheel descriptor */
+            tgenuring_submit(io->ring, TRUE);
+        }
+    }
+
+    /* requests that the callbacks submit may complete right away, and serving
+     * them in this same turn would starve requests that the kernel completes
+     * asynchronously, like accepts. they wait for the next turn. */
+    guint numCompletions = tgenuring_getNumCompletions(io->ring);
+
+    while(numEvents < maxEvents && numCompletions > 0 &&
+            tgenuring_popCompletion(io->ring, &userData, &result, &bufferID)) {
+        numCompletions--;
+
+        if(userData == 0) {
+            /* the completion of a removal or cancellation */
+            continue;
+        }
+
+        TGenIOOp op = TGEN_IO_USER_DATA_OP(userData);
+        TGenIOHandle handle = TGEN_IO_USER_DATA_HANDLE(userData);
+
+        if(op == TGEN_IO_OP_TIMEOUT) {
+            if(handle == io->timeoutSequence) {
+                io->timeoutDeadlineMicros = 0;
+            }
+            continue;
+        }
+
+        TGenIOChild* child = _tgenio_getChildFromHandle(io, handle);
+
+        if(op != TGEN_IO_OP_POLL && (!child || !child->stream)) {
+            _tgenio_onOrphanCompleted(io, handle, op, result, bufferID);
+            continue;
+        }
+
+        if(!child) {
+            /* the poll outlived the registration it was armed for */
+            continue;
+        }
+
+        numEvents++;
+
+        if(op == TGEN_IO_OP_POLL) {
+            _tgenio_onPollCompleted(io, handle, result);
+        } else {
+            _tgenio_onStreamCompleted(io, handle, op, result, bufferID);
+        }
+    }
+
+    /* serve the reads and writes that just completed in this same turn */
+    if(io->pendingHandles->len > 0 && numEvents < maxEvents) {
+        numEvents += _tgenio_runPending(io);
+    }
+
+    io->isLooping = FALSE;
+
+    /* hand all of the requests we made while looping to the kernel at once */
+    tgenuring_submit(io->ring, FALSE);
+
+    return numEvents;
+}
+
+static gint _tgenio_epollWait(TGenIO* io, struct epoll_event* epevs, gint maxEvents, gint64 timeoutMicros) {
+    io->numSyscalls++;
+
+#ifdef SYS_epoll_pwait2
+    /* epoll_pwait2 lets us wake up right at the timer deadline */
+    if(timeoutMicros > 0 && !io->noPWait2) {
+        struct timespec timeout;
+        timeout.tv_sec = timeoutMicros / 1000000;
+        timeout.tv_nsec = (timeoutMicros % 1000000) * 1000;
+
+        gint nfds = (gint)syscall(SYS_epoll_pwait2, io->epollD, epevs, maxEvents, &timeout, NULL, 0);
+        if(nfds >= 0 || errno != ENOSYS) {
+            return nfds;
+        }
+
+        tgen_info("epoll_pwait2 is not supported, falling back to epoll_wait");
+        io->noPWait2 = TRUE;
+    }
+#endif
+
+    /* round up so we never wake up before the deadline */
+    gint timeoutMillis = timeoutMicros < 0 ? -1 :
+            (gint)MIN((timeoutMicros + 999) / 1000, (gint64)G_MAXINT);
+    return epoll_wait(io->epollD, epevs, maxEvents, timeoutMillis);
+}
+
+static gint _tgenio_loopOnceEpoll(TGenIO* io, gint maxEvents, gint64 timeoutMicros) {
+    /* persistent storage for collecting events from our epoll descriptor */
+    if(maxEvents > io->epollEventsLength) {
+        io->epollEvents = g_renew(struct epoll_event, io->epollEvents, maxEvents);
+        io->epollEventsLength = maxEvents;
+    }
+    struct epoll_event* epevs = io->epollEvents;
+
+    /* children with pending work go first, and we must not block while any remain */
+    gint numPending = 0;
+    if(io->pendingHandles->len > 0) {
+        numPending = _tgenio_runPending(io);
+        if(io->pendingHandles->len > 0) {
+            timeoutMicros = 0;
+        }
+    }
 
     /* collect all events that are ready */
-    gint nfds = epoll_wait(io->epollD, epevs, maxEvents, 0);
+    gint nfds = _tgenio_epollWait(io, epevs, maxEvents, timeoutMicros);
 
     if(nfds < 0) {
-        tgen_critical("epoll_wait(): epoll %i returned %i error %i: %s",
-                io->epollD, nfds, errno, g_strerror(errno));
-        g_free(epevs);
+        if(errno != EINTR) {
+            tgen_critical("epoll_wait(): epoll %i returned %i error %i: %s",
+                    io->epollD, nfds, errno, g_strerror(errno));
+        }
 
-        /* we didn't process any events */
-        return 0;
+        /* we didn't process any new events */
+        return numPending;
     }
 
     /* activate correct component for every descriptor that's ready. */
@@ -196,11 +1160,11 @@ gint tgenio_loopOnce(TGenIO* io, gint maxEvents) {
         gboolean in = (epevs[i].events & EPOLLIN) ? TRUE : FALSE;
         gboolean out = (epevs[i].events & EPOLLOUT) ? TRUE : FALSE;
 
-        gint eventDescriptor = epevs[i].data.fd;
-        TGenIOChild* child = g_hash_table_lookup(io->children, GINT_TO_POINTER(eventDescriptor));
+        TGenIOHandle handle = epevs[i].data.u64;
+        gint eventDescriptor = TGEN_IO_HANDLE_DESCRIPTOR(handle);
 
-        if(child) {
-            _tgenio_helper(io, child, in, out);
+        if(_tgenio_getChild(io, eventDescriptor)) {
+            _tgenio_helper(io, handle, in, out);
         } else {
             /* we don't currently have a child for the event descriptor, stop paying attention to it */
             tgen_warning("can't find child for descriptor %i, canceling event now", eventDescriptor);
@@ -208,80 +1172,319 @@ gint tgenio_loopOnce(TGenIO* io, gint maxEvents) {
         }
     }
 
-    g_free(epevs);
-    return nfds;
+    return numPending + nfds;
 }
 
-void tgenio_checkTimeouts(TGenIO* io) {
+/* processes up to maxEvents ready events without blocking. the epoll
+ * descriptor becomes readable whenever this should be called. */
+gint tgenio_loopOnce(TGenIO* io, gint maxEvents) {
     TGEN_ASSERT(io);
 
-    /* TODO this was a quick polling approach to checking for timeouts, which
-     * could be more efficient if replaced with an asynchronous notify design. */
-    GList* items = g_hash_table_get_values(io->children);
-    GList* item = g_list_first(items);
-
-    while(item) {
-        TGenIOChild* child = item->data;
-        if(child && child->checkTimeout) {
-            /* this calls tgentransfer_onCheckTimeout to check and handle if a timeout is present */
-            gboolean hasTimeout = child->checkTimeout(child->data, child->descriptor);
-            if(hasTimeout) {
-                tgenio_deregister(io, child->descriptor);
-            }
-        }
-        item = g_list_next(item);
+    if(io->backend == TGEN_IO_BACKEND_URING) {
+        return _tgenio_loopOnceURing(io, maxEvents, FALSE);
     }
 
-    if(items != NULL) {
-        g_list_free(items);
+    gint numEvents = _tgenio_loopOnceEpoll(io, maxEvents, 0);
+
+    /* nothing wakes us up for pending work, so we keep taking turns until it is done */
+    while(io->pendingHandles->len > 0) {
+        numEvents += _tgenio_loopOnceEpoll(io, maxEvents, 0);
+    }
+
+    return numEvents;
+}
+
+/* blocks until descriptors are ready or timers expire, and processes up to
+ * maxEvents ready events. the first call stops using the timer wheel
+ * descriptor and instead derives the wait timeout from the next timer
+ * deadline (with io_uring, through a timeout request), so tgenio_loopOnce
+ * must not be used on the same io afterwards. with io_uring, sockets that
+ * are read or written through tgenio_read and tgenio_write from then on
+ * have those reads and writes submitted through the ring. rings without
+ * socket io keep waking up through the timer wheel descriptor. */
+gint tgenio_loopWait(TGenIO* io, gint maxEvents) {
+    TGEN_ASSERT(io);
+
+    if(!io->isWaiting && (io->backend == TGEN_IO_BACKEND_EPOLL || io->hasStreams)) {
+        gint timerD = tgentimerwheel_getDescriptor(io->timers);
+        tgenio_deregister(io, timerD);
+        tgentimerwheel_disableDescriptor(io->timers);
+        io->isWaiting = TRUE;
     }
+
+    gint numEvents = 0;
+    if(io->backend == TGEN_IO_BACKEND_URING) {
+        numEvents = _tgenio_loopOnceURing(io, maxEvents, TRUE);
+    } else {
+        numEvents = _tgenio_loopOnceEpoll(io, maxEvents, _tgenio_getTimeoutMicros(io));
+    }
+
+    gint64 expireMicros = io->isWaiting ? tgentimerwheel_getNextExpireMicros(io->timers) : 0;
+    if(expireMicros != 0 && expireMicros <= g_get_monotonic_time()) {
+        tgentimerwheel_expire(io->timers);
+    }
+
+    return numEvents;
 }
 
 /** Modify the tgenio epoll instance so that it notifies us when the given
- * events occur on the given descriptor. */
+ * events occur on the descriptor registration identified by the handle.
+ * Nothing happens if the handle is stale, i.e., the descriptor was deregistered
+ * (and possibly reused by another registration) since the handle was taken. */
 void
-tgenio_setEvents(TGenIO *io, gint descriptor, TGenEvent events)
+tgenio_setEvents(TGenIO *io, TGenIOHandle handle, TGenEvent events)
 {
-    /* FIXME
-     * RGJ: there is an error here due to the new SCHED transfer code.
-     * If a SCHED wants to delay sending, then it uses this function to
-     * disable events and then it pauses for a while. In the meantime,
-     * the transfer might close because of a timeout or stallout, and
-     * that event will destroy the descriptor and deregister it from
-     * the children table. Then the SCHED pause timer expires and this
-     * function is called with a descriptor that is no longer valid, or
-     * worse, with a descriptor that has been re-assigned to a completely
-     * different socket.
-     *
-     * For now I'm going to add the children table check, but this needs
-     * to be redesigned to avoid this problem in the first place.
-     * (We probably need to ref and store the transport object in the
-     * pause event, and then when it expires, we can check a flag somewhere
-     * to see if it is in an error state and only continue if it's not.)
-     */
-    if(g_hash_table_lookup(io->children, GINT_TO_POINTER(descriptor)) == NULL) {
-        tgen_warning("transport descriptor %i cannot be found", descriptor);
+    TGEN_ASSERT(io);
+
+    TGenIOChild* child = _tgenio_getChildFromHandle(io, handle);
+    if(!child) {
+        tgen_info("descriptor %i is no longer registered with handle %"G_GUINT64_FORMAT", not setting events",
+                TGEN_IO_HANDLE_DESCRIPTOR(handle), handle);
         return;
     }
 
-    struct epoll_event ee;
-    memset(&ee, 0, sizeof(struct epoll_event));
-    if (events & TGEN_EVENT_READ) {
-        ee.events |= EPOLLIN;
+    _tgenio_setChildEvents(io, child, handle, events);
+}
+
+/* copies (or with a NULL buffer, drops) up to length bytes of the reads that
+ * already completed. if none did, we read directly unless a read is in flight. */
+static gssize _tgenio_readStream(TGenIO* io, TGenIOChild* child, gpointer buffer, gsize length) {
+    TGenIOStream* stream = child->stream;
+    gsize totalBytes = 0;
+
+    while(totalBytes < length && stream->numReceived > 0) {
+        TGenIOReceived* received = &stream->received[stream->receivedHead];
+        gsize bytes = MIN(length - totalBytes, (gsize)(received->length - received->offset));
+
+        if(buffer) {
+            guint8* position = tgenuring_getBuffer(io->ring, received->bufferID);
+            memcpy((guint8*)buffer + totalBytes, position + received->offset, bytes);
+        }
+
+        received->offset += (guint32)bytes;
+        totalBytes += bytes;
+
+        if(received->offset >= received->length) {
+            tgenuring_recycleBuffer(io->ring, received->bufferID);
+            stream->receivedHead = (stream->receivedHead + 1) % TGEN_IO_STREAM_MAX_QUEUED;
+            stream->numReceived--;
+        }
     }
-    if (events & TGEN_EVENT_WRITE) {
-        ee.events |= EPOLLOUT;
+
+    if(totalBytes > 0) {
+        /* we made room to read ahead */
+        if(child->events & TGEN_EVENT_READ) {
+            _tgenio_armStreamRead(io, stream, stream->handle);
+        }
+        return (gssize)totalBytes;
+    } else if(stream->recvError != 0) {
+        errno = stream->recvError;
+        return -1;
+    } else if(stream->isEOF) {
+        return 0;
+    } else if(stream->isRecvArmed || stream->isPollingRecv) {
+        errno = EAGAIN;
+        return -1;
     }
-    ee.data.fd = descriptor;
-    gint result = epoll_ctl(io->epollD, EPOLL_CTL_MOD, descriptor, &ee);
-    if (result != 0) {
-        tgen_warning("epoll_ctl(): epoll %i descriptor %i returned %i error %i: %s",
-                io->epollD, descriptor, result, errno, g_strerror(errno));
+
+    /* the socket was reported readable by a poll. accepted sockets may be
+     * blocking, and the owner may read without having been told to. */
+    io->numSyscalls++;
+    if(buffer) {
+        return recv(child->descriptor, buffer, length, MSG_DONTWAIT);
+    } else {
+        return recv(child->descriptor, NULL, length, MSG_TRUNC|MSG_DONTWAIT);
+    }
+}
+
+/* reads from the socket, and otherwise behaves like read(). with io_uring,
+ * the first call makes the reads of the registered socket go through the
+ * ring, and we return what the reads that already completed returned. */
+gssize tgenio_read(TGenIO* io, gint descriptor, gpointer buffer, gsize length) {
+    TGEN_ASSERT(io);
+
+    TGenIOChild* child = _tgenio_getChild(io, descriptor);
+    if(child && _tgenio_getStream(io, child, FALSE)) {
+        return _tgenio_readStream(io, child, buffer, length);
     }
 
+    io->numSyscalls++;
+    return read(descriptor, buffer, length);
 }
 
+/* drops up to length received bytes without copying them, and otherwise
+ * behaves like recv() with MSG_TRUNC */
+gssize tgenio_discard(TGenIO* io, gint descriptor, gsize length) {
+    TGEN_ASSERT(io);
+
+    TGenIOChild* child = _tgenio_getChild(io, descriptor);
+    if(child && _tgenio_getStream(io, child, FALSE)) {
+        return _tgenio_readStream(io, child, NULL, length);
+    }
+
+    io->numSyscalls++;
+    return recv(descriptor, NULL, length, MSG_TRUNC);
+}
+
+/* writes to the socket, and otherwise behaves like write(). with io_uring,
+ * the bytes are staged and sent once the notify function of the socket
+ * returns; errors of earlier sends are returned by the next write. */
+gssize tgenio_write(TGenIO* io, gint descriptor, gconstpointer buffer, gsize length) {
+    TGEN_ASSERT(io);
+
+    TGenIOChild* child = _tgenio_getChild(io, descriptor);
+    TGenIOStream* stream = child ? _tgenio_getStream(io, child, FALSE) : NULL;
+    if(!stream) {
+        io->numSyscalls++;
+        return write(descriptor, buffer, length);
+    }
+
+    if(stream->sendError != 0) {
+        errno = stream->sendError;
+        return -1;
+    }
+
+    if(!stream->sendBuffer) {
+        stream->sendBuffer = io->spareSendBuffers->len > 0 ?
+                g_ptr_array_remove_index_fast(io->spareSendBuffers, io->spareSendBuffers->len - 1) :
+                g_malloc(TGEN_IO_STREAM_SEND_LENGTH);
+    }
+
+    /* bytes that were sent make room once nothing is in flight */
+    if(!stream->isSendArmed && stream->sendOffset > 0) {
+        memmove(stream->sendBuffer, stream->sendBuffer + stream->sendOffset,
+                stream->sendLength - stream->sendOffset);
+        stream->sendLength -= stream->sendOffset;
+        stream->sendOffset = 0;
+    }
+
+    gsize bytes = MIN(length, TGEN_IO_STREAM_SEND_LENGTH - stream->sendLength);
+    if(bytes == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    memcpy(stream->sendBuffer + stream->sendLength, buffer, bytes);
+    stream->sendLength += bytes;
+
+    /* writes from outside of the notify function go out right away */
+    if(io->notifyingHandle != stream->handle) {
+        _tgenio_flushStream(io, stream, stream->handle);
+        _tgenio_flushPolls(io);
+    }
+
+    return (gssize)bytes;
+}
+
+/* sends from the file without copying it, and otherwise behaves like
+ * sendfile(). sockets whose writes go through the io_uring return EINVAL,
+ * so that the caller falls back to tgenio_write and keeps the bytes in order. */
+gssize tgenio_sendfile(TGenIO* io, gint descriptor, gint fileD, gsize offset, gsize length) {
+    TGEN_ASSERT(io);
+
+    TGenIOChild* child = _tgenio_getChild(io, descriptor);
+    if(child && child->stream) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    off_t fileOffset = (off_t)offset;
+    io->numSyscalls++;
+    return sendfile(descriptor, fileD, &fileOffset, length);
+}
+
+/* accepts a connection on the listening socket, and otherwise behaves like
+ * accept(). with io_uring, the first call makes the accepts of the registered
+ * socket go through the ring, and we return the sockets they accepted. */
+gint tgenio_accept(TGenIO* io, gint descriptor, struct sockaddr* address, socklen_t* addressLength) {
+    TGEN_ASSERT(io);
+
+    TGenIOChild* child = _tgenio_getChild(io, descriptor);
+    TGenIOStream* stream = child ? _tgenio_getStream(io, child, TRUE) : NULL;
+    if(!stream) {
+        io->numSyscalls++;
+        return accept(descriptor, address, addressLength);
+    }
+
+    if(stream->numAccepted > 0) {
+        TGenIOAccepted* accepted = &stream->accepted[stream->acceptedHead];
+        stream->acceptedHead = (stream->acceptedHead + 1) % TGEN_IO_STREAM_MAX_QUEUED;
+        stream->numAccepted--;
+
+        if(address && addressLength) {
+            memcpy(address, &accepted->address, MIN(*addressLength, accepted->addressLength));
+            *addressLength = accepted->addressLength;
+        }
+
+        /* we made room to accept ahead */
+        if(child->events & TGEN_EVENT_READ) {
+            _tgenio_armStreamRead(io, stream, stream->handle);
+        }
+        return accepted->descriptor;
+    } else if(stream->acceptError != 0) {
+        /* accept errors only concern the connection that failed */
+        errno = stream->acceptError;
+        stream->acceptError = 0;
+        return -1;
+    } else if(stream->isAcceptArmed && !stream->isAcceptDraining) {
+        errno = EWOULDBLOCK;
+        return -1;
+    }
+
+    /* the ring accepts one connection per turn of the loop, which is too slow
+     * to keep a busy backlog from overflowing. so after each accept completes,
+     * we accept the rest directly until the backlog is empty, like epoll does. */
+    io->numSyscalls++;
+    gint result = accept(descriptor, address, addressLength);
+    if(result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        stream->isAcceptDraining = FALSE;
+    }
+    return result;
+}
+
+/* returns the number of epoll_ctl modifications we issued and avoided
+ * since the last call, and resets the counters */
+void tgenio_collectEpollModCounts(TGenIO* io, guint64* numIssued, guint64* numAvoided) {
+    TGEN_ASSERT(io);
+
+    if(numIssued) {
+        *numIssued = io->numModsIssued;
+    }
+    if(numAvoided) {
+        *numAvoided = io->numModsAvoided;
+    }
+
+    io->numModsIssued = 0;
+    io->numModsAvoided = 0;
+}
+
+/* returns the number of system calls we made to wait for events and to
+ * read, write, and accept since the last call, and resets the counter.
+ * with io_uring, reads and writes through the ring only count towards the
+ * io_uring_enter calls that submit them. */
+guint64 tgenio_collectNumSyscalls(TGenIO* io) {
+    TGEN_ASSERT(io);
+
+    guint64 numSyscalls = io->numSyscalls;
+    if(io->ring) {
+        numSyscalls += tgenuring_collectNumEnters(io->ring);
+    }
+
+    io->numSyscalls = 0;
+    return numSyscalls;
+}
+
+TGenIOBackend tgenio_getBackend(TGenIO* io) {
+    TGEN_ASSERT(io);
+    return io->backend;
+}
+
+/* the descriptor becomes readable when events are ready to be processed
+ * with tgenio_loopOnce. with io_uring, that is the ring descriptor. */
 gint tgenio_getEpollDescriptor(TGenIO* io) {
     TGEN_ASSERT(io);
+    if(io->backend == TGEN_IO_BACKEND_URING) {
+        return tgenuring_getDescriptor(io->ring);
+    }
     return io->epollD;
 }
@@ -13,24 +13,52 @@ typedef enum _TGenEvent {
     TGEN_EVENT_READ = 1 << 0,
     TGEN_EVENT_WRITE = 1 << 1,
     TGEN_EVENT_DONE = 1 << 2,
+    /* the descriptor may still be ready, e.g., because an io budget ran out.
+     * edge-triggered descriptors are notified again without waiting for the kernel. */
+    TGEN_EVENT_PENDING = 1 << 3,
 } TGenEvent;
 
+typedef enum _TGenIOBackend {
+    TGEN_IO_BACKEND_EPOLL,
+    TGEN_IO_BACKEND_URING,
+} TGenIOBackend;
+
 typedef TGenEvent (*TGenIO_notifyEventFunc)(gpointer data, gint descriptor, TGenEvent events);
-typedef gboolean (*TGenIO_notifyCheckTimeoutFunc)(gpointer data, gint descriptor);
+
+/* identifies one registration of a descriptor, 0 is never a valid handle */
+typedef guint64 TGenIOHandle;
 
 typedef struct _TGenIO TGenIO;
 
-TGenIO* tgenio_new();
+TGenIO* tgenio_new(TGenIOBackend backend);
 void tgenio_ref(TGenIO* io);
 void tgenio_unref(TGenIO* io);
+void tgenio_setEdgeTriggered(TGenIO* io, gboolean edgeTriggered);
 
 gboolean tgenio_register(TGenIO* io, gint descriptor, TGenIO_notifyEventFunc notify,
-        TGenIO_notifyCheckTimeoutFunc checkTimeout, gpointer data, GDestroyNotify destructData);
+        gpointer data, GDestroyNotify destructData);
 void tgenio_deregister(TGenIO* io, gint descriptor);
+TGenIOHandle tgenio_getHandle(TGenIO* io, gint descriptor);
+
+void tgenio_registerTimer(TGenIO* io, TGenTimer* timer);
+void tgenio_deregisterTimer(TGenIO* io, TGenTimer* timer);
+guint tgenio_getNumTimers(TGenIO* io);
+void tgenio_collectTimerLateness(TGenIO* io, guint64* numExpired,
+        guint64* meanLatenessMicros, guint64* maxLatenessMicros);
 
 gint tgenio_loopOnce(TGenIO* io, gint maxEvents);
-void tgenio_checkTimeouts(TGenIO* io);
-void tgenio_setEvents(TGenIO *io, gint descriptor, TGenEvent events);
+gint tgenio_loopWait(TGenIO* io, gint maxEvents);
+void tgenio_setEvents(TGenIO *io, TGenIOHandle handle, TGenEvent events);
+
+gssize tgenio_read(TGenIO* io, gint descriptor, gpointer buffer, gsize length);
+gssize tgenio_discard(TGenIO* io, gint descriptor, gsize length);
+gssize tgenio_write(TGenIO* io, gint descriptor, gconstpointer buffer, gsize length);
+gssize tgenio_sendfile(TGenIO* io, gint descriptor, gint fileD, gsize offset, gsize length);
+gint tgenio_accept(TGenIO* io, gint descriptor, struct sockaddr* address, socklen_t* addressLength);
+
+void tgenio_collectEpollModCounts(TGenIO* io, guint64* numIssued, guint64* numAvoided);
+guint64 tgenio_collectNumSyscalls(TGenIO* io);
+TGenIOBackend tgenio_getBackend(TGenIO* io);
 gint tgenio_getEpollDescriptor(TGenIO* io);
 
 #endif /* TGEN_IO_H_ */
@@ -3,16 +3,104 @@
  */
 
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 #include <glib.h>
 
+#include "tgen-log.h"
+
+/* the longest line we log, longer lines are truncated */
+#define TGEN_LOG_LINE_LENGTH 8192
+/* each thread queues lines in a ring of this many fixed-size records. a line
+ * longer than a record uses consecutive records. must be a power of 2. */
+#define TGEN_LOG_RING_RECORDS 2048
+#define TGEN_LOG_RECORD_LENGTH 512
+/* how long a thread sleeps between checks for space in its full ring */
+#define TGEN_LOG_FULL_WAIT_USEC 100
+/* the writer sleeps this long when all rings are empty */
+#define TGEN_LOG_WRITER_SLEEP_USEC 10000
+/* the most records we write with one writev() */
+#define TGEN_LOG_WRITER_BATCH 1024
+
+typedef struct _TGenLogRecord {
+    guint length;
+    gchar bytes[TGEN_LOG_RECORD_LENGTH];
+} TGenLogRecord;
+
+/* a single producer (the thread that owns it) and single consumer (the writer)
+ * queue. head and tail only grow, and wrap into the records with a mask. */
+typedef struct _TGenLogRing TGenLogRing;
+struct _TGenLogRing {
+    TGenLogRecord* records;
+    /* the records the owner published */
+    gsize head;
+    /* the records the writer printed, and how much of the next one */
+    gsize tail;
+    gsize tailOffset;
+    /* all the rings we ever created, so the writer can find them */
+    TGenLogRing* next;
+};
+
 /* store a global pointer to the log filter */
 GLogLevelFlags tgenLogFilterLevel = G_LOG_LEVEL_MESSAGE;
 
+static TGenLogBackend tgenLogBackend = TGEN_LOG_BACKEND_SYNC;
+/* the log file, or -1 for stdout */
+static gint tgenLogFD = -1;
+static TGenLogRing* tgenLogRings = NULL;
+static GThread* tgenLogWriter = NULL;
+static gboolean tgenLogWriterStopping = FALSE;
+static guint64 tgenLogNumDropped = 0;
+
+/* each thread's ring, and the date string of the second it logged last */
+static __thread TGenLogRing* threadRing = NULL;
+static __thread gint64 threadDateSecond = -1;
+static __thread gchar threadDateStr[32];
+
 void tgenlog_setLogFilterLevel(GLogLevelFlags level) {
     tgenLogFilterLevel = level;
 }
 
+/* TRUE if messages at this level pass the filter */
+gboolean tgenlog_isLevelEnabled(GLogLevelFlags level) {
+    return (level <= tgenLogFilterLevel) ? TRUE : FALSE;
+}
+
+/* the number of lines we dropped because a ring was full, or because we could
+ * not write them */
+guint64 tgenlog_getNumDropped() {
+    return __atomic_load_n(&tgenLogNumDropped, __ATOMIC_RELAXED);
+}
+
+/* sends lines to the file at the path instead of stdout, which we do once we
+ * read the config and before we start the workers */
+gboolean tgenlog_setFile(const gchar* path) {
+    g_assert(path);
+
+    gint fileD = open(path, O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0644);
+    if(fileD < 0) {
+        g_print("open(): unable to open log file '%s', error %i: %s\n", path, errno, g_strerror(errno));
+        return FALSE;
+    }
+
+    /* lines we printed so far stay on stdout */
+    fflush(stdout);
+    tgenLogFD = fileD;
+    return TRUE;
+}
+
+/* the descriptor that the lines go to */
+static gint _tgenlog_getDescriptor() {
+    return (tgenLogFD >= 0) ? tgenLogFD : STDOUT_FILENO;
+}
+
 static const gchar* _tgenlog_logLevelToString(GLogLevelFlags logLevel) {
     switch (logLevel) {
         case G_LOG_LEVEL_ERROR:
@@ -32,34 +120,216 @@ static const gchar* _tgenlog_logLevelToString(GLogLevelFlags logLevel) {
     }
 }
 
-void tgenlog_printMessage(GLogLevelFlags level, const gchar* fileName, const gint lineNum,
-        const gchar* functionName, const gchar* format, ...) {
-    if(level > tgenLogFilterLevel) {
-        return;
+/* writes the whole line including the newline into the buffer, and returns its length */
+static gsize _tgenlog_formatLine(gchar* buffer, gsize bufferLength, GLogLevelFlags level,
+        const gchar* fileName, const gint lineNum, const gchar* functionName,
+        const gchar* format, va_list vargs) {
+    const gchar* fileStr = "n/a";
+    if(fileName) {
+        const gchar* separator = strrchr(fileName, G_DIR_SEPARATOR);
+        fileStr = separator ? separator + 1 : fileName;
     }
+    const gchar* functionStr = functionName ? functionName : "n/a";
 
-    va_list vargs;
-    va_start(vargs, format);
+    /* we only format the local date once per second */
+    gint64 nowMicros = g_get_real_time();
+    gint64 nowSeconds = nowMicros / G_USEC_PER_SEC;
+    if(nowSeconds != threadDateSecond) {
+        time_t seconds = (time_t)nowSeconds;
+        struct tm local;
+        localtime_r(&seconds, &local);
+        strftime(threadDateStr, sizeof(threadDateStr), "%Y-%m-%d %H:%M:%S", &local);
+        threadDateSecond = nowSeconds;
+    }
 
-    gchar* fileStr = fileName ? g_path_get_basename(fileName) : g_strdup("n/a");
-    const gchar* functionStr = functionName ? functionName : "n/a";
+    gint length = g_snprintf(buffer, bufferLength, "%s %"G_GINT64_FORMAT".%06i [%s] [%s:%i] [%s] ",
+            threadDateStr, nowSeconds, (gint)(nowMicros % G_USEC_PER_SEC),
+            _tgenlog_logLevelToString(level), fileStr, lineNum, functionStr);
+    gsize used = MIN((gsize)MAX(length, 0), bufferLength - 2);
+
+    length = g_vsnprintf(&buffer[used], bufferLength - used - 1, format, vargs);
+    used = MIN(used + (gsize)MAX(length, 0), bufferLength - 2);
+
+    buffer[used++] = '\n';
+    buffer[used] = '\0';
+    return used;
+}
+
+static TGenLogRing* _tgenlog_getThreadRing() {
+    if(!threadRing) {
+        TGenLogRing* ring = g_new0(TGenLogRing, 1);
+        ring->records = g_new(TGenLogRecord, TGEN_LOG_RING_RECORDS);
+
+        /* the writer may be walking the list, so we only ever push at the front */
+        ring->next = __atomic_load_n(&tgenLogRings, __ATOMIC_RELAXED);
+        while(!__atomic_compare_exchange_n(&tgenLogRings, &ring->next, ring,
+                TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+        threadRing = ring;
+    }
+    return threadRing;
+}
+
+/* copies the line into our ring without blocking on the writer, unless the
+ * ring is full and the line is one we must not lose */
+static void _tgenlog_enqueue(GLogLevelFlags level, const gchar* line, gsize length) {
+    TGenLogRing* ring = _tgenlog_getThreadRing();
+
+    gsize numRecords = (length + TGEN_LOG_RECORD_LENGTH - 1) / TGEN_LOG_RECORD_LENGTH;
+    gsize head = ring->head;
+
+    while(head + numRecords - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > TGEN_LOG_RING_RECORDS) {
+        /* the writer fell behind. we drop info and debug lines so we do not
+         * stall the event loop for them. message lines carry the transfer and
+         * heartbeat results that the analysis needs, so they and the lines
+         * that tell about problems wait for the writer, in order. */
+        if(level >= G_LOG_LEVEL_INFO) {
+            __atomic_add_fetch(&tgenLogNumDropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        g_usleep(TGEN_LOG_FULL_WAIT_USEC);
+    }
 
-    GDateTime* dt = g_date_time_new_now_local();
-    GString* newformat = g_string_new(NULL);
+    for(gsize i = 0; i < numRecords; i++) {
+        TGenLogRecord* record = &ring->records[(head + i) & (TGEN_LOG_RING_RECORDS - 1)];
+        gsize offset = i * TGEN_LOG_RECORD_LENGTH;
+        record->length = (guint)MIN(length - offset, TGEN_LOG_RECORD_LENGTH);
+        memcpy(record->bytes, &line[offset], record->length);
+    }
+
+    __atomic_store_n(&ring->head, head + numRecords, __ATOMIC_RELEASE);
+}
+
+/* writes what the ring holds in one writev, and returns the bytes we wrote */
+static gsize _tgenlog_flushRing(TGenLogRing* ring) {
+    gsize head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    gsize tail = ring->tail;
+    if(tail == head) {
+        return 0;
+    }
+
+    struct iovec iov[TGEN_LOG_WRITER_BATCH];
+    gint numIOV = 0;
+    for(gsize position = tail; position < head && numIOV < TGEN_LOG_WRITER_BATCH; position++) {
+        TGenLogRecord* record = &ring->records[position & (TGEN_LOG_RING_RECORDS - 1)];
+        gsize offset = (position == tail) ? ring->tailOffset : 0;
+        iov[numIOV].iov_base = &record->bytes[offset];
+        iov[numIOV].iov_len = record->length - offset;
+        numIOV++;
+    }
+
+    gssize written = writev(_tgenlog_getDescriptor(), iov, numIOV);
+    if(written < 0) {
+        if(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            /* we can not print, so we do not hold the lines forever */
+            __atomic_add_fetch(&tgenLogNumDropped, (guint64)(head - tail), __ATOMIC_RELAXED);
+            ring->tailOffset = 0;
+            __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+        }
+        return 0;
+    }
+
+    /* a short write leaves us inside a record */
+    gsize remaining = (gsize)written;
+    while(remaining > 0) {
+        TGenLogRecord* record = &ring->records[tail & (TGEN_LOG_RING_RECORDS - 1)];
+        gsize recordRemaining = record->length - ring->tailOffset;
+        if(remaining >= recordRemaining) {
+            remaining -= recordRemaining;
+            ring->tailOffset = 0;
+            tail++;
+        } else {
+            ring->tailOffset += remaining;
+            remaining = 0;
+        }
+    }
+
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    return (gsize)written;
+}
+
+static gpointer _tgenlog_runWriter(gpointer unused) {
+    while(TRUE) {
+        /* check before we flush, so we drain everything logged before the stop */
+        gboolean isStopping = __atomic_load_n(&tgenLogWriterStopping, __ATOMIC_ACQUIRE);
+
+        gsize written = 0;
+        for(TGenLogRing* ring = __atomic_load_n(&tgenLogRings, __ATOMIC_ACQUIRE);
+                ring != NULL; ring = ring->next) {
+            written += _tgenlog_flushRing(ring);
+        }
+
+        if(written == 0) {
+            if(isStopping) {
+                break;
+            }
+            g_usleep(TGEN_LOG_WRITER_SLEEP_USEC);
+        }
+    }
+    return NULL;
+}
+
+/* runs at exit, so the lines still queued make it out */
+static void _tgenlog_stopWriter() {
+    if(tgenLogWriter) {
+        __atomic_store_n(&tgenLogWriterStopping, TRUE, __ATOMIC_RELEASE);
+        g_thread_join(tgenLogWriter);
+        tgenLogWriter = NULL;
+    }
+}
+
+/* the backend can only be switched from sync to async, which we do once we
+ * read the config and before we start the workers */
+void tgenlog_setBackend(TGenLogBackend backend) {
+    if(backend != TGEN_LOG_BACKEND_ASYNC || tgenLogWriter) {
+        return;
+    }
 
-    g_string_append_printf(newformat, "%04i-%02i-%02i %02i:%02i:%02i %"G_GINT64_FORMAT".%06i [%s] [%s:%i] [%s] %s",
-            g_date_time_get_year(dt), g_date_time_get_month(dt), g_date_time_get_day_of_month(dt),
-            g_date_time_get_hour(dt), g_date_time_get_minute(dt), g_date_time_get_second(dt),
-            g_date_time_to_unix(dt), g_date_time_get_microsecond(dt),
-            _tgenlog_logLevelToString(level), fileStr, lineNum, functionName, format);
+    /* lines we printed so far must come out before the queued ones */
+    fflush(stdout);
 
-    gchar* message = g_strdup_vprintf(newformat->str, vargs);
-    g_print("%s\n", message);
-    g_free(message);
+    GError* error = NULL;
+    tgenLogWriter = g_thread_try_new("tgen-log-writer", _tgenlog_runWriter, NULL, &error);
+    if(!tgenLogWriter) {
+        g_print("failed to start the log writer thread, logging synchronously: %s\n", error->message);
+        g_error_free(error);
+        return;
+    }
 
-    g_string_free(newformat, TRUE);
-    g_date_time_unref(dt);
-    g_free(fileStr);
+    atexit(_tgenlog_stopWriter);
+    __atomic_store_n(&tgenLogBackend, TGEN_LOG_BACKEND_ASYNC, __ATOMIC_RELEASE);
+}
 
+void tgenlog_printMessage(GLogLevelFlags level, const gchar* fileName, const gint lineNum,
+        const gchar* functionName, const gchar* format, ...) {
+    if(level > tgenLogFilterLevel) {
+        return;
+    }
+
+    gchar line[TGEN_LOG_LINE_LENGTH];
+
+    va_list vargs;
+    va_start(vargs, format);
+    gsize length = _tgenlog_formatLine(line, TGEN_LOG_LINE_LENGTH, level,
+            fileName, lineNum, functionName, format, vargs);
     va_end(vargs);
+
+    if(__atomic_load_n(&tgenLogBackend, __ATOMIC_ACQUIRE) == TGEN_LOG_BACKEND_ASYNC) {
+        _tgenlog_enqueue(level, line, length);
+    } else if(tgenLogFD >= 0) {
+        /* O_APPEND keeps lines from different threads whole */
+        gsize offset = 0;
+        while(offset < length) {
+            gssize written = write(tgenLogFD, &line[offset], length - offset);
+            if(written < 0 && errno == EINTR) {
+                continue;
+            } else if(written <= 0) {
+                __atomic_add_fetch(&tgenLogNumDropped, 1, __ATOMIC_RELAXED);
+                break;
+            }
+            offset += (gsize)written;
+        }
+    } else {
+        g_print("%s", line);
+    }
 }
@@ -9,18 +9,35 @@
 
 #include <glib.h>
 
+/* how formatted lines get to stdout or the log file */
+typedef enum _TGenLogBackend {
+    /* the logging thread prints each line itself */
+    TGEN_LOG_BACKEND_SYNC,
+    /* the logging thread queues lines in its ring, and a writer thread prints them */
+    TGEN_LOG_BACKEND_ASYNC,
+} TGenLogBackend;
+
 void tgenlog_setLogFilterLevel(GLogLevelFlags level);
+gboolean tgenlog_isLevelEnabled(GLogLevelFlags level);
+
+gboolean tgenlog_setFile(const gchar* path);
+void tgenlog_setBackend(TGenLogBackend backend);
+guint64 tgenlog_getNumDropped();
 
 void tgenlog_printMessage(GLogLevelFlags level, const gchar* fileName, const gint lineNum,
         const gchar* functionName, const gchar* format, ...);
 
-#define tgen_error(...)     {tgenlog_printMessage(G_LOG_LEVEL_ERROR, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);}
-#define tgen_critical(...)  {tgenlog_printMessage(G_LOG_LEVEL_CRITICAL, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);}
-#define tgen_warning(...)   {tgenlog_printMessage(G_LOG_LEVEL_WARNING, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);}
-#define tgen_message(...)   {tgenlog_printMessage(G_LOG_LEVEL_MESSAGE, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);}
-#define tgen_info(...)      {tgenlog_printMessage(G_LOG_LEVEL_INFO, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);}
+/* the arguments are only evaluated if the message will be printed, so they
+ * may call functions that build strings */
+#define _tgen_log(level, ...) {if(tgenlog_isLevelEnabled(level)) {tgenlog_printMessage(level, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);}}
+
+#define tgen_error(...)     _tgen_log(G_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define tgen_critical(...)  _tgen_log(G_LOG_LEVEL_CRITICAL, __VA_ARGS__)
+#define tgen_warning(...)   _tgen_log(G_LOG_LEVEL_WARNING, __VA_ARGS__)
+#define tgen_message(...)   _tgen_log(G_LOG_LEVEL_MESSAGE, __VA_ARGS__)
+#define tgen_info(...)      _tgen_log(G_LOG_LEVEL_INFO, __VA_ARGS__)
 #ifdef DEBUG
-#define tgen_debug(...)     {tgenlog_printMessage(G_LOG_LEVEL_DEBUG, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);}
+#define tgen_debug(...)     _tgen_log(G_LOG_LEVEL_DEBUG, __VA_ARGS__)
 #else
 #define tgen_debug(...)
 #endif
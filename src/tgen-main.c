@@ -10,6 +10,12 @@
 
 #include "tgen.h"
 
+typedef struct _TGenWorker {
+    TGenDriver* driver;
+    GThread* thread;
+    gboolean isDone;
+} TGenWorker;
+
 static void _tgenmain_cleanup(gint status, gpointer arg) {
     if(arg) {
         TGenDriver* tgen = (TGenDriver*) arg;
@@ -17,6 +23,101 @@ static void _tgenmain_cleanup(gint status, gpointer arg) {
     }
 }
 
+static gpointer _tgenmain_runWorker(TGenWorker* worker) {
+    tgendriver_run(worker->driver);
+    __atomic_store_n(&worker->isDone, TRUE, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* runs one driver per worker thread. each driver has its own event loop,
+ * its own listening socket on the server port, and its own walk through a
+ * private copy of the action graph. the end actions count the progress of
+ * all of the workers, and an acyclic graph is only walked by one of them. */
+static gint _tgenmain_runWorkers(TGenGraph* graph, guint numWorkers) {
+    TGenDriverStats* stats = tgendriver_newSharedStats();
+    TGenWorker* workers = g_new0(TGenWorker, numWorkers);
+    guint numStarted = 0;
+    gint result = 0;
+
+    /* graphs are parsed and drivers are created here, because igraph is not thread-safe */
+    for(guint i = 0; i < numWorkers; i++) {
+        TGenGraph* workerGraph = graph;
+        if(i == 0) {
+            tgengraph_ref(graph);
+        } else {
+            workerGraph = tgengraph_new(tgengraph_getGraphPath(graph));
+        }
+
+        if(workerGraph) {
+            workers[i].driver = tgendriver_new(workerGraph, stats);
+            tgengraph_unref(workerGraph);
+        }
+
+        if(!workers[i].driver) {
+            tgen_critical("Error initializing TrafficGen worker %u", i);
+            result = -1;
+            break;
+        }
+    }
+
+    for(guint i = 0; result == 0 && i < numWorkers; i++) {
+        gchar* name = g_strdup_printf("tgen-worker-%u", i);
+        GError* error = NULL;
+        workers[i].thread = g_thread_try_new(name,
+                (GThreadFunc)_tgenmain_runWorker, &workers[i], &error);
+        g_free(name);
+
+        if(!workers[i].thread) {
+            tgen_critical("Error starting TrafficGen worker %u: %s", i, error->message);
+            g_error_free(error);
+            result = -1;
+        } else {
+            numStarted++;
+        }
+    }
+
+    if(result == 0) {
+        tgen_message("started %u workers", numWorkers);
+
+        /* log the heartbeat for the whole process until all of the workers are done */
+        gulong heartbeatMicros = (gulong)(tgendriver_getHeartbeatPeriodMillis(workers[0].driver) * 1000);
+        gboolean allDone = FALSE;
+        while(!allDone) {
+            g_usleep(heartbeatMicros);
+            tgendriver_logSharedStats(stats);
+
+            allDone = TRUE;
+            for(guint i = 0; i < numWorkers; i++) {
+                if(!__atomic_load_n(&workers[i].isDone, __ATOMIC_ACQUIRE)) {
+                    allDone = FALSE;
+                    break;
+                }
+            }
+        }
+    } else if(numStarted > 0) {
+        /* the workers we already started would run forever, so we end them */
+        tgendriver_endShared(stats);
+    }
+
+    for(guint i = 0; i < numWorkers; i++) {
+        if(workers[i].thread) {
+            g_thread_join(workers[i].thread);
+        }
+        if(workers[i].driver) {
+            tgendriver_unref(workers[i].driver);
+        }
+    }
+
+    if(result == 0) {
+        tgendriver_logSharedSummary(stats);
+    }
+
+    g_free(workers);
+    tgendriver_freeSharedStats(stats);
+
+    return result;
+}
+
 static gint _tgenmain_run(gint argc, gchar *argv[]) {
     /* start the logger at the message level until we read the config file */
     tgenlog_setLogFilterLevel(G_LOG_LEVEL_MESSAGE);
@@ -81,71 +182,49 @@ static gint _tgenmain_run(gint argc, gchar *argv[]) {
     GLogLevelFlags level = tgenaction_getLogLevel(tgengraph_getStartAction(graph));
     tgenlog_setLogFilterLevel(level);
 
-    /* create the new state according to user inputs */
-    TGenDriver* tgen = tgendriver_new(graph);
-
-    /* driver should have reffed the graph if it needed it */
-    tgengraph_unref(graph);
-
-    if(!tgen) {
-        tgen_critical("Error initializing new TrafficGen instance");
+    /* log lines go to stdout unless we configured a file for them */
+    const gchar* logFilePath = tgenaction_getLogFilePath(tgengraph_getStartAction(graph));
+    if(logFilePath && !tgenlog_setFile(logFilePath)) {
+        tgen_critical("cannot continue: unable to open the log file at '%s'", logFilePath);
+        tgengraph_unref(graph);
         return -1;
-    } else {
-        on_exit(_tgenmain_cleanup, tgen);
     }
 
-    /* all of the tgen descriptors are watched internally */
-    gint tgenepolld = tgendriver_getEpollDescriptor(tgen);
-    if(tgenepolld < 0) {
-        tgen_critical("Error retrieving tgen epolld");
+    tgenlog_setBackend(tgenaction_getLogBackend(tgengraph_getStartAction(graph)));
+
+    /* the binary event log is written next to the text log if configured */
+    const gchar* eventLogPath = tgenaction_getEventLogPath(tgengraph_getStartAction(graph));
+    if(eventLogPath && !tgeneventlog_open(eventLogPath)) {
+        tgen_critical("cannot continue: unable to open the event log at '%s'", eventLogPath);
+        tgengraph_unref(graph);
         return -1;
     }
 
-    /* now we need to watch all of the epoll descriptors in our main loop */
-    gint mainepolld = epoll_create(1);
-    if(mainepolld < 0) {
-        tgen_critical("Error in main epoll_create");
-        return -1;
+    /* run multiple event loops in worker threads if configured */
+    guint numThreads = tgenaction_getNumThreads(tgengraph_getStartAction(graph));
+    if(numThreads > 1) {
+        gint result = _tgenmain_runWorkers(graph, numThreads);
+        tgengraph_unref(graph);
+
+        tgen_message("returning %i from main", result);
+        return result;
     }
 
-    /* register the tgen epoll descriptor so we can watch its events */
-    struct epoll_event mainevent;
-    memset(&mainevent, 0, sizeof(struct epoll_event));
-    mainevent.events = EPOLLIN|EPOLLOUT;
-    epoll_ctl(mainepolld, EPOLL_CTL_ADD, tgenepolld, &mainevent);
-
-    /* main loop - wait for events on the trafficgen epoll descriptors */
-    tgen_message("entering main loop to watch descriptors");
-    while(TRUE) {
-        /* clear the event space */
-        memset(&mainevent, 0, sizeof(struct epoll_event));
-
-        /* wait for an event on the tgen descriptor */
-        tgen_debug("waiting for events");
-        gint nReadyFDs = epoll_wait(mainepolld, &mainevent, 1, -1);
-
-        if(nReadyFDs == -1) {
-            tgen_critical("error in client epoll_wait");
-            return -1;
-        }
+    /* create the new state according to user inputs */
+    TGenDriver* tgen = tgendriver_new(graph, NULL);
 
-        /* activate if something is ready */
-        if(nReadyFDs > 0) {
-            tgen_debug("processing event");
-            tgendriver_activate(tgen);
-        }
+    /* driver should have reffed the graph if it needed it */
+    tgengraph_unref(graph);
 
-        /* break out if trafficgen is done */
-        if(tgendriver_hasEnded(tgen)) {
-            break;
-        }
+    if(!tgen) {
+        tgen_critical("Error initializing new TrafficGen instance");
+        return -1;
+    } else {
+        on_exit(_tgenmain_cleanup, tgen);
     }
 
-    tgen_message("finished main loop, cleaning up");
-
-    /* de-register the tgen epoll descriptor and close */
-    epoll_ctl(mainepolld, EPOLL_CTL_DEL, tgenepolld, NULL);
-    close(mainepolld);
+    /* main loop - block until our descriptors are ready or timers expire */
+    tgendriver_run(tgen);
 
     tgen_message("returning 0 from main");
 
@@ -6,10 +6,12 @@
 #include <stdio.h>
 #include <math.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include <igraph.h>
 
 #include "tgen-log.h"
+#include "tgen-random.h"
 #include "tgen-markovmodel.h"
 
 #if 1 /* #ifdef DEBUG */
@@ -20,6 +22,9 @@
 #define TGEN_MMODEL_ASSERT(obj)
 #endif
 
+/* we draw the uniform numbers for choosing edges this many at a time */
+#define TGEN_MMODEL_UNIFORM_BATCH 64
+
 typedef enum _VertexAttribute VertexAttribute;
 enum _VertexAttribute {
     VERTEX_ATTR_NAME=1,
@@ -56,18 +61,65 @@ enum _VertexID {
     VERTEX_NAME_END=16,
 };
 
+/* one choice in an alias table. we pick a slot uniformly, and then either
+ * keep it or take its alias, so a choice costs one random number no matter
+ * how many edges a state has. */
+typedef struct _TGenMarkovModelChoice TGenMarkovModelChoice;
+struct _TGenMarkovModelChoice {
+    gdouble keepProbability;
+    guint alias;
+    /* the state we move to, for transitions */
+    guint toVertexIndex;
+    /* what we observe and how we generate the delay, for emissions */
+    Observation observation;
+    gboolean isLogNormal;
+    gdouble mu;
+    gdouble sigma;
+    gdouble lambda;
+};
+
+/* the choices of a state are a slice of the model's choices array */
+typedef struct _TGenMarkovModelTable TGenMarkovModelTable;
+struct _TGenMarkovModelTable {
+    guint first;
+    guint length;
+};
+
+typedef struct _TGenMarkovModelCompiled TGenMarkovModelCompiled;
+
+/* what we load from a graphml file. it does not change once we compiled it, so
+ * all the models that we create from the same file share it. */
+struct _TGenMarkovModelCompiled {
+    gint refcount;
+
+    igraph_t* graph;
+    igraph_integer_t startVertexIndex;
+
+    /* the graph compiled into flat arrays when we load it, so that we do not
+     * look up attributes in the graph for every observation. the tables are
+     * indexed by vertex. */
+    guint numVertices;
+    TGenMarkovModelTable* transitionTables;
+    TGenMarkovModelTable* emissionTables;
+    TGenMarkovModelChoice* choices;
+
+    guint magic;
+};
+
+/* a walk through a compiled model */
 struct _TGenMarkovModel {
     gint refcount;
 
     /* For generating deterministic pseudo-random sequences. */
-    GRand* prng;
+    TGenRandom* prng;
     guint32 prngSeed;
+    gdouble uniforms[TGEN_MMODEL_UNIFORM_BATCH];
+    guint nextUniform;
 
     /* The name of the graphml file that we loaded. */
     gchar* name;
 
-    igraph_t* graph;
-    igraph_integer_t startVertexIndex;
+    TGenMarkovModelCompiled* compiled;
     igraph_integer_t currentStateVertexIndex;
     gboolean foundEndState;
 
@@ -179,14 +231,14 @@ static gboolean _tgenmarkovmodel_vertexIDIsEmission(const gchar* idStr) {
 
 /* if the value is found and not NULL, it's value is returned in valueOut.
  * returns true if valueOut has been set, false otherwise */
-static gboolean _tgenmarkovmodel_findVertexAttributeString(TGenMarkovModel* mmodel, igraph_integer_t vertexIndex,
+static gboolean _tgenmarkovmodel_findVertexAttributeString(TGenMarkovModelCompiled* compiled, igraph_integer_t vertexIndex,
         VertexAttribute attr, const gchar** valueOut) {
-    TGEN_MMODEL_ASSERT(mmodel);
+    TGEN_MMODEL_ASSERT(compiled);
 
     const gchar* name = _tgenmarkovmodel_vertexAttributeToString(attr);
 
-    if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_VERTEX, name)) {
-        const gchar* value = igraph_cattribute_VAS(mmodel->graph, name, vertexIndex);
+    if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_VERTEX, name)) {
+        const gchar* value = igraph_cattribute_VAS(compiled->graph, name, vertexIndex);
         if(value != NULL && value[0] != '\0') {
             if(valueOut != NULL) {
                 *valueOut = value;
@@ -200,14 +252,14 @@ static gboolean _tgenmarkovmodel_findVertexAttributeString(TGenMarkovModel* mmod
 
 /* if the value is found and not NULL, it's value is returned in valueOut.
  * returns true if valueOut has been set, false otherwise */
-static gboolean _tgenmarkovmodel_findEdgeAttributeDouble(TGenMarkovModel* mmodel, igraph_integer_t edgeIndex,
+static gboolean _tgenmarkovmodel_findEdgeAttributeDouble(TGenMarkovModelCompiled* compiled, igraph_integer_t edgeIndex,
         EdgeAttribute attr, gdouble* valueOut) {
-    TGEN_MMODEL_ASSERT(mmodel);
+    TGEN_MMODEL_ASSERT(compiled);
 
     const gchar* name = _tgenmarkovmodel_edgeAttributeToString(attr);
 
-    if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_EDGE, name)) {
-        gdouble value = (gdouble) igraph_cattribute_EAN(mmodel->graph, name, edgeIndex);
+    if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_EDGE, name)) {
+        gdouble value = (gdouble) igraph_cattribute_EAN(compiled->graph, name, edgeIndex);
         if(isnan(value) == 0) {
             if(valueOut != NULL) {
                 *valueOut = value;
@@ -221,14 +273,14 @@ static gboolean _tgenmarkovmodel_findEdgeAttributeDouble(TGenMarkovModel* mmodel
 
 /* if the value is found and not NULL, it's value is returned in valueOut.
  * returns true if valueOut has been set, false otherwise */
-static gboolean _tgenmarkovmodel_findEdgeAttributeString(TGenMarkovModel* mmodel, igraph_integer_t edgeIndex,
+static gboolean _tgenmarkovmodel_findEdgeAttributeString(TGenMarkovModelCompiled* compiled, igraph_integer_t edgeIndex,
         EdgeAttribute attr, const gchar** valueOut) {
-    TGEN_MMODEL_ASSERT(mmodel);
+    TGEN_MMODEL_ASSERT(compiled);
 
     const gchar* name = _tgenmarkovmodel_edgeAttributeToString(attr);
 
-    if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_EDGE, name)) {
-        const gchar* value = igraph_cattribute_EAS(mmodel->graph, name, edgeIndex);
+    if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_EDGE, name)) {
+        const gchar* value = igraph_cattribute_EAS(compiled->graph, name, edgeIndex);
         if(value != NULL && value[0] != '\0') {
             if(valueOut != NULL) {
                 *valueOut = value;
@@ -240,9 +292,9 @@ static gboolean _tgenmarkovmodel_findEdgeAttributeString(TGenMarkovModel* mmodel
     return FALSE;
 }
 
-static gboolean _tgenmarkovmodel_checkVertexAttributes(TGenMarkovModel* mmodel, igraph_integer_t vertexIndex) {
-    TGEN_MMODEL_ASSERT(mmodel);
-    g_assert(mmodel->graph);
+static gboolean _tgenmarkovmodel_checkVertexAttributes(TGenMarkovModelCompiled* compiled, igraph_integer_t vertexIndex) {
+    TGEN_MMODEL_ASSERT(compiled);
+    g_assert(compiled->graph);
 
     gboolean isSuccess = TRUE;
     GString* message = g_string_new(NULL);
@@ -253,9 +305,9 @@ static gboolean _tgenmarkovmodel_checkVertexAttributes(TGenMarkovModel* mmodel,
 
     /* this attribute is required, so it is an error if it doesn't exist */
     const gchar* idKey = _tgenmarkovmodel_vertexAttributeToString(VERTEX_ATTR_NAME);
-    if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_VERTEX, idKey)) {
+    if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_VERTEX, idKey)) {
         const gchar* vidStr;
-        if(_tgenmarkovmodel_findVertexAttributeString(mmodel, vertexIndex, VERTEX_ATTR_NAME, &vidStr)) {
+        if(_tgenmarkovmodel_findVertexAttributeString(compiled, vertexIndex, VERTEX_ATTR_NAME, &vidStr)) {
             g_string_append_printf(message, " %s='%s'", idKey, vidStr);
             idStr = g_strdup(vidStr);
         } else {
@@ -271,11 +323,11 @@ static gboolean _tgenmarkovmodel_checkVertexAttributes(TGenMarkovModel* mmodel,
 
     /* this attribute is required, so it is an error if it doesn't exist */
     const gchar* typeKey = _tgenmarkovmodel_vertexAttributeToString(VERTEX_ATTR_TYPE);
-    if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_VERTEX, typeKey)) {
+    if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_VERTEX, typeKey)) {
         const gchar* typeStr;
         if(_tgenmarkovmodel_vertexIDIsEqual(idStr, VERTEX_NAME_START)) {
             /* start vertex doesnt need any attributes */
-        } else if(_tgenmarkovmodel_findVertexAttributeString(mmodel, vertexIndex, VERTEX_ATTR_TYPE, &typeStr)) {
+        } else if(_tgenmarkovmodel_findVertexAttributeString(compiled, vertexIndex, VERTEX_ATTR_TYPE, &typeStr)) {
             g_string_append_printf(message, " %s='%s'", typeKey, typeStr);
 
             if(_tgenmarkovmodel_vertexTypeIsEqual(typeStr, VERTEX_TYPE_STATE)) {
@@ -318,15 +370,15 @@ static gboolean _tgenmarkovmodel_checkVertexAttributes(TGenMarkovModel* mmodel,
     return isSuccess;
 }
 
-static gboolean _tgenmarkovmodel_validateVertices(TGenMarkovModel* mmodel, igraph_integer_t* startVertexID) {
-    TGEN_MMODEL_ASSERT(mmodel);
-    g_assert(mmodel->graph);
+static gboolean _tgenmarkovmodel_validateVertices(TGenMarkovModelCompiled* compiled, igraph_integer_t* startVertexID) {
+    TGEN_MMODEL_ASSERT(compiled);
+    g_assert(compiled->graph);
 
     gboolean isSuccess = TRUE;
     gboolean foundStart = FALSE;
 
     igraph_vit_t vertexIterator;
-    gint result = igraph_vit_create(mmodel->graph, igraph_vss_all(), &vertexIterator);
+    gint result = igraph_vit_create(compiled->graph, igraph_vss_all(), &vertexIterator);
 
     if (result != IGRAPH_SUCCESS) {
         isSuccess = FALSE;
@@ -336,13 +388,13 @@ static gboolean _tgenmarkovmodel_validateVertices(TGenMarkovModel* mmodel, igrap
     while (!IGRAPH_VIT_END(vertexIterator)) {
         igraph_integer_t vertexIndex = IGRAPH_VIT_GET(vertexIterator);
 
-        isSuccess = _tgenmarkovmodel_checkVertexAttributes(mmodel, vertexIndex);
+        isSuccess = _tgenmarkovmodel_checkVertexAttributes(compiled, vertexIndex);
 
         if(!isSuccess) {
             break;
         }
 
-        const gchar* idStr = VAS(mmodel->graph,
+        const gchar* idStr = VAS(compiled->graph,
                 _tgenmarkovmodel_vertexAttributeToString(VERTEX_ATTR_NAME), vertexIndex);
         if (_tgenmarkovmodel_vertexIDIsEqual(idStr, VERTEX_NAME_START)) {
             /* found the start vertex */
@@ -364,12 +416,12 @@ static gboolean _tgenmarkovmodel_validateVertices(TGenMarkovModel* mmodel, igrap
     return isSuccess && foundStart;
 }
 
-static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, igraph_integer_t edgeIndex) {
-    TGEN_MMODEL_ASSERT(mmodel);
-    g_assert(mmodel->graph);
+static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModelCompiled* compiled, igraph_integer_t edgeIndex) {
+    TGEN_MMODEL_ASSERT(compiled);
+    g_assert(compiled->graph);
 
     igraph_integer_t fromVertexIndex, toVertexIndex;
-    gint result = igraph_edge(mmodel->graph, edgeIndex, &fromVertexIndex, &toVertexIndex);
+    gint result = igraph_edge(compiled->graph, edgeIndex, &fromVertexIndex, &toVertexIndex);
 
     if(result != IGRAPH_SUCCESS) {
         tgen_warning("igraph_edge return non-success code %i", result);
@@ -380,13 +432,13 @@ static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, ig
     const gchar* fromIDStr = NULL;
     const gchar* toIDStr = NULL;
 
-    found = _tgenmarkovmodel_findVertexAttributeString(mmodel, fromVertexIndex, VERTEX_ATTR_NAME, &fromIDStr);
+    found = _tgenmarkovmodel_findVertexAttributeString(compiled, fromVertexIndex, VERTEX_ATTR_NAME, &fromIDStr);
     if(!found) {
         tgen_warning("unable to find source vertex for edge %li", (glong)edgeIndex);
         return FALSE;
     }
 
-    found = _tgenmarkovmodel_findVertexAttributeString(mmodel, toVertexIndex, VERTEX_ATTR_NAME, &toIDStr);
+    found = _tgenmarkovmodel_findVertexAttributeString(compiled, toVertexIndex, VERTEX_ATTR_NAME, &toIDStr);
     if(!found) {
         tgen_warning("unable to find destination vertex for edge %li", (glong)edgeIndex);
         return FALSE;
@@ -399,8 +451,8 @@ static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, ig
     /* this attribute is required, so it is an error if it doesn't exist */
     const gchar* weightKey = _tgenmarkovmodel_edgeAttributeToString(EDGE_ATTR_WEIGHT);
     gdouble weightValue;
-    if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_EDGE, weightKey) &&
-            _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_WEIGHT, &weightValue)) {
+    if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_EDGE, weightKey) &&
+            _tgenmarkovmodel_findEdgeAttributeDouble(compiled, edgeIndex, EDGE_ATTR_WEIGHT, &weightValue)) {
         if(weightValue >= 0.0f) {
             g_string_append_printf(message, " %s='%f'", weightKey, weightValue);
         } else {
@@ -419,9 +471,9 @@ static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, ig
 
     /* this attribute is required, so it is an error if it doesn't exist */
     const gchar* typeKey = _tgenmarkovmodel_edgeAttributeToString(EDGE_ATTR_TYPE);
-    if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_EDGE, typeKey)) {
+    if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_EDGE, typeKey)) {
         const gchar* typeStr;
-        if(_tgenmarkovmodel_findEdgeAttributeString(mmodel, edgeIndex, EDGE_ATTR_TYPE, &typeStr)) {
+        if(_tgenmarkovmodel_findEdgeAttributeString(compiled, edgeIndex, EDGE_ATTR_TYPE, &typeStr)) {
             g_string_append_printf(message, " %s='%s'", typeKey, typeStr);
 
             if(_tgenmarkovmodel_edgeTypeIsEqual(typeStr, EDGE_TYPE_TRANSITION)) {
@@ -479,8 +531,8 @@ static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, ig
         /* this attribute is required, so it is an error if it doesn't exist */
         const gchar* muKey = _tgenmarkovmodel_edgeAttributeToString(EDGE_ATTR_LOGNORMMU);
         gdouble muValue;
-        if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_EDGE, muKey) &&
-                _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_LOGNORMMU, &muValue)) {
+        if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_EDGE, muKey) &&
+                _tgenmarkovmodel_findEdgeAttributeDouble(compiled, edgeIndex, EDGE_ATTR_LOGNORMMU, &muValue)) {
             if(muValue >= 0.0f) {
                 g_string_append_printf(message, " %s='%f'", muKey, muValue);
             } else {
@@ -498,8 +550,8 @@ static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, ig
         /* this attribute is required, so it is an error if it doesn't exist */
         const gchar* sigmaKey = _tgenmarkovmodel_edgeAttributeToString(EDGE_ATTR_LOGNORMSIGMA);
         gdouble sigmaValue;
-        if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_EDGE, sigmaKey) &&
-                _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_LOGNORMSIGMA, &sigmaValue)) {
+        if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_EDGE, sigmaKey) &&
+                _tgenmarkovmodel_findEdgeAttributeDouble(compiled, edgeIndex, EDGE_ATTR_LOGNORMSIGMA, &sigmaValue)) {
             if(sigmaValue >= 0.0f) {
                 g_string_append_printf(message, " %s='%f'", sigmaKey, sigmaValue);
             } else {
@@ -517,8 +569,8 @@ static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, ig
         /* this attribute is required, so it is an error if it doesn't exist */
         const gchar* lambdaKey = _tgenmarkovmodel_edgeAttributeToString(EDGE_ATTR_EXPLAMBDA);
         gdouble lambdaValue;
-        if(igraph_cattribute_has_attr(mmodel->graph, IGRAPH_ATTRIBUTE_EDGE, lambdaKey) &&
-                _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_EXPLAMBDA, &lambdaValue)) {
+        if(igraph_cattribute_has_attr(compiled->graph, IGRAPH_ATTRIBUTE_EDGE, lambdaKey) &&
+                _tgenmarkovmodel_findEdgeAttributeDouble(compiled, edgeIndex, EDGE_ATTR_EXPLAMBDA, &lambdaValue)) {
             if(lambdaValue >= 0.0f) {
                 g_string_append_printf(message, " %s='%f'", lambdaKey, lambdaValue);
             } else {
@@ -541,15 +593,15 @@ static gboolean _tgenmarkovmodel_checkEdgeAttributes(TGenMarkovModel* mmodel, ig
     return isSuccess;
 }
 
-static gboolean _tgenmarkovmodel_validateEdges(TGenMarkovModel* mmodel) {
-    TGEN_MMODEL_ASSERT(mmodel);
-    g_assert(mmodel->graph);
+static gboolean _tgenmarkovmodel_validateEdges(TGenMarkovModelCompiled* compiled) {
+    TGEN_MMODEL_ASSERT(compiled);
+    g_assert(compiled->graph);
 
     gboolean isSuccess = TRUE;
 
     /* we will iterate through the edges */
     igraph_eit_t edgeIterator;
-    gint result = igraph_eit_create(mmodel->graph, igraph_ess_all(IGRAPH_EDGEORDER_ID), &edgeIterator);
+    gint result = igraph_eit_create(compiled->graph, igraph_ess_all(IGRAPH_EDGEORDER_ID), &edgeIterator);
 
     if(result != IGRAPH_SUCCESS) {
         tgen_warning("igraph_eit_create return non-success code %i", result);
@@ -561,7 +613,7 @@ static gboolean _tgenmarkovmodel_validateEdges(TGenMarkovModel* mmodel) {
         igraph_integer_t edgeIndex = IGRAPH_EIT_GET(edgeIterator);
 
         /* call the hook function for each edge */
-        isSuccess = _tgenmarkovmodel_checkEdgeAttributes(mmodel, edgeIndex);
+        isSuccess = _tgenmarkovmodel_checkEdgeAttributes(compiled, edgeIndex);
         if(!isSuccess) {
             break;
         }
@@ -574,6 +626,212 @@ static gboolean _tgenmarkovmodel_validateEdges(TGenMarkovModel* mmodel) {
     return isSuccess;
 }
 
+static Observation _tgenmarkovmodel_vertexToObservation(TGenMarkovModelCompiled* compiled,
+        igraph_integer_t vertexIndex) {
+    TGEN_MMODEL_ASSERT(compiled);
+
+    /* we already validated the attributes, so assert that they exist here */
+    gboolean isSuccess = FALSE;
+
+    const gchar* typeStr;
+    isSuccess = _tgenmarkovmodel_findVertexAttributeString(compiled, vertexIndex, VERTEX_ATTR_TYPE, &typeStr);
+    g_assert(isSuccess);
+    g_assert(_tgenmarkovmodel_vertexTypeIsEqual(typeStr, VERTEX_TYPE_OBSERVATION));
+
+    const gchar* vidStr;
+    isSuccess = _tgenmarkovmodel_findVertexAttributeString(compiled, vertexIndex, VERTEX_ATTR_NAME, &vidStr);
+    g_assert(isSuccess);
+
+    if(_tgenmarkovmodel_vertexIDIsEqual(vidStr, VERTEX_NAME_PACKET_TO_ORIGIN)) {
+        return OBSERVATION_PACKET_TO_ORIGIN;
+    } else if(_tgenmarkovmodel_vertexIDIsEqual(vidStr, VERTEX_NAME_PACKET_TO_SERVER)) {
+        return OBSERVATION_PACKET_TO_SERVER;
+    } else if(_tgenmarkovmodel_vertexIDIsEqual(vidStr, VERTEX_NAME_STREAM)) {
+        return OBSERVATION_STREAM;
+    } else {
+        return OBSERVATION_END;
+    }
+}
+
+/* fills in the keep probabilities and aliases of the table from the weights,
+ * using Vose's method */
+static void _tgenmarkovmodel_buildAliasTable(TGenMarkovModelChoice* choices, gdouble* weights, guint length) {
+    gdouble totalWeight = 0.0;
+    for(guint i = 0; i < length; i++) {
+        totalWeight += weights[i];
+    }
+
+    if(totalWeight <= 0.0) {
+        /* like before we compiled the model, we always choose the first edge */
+        for(guint i = 0; i < length; i++) {
+            choices[i].keepProbability = (i == 0) ? 1.0 : 0.0;
+            choices[i].alias = 0;
+        }
+        return;
+    }
+
+    /* scale the weights so that their mean is 1, and sort them into the
+     * slots that are under and over full */
+    guint* small = g_new(guint, length);
+    guint* large = g_new(guint, length);
+    guint numSmall = 0, numLarge = 0;
+
+    for(guint i = 0; i < length; i++) {
+        weights[i] = weights[i] * (gdouble)length / totalWeight;
+        if(weights[i] < 1.0) {
+            small[numSmall++] = i;
+        } else {
+            large[numLarge++] = i;
+        }
+    }
+
+    /* fill each under-full slot from an over-full one */
+    while(numSmall > 0 && numLarge > 0) {
+        guint less = small[--numSmall];
+        guint more = large[--numLarge];
+
+        choices[less].keepProbability = weights[less];
+        choices[less].alias = more;
+
+        weights[more] = (weights[more] + weights[less]) - 1.0;
+        if(weights[more] < 1.0) {
+            small[numSmall++] = more;
+        } else {
+            large[numLarge++] = more;
+        }
+    }
+
+    /* what is left is full, up to rounding errors */
+    while(numLarge > 0) {
+        guint i = large[--numLarge];
+        choices[i].keepProbability = 1.0;
+        choices[i].alias = i;
+    }
+    while(numSmall > 0) {
+        guint i = small[--numSmall];
+        choices[i].keepProbability = 1.0;
+        choices[i].alias = i;
+    }
+
+    g_free(small);
+    g_free(large);
+}
+
+/* compiles the validated graph into the tables that we use to generate observations */
+static gboolean _tgenmarkovmodel_compile(TGenMarkovModelCompiled* compiled) {
+    TGEN_MMODEL_ASSERT(compiled);
+    g_assert(compiled->graph);
+
+    guint numVertices = (guint)igraph_vcount(compiled->graph);
+    guint numEdges = (guint)igraph_ecount(compiled->graph);
+
+    /* we look up each edge once, and remember what we found */
+    EdgeType* edgeTypes = g_new0(EdgeType, numEdges);
+    guint* edgeFrom = g_new0(guint, numEdges);
+    guint* edgeTo = g_new0(guint, numEdges);
+
+    compiled->numVertices = numVertices;
+    compiled->transitionTables = g_new0(TGenMarkovModelTable, numVertices);
+    compiled->emissionTables = g_new0(TGenMarkovModelTable, numVertices);
+    compiled->choices = g_new0(TGenMarkovModelChoice, MAX(numEdges, 1));
+
+    for(guint edgeIndex = 0; edgeIndex < numEdges; edgeIndex++) {
+        igraph_integer_t from, to;
+        gint result = igraph_edge(compiled->graph, (igraph_integer_t)edgeIndex, &from, &to);
+        if(result != IGRAPH_SUCCESS) {
+            tgen_warning("igraph_edge return non-success code %i", result);
+            g_free(edgeTypes);
+            g_free(edgeFrom);
+            g_free(edgeTo);
+            return FALSE;
+        }
+
+        const gchar* typeStr;
+        gboolean isSuccess = _tgenmarkovmodel_findEdgeAttributeString(compiled,
+                (igraph_integer_t)edgeIndex, EDGE_ATTR_TYPE, &typeStr);
+        g_assert(isSuccess);
+
+        edgeFrom[edgeIndex] = (guint)from;
+        edgeTo[edgeIndex] = (guint)to;
+
+        if(_tgenmarkovmodel_edgeTypeIsEqual(typeStr, EDGE_TYPE_TRANSITION)) {
+            edgeTypes[edgeIndex] = EDGE_TYPE_TRANSITION;
+            compiled->transitionTables[edgeFrom[edgeIndex]].length++;
+        } else {
+            edgeTypes[edgeIndex] = EDGE_TYPE_EMISSION;
+            compiled->emissionTables[edgeFrom[edgeIndex]].length++;
+        }
+    }
+
+    /* lay out the tables of each vertex one after another */
+    guint next = 0;
+    for(guint vertexIndex = 0; vertexIndex < numVertices; vertexIndex++) {
+        compiled->transitionTables[vertexIndex].first = next;
+        next += compiled->transitionTables[vertexIndex].length;
+        compiled->emissionTables[vertexIndex].first = next;
+        next += compiled->emissionTables[vertexIndex].length;
+    }
+    g_assert(next == numEdges);
+
+    /* fill the choices in the order of the edges, like the graph orders them */
+    gdouble* weights = g_new0(gdouble, MAX(numEdges, 1));
+    guint* filled = g_new0(guint, numVertices * 2);
+
+    for(guint edgeIndex = 0; edgeIndex < numEdges; edgeIndex++) {
+        guint from = edgeFrom[edgeIndex];
+        gboolean isTransition = (edgeTypes[edgeIndex] == EDGE_TYPE_TRANSITION);
+        TGenMarkovModelTable* table = isTransition ?
+                &compiled->transitionTables[from] : &compiled->emissionTables[from];
+        guint position = table->first + filled[(from * 2) + (isTransition ? 0 : 1)]++;
+
+        TGenMarkovModelChoice* choice = &compiled->choices[position];
+        gboolean isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(compiled,
+                (igraph_integer_t)edgeIndex, EDGE_ATTR_WEIGHT, &weights[position]);
+        g_assert(isSuccess);
+
+        if(isTransition) {
+            choice->toVertexIndex = edgeTo[edgeIndex];
+        } else {
+            choice->observation = _tgenmarkovmodel_vertexToObservation(compiled, edgeTo[edgeIndex]);
+
+            isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(compiled,
+                    (igraph_integer_t)edgeIndex, EDGE_ATTR_LOGNORMMU, &choice->mu);
+            g_assert(isSuccess);
+            isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(compiled,
+                    (igraph_integer_t)edgeIndex, EDGE_ATTR_LOGNORMSIGMA, &choice->sigma);
+            g_assert(isSuccess);
+            isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(compiled,
+                    (igraph_integer_t)edgeIndex, EDGE_ATTR_EXPLAMBDA, &choice->lambda);
+            g_assert(isSuccess);
+
+            choice->isLogNormal = (choice->sigma > 0 || choice->mu > 0) ? TRUE : FALSE;
+        }
+    }
+
+    for(guint vertexIndex = 0; vertexIndex < numVertices; vertexIndex++) {
+        TGenMarkovModelTable* tables[2] = {
+                &compiled->transitionTables[vertexIndex], &compiled->emissionTables[vertexIndex]};
+        for(gint i = 0; i < 2; i++) {
+            if(tables[i]->length > 0) {
+                _tgenmarkovmodel_buildAliasTable(&compiled->choices[tables[i]->first],
+                        &weights[tables[i]->first], tables[i]->length);
+            }
+        }
+    }
+
+    g_free(weights);
+    g_free(filled);
+    g_free(edgeTypes);
+    g_free(edgeFrom);
+    g_free(edgeTo);
+
+    return TRUE;
+}
+
+/* the igraph parser uses global state, and worker threads may load
+ * their models at the same time */
+static GMutex tgenMarkovModelLoadLock;
+
 static igraph_t* _tgenmarkovmodel_loadGraph(FILE* graphFileStream, const gchar* graphName) {
     tgen_debug("Computing size of markov model graph file '%s'", graphmlFilePath);
 
@@ -598,11 +856,26 @@ static igraph_t* _tgenmarkovmodel_loadGraph(FILE* graphFileStream, const gchar*
 
     igraph_t* graph = g_new0(igraph_t, 1);
 
+    g_mutex_lock(&tgenMarkovModelLoadLock);
+
     /* make sure we use the correct attribute handler */
     igraph_i_set_attribute_table(&igraph_cattribute_table);
 
     result = igraph_read_graph_graphml(graph, graphFileStream, 0);
 
+    /* This is a workaround because igraph tries to store vertex ids as attributes.
+     * Normally igraph would print the following warning to stderr when writing:
+     *   Warning: Could not add vertex ids, there is already an 'id' vertex attribute
+     *   in file foreign-graphml.c, line 443
+     * The fix is to remove the id attributes since we don't use it anyway, which
+     * prevents igraph from trying to write it in the vertex id field AND as an attribute.
+     * We do it here, because the graph is shared and never changes after we load it. */
+    if(result == IGRAPH_SUCCESS) {
+        igraph_cattribute_remove_v(graph, "id");
+    }
+
+    g_mutex_unlock(&tgenMarkovModelLoadLock);
+
     if (result != IGRAPH_SUCCESS) {
         if(result == IGRAPH_PARSEERROR) {
             tgen_warning("IGraph reported that there was either a problem reading "
@@ -625,18 +898,89 @@ static igraph_t* _tgenmarkovmodel_loadGraph(FILE* graphFileStream, const gchar*
     return graph;
 }
 
+static void _tgenmarkovmodel_unrefCompiled(TGenMarkovModelCompiled* compiled) {
+    TGEN_MMODEL_ASSERT(compiled);
+
+    /* models in different worker threads may share it */
+    if(!g_atomic_int_dec_and_test(&compiled->refcount)) {
+        return;
+    }
+
+    if(compiled->graph) {
+        igraph_destroy(compiled->graph);
+        g_free(compiled->graph);
+        compiled->graph = NULL;
+    }
+
+    g_free(compiled->transitionTables);
+    g_free(compiled->emissionTables);
+    g_free(compiled->choices);
+
+    compiled->magic = 0;
+    g_free(compiled);
+}
+
+static TGenMarkovModelCompiled* _tgenmarkovmodel_refCompiled(TGenMarkovModelCompiled* compiled) {
+    TGEN_MMODEL_ASSERT(compiled);
+    g_atomic_int_inc(&compiled->refcount);
+    return compiled;
+}
+
+/* validates and compiles the graph, and takes ownership of it */
+static TGenMarkovModelCompiled* _tgenmarkovmodel_newCompiled(igraph_t* graph, const gchar* name) {
+    g_assert(graph);
+    g_assert(name);
+
+    TGenMarkovModelCompiled* compiled = g_new0(TGenMarkovModelCompiled, 1);
+    compiled->magic = TGEN_MMODEL_MAGIC;
+    compiled->refcount = 1;
+    compiled->graph = graph;
+
+    tgen_info("Starting graph validation on markov model name '%s'", name);
+
+    gboolean verticesPassed = _tgenmarkovmodel_validateVertices(compiled, &(compiled->startVertexIndex));
+    if(verticesPassed) {
+        tgen_info("Markov model name '%s' passed vertex validation", name);
+    } else {
+        tgen_warning("Markov model name '%s' failed vertex validation", name);
+    }
+
+    gboolean edgesPassed = _tgenmarkovmodel_validateEdges(compiled);
+    if(edgesPassed) {
+        tgen_info("Markov model name '%s' passed edge validation", name);
+    } else {
+        tgen_warning("Markov model name '%s' failed edge validation", name);
+    }
+
+    if(!verticesPassed || !edgesPassed) {
+        _tgenmarkovmodel_unrefCompiled(compiled);
+        tgen_info("Failed to create markov model object");
+        return NULL;
+    }
+
+    if(!_tgenmarkovmodel_compile(compiled)) {
+        _tgenmarkovmodel_unrefCompiled(compiled);
+        tgen_warning("Failed to compile markov model name '%s'", name);
+        return NULL;
+    }
+
+    tgen_info("Successfully validated markov model name '%s', "
+            "found start vertex at index %i", name, (int)compiled->startVertexIndex);
+
+    return compiled;
+}
+
 static void _tgenmarkovmodel_free(TGenMarkovModel* mmodel) {
     TGEN_MMODEL_ASSERT(mmodel);
     g_assert(mmodel->refcount == 0);
 
-    if(mmodel->graph) {
-        igraph_destroy(mmodel->graph);
-        g_free(mmodel->graph);
-        mmodel->graph = NULL;
+    if(mmodel->compiled) {
+        _tgenmarkovmodel_unrefCompiled(mmodel->compiled);
+        mmodel->compiled = NULL;
     }
 
     if(mmodel->prng) {
-        g_rand_free(mmodel->prng);
+        tgenrandom_free(mmodel->prng);
     }
 
     if(mmodel->name) {
@@ -659,8 +1003,10 @@ void tgenmarkovmodel_unref(TGenMarkovModel* mmodel) {
     }
 }
 
-static TGenMarkovModel* _tgenmarkovmodel_new(igraph_t* graph, const gchar* name, guint32 seed) {
-    g_assert(graph);
+/* takes ownership of the reference to the compiled model */
+static TGenMarkovModel* _tgenmarkovmodel_new(TGenMarkovModelCompiled* compiled,
+        const gchar* name, guint32 seed) {
+    TGEN_MMODEL_ASSERT(compiled);
     g_assert(name);
 
     TGenMarkovModel* mmodel = g_new0(TGenMarkovModel, 1);
@@ -668,40 +1014,54 @@ static TGenMarkovModel* _tgenmarkovmodel_new(igraph_t* graph, const gchar* name,
     mmodel->refcount = 1;
 
     /* create our local prng for this model */
-    mmodel->prng = g_rand_new_with_seed(seed);
+    mmodel->prng = tgenrandom_new((guint64)seed);
     mmodel->prngSeed = seed;
+    mmodel->nextUniform = TGEN_MMODEL_UNIFORM_BATCH;
 
-    mmodel->graph = graph;
     mmodel->name = g_strdup(name);
+    mmodel->compiled = compiled;
+    mmodel->currentStateVertexIndex = compiled->startVertexIndex;
 
-    tgen_info("Starting graph validation on markov model name '%s'", name);
+    return mmodel;
+}
 
-    gboolean verticesPassed = _tgenmarkovmodel_validateVertices(mmodel, &(mmodel->startVertexIndex));
-    if(verticesPassed) {
-        tgen_info("Markov model name '%s' passed vertex validation", name);
-    } else {
-        tgen_warning("Markov model name '%s' failed vertex validation", name);
+/* the models that we compiled from files, so that we parse each file only once.
+ * the key is the path, and we compile it again if the file was modified. */
+typedef struct _TGenMarkovModelCacheEntry {
+    gint64 modifiedTime;
+    gint64 size;
+    TGenMarkovModelCompiled* compiled;
+} TGenMarkovModelCacheEntry;
+
+static GMutex tgenMarkovModelCacheLock;
+static GHashTable* tgenMarkovModelCache = NULL;
+
+static void _tgenmarkovmodel_freeCacheEntry(TGenMarkovModelCacheEntry* entry) {
+    if(entry) {
+        if(entry->compiled) {
+            _tgenmarkovmodel_unrefCompiled(entry->compiled);
+        }
+        g_free(entry);
     }
+}
 
-    gboolean edgesPassed = _tgenmarkovmodel_validateEdges(mmodel);
-    if(edgesPassed) {
-        tgen_info("Markov model name '%s' passed edge validation", name);
-    } else {
-        tgen_warning("Markov model name '%s' failed edge validation", name);
-    }
+static TGenMarkovModelCompiled* _tgenmarkovmodel_loadCompiledFromPath(const gchar* name,
+        const gchar* graphmlFilePath) {
+    tgen_debug("Opening markov model graph file '%s'", graphmlFilePath);
 
-    if(!verticesPassed || !edgesPassed) {
-        tgenmarkovmodel_unref(mmodel);
-        tgen_info("Failed to create markov model object");
+    FILE* graphFileStream = fopen(graphmlFilePath, "r");
+    if (!graphFileStream) {
+        tgen_warning("Unable to open markov model graph file at "
+                "path '%s', fopen returned NULL with errno %i: %s",
+                graphmlFilePath, errno, strerror(errno));
         return NULL;
     }
 
-    mmodel->currentStateVertexIndex = mmodel->startVertexIndex;
+    igraph_t* graph = _tgenmarkovmodel_loadGraph(graphFileStream, name);
 
-    tgen_info("Successfully validated markov model name '%s', "
-            "found start vertex at index %i", name, (int)mmodel->startVertexIndex);
+    fclose(graphFileStream);
 
-    return mmodel;
+    return graph ? _tgenmarkovmodel_newCompiled(graph, name) : NULL;
 }
 
 TGenMarkovModel* tgenmarkovmodel_newFromPath(const gchar* name, guint32 seed, const gchar* graphmlFilePath) {
@@ -710,34 +1070,59 @@ TGenMarkovModel* tgenmarkovmodel_newFromPath(const gchar* name, guint32 seed, co
         return NULL;
     }
 
-    if(!g_file_test(graphmlFilePath, G_FILE_TEST_EXISTS)) {
+    struct stat fileInfo;
+    if(stat(graphmlFilePath, &fileInfo) != 0) {
         tgen_warning("We failed to load the markov model graph because the "
                 "given path '%s' does not exist", graphmlFilePath);
         return NULL;
     }
 
-    if(!g_file_test(graphmlFilePath, G_FILE_TEST_IS_REGULAR)) {
+    if(!S_ISREG(fileInfo.st_mode)) {
         tgen_warning("We failed to load the markov model graph because the file at the "
                 "given path '%s' is not a regular file", graphmlFilePath);
         return NULL;
     }
 
-    tgen_debug("Opening markov model graph file '%s'", graphmlFilePath);
+    gint64 modifiedTime = ((gint64)fileInfo.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000)) +
+            (gint64)fileInfo.st_mtim.tv_nsec;
+    gint64 size = (gint64)fileInfo.st_size;
 
-    FILE* graphFileStream = fopen(graphmlFilePath, "r");
-    if (!graphFileStream) {
-        tgen_warning("Unable to open markov model graph file at "
-                "path '%s', fopen returned NULL with errno %i: %s",
-                graphmlFilePath, errno, strerror(errno));
-        return NULL;
+    /* we hold the lock while we load, so two threads that want the same
+     * file do not both parse it */
+    g_mutex_lock(&tgenMarkovModelCacheLock);
+
+    if(!tgenMarkovModelCache) {
+        tgenMarkovModelCache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                g_free, (GDestroyNotify)_tgenmarkovmodel_freeCacheEntry);
     }
 
-    igraph_t* graph = _tgenmarkovmodel_loadGraph(graphFileStream, name);
+    TGenMarkovModelCacheEntry* entry = g_hash_table_lookup(tgenMarkovModelCache, graphmlFilePath);
 
-    fclose(graphFileStream);
+    if(entry && (entry->modifiedTime != modifiedTime || entry->size != size)) {
+        tgen_info("Markov model file '%s' changed since we loaded it, loading it again",
+                graphmlFilePath);
+        g_hash_table_remove(tgenMarkovModelCache, graphmlFilePath);
+        entry = NULL;
+    }
 
-    TGenMarkovModel* mmodel = graph ? _tgenmarkovmodel_new(graph, name, seed) : NULL;
-    return mmodel;
+    if(!entry) {
+        TGenMarkovModelCompiled* compiled = _tgenmarkovmodel_loadCompiledFromPath(name, graphmlFilePath);
+        if(compiled) {
+            entry = g_new0(TGenMarkovModelCacheEntry, 1);
+            entry->modifiedTime = modifiedTime;
+            entry->size = size;
+            entry->compiled = compiled;
+            g_hash_table_replace(tgenMarkovModelCache, g_strdup(graphmlFilePath), entry);
+        }
+    } else {
+        tgen_debug("Using the cached markov model for file '%s'", graphmlFilePath);
+    }
+
+    TGenMarkovModelCompiled* compiled = entry ? _tgenmarkovmodel_refCompiled(entry->compiled) : NULL;
+
+    g_mutex_unlock(&tgenMarkovModelCacheLock);
+
+    return compiled ? _tgenmarkovmodel_new(compiled, name, seed) : NULL;
 }
 
 TGenMarkovModel* tgenmarkovmodel_newFromString(const gchar* name, guint32 seed, const GString* graphmlString) {
@@ -757,210 +1142,46 @@ TGenMarkovModel* tgenmarkovmodel_newFromString(const gchar* name, guint32 seed,
 
     fclose(memoryStream);
 
-    TGenMarkovModel* mmodel = graph ? _tgenmarkovmodel_new(graph, name, seed) : NULL;
-    return mmodel;
+    TGenMarkovModelCompiled* compiled = graph ? _tgenmarkovmodel_newCompiled(graph, name) : NULL;
+    return compiled ? _tgenmarkovmodel_new(compiled, name, seed) : NULL;
 }
 
-static gboolean _tgenmarkovmodel_chooseEdge(TGenMarkovModel* mmodel, EdgeType type,
-        igraph_integer_t fromVertexIndex,
-        igraph_integer_t* edgeIndexOut, igraph_integer_t* toVertexIndexOut) {
+/* samples the alias table with one random number: the integer part picks a
+ * slot, and the fraction decides between the slot and its alias */
+static TGenMarkovModelChoice* _tgenmarkovmodel_choose(TGenMarkovModel* mmodel,
+        TGenMarkovModelTable* table) {
     TGEN_MMODEL_ASSERT(mmodel);
 
-    int result = 0;
-    gboolean isSuccess = FALSE;
-
-    /* first we 'select' the incident edges, that is, those to which vertexIndex is connected */
-    igraph_es_t edgeSelector;
-    result = igraph_es_incident(&edgeSelector, fromVertexIndex, IGRAPH_OUT);
-
-    if(result != IGRAPH_SUCCESS) {
-        tgen_warning("igraph_es_incident return non-success code %i", result);
-        return FALSE;
-    }
-
-    /* now we set up an iterator on these edges */
-    igraph_eit_t edgeIterator;
-    result = igraph_eit_create(mmodel->graph, edgeSelector, &edgeIterator);
-
-    if(result != IGRAPH_SUCCESS) {
-        tgen_warning("igraph_eit_create return non-success code %i", result);
-        igraph_es_destroy(&edgeSelector);
-        return FALSE;
-    }
-
-    /* TODO
-     * Ideally, we should do this initial iteration over the edges to compute the total
-     * weight once at the graph load time. If we want to support graphs with weights
-     * that don't add to one, we can normalize the weights ourselves at load time and
-     * update the edge weight values. That way, in this function we only have to get
-     * the random value and iterate one to find the appropriate choice.
-     */
-
-    /* iterate over the edges to get the total weight, filtering by edge type */
-    gdouble totalWeight = 0.0;
-    guint numEdgesTotal = 0;
-    guint numEdgesType = 0;
-
-    /* iterate */
-    while (!IGRAPH_EIT_END(edgeIterator)) {
-        igraph_integer_t edgeIndex = IGRAPH_EIT_GET(edgeIterator);
-        numEdgesTotal++;
-
-        const gchar* typeStr;
-        isSuccess = _tgenmarkovmodel_findEdgeAttributeString(mmodel, edgeIndex, EDGE_ATTR_TYPE, &typeStr);
-        g_assert(isSuccess);
-
-        if(_tgenmarkovmodel_edgeTypeIsEqual(typeStr, type)) {
-            numEdgesType++;
-
-            gdouble weightValue = 0;
-            isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_WEIGHT, &weightValue);
-            g_assert(isSuccess);
-
-            totalWeight += weightValue;
-        }
-
-        IGRAPH_EIT_NEXT(edgeIterator);
-    }
-
-    tgen_debug("We found a total weight of %f from %u of %u edges that matched type '%s'",
-            totalWeight, numEdgesType, numEdgesTotal, _tgenmarkovmodel_edgeTypeToString(type));
-
-    /* select a random weight value */
-    gdouble randomValue = g_rand_double_range(mmodel->prng, (gdouble)0.0, totalWeight);
-
-    tgen_debug("Using random value %f from total weight %f", randomValue, totalWeight);
-
-    /* now iterate again to actually select one of the edges */
-    igraph_integer_t chosenEdgeIndex = 0;
-    gdouble cumulativeWeight = 0;
-    gboolean foundEdge = FALSE;
-
-    /* reset the iterator and iterate again */
-    IGRAPH_EIT_RESET(edgeIterator);
-    while (!IGRAPH_EIT_END(edgeIterator)) {
-        igraph_integer_t edgeIndex = IGRAPH_EIT_GET(edgeIterator);
-
-        const gchar* typeStr;
-        isSuccess = _tgenmarkovmodel_findEdgeAttributeString(mmodel, edgeIndex, EDGE_ATTR_TYPE, &typeStr);
-        g_assert(isSuccess);
-
-        if(_tgenmarkovmodel_edgeTypeIsEqual(typeStr, type)) {
-            gdouble weightValue = 0;
-            isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_WEIGHT, &weightValue);
-            g_assert(isSuccess);
-
-            cumulativeWeight += weightValue;
-
-            if(cumulativeWeight >= randomValue) {
-                foundEdge = TRUE;
-                chosenEdgeIndex = edgeIndex;
-                break;
-            }
-        }
-
-        IGRAPH_EIT_NEXT(edgeIterator);
-    }
-
-    /* clean up */
-    igraph_es_destroy(&edgeSelector);
-    igraph_eit_destroy(&edgeIterator);
-
-    if(!foundEdge) {
-        tgen_warning("Unable to choose random outgoing edge from vertex %i, "
-                "%u of %u edges matched edge type '%s'. "
-                "Total weight was %f, cumulative weight was %f, and randomValue was %f.",
-                (int)fromVertexIndex, numEdgesType, numEdgesTotal,
-                _tgenmarkovmodel_edgeTypeToString(type),
-                totalWeight, cumulativeWeight, randomValue);
-        return FALSE;
+    if(table->length == 0) {
+        return NULL;
     }
 
-    if(edgeIndexOut) {
-        *edgeIndexOut = chosenEdgeIndex;
+    if(mmodel->nextUniform >= TGEN_MMODEL_UNIFORM_BATCH) {
+        tgenrandom_fillDoubles(mmodel->prng, mmodel->uniforms, TGEN_MMODEL_UNIFORM_BATCH);
+        mmodel->nextUniform = 0;
     }
 
-    if(toVertexIndexOut) {
-        /* get the other vertex that we chose */
-         igraph_integer_t from, to;
-         result = igraph_edge(mmodel->graph, chosenEdgeIndex, &from, &to);
+    gdouble x = mmodel->uniforms[mmodel->nextUniform++] * (gdouble)table->length;
+    guint slot = MIN((guint)x, table->length - 1);
 
-         if(result != IGRAPH_SUCCESS) {
-             tgen_warning("igraph_edge return non-success code %i", result);
-             return FALSE;
-         }
-
-         *toVertexIndexOut = to;
+    TGenMarkovModelChoice* choices = &mmodel->compiled->choices[table->first];
+    if((x - (gdouble)slot) < choices[slot].keepProbability) {
+        return &choices[slot];
+    } else {
+        return &choices[choices[slot].alias];
     }
-
-    return TRUE;
-}
-
-static gboolean _tgenmarkovmodel_chooseTransition(TGenMarkovModel* mmodel,
-        igraph_integer_t fromVertexIndex,
-        igraph_integer_t* transitionEdgeIndex, igraph_integer_t* transitionStateVertexIndex) {
-    TGEN_MMODEL_ASSERT(mmodel);
-    return _tgenmarkovmodel_chooseEdge(mmodel, EDGE_TYPE_TRANSITION, fromVertexIndex,
-            transitionEdgeIndex, transitionStateVertexIndex);
-}
-
-static gboolean _tgenmarkovmodel_chooseEmission(TGenMarkovModel* mmodel,
-        igraph_integer_t fromVertexIndex,
-        igraph_integer_t* emissionEdgeIndex, igraph_integer_t* emissionObservationVertexIndex) {
-    TGEN_MMODEL_ASSERT(mmodel);
-    return _tgenmarkovmodel_chooseEdge(mmodel, EDGE_TYPE_EMISSION, fromVertexIndex,
-            emissionEdgeIndex, emissionObservationVertexIndex);
-}
-
-static gdouble _tgenmarkovmodel_generateLogNormalValue(TGenMarkovModel* mmodel, gdouble mu, gdouble sigma) {
-    /* first get a normal value from mu and sigma, using the Box-Muller method */
-    gdouble u = g_rand_double_range(mmodel->prng, (gdouble)0.0001, (gdouble)0.9999);
-    gdouble v = g_rand_double_range(mmodel->prng, (gdouble)0.0001, (gdouble)0.9999);
-
-    /* this gives us 2 normally-distributed values */
-    gdouble two = (gdouble)2;
-    gdouble x = sqrt(-two * log(u)) * cos(two * M_PI * v);
-    //double y = sqrt(-two * log(u)) * sin(two * M_PI * v);
-
-    /* location is mu, scale is sigma */
-    return exp(mu + (sigma * x));
-}
-
-static gdouble _tgenmarkovmodel_generateExponentialValue(TGenMarkovModel* mmodel, gdouble lambda) {
-    /* inverse transform sampling */
-    gdouble clampedUniform = g_rand_double_range(mmodel->prng, (gdouble)0.0001, (gdouble)0.9999);
-    return -log(clampedUniform)/lambda;
 }
 
 static guint64 _tgenmarkovmodel_generateDelay(TGenMarkovModel* mmodel,
-        igraph_integer_t edgeIndex) {
+        TGenMarkovModelChoice* emission) {
     TGEN_MMODEL_ASSERT(mmodel);
 
-    /* we already validated the attributes, so assert that they exist here */
-    gboolean isSuccess = FALSE;
-
-    const gchar* typeStr;
-    isSuccess = _tgenmarkovmodel_findEdgeAttributeString(mmodel, edgeIndex, EDGE_ATTR_TYPE, &typeStr);
-    g_assert(isSuccess);
-    g_assert(_tgenmarkovmodel_edgeTypeIsEqual(typeStr, EDGE_TYPE_EMISSION));
-
-    gdouble muValue = 0;
-    isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_LOGNORMMU, &muValue);
-    g_assert(isSuccess);
-
-    gdouble sigmaValue = 0;
-    isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_LOGNORMSIGMA, &sigmaValue);
-    g_assert(isSuccess);
-
     gdouble generatedValue = 0;
-    if(sigmaValue > 0 || muValue > 0) {
-        generatedValue = _tgenmarkovmodel_generateLogNormalValue(mmodel, muValue, sigmaValue);
+    if(emission->isLogNormal) {
+        /* location is mu, scale is sigma */
+        generatedValue = exp(emission->mu + (emission->sigma * tgenrandom_nextNormal(mmodel->prng)));
     } else {
-        gdouble lambdaValue = 0;
-        isSuccess = _tgenmarkovmodel_findEdgeAttributeDouble(mmodel, edgeIndex, EDGE_ATTR_EXPLAMBDA, &lambdaValue);
-        g_assert(isSuccess);
-
-        generatedValue = _tgenmarkovmodel_generateExponentialValue(mmodel, lambdaValue);
+        generatedValue = tgenrandom_nextExponential(mmodel->prng) / emission->lambda;
     }
 
     if(generatedValue > UINT64_MAX) {
@@ -970,31 +1191,15 @@ static guint64 _tgenmarkovmodel_generateDelay(TGenMarkovModel* mmodel,
     }
 }
 
-static Observation _tgenmarkovmodel_vertexToObservation(TGenMarkovModel* mmodel,
-        igraph_integer_t vertexIndex) {
-    TGEN_MMODEL_ASSERT(mmodel);
-
-    /* we already validated the attributes, so assert that they exist here */
-    gboolean isSuccess = FALSE;
-
-    const gchar* typeStr;
-    isSuccess = _tgenmarkovmodel_findVertexAttributeString(mmodel, vertexIndex, VERTEX_ATTR_TYPE, &typeStr);
-    g_assert(isSuccess);
-    g_assert(_tgenmarkovmodel_vertexTypeIsEqual(typeStr, VERTEX_TYPE_OBSERVATION));
-
-    const gchar* vidStr;
-    isSuccess = _tgenmarkovmodel_findVertexAttributeString(mmodel, vertexIndex, VERTEX_ATTR_NAME, &vidStr);
-    g_assert(isSuccess);
+static void _tgenmarkovmodel_warnNoChoice(TGenMarkovModel* mmodel, EdgeType type) {
+    const gchar* fromIDStr = NULL;
+    _tgenmarkovmodel_findVertexAttributeString(mmodel->compiled,
+            mmodel->currentStateVertexIndex, VERTEX_ATTR_NAME, &fromIDStr);
 
-    if(_tgenmarkovmodel_vertexIDIsEqual(vidStr, VERTEX_NAME_PACKET_TO_ORIGIN)) {
-        return OBSERVATION_PACKET_TO_ORIGIN;
-    } else if(_tgenmarkovmodel_vertexIDIsEqual(vidStr, VERTEX_NAME_PACKET_TO_SERVER)) {
-        return OBSERVATION_PACKET_TO_SERVER;
-    } else if(_tgenmarkovmodel_vertexIDIsEqual(vidStr, VERTEX_NAME_STREAM)) {
-        return OBSERVATION_STREAM;
-    } else {
-        return OBSERVATION_END;
-    }
+    tgen_warning("Failed to choose a %s edge from state %li (%s)",
+            _tgenmarkovmodel_edgeTypeToString(type),
+            (glong)mmodel->currentStateVertexIndex, fromIDStr);
+    tgen_warning("Prematurely returning end observation");
 }
 
 Observation tgenmarkovmodel_getNextObservation(TGenMarkovModel* mmodel, guint64* delay) {
@@ -1004,68 +1209,45 @@ Observation tgenmarkovmodel_getNextObservation(TGenMarkovModel* mmodel, guint64*
         return OBSERVATION_END;
     }
 
-    tgen_debug("About to choose transition from vertex %li", (glong)mmodel->currentStateVertexIndex);
-
     /* first choose the next state through a transition edge */
-    igraph_integer_t nextStateVertexIndex = 0;
-    gboolean isSuccess = _tgenmarkovmodel_chooseTransition(mmodel,
-            mmodel->currentStateVertexIndex, NULL, &nextStateVertexIndex);
-
-    if(!isSuccess) {
-        const gchar* fromIDStr;
-        _tgenmarkovmodel_findVertexAttributeString(mmodel,
-                mmodel->currentStateVertexIndex, VERTEX_ATTR_NAME, &fromIDStr);
-
-        tgen_warning("Failed to choose a transition edge from state %li (%s)",
-                (glong)mmodel->currentStateVertexIndex, fromIDStr);
-        tgen_warning("Prematurely returning end observation");
+    TGenMarkovModelChoice* transition = _tgenmarkovmodel_choose(mmodel,
+            &mmodel->compiled->transitionTables[(guint)mmodel->currentStateVertexIndex]);
 
+    if(!transition) {
+        _tgenmarkovmodel_warnNoChoice(mmodel, EDGE_TYPE_TRANSITION);
         return OBSERVATION_END;
     }
 
-    tgen_debug("Found transition to vertex %li", (glong)nextStateVertexIndex);
+    tgen_debug("Transition from vertex %li to vertex %u",
+            (glong)mmodel->currentStateVertexIndex, transition->toVertexIndex);
 
     /* update our current state */
-    mmodel->currentStateVertexIndex = nextStateVertexIndex;
-
-    tgen_debug("About to choose emission from vertex %li", (glong)mmodel->currentStateVertexIndex);
+    mmodel->currentStateVertexIndex = (igraph_integer_t)transition->toVertexIndex;
 
     /* now choose an observation through an emission edge */
-    igraph_integer_t emissionEdgeIndex = 0;
-    igraph_integer_t emissionObservationVertexIndex = 0;
-    isSuccess = _tgenmarkovmodel_chooseEmission(mmodel, mmodel->currentStateVertexIndex,
-            &emissionEdgeIndex, &emissionObservationVertexIndex);
-
-    if(!isSuccess) {
-        const gchar* fromIDStr;
-        _tgenmarkovmodel_findVertexAttributeString(mmodel,
-                mmodel->currentStateVertexIndex, VERTEX_ATTR_NAME, &fromIDStr);
-
-        tgen_warning("Failed to choose an emission edge from state %li (%s)",
-                (glong)mmodel->currentStateVertexIndex, fromIDStr);
-        tgen_warning("Prematurely returning end observation");
+    TGenMarkovModelChoice* emission = _tgenmarkovmodel_choose(mmodel,
+            &mmodel->compiled->emissionTables[(guint)mmodel->currentStateVertexIndex]);
 
+    if(!emission) {
+        _tgenmarkovmodel_warnNoChoice(mmodel, EDGE_TYPE_EMISSION);
         return OBSERVATION_END;
     }
 
-    tgen_debug("Found emission on edge %li and observation on vertex %li",
-            (glong)emissionEdgeIndex, (glong)emissionObservationVertexIndex);
-
     if(delay) {
-        *delay = _tgenmarkovmodel_generateDelay(mmodel, emissionEdgeIndex);
+        *delay = _tgenmarkovmodel_generateDelay(mmodel, emission);
         if(*delay > 60000000){
             *delay = 60000000;
         }
     }
 
-    return _tgenmarkovmodel_vertexToObservation(mmodel, emissionObservationVertexIndex);
+    return emission->observation;
 }
 
 void tgenmarkovmodel_reset(TGenMarkovModel* mmodel) {
     TGEN_MMODEL_ASSERT(mmodel);
 
     mmodel->foundEndState = FALSE;
-    mmodel->currentStateVertexIndex = mmodel->startVertexIndex;
+    mmodel->currentStateVertexIndex = mmodel->compiled->startVertexIndex;
 }
 
 guint32 tgenmarkovmodel_getSeed(TGenMarkovModel* mmodel) {
@@ -1092,15 +1274,10 @@ GString* tgenmarkovmodel_toGraphmlString(TGenMarkovModel* mmodel) {
         return NULL;
     }
 
-    /* This is a workaround because igraph tries to store vertex ids as attributes.
-     * Normally igraph would print the following warning to stderr:
-     *   Warning: Could not add vertex ids, there is already an 'id' vertex attribute
-     *   in file foreign-graphml.c, line 443
-     * The fix is to remove the id attributes since we don't use it anyway, which
-     * prevents igraph from trying to write it in the vertex id field AND as an attribute. */
-    igraph_cattribute_remove_v(mmodel->graph, "id");
-
-    int result = igraph_write_graph_graphml(mmodel->graph, graphStream, FALSE);
+    /* igraph uses the global attribute handler while it writes */
+    g_mutex_lock(&tgenMarkovModelLoadLock);
+    int result = igraph_write_graph_graphml(mmodel->compiled->graph, graphStream, FALSE);
+    g_mutex_unlock(&tgenMarkovModelLoadLock);
 
     if(result != IGRAPH_SUCCESS) {
         tgen_warning("IGraph error when writing graph name '%s'", mmodel->name);
@@ -0,0 +1,132 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#include <sys/mman.h>
+
+#include "tgen.h"
+
+/* the payload pool fills one (huge) page. the bytes at the end of the pool
+ * repeat the bytes at its start, so that a chunk of up to TGEN_PAYLOAD_MAX_CHUNK
+ * bytes starting anywhere in the period is contiguous. */
+#define TGEN_PAYLOAD_POOL_LENGTH (2*1024*1024)
+#define TGEN_PAYLOAD_PERIOD (TGEN_PAYLOAD_POOL_LENGTH - TGEN_PAYLOAD_MAX_CHUNK)
+
+/* the pools are created on first use and then shared read-only by all
+ * transfers in all threads until the process exits */
+static gchar* tgenPayloadPools[2];
+
+/* memfd copies of the pools, so that transports can send them with sendfile */
+static GOnce tgenPayloadFiles[2] = {G_ONCE_INIT, G_ONCE_INIT};
+
+static gchar* _tgenpayload_allocate(void) {
+    gsize length = TGEN_PAYLOAD_POOL_LENGTH;
+
+#ifdef MAP_HUGETLB
+    gpointer hugePool = mmap(NULL, length, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if(hugePool != MAP_FAILED) {
+        tgen_info("allocated payload pool of %"G_GSIZE_FORMAT" bytes on a huge page", length);
+        return hugePool;
+    }
+#endif
+
+    /* no huge pages are reserved, so we ask for a transparent one instead */
+    gpointer pool = mmap(NULL, length, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(pool == MAP_FAILED) {
+        tgen_error("mmap(): unable to allocate payload pool of %"G_GSIZE_FORMAT" bytes, error %i: %s",
+                length, errno, g_strerror(errno));
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(pool, length, MADV_HUGEPAGE);
+#endif
+
+    tgen_info("allocated payload pool of %"G_GSIZE_FORMAT" bytes", length);
+    return pool;
+}
+
+static gchar* _tgenpayload_newPool(TGenPayloadContent content) {
+    gchar* pool = _tgenpayload_allocate();
+
+    if(content == TGEN_PAYLOAD_RANDOM) {
+        /* high-entropy bytes that proxies can not compress */
+        guint32* words = (guint32*)pool;
+        for(gsize i = 0; i < TGEN_PAYLOAD_PERIOD / sizeof(guint32); i++) {
+            words[i] = g_random_int();
+        }
+    } else {
+        /* pick the letter once, like we did when generating every chunk.
+         * the glib prng is safe to use from any worker thread. */
+        gchar c = (gchar)('a' + g_random_int_range(0, 26));
+        memset(pool, c, TGEN_PAYLOAD_PERIOD);
+    }
+
+    memcpy(&pool[TGEN_PAYLOAD_PERIOD], pool, TGEN_PAYLOAD_MAX_CHUNK);
+
+    /* nobody writes to the pool once it is shared */
+    mprotect(pool, TGEN_PAYLOAD_POOL_LENGTH, PROT_READ);
+
+    return pool;
+}
+
+/* returns length contiguous payload bytes starting at the offset into the
+ * payload period. the bytes must not be modified or freed. */
+const gchar* tgenpayload_getBytes(TGenPayloadContent content, gsize offset, gsize length) {
+    g_assert(content == TGEN_PAYLOAD_CONSTANT || content == TGEN_PAYLOAD_RANDOM);
+    g_assert(offset < TGEN_PAYLOAD_PERIOD && length <= TGEN_PAYLOAD_MAX_CHUNK);
+
+    gchar** pool = &tgenPayloadPools[content];
+    if(g_once_init_enter(pool)) {
+        g_once_init_leave(pool, _tgenpayload_newPool(content));
+    }
+
+    return &(*pool)[offset];
+}
+
+static gpointer _tgenpayload_newFile(gpointer contentPointer) {
+    TGenPayloadContent content = (TGenPayloadContent)GPOINTER_TO_INT(contentPointer);
+    const gchar* pool = tgenpayload_getBytes(content, 0, 0);
+
+#ifdef MFD_CLOEXEC
+    /* hugetlbfs files can not be spliced, so this one lives on normal pages */
+    gint fileD = memfd_create("tgen-payload", MFD_CLOEXEC);
+    if(fileD < 0) {
+        tgen_warning("memfd_create(): returned %i error %i: %s", fileD, errno, g_strerror(errno));
+        return GINT_TO_POINTER(-1);
+    }
+
+    gsize offset = 0;
+    while(offset < TGEN_PAYLOAD_POOL_LENGTH) {
+        gssize bytes = pwrite(fileD, &pool[offset], TGEN_PAYLOAD_POOL_LENGTH - offset, (off_t)offset);
+        if(bytes <= 0 && errno != EINTR) {
+            tgen_warning("pwrite(): payload file %i returned %i error %i: %s",
+                    fileD, (gint)bytes, errno, g_strerror(errno));
+            close(fileD);
+            return GINT_TO_POINTER(-1);
+        }
+        offset += (bytes > 0) ? (gsize)bytes : 0;
+    }
+
+    tgen_info("created payload file %i of %"G_GSIZE_FORMAT" bytes", fileD, offset);
+    return GINT_TO_POINTER(fileD);
+#else
+    tgen_warning("tgen was built without memfd support");
+    return GINT_TO_POINTER(-1);
+#endif
+}
+
+/* returns a descriptor whose file bytes equal the pool bytes at the same
+ * offsets, or -1 if no such file could be created. the descriptor must not be closed. */
+gint tgenpayload_getDescriptor(TGenPayloadContent content) {
+    g_assert(content == TGEN_PAYLOAD_CONSTANT || content == TGEN_PAYLOAD_RANDOM);
+    return GPOINTER_TO_INT(g_once(&tgenPayloadFiles[content], _tgenpayload_newFile,
+            GINT_TO_POINTER(content)));
+}
+
+/* the payload bytes repeat after this many bytes */
+gsize tgenpayload_getPeriod(void) {
+    return TGEN_PAYLOAD_PERIOD;
+}
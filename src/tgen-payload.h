@@ -0,0 +1,22 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_PAYLOAD_H_
+#define TGEN_PAYLOAD_H_
+
+#include <glib.h>
+
+/* the most payload bytes that can be borrowed from the pool at once */
+#define TGEN_PAYLOAD_MAX_CHUNK 65536
+
+typedef enum _TGenPayloadContent {
+    TGEN_PAYLOAD_CONSTANT,
+    TGEN_PAYLOAD_RANDOM,
+} TGenPayloadContent;
+
+const gchar* tgenpayload_getBytes(TGenPayloadContent content, gsize offset, gsize length);
+gint tgenpayload_getDescriptor(TGenPayloadContent content);
+gsize tgenpayload_getPeriod(void);
+
+#endif /* TGEN_PAYLOAD_H_ */
@@ -4,11 +4,20 @@
 
 #include "tgen.h"
 
+/* names we look up that are shorter than this are kept inline in the peer */
+#define TGEN_PEER_NAME_BUFFER_LENGTH 64
+
 struct _TGenPeer {
     in_addr_t netIP;
     in_port_t netPort;
-    gchar* hostIPStr;
-    gchar* hostNameStr;
+    /* empty if we do not know the ip */
+    gchar hostIPStr[INET_ADDRSTRLEN];
+    /* names from the config are interned, since there are only a few of them.
+     * names we look up for the peers that connect to us point into the buffer,
+     * or to the heap if they are too long to fit. */
+    const gchar* hostNameStr;
+    gchar hostNameBuffer[TGEN_PEER_NAME_BUFFER_LENGTH];
+    gboolean ownsHostName;
 
     gchar* string;
 
@@ -27,21 +36,15 @@ static in_addr_t _tgenpeer_ipStrToIP(const gchar* string) {
     }
 }
 
-static gchar* _tgenpeer_ipToIPStr(in_addr_t netIP) {
-    gchar* ipStr = NULL;
+/* writes the ip string into the buffer, or an empty string if we have no ip */
+static void _tgenpeer_ipToIPStr(in_addr_t netIP, gchar ipStr[INET_ADDRSTRLEN]) {
+    memset(ipStr, 0, INET_ADDRSTRLEN);
 
     if(netIP != htonl(INADDR_NONE)) {
-        gchar netbuf[INET_ADDRSTRLEN+1];
-        memset(netbuf, 0, INET_ADDRSTRLEN+1);
-
-        const gchar* netresult = inet_ntop(AF_INET, &netIP, netbuf, INET_ADDRSTRLEN);
-
-        if(netresult != NULL) {
-            ipStr = g_strdup(netresult);
+        if(inet_ntop(AF_INET, &netIP, ipStr, INET_ADDRSTRLEN) == NULL) {
+            memset(ipStr, 0, INET_ADDRSTRLEN);
         }
     }
-
-    return ipStr;
 }
 
 static in_addr_t _tgenpeer_lookupIP(const gchar* hostname) {
@@ -64,8 +67,8 @@ static in_addr_t _tgenpeer_lookupIP(const gchar* hostname) {
     return ip;
 }
 
-static gchar* _tgenpeer_lookupName(in_addr_t networkIP) {
-    gchar* name = NULL;
+static const gchar* _tgenpeer_lookupName(TGenPeer* peer, in_addr_t networkIP) {
+    const gchar* name = NULL;
 
     struct sockaddr_in addrbuf;
     memset(&addrbuf, 0, sizeof(struct sockaddr_in));
@@ -80,14 +83,20 @@ static gchar* _tgenpeer_lookupName(in_addr_t networkIP) {
             namebuf, (socklen_t) 255, NULL, 0, 0);
 
     if(result == 0) {
-        name = g_strdup(namebuf);
+        /* we do not intern these, there is no bound on how many we see */
+        gsize length = strlen(namebuf);
+        if(length < TGEN_PEER_NAME_BUFFER_LENGTH) {
+            memcpy(peer->hostNameBuffer, namebuf, length + 1);
+            name = peer->hostNameBuffer;
+        } else {
+            name = g_strndup(namebuf, length);
+            peer->ownsHostName = TRUE;
+        }
     } else {
-        gchar* ipStr = _tgenpeer_ipToIPStr(networkIP);
+        gchar ipStr[INET_ADDRSTRLEN];
+        _tgenpeer_ipToIPStr(networkIP, ipStr);
         tgen_warning("getnameinfo(): returned %i ip '%s' errno %i: %s",
                 result, ipStr, errno, gai_strerror(errno));
-        if(ipStr) {
-            g_free(ipStr);
-        }
     }
 
     return name;
@@ -101,7 +110,7 @@ void tgenpeer_performLookups(TGenPeer* peer) {
 
     /* hostname lookup */
     if(peer->netIP && !peer->hostNameStr) {
-        peer->hostNameStr = _tgenpeer_lookupName(peer->netIP);
+        peer->hostNameStr = _tgenpeer_lookupName(peer, peer->netIP);
         changed = TRUE;
     }
 
@@ -110,10 +119,7 @@ void tgenpeer_performLookups(TGenPeer* peer) {
         in_addr_t ipTry = _tgenpeer_lookupIP(peer->hostNameStr);
         if(ipTry != htonl(INADDR_NONE)) {
             peer->netIP = ipTry;
-            if(peer->hostIPStr) {
-                g_free(peer->hostIPStr);
-            }
-            peer->hostIPStr = _tgenpeer_ipToIPStr(peer->netIP);
+            _tgenpeer_ipToIPStr(peer->netIP, peer->hostIPStr);
             changed = TRUE;
         }
     }
@@ -128,7 +134,7 @@ void tgenpeer_performLookups(TGenPeer* peer) {
 }
 
 static TGenPeer* _tgenpeer_new(const gchar* name, in_addr_t networkIP, in_port_t networkPort) {
-    TGenPeer* peer = g_new0(TGenPeer, 1);
+    TGenPeer* peer = tgenslab_alloc0(TGEN_SLAB_PEER, sizeof(TGenPeer));
     peer->magic = TGEN_MAGIC;
     peer->refcount = 1;
 
@@ -148,7 +154,7 @@ static TGenPeer* _tgenpeer_new(const gchar* name, in_addr_t networkIP, in_port_t
                 peer->netIP = ipTry;
             } else {
                 /* not a valid ip, lets assume its a hostname */
-                peer->hostNameStr = g_strdup(name);
+                peer->hostNameStr = g_intern_string(name);
             }
         }
     }
@@ -158,9 +164,9 @@ static TGenPeer* _tgenpeer_new(const gchar* name, in_addr_t networkIP, in_port_t
     }
 
     if(peer->netIP) {
-        peer->hostIPStr = _tgenpeer_ipToIPStr(peer->netIP);
+        _tgenpeer_ipToIPStr(peer->netIP, peer->hostIPStr);
         if(peer->netIP == htonl(INADDR_LOOPBACK) && !peer->hostNameStr) {
-            peer->hostNameStr = g_strdup("localhost");
+            peer->hostNameStr = g_intern_static_string("localhost");
         }
     }
 
@@ -179,20 +185,16 @@ static void _tgenpeer_free(TGenPeer* peer) {
     TGEN_ASSERT(peer);
     g_assert(peer->refcount == 0);
 
-    if(peer->hostIPStr) {
-        g_free(peer->hostIPStr);
-    }
-
-    if(peer->hostNameStr) {
-        g_free(peer->hostNameStr);
-    }
-
     if(peer->string) {
         g_free(peer->string);
     }
 
+    if(peer->ownsHostName) {
+        g_free((gchar*)peer->hostNameStr);
+    }
+
     peer->magic = 0;
-    g_free(peer);
+    tgenslab_free(TGEN_SLAB_PEER, peer);
 }
 
 void tgenpeer_ref(TGenPeer* peer) {
@@ -242,7 +244,7 @@ const gchar* tgenpeer_toString(TGenPeer* peer) {
     if(!peer->string) {
         GString* stringBuffer = g_string_new(NULL);
         g_string_printf(stringBuffer, "%s:%s:%u",peer->hostNameStr ? peer->hostNameStr : "NULL",
-                peer->hostIPStr ? peer->hostIPStr : "0.0.0.0", ntohs(peer->netPort));
+                peer->hostIPStr[0] ? peer->hostIPStr : "0.0.0.0", ntohs(peer->netPort));
         peer->string = g_string_free(stringBuffer, FALSE);
     }
 
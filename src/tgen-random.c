@@ -0,0 +1,296 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#include <math.h>
+
+#include <glib.h>
+
+#include "tgen-random.h"
+
+/* the Ziggurat tables, as in Marsaglia and Tsang, "The Ziggurat Method for
+ * Generating Random Variables", 2000. the normal uses 128 layers, and the
+ * exponential 256 layers. r is where the tail starts, and v is the area of
+ * each layer. */
+#define TGEN_RANDOM_NORMAL_LAYERS 128
+#define TGEN_RANDOM_NORMAL_R 3.442619855899
+#define TGEN_RANDOM_NORMAL_V 9.91256303526217e-3
+#define TGEN_RANDOM_EXPONENTIAL_LAYERS 256
+#define TGEN_RANDOM_EXPONENTIAL_R 7.697117470131487
+#define TGEN_RANDOM_EXPONENTIAL_V 3.949659822581572e-3
+
+/* 2^-53, to turn the top 53 bits into a double */
+#define TGEN_RANDOM_DOUBLE_UNIT (1.0 / 9007199254740992.0)
+
+struct _TGenRandom {
+    guint64 state[4];
+    guint magic;
+};
+
+typedef struct _TGenRandomTables {
+    guint32 kn[TGEN_RANDOM_NORMAL_LAYERS];
+    gdouble wn[TGEN_RANDOM_NORMAL_LAYERS];
+    gdouble fn[TGEN_RANDOM_NORMAL_LAYERS];
+    guint32 ke[TGEN_RANDOM_EXPONENTIAL_LAYERS];
+    gdouble we[TGEN_RANDOM_EXPONENTIAL_LAYERS];
+    gdouble fe[TGEN_RANDOM_EXPONENTIAL_LAYERS];
+} TGenRandomTables;
+
+static TGenRandomTables tables;
+static gsize tablesInitialized = 0;
+
+static __thread TGenRandom* threadRandom = NULL;
+
+#if 1 /* #ifdef DEBUG */
+#define TGEN_RANDOM_MAGIC 0xABBA5EED
+#define TGEN_RANDOM_ASSERT(obj) g_assert(obj && (obj->magic == TGEN_RANDOM_MAGIC))
+#else
+#define TGEN_RANDOM_MAGIC 0
+#define TGEN_RANDOM_ASSERT(obj)
+#endif
+
+static void _tgenrandom_initTables() {
+    if(!g_once_init_enter(&tablesInitialized)) {
+        return;
+    }
+
+    /* the normal distribution, from the tail layer down */
+    const gdouble m1 = 2147483648.0;
+    gdouble dn = TGEN_RANDOM_NORMAL_R;
+    gdouble tn = dn;
+    gdouble q = TGEN_RANDOM_NORMAL_V / exp(-0.5 * dn * dn);
+
+    tables.kn[0] = (guint32)((dn / q) * m1);
+    tables.kn[1] = 0;
+    tables.wn[0] = q / m1;
+    tables.wn[TGEN_RANDOM_NORMAL_LAYERS - 1] = dn / m1;
+    tables.fn[0] = 1.0;
+    tables.fn[TGEN_RANDOM_NORMAL_LAYERS - 1] = exp(-0.5 * dn * dn);
+
+    for(gint i = TGEN_RANDOM_NORMAL_LAYERS - 2; i >= 1; i--) {
+        dn = sqrt(-2.0 * log(TGEN_RANDOM_NORMAL_V / dn + exp(-0.5 * dn * dn)));
+        tables.kn[i + 1] = (guint32)((dn / tn) * m1);
+        tn = dn;
+        tables.fn[i] = exp(-0.5 * dn * dn);
+        tables.wn[i] = dn / m1;
+    }
+
+    /* the exponential distribution, from the tail layer down */
+    const gdouble m2 = 4294967296.0;
+    gdouble de = TGEN_RANDOM_EXPONENTIAL_R;
+    gdouble te = de;
+    q = TGEN_RANDOM_EXPONENTIAL_V / exp(-de);
+
+    tables.ke[0] = (guint32)((de / q) * m2);
+    tables.ke[1] = 0;
+    tables.we[0] = q / m2;
+    tables.we[TGEN_RANDOM_EXPONENTIAL_LAYERS - 1] = de / m2;
+    tables.fe[0] = 1.0;
+    tables.fe[TGEN_RANDOM_EXPONENTIAL_LAYERS - 1] = exp(-de);
+
+    for(gint i = TGEN_RANDOM_EXPONENTIAL_LAYERS - 2; i >= 1; i--) {
+        de = -log(TGEN_RANDOM_EXPONENTIAL_V / de + exp(-de));
+        tables.ke[i + 1] = (guint32)((de / te) * m2);
+        te = de;
+        tables.fe[i] = exp(-de);
+        tables.we[i] = de / m2;
+    }
+
+    g_once_init_leave(&tablesInitialized, 1);
+}
+
+/* splitmix64, which the xoshiro authors suggest to expand a seed into the state */
+static guint64 _tgenrandom_splitMix64(guint64* x) {
+    guint64 z = (*x += G_GUINT64_CONSTANT(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * G_GUINT64_CONSTANT(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * G_GUINT64_CONSTANT(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+TGenRandom* tgenrandom_new(guint64 seed) {
+    _tgenrandom_initTables();
+
+    TGenRandom* random = g_new0(TGenRandom, 1);
+    random->magic = TGEN_RANDOM_MAGIC;
+
+    /* splitmix64 never gives an all zero state */
+    guint64 x = seed;
+    for(gint i = 0; i < 4; i++) {
+        random->state[i] = _tgenrandom_splitMix64(&x);
+    }
+
+    return random;
+}
+
+void tgenrandom_free(TGenRandom* random) {
+    TGEN_RANDOM_ASSERT(random);
+    random->magic = 0;
+    g_free(random);
+}
+
+TGenRandom* tgenrandom_getThreadLocal() {
+    if(!threadRandom) {
+        /* the global glib prng is thread-safe, and seeded from /dev/urandom */
+        guint64 seed = (((guint64)g_random_int()) << 32) | (guint64)g_random_int();
+        threadRandom = tgenrandom_new(seed);
+    }
+    return threadRandom;
+}
+
+static inline guint64 _tgenrandom_rotateLeft(const guint64 x, gint k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/* xoshiro256**, from Blackman and Vigna, "Scrambled Linear Pseudorandom
+ * Number Generators", 2018 */
+static inline guint64 _tgenrandom_next(TGenRandom* random) {
+    guint64* s = random->state;
+    const guint64 result = _tgenrandom_rotateLeft(s[1] * 5, 7) * 9;
+    const guint64 t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = _tgenrandom_rotateLeft(s[3], 45);
+
+    return result;
+}
+
+static inline gdouble _tgenrandom_nextDouble(TGenRandom* random) {
+    return (gdouble)(_tgenrandom_next(random) >> 11) * TGEN_RANDOM_DOUBLE_UNIT;
+}
+
+/* uniform in (0, 1), so that we can take its log */
+static inline gdouble _tgenrandom_nextDoubleOpen(TGenRandom* random) {
+    return ((gdouble)(_tgenrandom_next(random) >> 11) + 0.5) * TGEN_RANDOM_DOUBLE_UNIT;
+}
+
+/* we rarely get here, only when the sample is outside of the rectangles */
+static gdouble _tgenrandom_fixNormal(TGenRandom* random, gint32 hz, guint iz) {
+    while(TRUE) {
+        gdouble x = (gdouble)hz * tables.wn[iz];
+
+        if(iz == 0) {
+            /* the base layer, so we sample from the tail */
+            gdouble y = 0;
+            do {
+                x = -log(_tgenrandom_nextDoubleOpen(random)) / TGEN_RANDOM_NORMAL_R;
+                y = -log(_tgenrandom_nextDoubleOpen(random));
+            } while(y + y < x * x);
+            return (hz > 0) ? TGEN_RANDOM_NORMAL_R + x : -TGEN_RANDOM_NORMAL_R - x;
+        }
+
+        if(tables.fn[iz] + _tgenrandom_nextDouble(random) * (tables.fn[iz - 1] - tables.fn[iz]) <
+                exp(-0.5 * x * x)) {
+            return x;
+        }
+
+        /* try again */
+        guint64 u = _tgenrandom_next(random);
+        hz = (gint32)(u >> 32);
+        iz = (guint)(u & (TGEN_RANDOM_NORMAL_LAYERS - 1));
+        if((guint32)ABS((gint64)hz) < tables.kn[iz]) {
+            return (gdouble)hz * tables.wn[iz];
+        }
+    }
+}
+
+static inline gdouble _tgenrandom_nextNormal(TGenRandom* random) {
+    /* the layer comes from the low bits and the value from the high bits,
+     * so they do not depend on each other */
+    guint64 u = _tgenrandom_next(random);
+    gint32 hz = (gint32)(u >> 32);
+    guint iz = (guint)(u & (TGEN_RANDOM_NORMAL_LAYERS - 1));
+
+    if((guint32)ABS((gint64)hz) < tables.kn[iz]) {
+        return (gdouble)hz * tables.wn[iz];
+    } else {
+        return _tgenrandom_fixNormal(random, hz, iz);
+    }
+}
+
+static gdouble _tgenrandom_fixExponential(TGenRandom* random, guint32 jz, guint iz) {
+    while(TRUE) {
+        if(iz == 0) {
+            /* the exponential is memoryless, so the tail is just shifted */
+            return TGEN_RANDOM_EXPONENTIAL_R - log(_tgenrandom_nextDoubleOpen(random));
+        }
+
+        gdouble x = (gdouble)jz * tables.we[iz];
+        if(tables.fe[iz] + _tgenrandom_nextDouble(random) * (tables.fe[iz - 1] - tables.fe[iz]) <
+                exp(-x)) {
+            return x;
+        }
+
+        /* try again */
+        guint64 u = _tgenrandom_next(random);
+        jz = (guint32)(u >> 32);
+        iz = (guint)(u & (TGEN_RANDOM_EXPONENTIAL_LAYERS - 1));
+        if(jz < tables.ke[iz]) {
+            return (gdouble)jz * tables.we[iz];
+        }
+    }
+}
+
+static inline gdouble _tgenrandom_nextExponential(TGenRandom* random) {
+    guint64 u = _tgenrandom_next(random);
+    guint32 jz = (guint32)(u >> 32);
+    guint iz = (guint)(u & (TGEN_RANDOM_EXPONENTIAL_LAYERS - 1));
+
+    if(jz < tables.ke[iz]) {
+        return (gdouble)jz * tables.we[iz];
+    } else {
+        return _tgenrandom_fixExponential(random, jz, iz);
+    }
+}
+
+guint64 tgenrandom_nextUInt64(TGenRandom* random) {
+    TGEN_RANDOM_ASSERT(random);
+    return _tgenrandom_next(random);
+}
+
+guint32 tgenrandom_nextUInt32Bounded(TGenRandom* random, guint32 bound) {
+    TGEN_RANDOM_ASSERT(random);
+    g_assert(bound > 0);
+    /* Lemire's multiply and shift, which is close enough to uniform for the
+     * small bounds we use and avoids a division */
+    return (guint32)(((_tgenrandom_next(random) >> 32) * (guint64)bound) >> 32);
+}
+
+gdouble tgenrandom_nextDouble(TGenRandom* random) {
+    TGEN_RANDOM_ASSERT(random);
+    return _tgenrandom_nextDouble(random);
+}
+
+gdouble tgenrandom_nextNormal(TGenRandom* random) {
+    TGEN_RANDOM_ASSERT(random);
+    return _tgenrandom_nextNormal(random);
+}
+
+gdouble tgenrandom_nextExponential(TGenRandom* random) {
+    TGEN_RANDOM_ASSERT(random);
+    return _tgenrandom_nextExponential(random);
+}
+
+void tgenrandom_fillDoubles(TGenRandom* random, gdouble* samples, gsize numSamples) {
+    TGEN_RANDOM_ASSERT(random);
+    for(gsize i = 0; i < numSamples; i++) {
+        samples[i] = _tgenrandom_nextDouble(random);
+    }
+}
+
+void tgenrandom_fillNormals(TGenRandom* random, gdouble* samples, gsize numSamples) {
+    TGEN_RANDOM_ASSERT(random);
+    for(gsize i = 0; i < numSamples; i++) {
+        samples[i] = _tgenrandom_nextNormal(random);
+    }
+}
+
+void tgenrandom_fillExponentials(TGenRandom* random, gdouble* samples, gsize numSamples) {
+    TGEN_RANDOM_ASSERT(random);
+    for(gsize i = 0; i < numSamples; i++) {
+        samples[i] = _tgenrandom_nextExponential(random);
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_RANDOM_H_
+#define TGEN_RANDOM_H_
+
+#include <glib.h>
+
+/* a pseudo-random number generator using xoshiro256**, with Ziggurat samplers
+ * for the normal and exponential distributions. the same seed always gives the
+ * same sequence, so the traffic we generate from a seed can be replayed.
+ * a generator is not thread-safe; use one per thread. */
+typedef struct _TGenRandom TGenRandom;
+
+TGenRandom* tgenrandom_new(guint64 seed);
+void tgenrandom_free(TGenRandom* random);
+
+/* a generator for the calling thread, seeded from the global glib prng */
+TGenRandom* tgenrandom_getThreadLocal();
+
+guint64 tgenrandom_nextUInt64(TGenRandom* random);
+/* uniform in [0, bound), bound must not be 0 */
+guint32 tgenrandom_nextUInt32Bounded(TGenRandom* random, guint32 bound);
+/* uniform in [0, 1) */
+gdouble tgenrandom_nextDouble(TGenRandom* random);
+/* standard normal, with mean 0 and standard deviation 1 */
+gdouble tgenrandom_nextNormal(TGenRandom* random);
+/* standard exponential, with rate 1 */
+gdouble tgenrandom_nextExponential(TGenRandom* random);
+
+/* these fill the array with the next numSamples samples, which are the same
+ * values that calling the function for one sample that many times returns */
+void tgenrandom_fillDoubles(TGenRandom* random, gdouble* samples, gsize numSamples);
+void tgenrandom_fillNormals(TGenRandom* random, gdouble* samples, gsize numSamples);
+void tgenrandom_fillExponentials(TGenRandom* random, gdouble* samples, gsize numSamples);
+
+#endif /* TGEN_RANDOM_H_ */
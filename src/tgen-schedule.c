@@ -0,0 +1,175 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#include "tgen.h"
+
+/* the number of delays we store in each window. a transfer that owns its
+ * schedule frees whole windows as it removes delays from the front. */
+#define TGEN_SCHEDULE_WINDOW_DELAYS 1024
+
+struct _TGenSchedule {
+    gint refcount;
+    /* windows of TGEN_SCHEDULE_WINDOW_DELAYS int32_t delays in microseconds */
+    GPtrArray* windows;
+    /* the delays we removed from the first window */
+    guint frontOffset;
+    guint length;
+    /* each delay is followed by one packet */
+    gsize totalBytes;
+    guint magic;
+};
+
+TGenSchedule* tgenschedule_new() {
+    TGenSchedule* schedule = g_new0(TGenSchedule, 1);
+    schedule->magic = TGEN_MAGIC;
+    schedule->refcount = 1;
+    schedule->windows = g_ptr_array_new_with_free_func(g_free);
+    return schedule;
+}
+
+/* parses the next delay of a comma-separated schedule and moves the cursor past
+ * it, skipping empty entries. returns FALSE at the end of the schedule. */
+static gboolean _tgenschedule_nextDelay(const gchar** cursor, gint32* delayOut) {
+    const gchar* position = *cursor;
+
+    while(*position != '\0') {
+        const gchar* end = strchr(position, ',');
+        const gchar* next = end ? end + 1 : position + strlen(position);
+
+        if(end == position) {
+            position = next;
+            continue;
+        }
+
+        /* delays are time in micros between packets */
+        gint64 value = g_ascii_strtoll(position, NULL, 10);
+        if(value > G_MAXINT32) {
+            *delayOut = G_MAXINT32;
+        } else if (value < G_MININT32) {
+            *delayOut = G_MININT32;
+        } else {
+            *delayOut = (gint32) value;
+        }
+
+        *cursor = next;
+        return TRUE;
+    }
+
+    *cursor = position;
+    return FALSE;
+}
+
+TGenSchedule* tgenschedule_newFromString(const gchar* scheduleStr) {
+    g_assert(scheduleStr);
+
+    TGenSchedule* schedule = tgenschedule_new();
+
+    gint32 delay = 0;
+    while(_tgenschedule_nextDelay(&scheduleStr, &delay)) {
+        tgenschedule_append(schedule, delay);
+    }
+
+    return schedule;
+}
+
+static void _tgenschedule_free(TGenSchedule* schedule) {
+    TGEN_ASSERT(schedule);
+    g_assert(schedule->refcount == 0);
+
+    if(schedule->windows) {
+        g_ptr_array_free(schedule->windows, TRUE);
+    }
+
+    schedule->magic = 0;
+    g_free(schedule);
+}
+
+void tgenschedule_ref(TGenSchedule* schedule) {
+    TGEN_ASSERT(schedule);
+    g_atomic_int_inc(&schedule->refcount);
+}
+
+void tgenschedule_unref(TGenSchedule* schedule) {
+    TGEN_ASSERT(schedule);
+    /* transfers in different workers may share the schedule of an action */
+    if(g_atomic_int_dec_and_test(&schedule->refcount)) {
+        _tgenschedule_free(schedule);
+    }
+}
+
+void tgenschedule_append(TGenSchedule* schedule, gint32 delay) {
+    TGEN_ASSERT(schedule);
+
+    guint position = schedule->frontOffset + schedule->length;
+    if(position / TGEN_SCHEDULE_WINDOW_DELAYS >= schedule->windows->len) {
+        g_ptr_array_add(schedule->windows, g_new(gint32, TGEN_SCHEDULE_WINDOW_DELAYS));
+    }
+
+    gint32* window = g_ptr_array_index(schedule->windows, position / TGEN_SCHEDULE_WINDOW_DELAYS);
+    window[position % TGEN_SCHEDULE_WINDOW_DELAYS] = delay;
+
+    schedule->length++;
+    schedule->totalBytes += TGEN_MMODEL_PACKET_DATA_SIZE;
+}
+
+void tgenschedule_removeFront(TGenSchedule* schedule, guint numDelays) {
+    TGEN_ASSERT(schedule);
+    numDelays = MIN(numDelays, schedule->length);
+    if(numDelays == 0) {
+        return;
+    }
+
+    schedule->length -= numDelays;
+    schedule->totalBytes -= (gsize)numDelays * TGEN_MMODEL_PACKET_DATA_SIZE;
+
+    if(schedule->length == 0) {
+        g_ptr_array_set_size(schedule->windows, 0);
+        schedule->frontOffset = 0;
+        return;
+    }
+
+    /* free the windows we used up, but keep the one we are in */
+    schedule->frontOffset += numDelays;
+    guint numWindows = schedule->frontOffset / TGEN_SCHEDULE_WINDOW_DELAYS;
+    if(numWindows > 0) {
+        g_ptr_array_remove_range(schedule->windows, 0, numWindows);
+        schedule->frontOffset %= TGEN_SCHEDULE_WINDOW_DELAYS;
+    }
+}
+
+gboolean tgenschedule_isShared(TGenSchedule* schedule) {
+    TGEN_ASSERT(schedule);
+    return g_atomic_int_get(&schedule->refcount) > 1 ? TRUE : FALSE;
+}
+
+guint tgenschedule_getLength(TGenSchedule* schedule) {
+    TGEN_ASSERT(schedule);
+    return schedule->length;
+}
+
+gint32 tgenschedule_getDelay(TGenSchedule* schedule, guint index) {
+    TGEN_ASSERT(schedule);
+    g_assert(index < schedule->length);
+    guint position = schedule->frontOffset + index;
+    gint32* window = g_ptr_array_index(schedule->windows, position / TGEN_SCHEDULE_WINDOW_DELAYS);
+    return window[position % TGEN_SCHEDULE_WINDOW_DELAYS];
+}
+
+gsize tgenschedule_getTotalBytes(TGenSchedule* schedule) {
+    TGEN_ASSERT(schedule);
+    return schedule->totalBytes;
+}
+
+gchar* tgenschedule_toString(TGenSchedule* schedule) {
+    TGEN_ASSERT(schedule);
+
+    /* a delay takes at most 11 characters and the comma */
+    GString* buffer = g_string_sized_new((gsize)schedule->length * 12 + 1);
+    for(guint i = 0; i < schedule->length; i++) {
+        g_string_append_printf(buffer, "%s%"G_GINT32_FORMAT, i > 0 ? "," : "",
+                tgenschedule_getDelay(schedule, i));
+    }
+
+    return g_string_free(buffer, FALSE);
+}
@@ -0,0 +1,36 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_SCHEDULE_H_
+#define TGEN_SCHEDULE_H_
+
+#include <glib.h>
+
+/* the delays in microseconds between the packets of a schedule transfer, and
+ * the payload bytes they add up to. once it is built, a shared schedule does not
+ * change, so transfers in any worker can share it. the delays are kept in
+ * windows, so whoever holds the only reference can free the delays it used. */
+typedef struct _TGenSchedule TGenSchedule;
+
+TGenSchedule* tgenschedule_new();
+/* parses the comma-separated delays of a config or a legacy text command */
+TGenSchedule* tgenschedule_newFromString(const gchar* scheduleStr);
+void tgenschedule_ref(TGenSchedule* schedule);
+void tgenschedule_unref(TGenSchedule* schedule);
+
+/* only for the one who builds the schedule, before it shares it */
+void tgenschedule_append(TGenSchedule* schedule, gint32 delay);
+/* only for the one who holds the only reference */
+void tgenschedule_removeFront(TGenSchedule* schedule, guint numDelays);
+/* returns TRUE if anyone besides the caller holds a reference */
+gboolean tgenschedule_isShared(TGenSchedule* schedule);
+
+guint tgenschedule_getLength(TGenSchedule* schedule);
+gint32 tgenschedule_getDelay(TGenSchedule* schedule, guint index);
+gsize tgenschedule_getTotalBytes(TGenSchedule* schedule);
+
+/* the comma-separated delays, for the legacy text command. free with g_free. */
+gchar* tgenschedule_toString(TGenSchedule* schedule);
+
+#endif /* TGEN_SCHEDULE_H_ */
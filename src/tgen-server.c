@@ -11,6 +11,8 @@ struct _TGenServer {
     GDestroyNotify destructData;
 
     gint socketD;
+    /* accepts go through the io module, which owns us and so outlives us */
+    TGenIO* io;
 
     gint refcount;
     guint magic;
@@ -26,7 +28,9 @@ static gint _tgenserver_acceptPeer(TGenServer* server) {
 
     gint64 started = g_get_monotonic_time();
 
-    gint peerSocketD = accept(server->socketD, (struct sockaddr*)&peerAddress, &addressLength);
+    gint peerSocketD = server->io ?
+            tgenio_accept(server->io, server->socketD, (struct sockaddr*)&peerAddress, &addressLength) :
+            accept(server->socketD, (struct sockaddr*)&peerAddress, &addressLength);
 
     if(peerSocketD >= 0) {
         gint64 created = g_get_monotonic_time();
@@ -76,7 +80,7 @@ TGenEvent tgenserver_onEvent(TGenServer* server, gint descriptor, TGenEvent even
     return TGEN_EVENT_READ;
 }
 
-TGenServer* tgenserver_new(in_port_t serverPort, TGenServer_notifyNewPeerFunc notify,
+TGenServer* tgenserver_new(in_port_t serverPort, TGenIO* io, TGenServer_notifyNewPeerFunc notify,
         gpointer data, GDestroyNotify destructData) {
     /* we run our protocol over a single server socket/port */
     gint socketD = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
@@ -150,6 +154,7 @@ TGenServer* tgenserver_new(in_port_t serverPort, TGenServer_notifyNewPeerFunc no
     server->destructData = destructData;
 
     server->socketD = socketD;
+    server->io = io;
 
     return server;
 }
@@ -12,7 +12,7 @@ typedef struct _TGenServer TGenServer;
 
 typedef void (*TGenServer_notifyNewPeerFunc)(gpointer data, gint socketD, gint64 started, gint64 created, TGenPeer* peer);
 
-TGenServer* tgenserver_new(in_port_t serverPort, TGenServer_notifyNewPeerFunc notify,
+TGenServer* tgenserver_new(in_port_t serverPort, TGenIO* io, TGenServer_notifyNewPeerFunc notify,
         gpointer data, GDestroyNotify destructData);
 void tgenserver_ref(TGenServer* server);
 void tgenserver_unref(TGenServer* server);
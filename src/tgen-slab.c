@@ -0,0 +1,171 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#include "tgen.h"
+
+/* we carve objects out of chunks of about this many bytes */
+#define TGEN_SLAB_CHUNK_BYTES 65536
+/* objects are aligned like malloc would align them */
+#define TGEN_SLAB_ALIGNMENT 16
+
+/* a thread moves free objects to and from the shared depot this many at a time */
+#define TGEN_SLAB_BATCH_OBJECTS 64
+
+/* freed objects link to the next free object through their first bytes. the
+ * first object of a batch in the depot also links to the next batch. */
+typedef struct _TGenSlabFreeObject TGenSlabFreeObject;
+struct _TGenSlabFreeObject {
+    TGenSlabFreeObject* next;
+    TGenSlabFreeObject* nextBatch;
+};
+
+/* each thread allocates from and frees to its own cache, without a lock. objects
+ * may be freed on another thread than the one that allocated them, and then
+ * simply join the free list of the freeing thread. a thread that holds too many
+ * free objects moves a batch to the shared depot, and a thread that runs out
+ * takes a batch from there before it carves a new chunk. */
+typedef struct _TGenSlabCache {
+    TGenSlabFreeObject* freeObjects;
+    gsize numFree;
+    /* the part of the newest chunk of this thread that we did not hand out yet */
+    gchar* chunkPosition;
+    gchar* chunkEnd;
+} TGenSlabCache;
+
+/* one slab per object type for the whole process. the lock only guards the depot.
+ * chunks are never returned to the system, we only reuse their objects. */
+typedef struct _TGenSlab {
+    GMutex lock;
+    gsize objectSize;
+    TGenSlabFreeObject* depotBatches;
+    gsize numLive;
+} TGenSlab;
+
+static TGenSlab slabs[TGEN_SLAB_NUM_TYPES];
+/* the free objects a thread still holds when it exits are lost, but our
+ * workers run until the process exits */
+static __thread TGenSlabCache slabCaches[TGEN_SLAB_NUM_TYPES];
+
+/* all slabs, so the heartbeat does not need to take the locks */
+static gsize slabLiveBytes = 0;
+static gsize slabReservedBytes = 0;
+
+static void _tgenslab_addChunk(TGenSlabCache* cache, gsize objectSize) {
+    gsize numObjects = MAX(TGEN_SLAB_CHUNK_BYTES / objectSize, 1);
+    gsize chunkBytes = numObjects * objectSize;
+
+    cache->chunkPosition = g_malloc(chunkBytes);
+    cache->chunkEnd = cache->chunkPosition + chunkBytes;
+
+    __atomic_add_fetch(&slabReservedBytes, chunkBytes, __ATOMIC_RELAXED);
+}
+
+static void _tgenslab_takeBatch(TGenSlab* slab, TGenSlabCache* cache) {
+    g_mutex_lock(&slab->lock);
+    TGenSlabFreeObject* batch = slab->depotBatches;
+    if(batch) {
+        slab->depotBatches = batch->nextBatch;
+    }
+    g_mutex_unlock(&slab->lock);
+
+    if(batch) {
+        cache->freeObjects = batch;
+        cache->numFree = TGEN_SLAB_BATCH_OBJECTS;
+    }
+}
+
+static void _tgenslab_giveBatch(TGenSlab* slab, TGenSlabCache* cache) {
+    TGenSlabFreeObject* batch = cache->freeObjects;
+    TGenSlabFreeObject* last = batch;
+    for(gsize i = 1; i < TGEN_SLAB_BATCH_OBJECTS; i++) {
+        last = last->next;
+    }
+    cache->freeObjects = last->next;
+    cache->numFree -= TGEN_SLAB_BATCH_OBJECTS;
+    last->next = NULL;
+
+    g_mutex_lock(&slab->lock);
+    batch->nextBatch = slab->depotBatches;
+    slab->depotBatches = batch;
+    g_mutex_unlock(&slab->lock);
+}
+
+/* returns a zeroed object of the given type. all objects of a type have the same size. */
+gpointer tgenslab_alloc0(TGenSlabType type, gsize objectSize) {
+    g_assert(type < TGEN_SLAB_NUM_TYPES);
+    TGenSlab* slab = &slabs[type];
+    TGenSlabCache* cache = &slabCaches[type];
+
+    gsize alignedSize = MAX(objectSize, sizeof(TGenSlabFreeObject));
+    alignedSize = (alignedSize + TGEN_SLAB_ALIGNMENT - 1) & ~((gsize)TGEN_SLAB_ALIGNMENT - 1);
+
+    gsize expectedSize = 0;
+    if(!__atomic_compare_exchange_n(&slab->objectSize, &expectedSize, alignedSize,
+            FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        g_assert(expectedSize == alignedSize);
+    }
+
+    if(!cache->freeObjects) {
+        _tgenslab_takeBatch(slab, cache);
+    }
+
+    gpointer object = NULL;
+    if(cache->freeObjects) {
+        object = cache->freeObjects;
+        cache->freeObjects = cache->freeObjects->next;
+        cache->numFree--;
+    } else {
+        if(cache->chunkPosition >= cache->chunkEnd) {
+            _tgenslab_addChunk(cache, alignedSize);
+        }
+        object = cache->chunkPosition;
+        cache->chunkPosition += alignedSize;
+    }
+
+    __atomic_add_fetch(&slab->numLive, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&slabLiveBytes, alignedSize, __ATOMIC_RELAXED);
+
+    memset(object, 0, alignedSize);
+    return object;
+}
+
+void tgenslab_free(TGenSlabType type, gpointer object) {
+    g_assert(type < TGEN_SLAB_NUM_TYPES);
+    if(!object) {
+        return;
+    }
+
+    TGenSlab* slab = &slabs[type];
+    TGenSlabCache* cache = &slabCaches[type];
+    TGenSlabFreeObject* freeObject = object;
+
+    freeObject->next = cache->freeObjects;
+    cache->freeObjects = freeObject;
+    cache->numFree++;
+
+    /* keep one batch for the next allocations, so we do not bounce on the edge */
+    if(cache->numFree >= 2 * TGEN_SLAB_BATCH_OBJECTS) {
+        _tgenslab_giveBatch(slab, cache);
+    }
+
+    gsize objectSize = __atomic_load_n(&slab->objectSize, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&slab->numLive, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&slabLiveBytes, objectSize, __ATOMIC_RELAXED);
+}
+
+/* the number of objects of the type that were allocated but not freed */
+gsize tgenslab_getNumLive(TGenSlabType type) {
+    g_assert(type < TGEN_SLAB_NUM_TYPES);
+    return __atomic_load_n(&slabs[type].numLive, __ATOMIC_RELAXED);
+}
+
+/* the bytes of all objects that are in use */
+gsize tgenslab_getLiveBytes() {
+    return __atomic_load_n(&slabLiveBytes, __ATOMIC_RELAXED);
+}
+
+/* the bytes we got from the system for the slabs, including free objects */
+gsize tgenslab_getReservedBytes() {
+    return __atomic_load_n(&slabReservedBytes, __ATOMIC_RELAXED);
+}
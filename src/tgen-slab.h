@@ -0,0 +1,27 @@
+/*
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_SLAB_H_
+#define TGEN_SLAB_H_
+
+#include <glib.h>
+
+/* the object types we keep one per connection, and allocate from slabs */
+typedef enum _TGenSlabType {
+    TGEN_SLAB_TRANSFER,
+    TGEN_SLAB_TRANSFER_GETPUT,
+    TGEN_SLAB_TRANSFER_SCHEDULE,
+    TGEN_SLAB_TRANSPORT,
+    TGEN_SLAB_PEER,
+    TGEN_SLAB_NUM_TYPES,
+} TGenSlabType;
+
+gpointer tgenslab_alloc0(TGenSlabType type, gsize objectSize);
+void tgenslab_free(TGenSlabType type, gpointer object);
+
+gsize tgenslab_getNumLive(TGenSlabType type);
+gsize tgenslab_getLiveBytes();
+gsize tgenslab_getReservedBytes();
+
+#endif /* TGEN_SLAB_H_ */
@@ -8,6 +8,16 @@
 
 #include "tgen.h"
 
+/* all timers are driven by a hierarchical timing wheel that is multiplexed
+ * on a single timerfd. the lowest level of the wheel has one slot per tick,
+ * and each higher level has one slot per full rotation of the level below it.
+ * timers are never fired early, but may fire up to one tick late. */
+#define TGEN_TIMERWHEEL_TICK_MICROS 250
+#define TGEN_TIMERWHEEL_LEVELS 4
+#define TGEN_TIMERWHEEL_SLOT_BITS 8
+#define TGEN_TIMERWHEEL_SLOTS (1 << TGEN_TIMERWHEEL_SLOT_BITS)
+#define TGEN_TIMERWHEEL_SLOT_MASK (TGEN_TIMERWHEEL_SLOTS - 1)
+
 struct _TGenTimer {
     TGenTimer_notifyExpiredFunc notify;
     gpointer data1;
@@ -15,108 +25,437 @@ struct _TGenTimer {
     GDestroyNotify destructData1;
     GDestroyNotify destructData2;
 
-    gint timerD;
+    /* the initial delay, or the period if we are persistent */
+    guint64 intervalMicros;
     gboolean isPersistent;
 
+    /* non-NULL while the wheel holds a reference to us */
+    TGenTimerWheel* wheel;
+    /* the wheel list we are linked into, NULL if we are not linked */
+    TGenTimer** list;
+    gint level;
+    TGenTimer* prev;
+    TGenTimer* next;
+
+    gint64 deadlineMicros;
+    guint64 expireTick;
+
     gint refcount;
     guint magic;
 };
 
-static void _tgentimer_disarm(TGenTimer* timer) {
-    TGEN_ASSERT(timer);
+struct _TGenTimerWheel {
+    gint timerD;
 
-    if(timer->timerD > 0) {
-        struct itimerspec disarm;
+    /* monotonic time of tick 0 */
+    gint64 epochMicros;
+    /* every tick up to and including this one has been processed */
+    guint64 currentTick;
+    /* absolute monotonic time the timerD is armed for, 0 if disarmed */
+    gint64 armedMicros;
+    /* if FALSE, the caller waits until armedMicros and then calls
+     * tgentimerwheel_expire, and the timerD stays disarmed */
+    gboolean useDescriptor;
+    gboolean isExpiring;
+
+    TGenTimer* slots[TGEN_TIMERWHEEL_LEVELS][TGEN_TIMERWHEEL_SLOTS];
+    guint levelCounts[TGEN_TIMERWHEEL_LEVELS];
+    /* timers that should fire as soon as possible */
+    TGenTimer* due;
+    /* timers that are registered but were canceled */
+    TGenTimer* idle;
+    guint numTimers;
+
+    /* lateness statistics since the last collection */
+    guint64 numExpired;
+    guint64 totalLatenessMicros;
+    guint64 maxLatenessMicros;
 
-        disarm.it_value.tv_sec = 0;
-        disarm.it_value.tv_nsec = 0;
-        disarm.it_interval.tv_sec = 0;
-        disarm.it_interval.tv_nsec = 0;
+    guint magic;
+};
 
-        timerfd_settime(timer->timerD, 0, &disarm, NULL);
+static void _tgentimer_link(TGenTimer* timer, TGenTimer** list, gint level) {
+    g_assert(!timer->list);
+    timer->list = list;
+    timer->level = level;
+    timer->prev = NULL;
+    timer->next = *list;
+    if(*list) {
+        (*list)->prev = timer;
     }
+    *list = timer;
 }
 
-/* disarms the timer so that its notification function is not called.
- * note that the data passed on tgentimer_new is *not* freed by this
- * function (use tgentimer_unref to free any data). */
-void tgentimer_cancel(TGenTimer *timer) {
-    TGEN_ASSERT(timer);
-    _tgentimer_disarm(timer);
+static void _tgentimer_unlink(TGenTimer* timer) {
+    if(!timer->list) {
+        return;
+    }
+
+    if(timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        *(timer->list) = timer->next;
+    }
+    if(timer->next) {
+        timer->next->prev = timer->prev;
+    }
+
+    if(timer->wheel && timer->level >= 0) {
+        timer->wheel->levelCounts[timer->level]--;
+    }
+
+    timer->list = NULL;
+    timer->prev = NULL;
+    timer->next = NULL;
 }
 
-/** Sets the timer to go off in the given number of microseconds. If the timer
- * is persistent, then configure it to continue going off at the new interval.
- */
-void
-tgentimer_settime_micros(TGenTimer *timer, guint64 micros)
-{
-    TGEN_ASSERT(timer);
+static guint64 _tgentimerwheel_getTickCeil(TGenTimerWheel* wheel, gint64 micros) {
+    guint64 offset = (guint64)MAX(micros - wheel->epochMicros, 0);
+    return (offset + TGEN_TIMERWHEEL_TICK_MICROS - 1) / TGEN_TIMERWHEEL_TICK_MICROS;
+}
+
+static guint64 _tgentimerwheel_getTickFloor(TGenTimerWheel* wheel, gint64 micros) {
+    guint64 offset = (guint64)MAX(micros - wheel->epochMicros, 0);
+    return offset / TGEN_TIMERWHEEL_TICK_MICROS;
+}
+
+static void _tgentimerwheel_setTimerD(TGenTimerWheel* wheel, gint64 micros) {
+    if(!wheel->useDescriptor) {
+        wheel->armedMicros = micros;
+        return;
+    }
+
     struct itimerspec arm;
-    guint64 seconds = micros / 1000000;
-    guint64 nanoseconds = (micros % 1000000) * 1000;
-
-    arm.it_value.tv_sec = seconds;
-    arm.it_value.tv_nsec = nanoseconds;
-    if (timer->isPersistent) {
-        arm.it_interval.tv_sec = seconds;
-        arm.it_interval.tv_nsec = nanoseconds;
-    } else {
-        arm.it_interval.tv_sec = 0;
-        arm.it_interval.tv_nsec = 0;
+    memset(&arm, 0, sizeof(struct itimerspec));
+
+    /* a zero value disarms the timerD */
+    if(micros > 0) {
+        arm.it_value.tv_sec = micros / 1000000;
+        arm.it_value.tv_nsec = (micros % 1000000) * 1000;
     }
-    gint result = timerfd_settime(timer->timerD, 0, &arm, NULL);
+
+    gint result = timerfd_settime(wheel->timerD, TFD_TIMER_ABSTIME, &arm, NULL);
     if (result < 0) {
         tgen_critical("timerfd_settime(): returned %i error %i: %s", result,
                 errno, g_strerror(errno));
         return;
     }
+
+    wheel->armedMicros = micros;
 }
 
-TGenEvent tgentimer_onEvent(TGenTimer* timer, gint descriptor, TGenEvent events) {
-    TGEN_ASSERT(timer);
+/* place the timer in the slot matching its expire tick */
+static void _tgentimerwheel_place(TGenTimerWheel* wheel, TGenTimer* timer) {
+    guint64 tick = timer->expireTick;
+
+    if(tick <= wheel->currentTick) {
+        _tgentimer_link(timer, &wheel->due, -1);
+        return;
+    }
+
+    guint64 delta = tick - wheel->currentTick;
+
+    for(gint level = 0; level < TGEN_TIMERWHEEL_LEVELS; level++) {
+        guint shift = (guint)(TGEN_TIMERWHEEL_SLOT_BITS * level);
+        guint64 range = ((guint64)1) << (shift + TGEN_TIMERWHEEL_SLOT_BITS);
+
+        if(delta < range || level == TGEN_TIMERWHEEL_LEVELS - 1) {
+            if(delta >= range) {
+                /* too far out, park it at the end of the wheel and it will
+                 * be placed again when that slot cascades */
+                tick = wheel->currentTick + range - 1;
+            }
+
+            guint idx = (guint)((tick >> shift) & TGEN_TIMERWHEEL_SLOT_MASK);
+            _tgentimer_link(timer, &wheel->slots[level][idx], level);
+            wheel->levelCounts[level]++;
+            return;
+        }
+    }
+}
+
+/* returns the next tick at which something in the wheel needs attention */
+static guint64 _tgentimerwheel_getNextTick(TGenTimerWheel* wheel) {
+    guint64 next = G_MAXUINT64;
+
+    if(wheel->levelCounts[0] > 0) {
+        for(guint64 j = 1; j < TGEN_TIMERWHEEL_SLOTS; j++) {
+            guint64 tick = wheel->currentTick + j;
+            if(wheel->slots[0][tick & TGEN_TIMERWHEEL_SLOT_MASK]) {
+                next = tick;
+                break;
+            }
+        }
+    }
+
+    /* higher levels need attention when their slots cascade */
+    for(gint level = 1; level < TGEN_TIMERWHEEL_LEVELS; level++) {
+        if(wheel->levelCounts[level] == 0) {
+            continue;
+        }
+
+        guint shift = (guint)(TGEN_TIMERWHEEL_SLOT_BITS * level);
+        guint64 block = wheel->currentTick >> shift;
+
+        for(guint64 j = 1; j <= TGEN_TIMERWHEEL_SLOTS; j++) {
+            if(wheel->slots[level][(block + j) & TGEN_TIMERWHEEL_SLOT_MASK]) {
+                next = MIN(next, (block + j) << shift);
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+/* make sure the timerD will wake us up no later than the given time */
+static void _tgentimerwheel_armBefore(TGenTimerWheel* wheel, gint64 micros) {
+    if(wheel->armedMicros == 0 || micros < wheel->armedMicros) {
+        _tgentimerwheel_setTimerD(wheel, micros);
+    }
+}
+
+static void _tgentimerwheel_rearm(TGenTimerWheel* wheel, gint64 now) {
+    gint64 nextMicros = 0;
+
+    if(wheel->due) {
+        nextMicros = now;
+    } else {
+        guint64 nextTick = _tgentimerwheel_getNextTick(wheel);
+        if(nextTick != G_MAXUINT64) {
+            nextMicros = wheel->epochMicros + (gint64)(nextTick * TGEN_TIMERWHEEL_TICK_MICROS);
+        }
+    }
+
+    if(nextMicros != wheel->armedMicros) {
+        _tgentimerwheel_setTimerD(wheel, nextMicros);
+    }
+}
+
+static void _tgentimerwheel_arm(TGenTimerWheel* wheel, TGenTimer* timer, gint64 deadline, gint64 now) {
+    _tgentimer_unlink(timer);
+
+    timer->deadlineMicros = deadline;
+
+    if(deadline <= now && !wheel->isExpiring) {
+        timer->expireTick = wheel->currentTick;
+    } else {
+        timer->expireTick = _tgentimerwheel_getTickCeil(wheel, deadline);
+        if(wheel->isExpiring && timer->expireTick <= wheel->currentTick) {
+            /* don't let callbacks starve the loop by re-arming into the current tick */
+            timer->expireTick = wheel->currentTick + 1;
+        }
+    }
+
+    _tgentimerwheel_place(wheel, timer);
+
+    /* after expiring, the wheel re-arms the timerD on its own. otherwise waking
+     * up at the expire tick is enough, since that processes all earlier cascades. */
+    if(!wheel->isExpiring) {
+        if(timer->list == &wheel->due) {
+            _tgentimerwheel_armBefore(wheel, now);
+        } else {
+            _tgentimerwheel_armBefore(wheel,
+                    wheel->epochMicros + (gint64)(timer->expireTick * TGEN_TIMERWHEEL_TICK_MICROS));
+        }
+    }
+}
+
+static void _tgentimerwheel_detach(TGenTimerWheel* wheel, TGenTimer* timer) {
+    g_assert(timer->wheel == wheel);
+    _tgentimer_unlink(timer);
+    timer->wheel = NULL;
+    wheel->numTimers--;
+    /* drop the reference that was transferred to the wheel in tgentimerwheel_add */
+    tgentimer_unref(timer);
+}
+
+static void _tgentimerwheel_fire(TGenTimerWheel* wheel, TGenTimer* timer, gint64 now) {
+    /* the callback may drop the last outside reference to the timer */
+    tgentimer_ref(timer);
+
+    guint64 lateness = (guint64)MAX(now - timer->deadlineMicros, 0);
+    wheel->numExpired++;
+    wheel->totalLatenessMicros += lateness;
+    wheel->maxLatenessMicros = MAX(wheel->maxLatenessMicros, lateness);
+
+    /* call the registered notification function */
+    gboolean shouldCancel = timer->notify(timer->data1, timer->data2);
+
+    /* the callback may have already deregistered the timer */
+    if(timer->wheel == wheel) {
+        if(shouldCancel || !timer->isPersistent) {
+            _tgentimerwheel_detach(wheel, timer);
+        } else if(!timer->list) {
+            /* persistent timers repeat relative to the previous deadline so they don't drift */
+            gint64 deadline = timer->deadlineMicros + (gint64)timer->intervalMicros;
+            _tgentimerwheel_arm(wheel, timer, MAX(deadline, now), now);
+        }
+    }
+
+    tgentimer_unref(timer);
+}
+
+static void _tgentimerwheel_fireList(TGenTimerWheel* wheel, TGenTimer** list, gint64 now) {
+    TGenTimer* timer = NULL;
+    while((timer = *list) != NULL) {
+        _tgentimer_unlink(timer);
+        _tgentimerwheel_fire(wheel, timer, now);
+    }
+}
+
+static void _tgentimerwheel_cascade(TGenTimerWheel* wheel, gint level, guint idx) {
+    TGenTimer* timer = NULL;
+    while((timer = wheel->slots[level][idx]) != NULL) {
+        _tgentimer_unlink(timer);
+        _tgentimerwheel_place(wheel, timer);
+    }
+}
+
+static void _tgentimerwheel_advance(TGenTimerWheel* wheel, guint64 nowTick, gint64 now) {
+    while(wheel->currentTick < nowTick) {
+        if(wheel->levelCounts[0] == 0) {
+            /* nothing can fire until the lowest level rotates, so skip ahead */
+            guint64 rotationEnd = wheel->currentTick | TGEN_TIMERWHEEL_SLOT_MASK;
+            if(rotationEnd >= nowTick) {
+                wheel->currentTick = nowTick;
+                break;
+            }
+            wheel->currentTick = rotationEnd;
+        }
+
+        wheel->currentTick++;
+
+        /* when a level completes a rotation, move the next slot of the level above down */
+        for(gint level = 1; level < TGEN_TIMERWHEEL_LEVELS; level++) {
+            guint lowerShift = (guint)(TGEN_TIMERWHEEL_SLOT_BITS * (level - 1));
+            if(((wheel->currentTick >> lowerShift) & TGEN_TIMERWHEEL_SLOT_MASK) != 0) {
+                break;
+            }
+            guint shift = (guint)(TGEN_TIMERWHEEL_SLOT_BITS * level);
+            _tgentimerwheel_cascade(wheel, level,
+                    (guint)((wheel->currentTick >> shift) & TGEN_TIMERWHEEL_SLOT_MASK));
+        }
+
+        _tgentimerwheel_fireList(wheel, &wheel->due, now);
+        _tgentimerwheel_fireList(wheel,
+                &wheel->slots[0][wheel->currentTick & TGEN_TIMERWHEEL_SLOT_MASK], now);
+    }
+}
 
-    /* our timerD is readable, so our timer has expired */
-    g_assert((events & TGEN_EVENT_READ) && descriptor == timer->timerD);
+void tgentimerwheel_onExpired(TGenTimerWheel* wheel) {
+    TGEN_ASSERT(wheel);
 
     /* clear the event from the descriptor */
     guint64 numExpirations = 0;
-    gssize result = read(timer->timerD, &numExpirations, sizeof(guint64));
+    gssize result = read(wheel->timerD, &numExpirations, sizeof(guint64));
 
     if(result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-    	/* the timer actually wasn't ready to read yet */
-    	tgen_info("We thought timer fd %i was ready, but it returned EAGAIN", timer->timerD);
-    	/* keep waiting for read */
-    	return TGEN_EVENT_READ;
+        /* the timer actually wasn't ready to read yet */
+        tgen_info("We thought timer wheel fd %i was ready, but it returned EAGAIN", wheel->timerD);
+        return;
     }
 
-    /* call the registered notification function */
-    gboolean shouldCancel = TRUE;
-    if(timer->notify) {
-        shouldCancel = timer->notify(timer->data1, timer->data2);
+    tgentimerwheel_expire(wheel);
+}
+
+/* fire all timers whose deadlines passed, and arm for the next one */
+void tgentimerwheel_expire(TGenTimerWheel* wheel) {
+    TGEN_ASSERT(wheel);
+
+    /* the timerD is not periodic, so it is disarmed now */
+    wheel->armedMicros = 0;
+
+    gint64 now = g_get_monotonic_time();
+
+    wheel->isExpiring = TRUE;
+    _tgentimerwheel_fireList(wheel, &wheel->due, now);
+    _tgentimerwheel_advance(wheel, _tgentimerwheel_getTickFloor(wheel, now), now);
+    wheel->isExpiring = FALSE;
+
+    _tgentimerwheel_rearm(wheel, now);
+}
+
+/* the wheel takes ownership of the caller's timer reference and arms the timer */
+void tgentimerwheel_add(TGenTimerWheel* wheel, TGenTimer* timer) {
+    TGEN_ASSERT(wheel);
+    TGEN_ASSERT(timer);
+
+    if(timer->wheel) {
+        tgen_warning("timer is already registered with a timer wheel");
+        return;
     }
 
-    if(shouldCancel || !timer->isPersistent) {
-        /* it already expired once, so its only armed if persistent */
-        if(timer->isPersistent) {
-            _tgentimer_disarm(timer);
-        }
-        return TGEN_EVENT_DONE;
-    } else {
-        /* we will only ever read timer expirations and never write */
-        return TGEN_EVENT_READ;
+    timer->wheel = wheel;
+    wheel->numTimers++;
+
+    gint64 now = g_get_monotonic_time();
+    _tgentimerwheel_arm(wheel, timer, now + (gint64)timer->intervalMicros, now);
+}
+
+/* disarms the timer and drops the wheel's reference to it */
+void tgentimerwheel_remove(TGenTimerWheel* wheel, TGenTimer* timer) {
+    TGEN_ASSERT(wheel);
+    TGEN_ASSERT(timer);
+
+    if(timer->wheel == wheel) {
+        _tgentimerwheel_detach(wheel, timer);
     }
 }
 
-TGenTimer* tgentimer_new(guint64 microseconds, gboolean isPersistent,
-        TGenTimer_notifyExpiredFunc notify, gpointer data1, gpointer data2,
-        GDestroyNotify destructData1, GDestroyNotify destructData2) {
-    /* if they dont want to be notified of timer expirations, there is no point */
-    if(!notify) {
-        return NULL;
+/* stop arming the timerD. the caller is then responsible for calling
+ * tgentimerwheel_expire once the next expire time passes. */
+void tgentimerwheel_disableDescriptor(TGenTimerWheel* wheel) {
+    TGEN_ASSERT(wheel);
+
+    if(wheel->useDescriptor) {
+        gint64 nextMicros = wheel->armedMicros;
+        _tgentimerwheel_setTimerD(wheel, 0);
+        wheel->useDescriptor = FALSE;
+        wheel->armedMicros = nextMicros;
     }
+}
+
+/* returns the absolute monotonic time at which the wheel next needs to
+ * expire timers, or 0 if no timers are armed */
+gint64 tgentimerwheel_getNextExpireMicros(TGenTimerWheel* wheel) {
+    TGEN_ASSERT(wheel);
+    return wheel->armedMicros;
+}
 
-    /* create the timer descriptor */
+gint tgentimerwheel_getDescriptor(TGenTimerWheel* wheel) {
+    TGEN_ASSERT(wheel);
+    return wheel->timerD;
+}
+
+guint tgentimerwheel_getNumTimers(TGenTimerWheel* wheel) {
+    TGEN_ASSERT(wheel);
+    return wheel->numTimers;
+}
+
+/* returns the lateness of timer expirations since the last call, and resets the counters */
+void tgentimerwheel_collectLateness(TGenTimerWheel* wheel, guint64* numExpired,
+        guint64* meanLatenessMicros, guint64* maxLatenessMicros) {
+    TGEN_ASSERT(wheel);
+
+    if(numExpired) {
+        *numExpired = wheel->numExpired;
+    }
+    if(meanLatenessMicros) {
+        *meanLatenessMicros = wheel->numExpired > 0 ?
+                wheel->totalLatenessMicros / wheel->numExpired : 0;
+    }
+    if(maxLatenessMicros) {
+        *maxLatenessMicros = wheel->maxLatenessMicros;
+    }
+
+    wheel->numExpired = 0;
+    wheel->totalLatenessMicros = 0;
+    wheel->maxLatenessMicros = 0;
+}
+
+TGenTimerWheel* tgentimerwheel_new() {
+    /* create the one descriptor that drives all of our timers */
     int timerD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
 
     if (timerD < 0) {
@@ -124,41 +463,83 @@ TGenTimer* tgentimer_new(guint64 microseconds, gboolean isPersistent,
         return NULL;
     }
 
-    /* create the timer info */
-    struct itimerspec arm;
+    TGenTimerWheel* wheel = g_new0(TGenTimerWheel, 1);
+    wheel->magic = TGEN_MAGIC;
 
-    guint64 seconds = microseconds / 1000000;
-    guint64 nanoseconds = (microseconds % 1000000) * 1000;
+    wheel->timerD = timerD;
+    wheel->useDescriptor = TRUE;
+    wheel->epochMicros = g_get_monotonic_time();
 
-    /* a timer with 0 delay will cause timerfd to disarm, so we use a 1 nano
-     * delay instead, in order to execute the event as close to now as possible */
-    if(seconds == 0 && nanoseconds == 0) {
-        nanoseconds = 1;
+    return wheel;
+}
+
+static void _tgentimerwheel_freeList(TGenTimerWheel* wheel, TGenTimer** list) {
+    TGenTimer* timer = NULL;
+    while((timer = *list) != NULL) {
+        _tgentimerwheel_detach(wheel, timer);
     }
+}
 
-    /* set the initial expiration */
-    arm.it_value.tv_sec = seconds;
-    arm.it_value.tv_nsec = nanoseconds;
+void tgentimerwheel_free(TGenTimerWheel* wheel) {
+    TGEN_ASSERT(wheel);
 
-    if(isPersistent) {
-        /* timer continuously repeats */
-        arm.it_interval.tv_sec = seconds;
-        arm.it_interval.tv_nsec = nanoseconds;
-    } else {
-        /* timer never repeats */
-        arm.it_interval.tv_sec = 0;
-        arm.it_interval.tv_nsec = 0;
+    for(gint level = 0; level < TGEN_TIMERWHEEL_LEVELS; level++) {
+        for(gint idx = 0; idx < TGEN_TIMERWHEEL_SLOTS; idx++) {
+            _tgentimerwheel_freeList(wheel, &wheel->slots[level][idx]);
+        }
+    }
+    _tgentimerwheel_freeList(wheel, &wheel->due);
+    _tgentimerwheel_freeList(wheel, &wheel->idle);
+
+    if(wheel->timerD > 0) {
+        close(wheel->timerD);
     }
 
-    /* arm the timer, flags=0 -> relative time, NULL -> ignore previous setting */
-    gint result = timerfd_settime(timerD, 0, &arm, NULL);
+    wheel->magic = 0;
+    g_free(wheel);
+}
 
-    if (result < 0) {
-        tgen_critical("timerfd_settime(): returned %i error %i: %s", result, errno, g_strerror(errno));
+/* disarms the timer so that its notification function is not called.
+ * note that the data passed on tgentimer_new is *not* freed by this
+ * function (use tgentimer_unref to free any data). */
+void tgentimer_cancel(TGenTimer *timer) {
+    TGEN_ASSERT(timer);
+
+    _tgentimer_unlink(timer);
+
+    /* we stay registered so that we can be armed again later */
+    if(timer->wheel) {
+        _tgentimer_link(timer, &timer->wheel->idle, -1);
+    }
+}
+
+/** Sets the timer to go off in the given number of microseconds. If the timer
+ * is persistent, then configure it to continue going off at the new interval.
+ */
+void
+tgentimer_settime_micros(TGenTimer *timer, guint64 micros)
+{
+    TGEN_ASSERT(timer);
+
+    timer->intervalMicros = micros;
+
+    /* unregistered timers are armed when they are added to a wheel */
+    if(timer->wheel) {
+        gint64 now = g_get_monotonic_time();
+        _tgentimerwheel_arm(timer->wheel, timer, now + (gint64)micros, now);
+    }
+}
+
+TGenTimer* tgentimer_new(guint64 microseconds, gboolean isPersistent,
+        TGenTimer_notifyExpiredFunc notify, gpointer data1, gpointer data2,
+        GDestroyNotify destructData1, GDestroyNotify destructData2) {
+    /* if they dont want to be notified of timer expirations, there is no point */
+    if(!notify) {
         return NULL;
     }
 
-    /* allocate the new server object and return it */
+    /* allocate the new timer object and return it. it is armed
+     * once it is added to a timer wheel. */
     TGenTimer* timer = g_new0(TGenTimer, 1);
     timer->magic = TGEN_MAGIC;
     timer->refcount = 1;
@@ -169,8 +550,9 @@ TGenTimer* tgentimer_new(guint64 microseconds, gboolean isPersistent,
     timer->destructData1 = destructData1;
     timer->destructData2 = destructData2;
 
-    timer->timerD = timerD;
+    timer->intervalMicros = microseconds;
     timer->isPersistent = isPersistent;
+    timer->level = -1;
 
     return timer;
 }
@@ -178,10 +560,7 @@ TGenTimer* tgentimer_new(guint64 microseconds, gboolean isPersistent,
 static void _tgentimer_free(TGenTimer* timer) {
     TGEN_ASSERT(timer);
     g_assert(timer->refcount == 0);
-
-    if(timer->timerD > 0) {
-        close(timer->timerD);
-    }
+    g_assert(!timer->wheel && !timer->list);
 
     if(timer->destructData1 && timer->data1) {
         timer->destructData1(timer->data1);
@@ -206,8 +585,3 @@ void tgentimer_unref(TGenTimer* timer) {
         _tgentimer_free(timer);
     }
 }
-
-gint tgentimer_getDescriptor(TGenTimer* timer) {
-    TGEN_ASSERT(timer);
-    return timer->timerD;
-}
@@ -9,6 +9,7 @@
 #include <glib.h>
 
 typedef struct _TGenTimer TGenTimer;
+typedef struct _TGenTimerWheel TGenTimerWheel;
 
 /* return TRUE to cancel the timer, FALSE to continue the timer as originally configured */
 typedef gboolean (*TGenTimer_notifyExpiredFunc)(gpointer data1, gpointer data2);
@@ -19,9 +20,23 @@ TGenTimer* tgentimer_new(guint64 microseconds, gboolean isPersistent,
 void tgentimer_ref(TGenTimer* timer);
 void tgentimer_unref(TGenTimer* timer);
 
-TGenEvent tgentimer_onEvent(TGenTimer* timer, gint descriptor, TGenEvent events);
-gint tgentimer_getDescriptor(TGenTimer* timer);
 void tgentimer_settime_micros(TGenTimer *timer, guint64 micros);
 void tgentimer_cancel(TGenTimer *timer);
 
+TGenTimerWheel* tgentimerwheel_new();
+void tgentimerwheel_free(TGenTimerWheel* wheel);
+
+void tgentimerwheel_add(TGenTimerWheel* wheel, TGenTimer* timer);
+void tgentimerwheel_remove(TGenTimerWheel* wheel, TGenTimer* timer);
+void tgentimerwheel_onExpired(TGenTimerWheel* wheel);
+void tgentimerwheel_expire(TGenTimerWheel* wheel);
+
+void tgentimerwheel_disableDescriptor(TGenTimerWheel* wheel);
+gint64 tgentimerwheel_getNextExpireMicros(TGenTimerWheel* wheel);
+
+gint tgentimerwheel_getDescriptor(TGenTimerWheel* wheel);
+guint tgentimerwheel_getNumTimers(TGenTimerWheel* wheel);
+void tgentimerwheel_collectLateness(TGenTimerWheel* wheel, guint64* numExpired,
+        guint64* meanLatenessMicros, guint64* maxLatenessMicros);
+
 #endif /* TGEN_TIMER_H_ */
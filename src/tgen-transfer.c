@@ -9,6 +9,11 @@
 /* 60 seconds default timeout */
 #define DEFAULT_XFER_TIMEOUT_USEC 60000000
 #define DEFAULT_XFER_STALLOUT_USEC 15000000
+/* by default we log the status of an active transfer on every progress event */
+#define DEFAULT_XFER_STATUS_INTERVAL_USEC 0
+/* names the other end sends us that are shorter than this are kept inline in the
+ * transfer, and longer ones on the heap. hostnames and vertex ids are usually short. */
+#define TGEN_TRANSFER_NAME_BUFFER_LENGTH 64
 
 /* default lengths for buffers used during i/o.
  * the read buffer is temporary and stack-allocated.
@@ -16,10 +21,59 @@
  * it will consume more memory so we keep it relatively smaller. */
 #define DEFAULT_XFER_READ_BUFLEN 65536
 #define DEFAULT_XFER_WRITE_BUFLEN 32768
+/* the buffer for reading command, response, and checksum lines in bulk */
+#define DEFAULT_XFER_LINE_BUFLEN 4096
+/* when we discard payload, we want to wake up for no less than this many bytes */
+#define DEFAULT_XFER_RCVLOWAT 65536
+/* but never for more than we expect to arrive in this fraction of the stallout */
+#define DEFAULT_XFER_RCVLOWAT_STALLOUT_FRACTION 4
 
 /* an auth password so we know both sides understand tgen */
 #define TGEN_AUTH_PW "T8nNx9L95LATtckJkR5n"
 
+/* the byte following the auth password tells the other side how we encode
+ * everything else we send it. older peers always send a space. */
+#define TGEN_AUTH_VERSION_TEXT ' '
+#define TGEN_AUTH_VERSION_BINARY 0x01
+
+/* binary frames start with a type byte and the 32-bit big-endian length of the body */
+#define TGEN_FRAME_HEADER_LENGTH 5
+#define TGEN_FRAME_MAX_LENGTH (16*1024*1024)
+
+/* in binary framing, we stream the other side's schedule to it in frames of up
+ * to this many delays, and keep it this far ahead of the time we started */
+#define TGEN_SCHEDULE_FRAME_DELAYS 1024
+#define TGEN_SCHEDULE_HORIZON_USEC 1000000
+
+typedef enum _TGenFrameType {
+    TGEN_FRAME_COMMAND = 1, TGEN_FRAME_RESPONSE = 2, TGEN_FRAME_CHECKSUM = 3,
+    TGEN_FRAME_SCHEDULE = 4,
+} TGenFrameType;
+
+/* decodes the body of a binary frame in place */
+typedef struct _TGenFrameReader {
+    const guchar* position;
+    const guchar* end;
+    gboolean isValid;
+} TGenFrameReader;
+
+/* a binary command as the commander sent it. the strings point into the frame
+ * and are not NUL-terminated. */
+typedef struct _TGenTransferCommand {
+    TGenTransferType type;
+    TGenChecksumType checksumType;
+    guint64 count;
+    const gchar* name;
+    gsize nameLength;
+    const gchar* id;
+    gsize idLength;
+    /* the sizes from the commander's perspective */
+    guint64 ourSize;
+    guint64 theirSize;
+    /* the number of delays in the schedule the commander streams to us */
+    guint64 scheduleLength;
+} TGenTransferCommand;
+
 typedef enum _TGenTransferState {
     TGEN_XFER_COMMAND, TGEN_XFER_RESPONSE,
     TGEN_XFER_PAYLOAD, TGEN_XFER_CHECKSUM,
@@ -35,8 +89,6 @@ typedef struct _TGenTransferGetputData {
     gsize ourSize;
     gsize theirSize;
     gsize expectedReceiveBytes;
-    GChecksum *ourPayloadChecksum;
-    GChecksum *theirPayloadChecksum;
     gboolean doneReadingPayload;
     gboolean doneWritingPayload;
     gboolean sentOurChecksum;
@@ -45,16 +97,34 @@ typedef struct _TGenTransferGetputData {
 
 typedef struct _TGenTransferScheduleData {
     TGenTimer *timer;
-    GChecksum *ourPayloadChecksum;
-    GChecksum *theirPayloadChecksum;
-    GArray *sched;
-    gint schedIdx;
+    /* our io registration when the timer was armed */
+    TGenIOHandle ioHandle;
+    TGenSchedule *sched;
+    guint schedIdx;
     gsize scheduleSize;
-    gchar* theirSchedule;
+    TGenSchedule* theirSchedule;
     gsize theirScheduleSize;
     gsize expectedReceiveBytes;
     int32_t nextDelay;
     gboolean timerSet;
+    /* as the commander in binary framing, we stream their schedule to them
+     * in frames that we interleave with our payload */
+    gboolean isSendingTheirSchedule;
+    gsize theirScheduleLength;
+    gsize theirScheduleSent;
+    /* the next delay to send, counted from the front of their schedule */
+    guint theirScheduleIdx;
+    gint64 theirScheduleSentMicros;
+    gint64 theirScheduleStart;
+    int32_t theirLastDelay;
+    /* as the other side in binary framing, sched only holds the delays we got
+     * from the commander but did not use yet */
+    gboolean isStreamed;
+    gsize scheduleLength;
+    gsize scheduleReceived;
+    int32_t lastReceivedDelay;
+    /* the payload bytes we read before the next schedule frame */
+    gsize payloadSegment;
     gboolean doneReadingPayload;
     gboolean doneWritingPayload;
     gboolean sentOurChecksum;
@@ -69,21 +139,34 @@ struct _TGenTransfer {
     gchar* string;
     gint64 timeoutUSecs;
     gint64 stalloutUSecs;
+    /* the least time between the status lines we log while we make progress */
+    gint64 statusIntervalUSecs;
+    /* our driver's histograms, indexed by TGenTransferLatency, or NULL */
+    TGenHistogram** latencyHistograms;
+    /* fires at the earlier of the timeout and stallout deadlines */
+    TGenTimer* timeoutTimer;
 
     /* used for authentication */
     guint authIndex;
     gboolean authComplete;
     gboolean authSuccess;
-
-    /* command information */
-    gchar* id; // the unique vertex id from the graph
+    /* the commander picks the framing, and the other side learns it during auth */
+    TGenTransferFraming framing;
+
+    /* command information. our hostname and the ids from our own graph are
+     * interned, because there are only a few distinct ones but we may hold very
+     * many transfers. the names we read from the other end point into the
+     * buffers below, or to the heap if they are too long to fit. */
+    const gchar* id; // the unique vertex id from the graph
     gsize count; // global transfer count
     TGenTransferType type;
     gsize size;
     gboolean isCommander;
-    gchar* hostname;
+    const gchar* hostname;
     gsize remoteCount;
-    gchar* remoteName;
+    const gchar* remoteName;
+    gchar idBuffer[TGEN_TRANSFER_NAME_BUFFER_LENGTH];
+    gchar remoteNameBuffer[TGEN_TRANSFER_NAME_BUFFER_LENGTH];
 
     /* socket communication layer and buffers */
     TGenTransport* transport;
@@ -91,9 +174,42 @@ struct _TGenTransfer {
     gint readBufferOffset;
     GString* writeBuffer;
     gint writeBufferOffset;
-
-    /* a checksum to store bytes received and test transfer integrity */
-    GChecksum* payloadChecksum;
+    /* payload we write is borrowed from the shared payload pool, starting at
+     * the offset into the payload period. pending bytes are not written yet. */
+    TGenPayloadContent payloadContent;
+    /* send the payload from the pool's file without copying it */
+    gboolean payloadZeroCopy;
+    gsize payloadOffset;
+    gsize payloadPending;
+    /* bytes we read from the transport in bulk but did not consume yet */
+    gchar* inBuffer;
+    gsize inBufferLength;
+    gsize inBufferOffset;
+
+    /* checksums over the payload we send and receive to test transfer integrity.
+     * they are created on first use, so we only have the ones for the directions
+     * in which payload flows, and none if the checksum type is none. */
+    TGenChecksumType checksumType;
+    TGenChecksum* ourPayloadChecksum;
+    TGenChecksum* theirPayloadChecksum;
+    /* without a checksum, nobody looks at the payload we receive, so we drop it
+     * in the kernel unless the transport can not do that */
+    gboolean payloadDiscardFailed;
+    /* the SO_RCVLOWAT we last set on the socket */
+    gint receiveLowWatermark;
+
+    /* how much we may read and write per event, zero limits mean one read or write */
+    struct {
+        guint64 bytesLimit;
+        guint64 syscallsLimit;
+        /* usage during the current event */
+        guint64 bytesRead;
+        guint64 numReads;
+        guint64 bytesWritten;
+        guint64 numWrites;
+        /* the directions in which we stopped because the budget ran out */
+        TGenEvent exhausted;
+    } budget;
 
     /* track bytes for read/write progress reporting */
     struct {
@@ -133,100 +249,114 @@ struct _TGenTransfer {
     guint magic;
 };
 
+static gint64 _tgentransfer_getTimeoutDeadline(TGenTransfer* transfer) {
+    gint64 deadline = transfer->time.start + transfer->timeoutUSecs;
+    if(transfer->time.lastProgress > 0) {
+        deadline = MIN(deadline, transfer->time.lastProgress + transfer->stalloutUSecs);
+    }
+    return deadline;
+}
+
+static void _tgentransfer_resetTimeoutTimer(TGenTransfer* transfer) {
+    if(transfer->timeoutTimer) {
+        gint64 remaining = _tgentransfer_getTimeoutDeadline(transfer) - g_get_monotonic_time();
+        tgentimer_settime_micros(transfer->timeoutTimer, (guint64)MAX(remaining, 0));
+    }
+}
+
+static void _tgentransfer_onProgress(TGenTransfer* transfer) {
+    gboolean isFirstProgress = (transfer->time.lastProgress == 0) ? TRUE : FALSE;
+    transfer->time.lastProgress = g_get_monotonic_time();
+
+    /* later progress only pushes the stallout deadline back, and the timeout timer
+     * handles that lazily when it expires. but the first progress arms the stallout,
+     * which might be sooner than the timeout we are currently waiting for. */
+    if(isFirstProgress) {
+        _tgentransfer_resetTimeoutTimer(transfer);
+    }
+}
+
+/* copies a name we read from the other end, which need not be NUL-terminated.
+ * we never intern these, since the other end picks them and there is no bound
+ * on how many distinct ones we see. returns the buffer, or a heap copy if the
+ * name does not fit, which _tgentransfer_freeName frees. */
+static const gchar* _tgentransfer_copyName(gchar buffer[TGEN_TRANSFER_NAME_BUFFER_LENGTH],
+        const gchar* name, gsize length) {
+    if(length < TGEN_TRANSFER_NAME_BUFFER_LENGTH) {
+        memcpy(buffer, name, length);
+        buffer[length] = '\0';
+        return buffer;
+    } else {
+        return g_strndup(name, length);
+    }
+}
+
+static void _tgentransfer_freeName(const gchar* name,
+        const gchar buffer[TGEN_TRANSFER_NAME_BUFFER_LENGTH]) {
+    if(name && name != buffer) {
+        g_free((gchar*)name);
+    }
+}
+
 static void _tgentransfer_initGetputData(TGenTransfer *transfer,
         gsize ourSize, gsize theirSize) {
     TGEN_ASSERT(transfer);
     g_assert(!transfer->getput); // Yes, assert that it is NULL
-    transfer->getput = g_new0(TGenTransferGetputData, 1);
-    transfer->getput->ourPayloadChecksum = g_checksum_new(G_CHECKSUM_MD5);
-    transfer->getput->theirPayloadChecksum = g_checksum_new(G_CHECKSUM_MD5);
+    transfer->getput = tgenslab_alloc0(TGEN_SLAB_TRANSFER_GETPUT, sizeof(TGenTransferGetputData));
     transfer->getput->ourSize = ourSize;
     transfer->getput->theirSize = theirSize;
 }
 
-static GArray* _tgentransfer_getScheduleFromString(const gchar *str, gsize* totalSizeBytes)
-{
-    g_assert(str);
-    GArray* sched = g_array_new(TRUE, FALSE, 4);
-    if(totalSizeBytes) {
-        *totalSizeBytes = 0;
-    }
-
-    gchar **delays = g_strsplit(str, ",", 0);
-    for(gint i = 0; delays[i] != NULL; i++) {
-        /* Make sure this string is of positive length, but stop at a max
-         * length of 10 chars so we don't read garbage. 10 chars isn't really
-         * important, but if it somehow became important, it allows for 1000
-         * seconds of delay expressed in microseconds */
-        if (strnlen(delays[i], 10) < 1) {
-            continue;
-        }
-
-        /* delays are time in micros between packets */
-        gint64 value = g_ascii_strtoll(delays[i], NULL, 10);
-        int32_t delay = 0;
-        if(value > INT32_MAX) {
-            delay = INT32_MAX;
-        } else if (value < INT32_MIN) {
-            delay = INT32_MIN;
-        } else {
-            delay = (int32_t) value;
-        }
-        g_array_append_val(sched, delay);
-        if(totalSizeBytes) {
-            *totalSizeBytes = *totalSizeBytes + TGEN_MMODEL_PACKET_DATA_SIZE;
-        }
-    }
-    if(delays) {
-        g_strfreev(delays);
-    }
-
-    return sched;
-}
-
 static void _tgentransfer_initSchedData(TGenTransfer *transfer,
-        const gchar* localSchedule, const gchar* remoteSchedule)
+        TGenSchedule* localSchedule, TGenSchedule* remoteSchedule)
 {
     TGEN_ASSERT(transfer);
     g_assert(!transfer->schedule); // Yes, assert that it is NULL
 
-    transfer->schedule = g_new0(TGenTransferScheduleData, 1);
-    transfer->schedule->ourPayloadChecksum = g_checksum_new(G_CHECKSUM_MD5);
-    transfer->schedule->theirPayloadChecksum = g_checksum_new(G_CHECKSUM_MD5);
+    transfer->schedule = tgenslab_alloc0(TGEN_SLAB_TRANSFER_SCHEDULE, sizeof(TGenTransferScheduleData));
 
     if (localSchedule) {
         /* keep the schedule size so that we can tell the other size how
          * much they can expect to receive from us. We need this so they
          * know when to stop waiting for more data. */
-        transfer->schedule->sched = _tgentransfer_getScheduleFromString(localSchedule,
-                &(transfer->schedule->scheduleSize));
+        tgenschedule_ref(localSchedule);
+        transfer->schedule->sched = localSchedule;
+        transfer->schedule->scheduleSize = tgenschedule_getTotalBytes(localSchedule);
         transfer->size = transfer->schedule->scheduleSize;
     }
     if(remoteSchedule) {
-        transfer->schedule->theirSchedule = g_strdup(remoteSchedule);
+        tgenschedule_ref(remoteSchedule);
+        transfer->schedule->theirSchedule = remoteSchedule;
         /* we need to know how much they will send us so we know when to
-         * stop waiting for more data. but we don't need the actual schedule,
-         * so just keep the size. */
-        GArray* temp = _tgentransfer_getScheduleFromString(transfer->schedule->theirSchedule,
-                &(transfer->schedule->theirScheduleSize));
-        g_array_unref(temp);
+         * stop waiting for more data. */
+        transfer->schedule->theirScheduleLength = tgenschedule_getLength(remoteSchedule);
+        transfer->schedule->theirScheduleSize = tgenschedule_getTotalBytes(remoteSchedule);
 
         transfer->schedule->expectedReceiveBytes = transfer->schedule->theirScheduleSize;
     }
 }
 
+/* the commander streams our schedule to us after the command */
+static void _tgentransfer_initStreamedSchedData(TGenTransfer *transfer,
+        gsize scheduleLength, gsize theirSize)
+{
+    _tgentransfer_initSchedData(transfer, NULL, NULL);
+
+    transfer->schedule->sched = tgenschedule_new();
+    transfer->schedule->isStreamed = TRUE;
+    transfer->schedule->scheduleLength = scheduleLength;
+    transfer->schedule->scheduleSize = scheduleLength * TGEN_MMODEL_PACKET_DATA_SIZE;
+    transfer->size = transfer->schedule->scheduleSize;
+    transfer->schedule->expectedReceiveBytes = theirSize;
+}
+
 static void _tgentransfer_freeGetputData(TGenTransfer *transfer) {
     TGEN_ASSERT(transfer);
     if (!transfer->getput) {
         return;
     }
-    if (transfer->getput->ourPayloadChecksum) {
-        g_checksum_free(transfer->getput->ourPayloadChecksum);
-    }
-    if (transfer->getput->theirPayloadChecksum) {
-        g_checksum_free(transfer->getput->theirPayloadChecksum);
-    }
-    g_free(transfer->getput);
+    tgenslab_free(TGEN_SLAB_TRANSFER_GETPUT, transfer->getput);
+    transfer->getput = NULL;
 }
 
 static void _tgentransfer_freeSchedData(TGenTransfer *transfer) {
@@ -234,21 +364,17 @@ static void _tgentransfer_freeSchedData(TGenTransfer *transfer) {
     if (!transfer->schedule) {
         return;
     }
-    if (transfer->schedule->ourPayloadChecksum) {
-        g_checksum_free(transfer->schedule->ourPayloadChecksum);
-    }
-    if (transfer->schedule->theirPayloadChecksum) {
-        g_checksum_free(transfer->schedule->theirPayloadChecksum);
-    }
     if (transfer->schedule->sched) {
-        g_array_unref(transfer->schedule->sched);
+        tgenschedule_unref(transfer->schedule->sched);
     }
     if (transfer->schedule->timer) {
         tgentimer_unref(transfer->schedule->timer);
     }
     if (transfer->schedule->theirSchedule) {
-        g_free(transfer->schedule->theirSchedule);
+        tgenschedule_unref(transfer->schedule->theirSchedule);
     }
+    tgenslab_free(TGEN_SLAB_TRANSFER_SCHEDULE, transfer->schedule);
+    transfer->schedule = NULL;
 }
 
 static const gchar* _tgentransfer_typeToString(TGenTransfer* transfer) {
@@ -380,6 +506,79 @@ static void _tgentransfer_changeError(TGenTransfer* transfer, TGenTransferError
     _tgentransfer_resetString(transfer);
 }
 
+static gsize _tgentransfer_getBufferedLength(TGenTransfer* transfer) {
+    return transfer->inBufferLength - transfer->inBufferOffset;
+}
+
+/* makes sure we have unconsumed bytes in the input buffer, reading more from
+ * the transport in bulk if needed. returns the number of buffered bytes, or
+ * the result of the transport read (with errno set) if it returned no bytes. */
+static gssize _tgentransfer_fillInBuffer(TGenTransfer* transfer) {
+    gsize buffered = _tgentransfer_getBufferedLength(transfer);
+    if(buffered > 0) {
+        return (gssize)buffered;
+    }
+
+    if(!transfer->inBuffer) {
+        transfer->inBuffer = g_malloc(DEFAULT_XFER_LINE_BUFLEN);
+    }
+
+    transfer->inBufferOffset = 0;
+    transfer->inBufferLength = 0;
+
+    gssize bytes = tgentransport_read(transfer->transport, transfer->inBuffer, DEFAULT_XFER_LINE_BUFLEN);
+    if(bytes > 0) {
+        transfer->inBufferLength = (gsize)bytes;
+    }
+    return bytes;
+}
+
+static void _tgentransfer_consumeInBuffer(TGenTransfer* transfer, gsize length) {
+    g_assert(length <= _tgentransfer_getBufferedLength(transfer));
+    transfer->inBufferOffset += length;
+    transfer->bytes.totalRead += length;
+}
+
+/* reads into the buffer, taking the bytes we already have in the input buffer first */
+static gssize _tgentransfer_read(TGenTransfer* transfer, gpointer buffer, gsize length) {
+    gsize buffered = _tgentransfer_getBufferedLength(transfer);
+    if(buffered == 0) {
+        gssize bytes = tgentransport_read(transfer->transport, buffer, length);
+        if(bytes > 0) {
+            transfer->bytes.totalRead += bytes;
+        }
+        return bytes;
+    }
+
+    length = MIN(length, buffered);
+    memcpy(buffer, &transfer->inBuffer[transfer->inBufferOffset], length);
+    _tgentransfer_consumeInBuffer(transfer, length);
+    return (gssize)length;
+}
+
+/* returns TRUE if the result of filling the input buffer left us bytes to read
+ * from, and moves the transfer to the error state if the transport failed */
+static gboolean _tgentransfer_checkControlRead(TGenTransfer* transfer, gssize bytes) {
+    if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
+        tgen_critical("read(): transport %s transfer %s error %i: %s",
+                tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer),
+                errno, g_strerror(errno));
+        return FALSE;
+    } else if(bytes == 0) {
+        _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
+        tgen_critical("read(): transport %s transfer %s closed unexpectedly",
+                tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer));
+        return FALSE;
+    } else if(bytes < 0) {
+        /* we will get the rest later */
+        return FALSE;
+    }
+    return TRUE;
+}
+
 static gboolean _tgentransfer_getLine(TGenTransfer* transfer) {
     TGEN_ASSERT(transfer);
 
@@ -388,53 +587,237 @@ static gboolean _tgentransfer_getLine(TGenTransfer* transfer) {
         transfer->readBuffer = g_string_new(NULL);
     }
 
-    gchar c;
-    gssize bytes = 1;
+    while(TRUE) {
+        gssize bytes = _tgentransfer_fillInBuffer(transfer);
+        if(!_tgentransfer_checkControlRead(transfer, bytes)) {
+            return FALSE;
+        }
 
-    while(bytes > 0) {
-        bytes = tgentransport_read(transfer->transport, &c, 1);
+        gchar* position = &transfer->inBuffer[transfer->inBufferOffset];
+        gchar* newline = memchr(position, '\n', (gsize)bytes);
 
-        if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-            _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
-            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
-            tgen_critical("read(): transport %s transfer %s error %i: %s",
-                    tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer),
-                    errno, g_strerror(errno));
-        } else if(bytes == 0) {
-            _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
-            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
-            tgen_critical("read(): transport %s transfer %s closed unexpectedly",
-                    tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer));
-        } else if(bytes == 1) {
-            transfer->bytes.totalRead += 1;
-            if(c == '\n') {
-                tgen_debug("finished receiving line: '%s'", transfer->readBuffer->str);
+        if(newline) {
+            /* bytes after the newline stay buffered for whoever reads next */
+            g_string_append_len(transfer->readBuffer, position, newline - position);
+            _tgentransfer_consumeInBuffer(transfer, (gsize)(newline - position) + 1);
+            tgen_debug("finished receiving line: '%s'", transfer->readBuffer->str);
+            return TRUE;
+        }
+
+        g_string_append_len(transfer->readBuffer, position, bytes);
+        _tgentransfer_consumeInBuffer(transfer, (gsize)bytes);
+    }
+}
+
+/* checks the header of a frame we expect, and returns the length of its body */
+static gboolean _tgentransfer_parseFrameHeader(TGenTransfer* transfer, const gchar* header,
+        TGenFrameType type, gsize* lengthOut) {
+    guint32 length;
+    memcpy(&length, &header[1], sizeof(guint32));
+    length = GUINT32_FROM_BE(length);
+
+    if((guchar)header[0] != type || length > TGEN_FRAME_MAX_LENGTH) {
+        _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
+        tgen_critical("transport %s transfer %s received a frame of type %i and length %u, "
+                "expected type %i", tgentransport_toString(transfer->transport),
+                _tgentransfer_toString(transfer), (gint)(guchar)header[0], (guint)length, (gint)type);
+        return FALSE;
+    }
+
+    *lengthOut = (gsize)length;
+    return TRUE;
+}
+
+/* gets the body of the next binary frame, which must be of the given type. the
+ * body is valid until the frame is released or we read again. we only copy frames
+ * that arrive in pieces; most are parsed in place in the input buffer. */
+static gboolean _tgentransfer_getFrame(TGenTransfer* transfer, TGenFrameType type,
+        const guchar** bodyOut, gsize* lengthOut) {
+    TGEN_ASSERT(transfer);
+
+    while(TRUE) {
+        /* how many bytes we need in the read buffer for the frame to be complete */
+        gsize wanted = TGEN_FRAME_HEADER_LENGTH;
+
+        if(transfer->readBuffer && transfer->readBuffer->len >= TGEN_FRAME_HEADER_LENGTH) {
+            gsize length = 0;
+            if(!_tgentransfer_parseFrameHeader(transfer, transfer->readBuffer->str, type, &length)) {
+                return FALSE;
+            }
+            wanted += length;
+
+            if(transfer->readBuffer->len == wanted) {
+                *bodyOut = (const guchar*)&transfer->readBuffer->str[TGEN_FRAME_HEADER_LENGTH];
+                *lengthOut = length;
                 return TRUE;
             }
-            g_string_append_c(transfer->readBuffer, c);
         }
+
+        gssize bytes = _tgentransfer_fillInBuffer(transfer);
+        if(!_tgentransfer_checkControlRead(transfer, bytes)) {
+            return FALSE;
+        }
+
+        const gchar* position = &transfer->inBuffer[transfer->inBufferOffset];
+
+        if(!transfer->readBuffer && (gsize)bytes >= TGEN_FRAME_HEADER_LENGTH) {
+            gsize length = 0;
+            if(!_tgentransfer_parseFrameHeader(transfer, position, type, &length)) {
+                return FALSE;
+            }
+
+            if((gsize)bytes >= TGEN_FRAME_HEADER_LENGTH + length) {
+                /* the whole frame is already buffered */
+                *bodyOut = (const guchar*)&position[TGEN_FRAME_HEADER_LENGTH];
+                *lengthOut = length;
+                _tgentransfer_consumeInBuffer(transfer, TGEN_FRAME_HEADER_LENGTH + length);
+                return TRUE;
+            }
+        }
+
+        if(!transfer->readBuffer) {
+            transfer->readBuffer = g_string_new(NULL);
+        }
+
+        /* bytes after the frame stay buffered for whoever reads next */
+        gsize amount = MIN((gsize)bytes, wanted - transfer->readBuffer->len);
+        g_string_append_len(transfer->readBuffer, position, amount);
+        _tgentransfer_consumeInBuffer(transfer, amount);
     }
+}
 
-    return FALSE;
+static void _tgentransfer_releaseFrame(TGenTransfer* transfer) {
+    if(transfer->readBuffer) {
+        g_string_free(transfer->readBuffer, TRUE);
+        transfer->readBuffer = NULL;
+    }
+}
+
+static guint8 _tgentransfer_readFrameByte(TGenFrameReader* reader) {
+    if(reader->position >= reader->end) {
+        reader->isValid = FALSE;
+        return 0;
+    }
+    return *reader->position++;
+}
+
+static guint64 _tgentransfer_readFrameVarint(TGenFrameReader* reader) {
+    guint64 value = 0;
+    for(guint shift = 0; shift < 64; shift += 7) {
+        guint8 byte = _tgentransfer_readFrameByte(reader);
+        if(!reader->isValid) {
+            return 0;
+        }
+        value |= ((guint64)(byte & 0x7F)) << shift;
+        if(!(byte & 0x80)) {
+            return value;
+        }
+    }
+    reader->isValid = FALSE;
+    return 0;
+}
+
+/* returns a pointer into the frame, the bytes are not NUL-terminated */
+static const gchar* _tgentransfer_readFrameBytes(TGenFrameReader* reader, gsize* lengthOut) {
+    guint64 length = _tgentransfer_readFrameVarint(reader);
+    if(!reader->isValid || length > (guint64)(reader->end - reader->position)) {
+        reader->isValid = FALSE;
+        *lengthOut = 0;
+        return NULL;
+    }
+    const gchar* bytes = (const gchar*)reader->position;
+    reader->position += length;
+    *lengthOut = (gsize)length;
+    return bytes;
+}
+
+/* starts a frame at the end of the buffer, and returns where it starts */
+static gsize _tgentransfer_beginFrame(GString* buffer, TGenFrameType type) {
+    gsize frameOffset = buffer->len;
+    g_string_append_c(buffer, (gchar)type);
+    /* the length is filled in when the frame ends */
+    g_string_append_len(buffer, "\0\0\0\0", sizeof(guint32));
+    return frameOffset;
+}
+
+static void _tgentransfer_endFrame(GString* buffer, gsize frameOffset) {
+    guint32 length = GUINT32_TO_BE((guint32)(buffer->len - frameOffset - TGEN_FRAME_HEADER_LENGTH));
+    memcpy(&buffer->str[frameOffset + 1], &length, sizeof(guint32));
+}
+
+/* writes up to 10 bytes, and returns how many */
+static gsize _tgentransfer_encodeVarint(guint64 value, gchar* bytes) {
+    gsize length = 0;
+    do {
+        guint8 byte = (guint8)(value & 0x7F);
+        value >>= 7;
+        bytes[length++] = (gchar)(value ? (byte | 0x80) : byte);
+    } while(value);
+    return length;
+}
+
+static void _tgentransfer_appendVarint(GString* buffer, guint64 value) {
+    gchar bytes[10];
+    gsize length = _tgentransfer_encodeVarint(value, bytes);
+    g_string_append_len(buffer, bytes, length);
+}
+
+static void _tgentransfer_appendBytes(GString* buffer, const gchar* bytes, gsize length) {
+    _tgentransfer_appendVarint(buffer, length);
+    if(length > 0) {
+        g_string_append_len(buffer, bytes, length);
+    }
+}
+
+/* the byte we send after the auth password */
+static gchar _tgentransfer_getVersion(TGenTransfer* transfer) {
+    return (transfer->framing == TGEN_FRAMING_BINARY) ?
+            TGEN_AUTH_VERSION_BINARY : TGEN_AUTH_VERSION_TEXT;
+}
+
+static gboolean _tgentransfer_acceptVersion(TGenTransfer* transfer, gchar version) {
+    TGenTransferFraming framing;
+    if(version == TGEN_AUTH_VERSION_TEXT) {
+        framing = TGEN_FRAMING_TEXT;
+    } else if(version == TGEN_AUTH_VERSION_BINARY) {
+        framing = TGEN_FRAMING_BINARY;
+    } else {
+        tgen_info("transfer authentication error: unsupported protocol version %i", (gint)version);
+        return FALSE;
+    }
+
+    if(transfer->isCommander && framing != transfer->framing) {
+        tgen_info("transfer authentication error: we sent protocol version %i but received %i",
+                (gint)_tgentransfer_getVersion(transfer), (gint)version);
+        return FALSE;
+    }
+
+    transfer->framing = framing;
+    return TRUE;
 }
 
 static void _tgentransfer_authenticate(TGenTransfer* transfer) {
     TGEN_ASSERT(transfer);
 
-    gchar authbuf[24];
-    gsize amt = 21 - transfer->authIndex;
-    gssize bytes = tgentransport_read(transfer->transport, &(authbuf[0]), amt);
+    gssize bytes = _tgentransfer_fillInBuffer(transfer);
 
     if(bytes > 0) {
-        for (gsize loc = 0; loc < bytes; loc++) {
+        const gchar* authbuf = &transfer->inBuffer[transfer->inBufferOffset];
+        gsize amt = MIN((gsize)(21 - transfer->authIndex), (gsize)bytes);
+        gsize consumed = 0;
+
+        for (gsize loc = 0; loc < amt; loc++) {
             gchar c = authbuf[loc];
-            transfer->bytes.totalRead += 1;
+            consumed++;
 
             if(transfer->authIndex == 20) {
-                /* we just read the space following the password, so we are now done */
-                tgen_info("transfer authentication successful!");
+                /* we just read the version following the password, so we are now done */
                 transfer->authComplete = TRUE;
-                transfer->authSuccess = TRUE;
+                transfer->authSuccess = _tgentransfer_acceptVersion(transfer, c);
+                if(transfer->authSuccess) {
+                    tgen_info("transfer authentication successful!");
+                }
                 break;
             }
 
@@ -451,6 +834,9 @@ static void _tgentransfer_authenticate(TGenTransfer* transfer) {
                 break;
             }
         }
+
+        /* the rest of the buffer belongs to the line after the password */
+        _tgentransfer_consumeInBuffer(transfer, consumed);
     } else if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
         /* we ran out of bytes for now, but expect more to come */
         transfer->authComplete = FALSE;
@@ -473,17 +859,20 @@ static void _tgentransfer_authenticate(TGenTransfer* transfer) {
     }
 }
 
-static void _tgentransfer_readCommand(TGenTransfer* transfer) {
-    TGEN_ASSERT(transfer);
-    g_assert(transfer->type == TGEN_TYPE_NONE);
-
-    if(!transfer->authComplete) {
-        _tgentransfer_authenticate(transfer);
-        if(!transfer->authComplete || !transfer->authSuccess) {
-            return;
-        }
+static void _tgentransfer_onCommandRead(TGenTransfer* transfer, gboolean hasError) {
+    /* payload phase is next unless there was an error parsing */
+    if(hasError) {
+        _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
+    } else {
+        /* we need to update our string with the new command info */
+        _tgentransfer_resetString(transfer);
+        _tgentransfer_changeState(transfer, TGEN_XFER_RESPONSE);
+        transfer->events |= TGEN_EVENT_WRITE;
     }
+}
 
+static void _tgentransfer_readTextCommand(TGenTransfer* transfer) {
     if(_tgentransfer_getLine(transfer)) {
         /* we have read the entire command from the other end */
         gboolean hasError = FALSE;
@@ -499,11 +888,12 @@ static void _tgentransfer_readCommand(TGenTransfer* transfer) {
             hasError = TRUE;
         } else {
             g_assert(!transfer->remoteName);
-            transfer->remoteName = g_strdup(parts[0]);
+            transfer->remoteName = _tgentransfer_copyName(transfer->remoteNameBuffer,
+                    parts[0], strlen(parts[0]));
 
             /* we are not the commander so we should not have an id yet */
             g_assert(transfer->id == NULL);
-            transfer->id = g_strdup(parts[1]);
+            transfer->id = _tgentransfer_copyName(transfer->idBuffer, parts[1], strlen(parts[1]));
 
             transfer->remoteCount = (gsize)g_ascii_strtoull(parts[2], NULL, 10);
             if(transfer->remoteCount == 0) {
@@ -531,6 +921,13 @@ static void _tgentransfer_readCommand(TGenTransfer* transfer) {
                 hasError = TRUE;
             }
 
+            /* the checksum type is optional, older peers always use md5 */
+            if (!hasError && parts[5] != NULL &&
+                    !tgenchecksum_typeFromString(parts[5], &transfer->checksumType)) {
+                tgen_critical("error parsing command checksum '%s'", parts[5]);
+                hasError = TRUE;
+            }
+
             if (!hasError && transfer->type != TGEN_TYPE_NONE) {
                 if (transfer->type == TGEN_TYPE_GET || transfer->type == TGEN_TYPE_PUT) {
                     transfer->size = (gsize)g_ascii_strtoull(parts[4], NULL, 10);
@@ -558,7 +955,10 @@ static void _tgentransfer_readCommand(TGenTransfer* transfer) {
 
                     /* the schedule we got is our local schedule, we don't care
                      * about the other end's schedule. */
-                    _tgentransfer_initSchedData(transfer, schedParts[1], NULL);
+                    TGenSchedule* ourSchedule = schedParts[1] ?
+                            tgenschedule_newFromString(schedParts[1]) : tgenschedule_new();
+                    _tgentransfer_initSchedData(transfer, ourSchedule, NULL);
+                    tgenschedule_unref(ourSchedule);
 
                     /* now that the schedule is initialized, we can store the size */
                     transfer->schedule->expectedReceiveBytes = theirSize;
@@ -576,25 +976,111 @@ static void _tgentransfer_readCommand(TGenTransfer* transfer) {
         }
         g_strfreev(parts);
 
-        /* payload phase is next unless there was an error parsing */
-        if(hasError) {
-            _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
-            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
-        } else {
-            /* we need to update our string with the new command info */
-            _tgentransfer_resetString(transfer);
-            _tgentransfer_changeState(transfer, TGEN_XFER_RESPONSE);
-            transfer->events |= TGEN_EVENT_WRITE;
-        }
-
+        _tgentransfer_onCommandRead(transfer, hasError);
     } else {
         /* unable to receive entire command, wait for next chance to read */
     }
 }
 
-static void _tgentransfer_readResponse(TGenTransfer* transfer) {
+static gboolean _tgentransfer_parseBinaryCommand(const guchar* body, gsize length,
+        TGenTransferCommand* command) {
+    TGenFrameReader reader = {body, body + length, TRUE};
+
+    command->type = (TGenTransferType)_tgentransfer_readFrameByte(&reader);
+    command->checksumType = (TGenChecksumType)_tgentransfer_readFrameByte(&reader);
+    command->count = _tgentransfer_readFrameVarint(&reader);
+    command->name = _tgentransfer_readFrameBytes(&reader, &command->nameLength);
+    command->id = _tgentransfer_readFrameBytes(&reader, &command->idLength);
+    command->ourSize = _tgentransfer_readFrameVarint(&reader);
+
+    if(command->type == TGEN_TYPE_GETPUT) {
+        command->theirSize = _tgentransfer_readFrameVarint(&reader);
+    } else if(command->type == TGEN_TYPE_SCHEDULE) {
+        command->scheduleLength = _tgentransfer_readFrameVarint(&reader);
+    }
+
+    /* newer peers may append fields that we ignore */
+    return reader.isValid;
+}
+
+static void _tgentransfer_readBinaryCommand(TGenTransfer* transfer) {
+    const guchar* body = NULL;
+    gsize length = 0;
+    if(!_tgentransfer_getFrame(transfer, TGEN_FRAME_COMMAND, &body, &length)) {
+        /* unable to receive entire command, wait for next chance to read */
+        return;
+    }
+
+    gboolean hasError = FALSE;
+    transfer->time.command = g_get_monotonic_time();
+
+    TGenTransferCommand command = {0};
+    if(!_tgentransfer_parseBinaryCommand(body, length, &command)) {
+        tgen_critical("error parsing binary command of %"G_GSIZE_FORMAT" bytes", length);
+        hasError = TRUE;
+    } else if(command.type < TGEN_TYPE_GET || command.type > TGEN_TYPE_SCHEDULE) {
+        tgen_critical("error parsing command type %i", (gint)command.type);
+        hasError = TRUE;
+    } else if(command.checksumType > TGEN_CHECKSUM_XXH3) {
+        tgen_critical("error parsing command checksum %i", (gint)command.checksumType);
+        hasError = TRUE;
+    } else if(command.count == 0) {
+        tgen_critical("error parsing command ID 0");
+        hasError = TRUE;
+    } else {
+        g_assert(!transfer->remoteName);
+        transfer->remoteName = _tgentransfer_copyName(transfer->remoteNameBuffer,
+                command.name, command.nameLength);
+
+        /* we are not the commander so we should not have an id yet */
+        g_assert(transfer->id == NULL);
+        transfer->id = _tgentransfer_copyName(transfer->idBuffer, command.id, command.idLength);
+
+        transfer->remoteCount = (gsize)command.count;
+        transfer->checksumType = command.checksumType;
+
+        /* we do the opposite of what they do */
+        switch(command.type) {
+            case TGEN_TYPE_GET: {
+                transfer->type = TGEN_TYPE_PUT;
+                transfer->events |= TGEN_EVENT_WRITE;
+                transfer->size = (gsize)command.ourSize;
+                break;
+            }
+            case TGEN_TYPE_PUT: {
+                transfer->type = TGEN_TYPE_GET;
+                transfer->size = (gsize)command.ourSize;
+                break;
+            }
+            case TGEN_TYPE_GETPUT: {
+                transfer->type = TGEN_TYPE_GETPUT;
+                transfer->events |= TGEN_EVENT_WRITE;
+                _tgentransfer_initGetputData(transfer, (gsize)command.theirSize, (gsize)command.ourSize);
+                break;
+            }
+            case TGEN_TYPE_SCHEDULE:
+            default: {
+                transfer->type = TGEN_TYPE_SCHEDULE;
+                /* the schedule they stream to us is our local schedule */
+                _tgentransfer_initStreamedSchedData(transfer, (gsize)command.scheduleLength,
+                        (gsize)command.ourSize);
+                break;
+            }
+        }
+
+        if((transfer->type == TGEN_TYPE_GET || transfer->type == TGEN_TYPE_PUT) && transfer->size == 0) {
+            tgen_critical("error parsing command size 0");
+            hasError = TRUE;
+        }
+    }
+
+    _tgentransfer_releaseFrame(transfer);
+    _tgentransfer_onCommandRead(transfer, hasError);
+}
+
+static void _tgentransfer_readCommand(TGenTransfer* transfer) {
     TGEN_ASSERT(transfer);
-    g_assert(transfer->type != TGEN_TYPE_NONE);
+    g_assert(transfer->type == TGEN_TYPE_NONE);
 
     if(!transfer->authComplete) {
         _tgentransfer_authenticate(transfer);
@@ -603,6 +1089,33 @@ static void _tgentransfer_readResponse(TGenTransfer* transfer) {
         }
     }
 
+    if(transfer->framing == TGEN_FRAMING_BINARY) {
+        _tgentransfer_readBinaryCommand(transfer);
+    } else {
+        _tgentransfer_readTextCommand(transfer);
+    }
+}
+
+static void _tgentransfer_onResponseRead(TGenTransfer* transfer, gboolean hasError) {
+    /* payload phase is next unless there was an error parsing */
+    if(hasError) {
+        _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
+    } else {
+        /* we need to update our string with the new command info */
+        _tgentransfer_resetString(transfer);
+        _tgentransfer_changeState(transfer, TGEN_XFER_PAYLOAD);
+        if(transfer->state == TGEN_TYPE_PUT) {
+            transfer->events |= TGEN_EVENT_WRITE;
+        } else if (transfer->state == TGEN_TYPE_GETPUT) {
+            transfer->events |= TGEN_EVENT_WRITE;
+        } else if (transfer->state == TGEN_TYPE_SCHEDULE) {
+            transfer->events |= TGEN_EVENT_WRITE|TGEN_EVENT_READ;
+        }
+    }
+}
+
+static void _tgentransfer_readTextResponse(TGenTransfer* transfer) {
     if(_tgentransfer_getLine(transfer)) {
         /* we have read the entire command from the other end */
         gboolean hasError = FALSE;
@@ -613,11 +1126,12 @@ static void _tgentransfer_readResponse(TGenTransfer* transfer) {
 
         gchar** parts = g_strsplit(line, " ", 0);
         if(parts[0] == NULL || parts[1] == NULL) {
-            tgen_critical("error parsing command '%s'", transfer->readBuffer->str);
+            tgen_critical("error parsing response '%s'", line);
             hasError = TRUE;
         } else {
             g_assert(!transfer->remoteName);
-            transfer->remoteName = g_strdup(parts[0]);
+            transfer->remoteName = _tgentransfer_copyName(transfer->remoteNameBuffer,
+                    parts[0], strlen(parts[0]));
 
             transfer->remoteCount = (gsize)g_ascii_strtoull(parts[1], NULL, 10);
             if(transfer->remoteCount == 0) {
@@ -632,27 +1146,276 @@ static void _tgentransfer_readResponse(TGenTransfer* transfer) {
         }
         g_strfreev(parts);
 
-        /* payload phase is next unless there was an error parsing */
-        if(hasError) {
-            _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
-            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
-        } else {
-            /* we need to update our string with the new command info */
-            _tgentransfer_resetString(transfer);
-            _tgentransfer_changeState(transfer, TGEN_XFER_PAYLOAD);
-            if(transfer->state == TGEN_TYPE_PUT) {
-                transfer->events |= TGEN_EVENT_WRITE;
-            } else if (transfer->state == TGEN_TYPE_GETPUT) {
-                transfer->events |= TGEN_EVENT_WRITE;
-            } else if (transfer->state == TGEN_TYPE_SCHEDULE) {
-                transfer->events |= TGEN_EVENT_WRITE|TGEN_EVENT_READ;
-            }
-        }
+        _tgentransfer_onResponseRead(transfer, hasError);
     } else {
         /* unable to receive entire command, wait for next chance to read */
     }
 }
 
+static void _tgentransfer_readBinaryResponse(TGenTransfer* transfer) {
+    const guchar* body = NULL;
+    gsize length = 0;
+    if(!_tgentransfer_getFrame(transfer, TGEN_FRAME_RESPONSE, &body, &length)) {
+        /* unable to receive entire response, wait for next chance to read */
+        return;
+    }
+
+    gboolean hasError = FALSE;
+    transfer->time.response = g_get_monotonic_time();
+
+    TGenFrameReader reader = {body, body + length, TRUE};
+    guint64 count = _tgentransfer_readFrameVarint(&reader);
+    gsize nameLength = 0;
+    const gchar* name = _tgentransfer_readFrameBytes(&reader, &nameLength);
+
+    if(!reader.isValid) {
+        tgen_critical("error parsing binary response of %"G_GSIZE_FORMAT" bytes", length);
+        hasError = TRUE;
+    } else if(count == 0) {
+        tgen_critical("error parsing command ID 0");
+        hasError = TRUE;
+    } else {
+        g_assert(!transfer->remoteName);
+        transfer->remoteName = _tgentransfer_copyName(transfer->remoteNameBuffer, name, nameLength);
+        transfer->remoteCount = (gsize)count;
+    }
+
+    _tgentransfer_releaseFrame(transfer);
+    _tgentransfer_onResponseRead(transfer, hasError);
+}
+
+static void _tgentransfer_readResponse(TGenTransfer* transfer) {
+    TGEN_ASSERT(transfer);
+    g_assert(transfer->type != TGEN_TYPE_NONE);
+
+    if(!transfer->authComplete) {
+        _tgentransfer_authenticate(transfer);
+        if(!transfer->authComplete || !transfer->authSuccess) {
+            return;
+        }
+    }
+
+    if(transfer->framing == TGEN_FRAMING_BINARY) {
+        _tgentransfer_readBinaryResponse(transfer);
+    } else {
+        _tgentransfer_readTextResponse(transfer);
+    }
+}
+
+static gboolean _tgentransfer_hasIOBudget(TGenTransfer* transfer) {
+    return (transfer->budget.bytesLimit > 0 || transfer->budget.syscallsLimit > 0) ? TRUE : FALSE;
+}
+
+/* limits the length of the next read or write to the bytes left in the budget */
+static gsize _tgentransfer_clampToIOBudget(TGenTransfer* transfer, gsize length, guint64 bytesUsed) {
+    if(transfer->budget.bytesLimit > 0) {
+        guint64 remaining = transfer->budget.bytesLimit - MIN(bytesUsed, transfer->budget.bytesLimit);
+        length = (gsize)MIN((guint64)length, remaining);
+    }
+    return length;
+}
+
+/* charges a read or write of the given bytes to the budget of the current event, and
+ * returns TRUE if we may read or write again. without a budget we only run through the
+ * loop once in order to give other sockets a chance for i/o. */
+static gboolean _tgentransfer_chargeIOBudget(TGenTransfer* transfer, TGenEvent direction, gsize bytes) {
+    if(!_tgentransfer_hasIOBudget(transfer)) {
+        return FALSE;
+    }
+
+    guint64 bytesUsed, numCalls;
+    if(direction == TGEN_EVENT_READ) {
+        bytesUsed = (transfer->budget.bytesRead += bytes);
+        numCalls = ++transfer->budget.numReads;
+    } else {
+        bytesUsed = (transfer->budget.bytesWritten += bytes);
+        numCalls = ++transfer->budget.numWrites;
+    }
+
+    if((transfer->budget.bytesLimit > 0 && bytesUsed >= transfer->budget.bytesLimit) ||
+            (transfer->budget.syscallsLimit > 0 && numCalls >= transfer->budget.syscallsLimit)) {
+        transfer->budget.exhausted |= direction;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void _tgentransfer_updateChecksum(TGenTransfer* transfer, TGenChecksum** checksum,
+        const guchar* data, gsize length) {
+    if(transfer->checksumType == TGEN_CHECKSUM_NONE) {
+        return;
+    }
+    if(!*checksum) {
+        *checksum = tgenchecksum_new(transfer->checksumType);
+    }
+    tgenchecksum_update(*checksum, data, length);
+}
+
+/* returns NULL if we do not compute checksums */
+static TGenChecksum* _tgentransfer_getChecksum(TGenTransfer* transfer, TGenChecksum** checksum) {
+    if(transfer->checksumType == TGEN_CHECKSUM_NONE) {
+        return NULL;
+    }
+    if(!*checksum) {
+        /* we did not see any payload, but still agree on the sum of nothing */
+        *checksum = tgenchecksum_new(transfer->checksumType);
+    }
+    return *checksum;
+}
+
+/* returns NULL if we do not compute checksums */
+static const gchar* _tgentransfer_getChecksumString(TGenTransfer* transfer, TGenChecksum** checksum) {
+    TGenChecksum* sum = _tgentransfer_getChecksum(transfer, checksum);
+    return sum ? tgenchecksum_getString(sum) : NULL;
+}
+
+/* returns TRUE if the commander did not stream all of our schedule yet, and we
+ * expect its next schedule frame instead of payload */
+static gboolean _tgentransfer_schedWantsFrame(TGenTransfer* transfer) {
+    TGenTransferScheduleData* schedule = transfer->schedule;
+    return (transfer->type == TGEN_TYPE_SCHEDULE && schedule && schedule->isStreamed &&
+            schedule->scheduleReceived < schedule->scheduleLength &&
+            schedule->payloadSegment == 0) ? TRUE : FALSE;
+}
+
+/* we can only read payload up to the next schedule frame */
+static gsize _tgentransfer_schedClampToSegment(TGenTransfer* transfer, gsize length) {
+    TGenTransferScheduleData* schedule = transfer->schedule;
+    if(transfer->type == TGEN_TYPE_SCHEDULE && schedule && schedule->isStreamed &&
+            schedule->scheduleReceived < schedule->scheduleLength) {
+        return MIN(length, schedule->payloadSegment);
+    }
+    return length;
+}
+
+static void _tgentransfer_schedConsumeSegment(TGenTransfer* transfer, gsize length) {
+    TGenTransferScheduleData* schedule = transfer->schedule;
+    if(transfer->type == TGEN_TYPE_SCHEDULE && schedule && schedule->isStreamed &&
+            schedule->scheduleReceived < schedule->scheduleLength) {
+        g_assert(length <= schedule->payloadSegment);
+        schedule->payloadSegment -= length;
+    }
+}
+
+/* reads the next frame of our schedule from the commander */
+static gboolean _tgentransfer_schedReadFrame(TGenTransfer* transfer) {
+    TGenTransferScheduleData* schedule = transfer->schedule;
+
+    const guchar* body = NULL;
+    gsize length = 0;
+    if(!_tgentransfer_getFrame(transfer, TGEN_FRAME_SCHEDULE, &body, &length)) {
+        return FALSE;
+    }
+
+    /* drop the delays we already used, so we only keep what is still ahead of us */
+    if(schedule->schedIdx > 0) {
+        tgenschedule_removeFront(schedule->sched, schedule->schedIdx);
+        schedule->schedIdx = 0;
+    }
+
+    TGenFrameReader reader = {body, body + length, TRUE};
+    gsize payloadSegment = (gsize)_tgentransfer_readFrameVarint(&reader);
+
+    while(reader.isValid && reader.position < reader.end) {
+        guint64 zigzag = _tgentransfer_readFrameVarint(&reader);
+        gint64 delta = (gint64)(zigzag >> 1) ^ -(gint64)(zigzag & 1);
+        gint64 delay = (gint64)schedule->lastReceivedDelay + delta;
+
+        if(!reader.isValid || delay > INT32_MAX || delay < INT32_MIN ||
+                schedule->scheduleReceived >= schedule->scheduleLength) {
+            reader.isValid = FALSE;
+            break;
+        }
+
+        int32_t value = (int32_t)delay;
+        tgenschedule_append(schedule->sched, value);
+        schedule->lastReceivedDelay = value;
+        schedule->scheduleReceived++;
+    }
+
+    _tgentransfer_releaseFrame(transfer);
+
+    if(!reader.isValid) {
+        _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_READ);
+        tgen_critical("error parsing schedule frame of %"G_GSIZE_FORMAT" bytes", length);
+        return FALSE;
+    }
+
+    schedule->payloadSegment = payloadSegment;
+
+    /* our writer may be waiting for these delays */
+    if(!schedule->doneWritingPayload && !schedule->timerSet) {
+        transfer->events |= TGEN_EVENT_WRITE;
+    }
+
+    return TRUE;
+}
+
+static gsize _tgentransfer_getRemainingPayloadReadBytes(TGenTransfer* transfer) {
+    if (transfer->type == TGEN_TYPE_GET) {
+        return transfer->size - transfer->bytes.payloadRead;
+    } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
+        return transfer->getput->theirSize - transfer->bytes.payloadRead;
+    } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
+        return transfer->schedule->expectedReceiveBytes - transfer->bytes.payloadRead;
+    } else {
+        g_assert_not_reached();
+        return 0;
+    }
+}
+
+static gboolean _tgentransfer_canDiscardPayload(TGenTransfer* transfer) {
+    return (transfer->checksumType == TGEN_CHECKSUM_NONE && !transfer->payloadDiscardFailed) ? TRUE : FALSE;
+}
+
+/* while we discard payload, we let the socket wake us up only once a good
+ * amount of it arrived, but never for more than the payload we still expect,
+ * since the other end waits for us after that. we wait for the first payload
+ * byte as usual so that it is timed and reported when it arrives, and then
+ * never wait for more bytes than we have seen so far, or than arrive in a
+ * fraction of the stallout at the rate we measured, since reads are what
+ * tell us that the transfer is not stalled. */
+static void _tgentransfer_updateReceiveLowWatermark(TGenTransfer* transfer) {
+    gint numBytes = 1;
+    if(transfer->state == TGEN_XFER_PAYLOAD && _tgentransfer_canDiscardPayload(transfer) &&
+            transfer->bytes.payloadRead > 0) {
+        gsize remaining = _tgentransfer_schedClampToSegment(transfer,
+                _tgentransfer_getRemainingPayloadReadBytes(transfer));
+
+        /* counting from the start of the transfer underestimates the rate,
+         * which only makes us wake up sooner */
+        gint64 elapsed = MAX(g_get_monotonic_time() - transfer->time.start, 1);
+        gdouble bytesPerUSec = ((gdouble)transfer->bytes.payloadRead) / ((gdouble)elapsed);
+        gsize expected = (gsize)(bytesPerUSec *
+                (gdouble)(transfer->stalloutUSecs / DEFAULT_XFER_RCVLOWAT_STALLOUT_FRACTION));
+
+        gsize limit = MIN(MIN(DEFAULT_XFER_RCVLOWAT, remaining),
+                MIN(expected, transfer->bytes.payloadRead));
+
+        /* round down to a power of two so we rarely need to change it */
+        numBytes = 1;
+        while(limit >= 2 && (gsize)numBytes <= limit / 2) {
+            numBytes *= 2;
+        }
+
+        /* but never leave the last few bytes waiting behind the watermark */
+        if(remaining > 0 && remaining <= (gsize)DEFAULT_XFER_RCVLOWAT && limit == remaining) {
+            numBytes = (gint)remaining;
+        }
+    }
+
+    if(numBytes != transfer->receiveLowWatermark) {
+        if(tgentransport_setReceiveLowWatermark(transfer->transport, numBytes)) {
+            transfer->receiveLowWatermark = numBytes;
+        } else if(numBytes > 1) {
+            /* keep waking up for every byte, like before */
+            transfer->payloadDiscardFailed = TRUE;
+        }
+    }
+}
+
 static void _tgentransfer_readPayload(TGenTransfer* transfer) {
     TGEN_ASSERT(transfer);
     g_assert(transfer->type == TGEN_TYPE_GET
@@ -661,22 +1424,41 @@ static void _tgentransfer_readPayload(TGenTransfer* transfer) {
 
     guchar buffer[DEFAULT_XFER_READ_BUFLEN];
 
-    /* we only run through the read loop once in order to give other sockets a chance for i/o */
-    if(TRUE) {
-        gsize length;
-        if (transfer->type == TGEN_TYPE_GET) {
-            length = MIN(DEFAULT_XFER_READ_BUFLEN, (transfer->size - transfer->bytes.payloadRead));
-        } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
-            length = MIN(DEFAULT_XFER_READ_BUFLEN, (transfer->getput->theirSize - transfer->bytes.payloadRead));
-        } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
-            length = MIN(DEFAULT_XFER_READ_BUFLEN, (transfer->schedule->expectedReceiveBytes - transfer->bytes.payloadRead));
-        } else {
-            g_assert_not_reached();
+    /* with an io budget, we drain the socket until EAGAIN or the budget runs out */
+    while(TRUE) {
+        if(_tgentransfer_schedWantsFrame(transfer)) {
+            /* the commander's schedule frames sit between its payload bursts */
+            if(_tgentransfer_schedReadFrame(transfer)) {
+                continue;
+            }
+            _tgentransfer_updateReceiveLowWatermark(transfer);
+            break;
         }
 
-        if(length > 0) {
+        gsize remaining = _tgentransfer_schedClampToSegment(transfer,
+                _tgentransfer_getRemainingPayloadReadBytes(transfer));
+
+        if(remaining > 0) {
             /* we need to read more payload */
-            gssize bytes = tgentransport_read(transfer->transport, buffer, length);
+            /* payload may have arrived along with the response line */
+            gboolean wasBuffered = _tgentransfer_getBufferedLength(transfer) > 0 ? TRUE : FALSE;
+            gssize bytes;
+
+            if(!wasBuffered && _tgentransfer_canDiscardPayload(transfer)) {
+                /* the kernel drops the bytes, so we are not limited by our buffer */
+                gsize length = _tgentransfer_clampToIOBudget(transfer, remaining, transfer->budget.bytesRead);
+                bytes = tgentransport_discard(transfer->transport, length);
+                if(bytes < 0 && errno == EOPNOTSUPP) {
+                    transfer->payloadDiscardFailed = TRUE;
+                    continue;
+                } else if(bytes > 0) {
+                    transfer->bytes.totalRead += bytes;
+                }
+            } else {
+                gsize length = MIN(DEFAULT_XFER_READ_BUFLEN, remaining);
+                length = _tgentransfer_clampToIOBudget(transfer, length, transfer->budget.bytesRead);
+                bytes = _tgentransfer_read(transfer, buffer, length);
+            }
 
             if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
                 _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
@@ -695,15 +1477,13 @@ static void _tgentransfer_readPayload(TGenTransfer* transfer) {
                 }
 
                 transfer->bytes.payloadRead += bytes;
-                transfer->bytes.totalRead += bytes;
-                if (transfer->type == TGEN_TYPE_GET) {
-                    g_checksum_update(transfer->payloadChecksum, buffer, bytes);
-                } else if (transfer->type == TGEN_TYPE_GETPUT) {
-                    g_checksum_update(transfer->getput->theirPayloadChecksum, buffer, bytes);
-                } else if (transfer->type == TGEN_TYPE_SCHEDULE) {
-                    g_checksum_update(transfer->schedule->theirPayloadChecksum, buffer, bytes);
-                } else {
-                    g_assert_not_reached();
+                _tgentransfer_schedConsumeSegment(transfer, (gsize)bytes);
+                _tgentransfer_updateChecksum(transfer, &transfer->theirPayloadChecksum,
+                        (const guchar*)buffer, (gsize)bytes);
+
+                /* the socket will not wake us up for bytes we already buffered */
+                if(wasBuffered || _tgentransfer_chargeIOBudget(transfer, TGEN_EVENT_READ, (gsize)bytes)) {
+                    continue;
                 }
             }
         } else {
@@ -729,73 +1509,131 @@ static void _tgentransfer_readPayload(TGenTransfer* transfer) {
                 g_assert_not_reached();
             }
         }
+
+        _tgentransfer_updateReceiveLowWatermark(transfer);
+        break;
     }
 }
 
-static void _tgentransfer_readChecksum(TGenTransfer* transfer) {
-    TGEN_ASSERT(transfer);
-    g_assert(transfer->type == TGEN_TYPE_GET
-            || transfer->type == TGEN_TYPE_GETPUT
-            || transfer->type == TGEN_TYPE_SCHEDULE);
+static void _tgentransfer_verifyTextChecksum(TGenTransfer* transfer) {
+    const gchar* checksumName = tgenchecksum_typeToString(transfer->checksumType);
+    const gchar* computedSum = _tgentransfer_getChecksumString(transfer,
+            &transfer->theirPayloadChecksum);
 
-    if(_tgentransfer_getLine(transfer)) {
-        if (transfer->type == TGEN_TYPE_GET) {
-            /* transfer is done */
-            _tgentransfer_changeState(transfer, TGEN_XFER_SUCCESS);
-            transfer->time.checksum = g_get_monotonic_time();
-        } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
-            transfer->getput->receivedTheirChecksum = TRUE;
-            if (transfer->getput->sentOurChecksum) {
-                _tgentransfer_changeState(transfer, TGEN_XFER_SUCCESS);
-                transfer->time.checksum = g_get_monotonic_time();
-            }
-        } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
-            transfer->schedule->receivedTheirChecksum = TRUE;
-            if (transfer->schedule->sentOurChecksum) {
-                _tgentransfer_changeState(transfer, TGEN_XFER_SUCCESS);
-                transfer->time.checksum = g_get_monotonic_time();
-            }
-        } else {
-            g_assert_not_reached();
-        }
+    gchar* line = g_string_free(transfer->readBuffer, FALSE);
+    transfer->readBuffer = NULL;
 
-        /* we have read the entire checksum from the other end */
-        gssize sha1Length = g_checksum_type_get_length(G_CHECKSUM_MD5);
-        g_assert(sha1Length >= 0);
-        gchar* computedSum = NULL;
-        if (transfer->type == TGEN_TYPE_GET) {
-            computedSum = g_strdup(g_checksum_get_string(transfer->payloadChecksum));
-        } else if (transfer->type == TGEN_TYPE_GETPUT) {
-            computedSum = g_strdup(g_checksum_get_string(transfer->getput->theirPayloadChecksum));
-        } else if (transfer->type == TGEN_TYPE_SCHEDULE) {
-            computedSum = g_strdup(g_checksum_get_string(transfer->schedule->theirPayloadChecksum));
-        } else {
-            g_assert_not_reached();
-        }
-        g_assert(computedSum);
+    gchar** parts = g_strsplit(line, " ", 0);
+    const gchar* receivedName = parts[0];
+    const gchar* receivedSum = receivedName ? parts[1] : NULL;
+
+    /* check that the sums match */
+    if(!computedSum) {
+        tgen_debug("transport %s transfer %s has no checksum to verify",
+                tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer));
+    } else if(!receivedName || g_ascii_strcasecmp(receivedName, checksumName)) {
+        tgen_message("%s checksums failed: received a %s checksum", checksumName,
+                receivedName ? receivedName : "NULL");
+    } else if(receivedSum && !g_ascii_strcasecmp(computedSum, receivedSum)) {
+        tgen_message("transport %s transfer %s %s checksums passed: computed=%s received=%s",
+                tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer),
+                checksumName, computedSum, receivedSum);
+    } else if (receivedSum) {
+        tgen_message("%s checksums failed: computed=%s received=%s", checksumName,
+                computedSum, receivedSum);
+    } else {
+        tgen_message("%s checksums failed: received sum is NULL", checksumName);
+    }
+
+    g_strfreev(parts);
+    g_free(line);
+}
+
+static void _tgentransfer_verifyBinaryChecksum(TGenTransfer* transfer,
+        const guchar* body, gsize length) {
+    const gchar* checksumName = tgenchecksum_typeToString(transfer->checksumType);
+    TGenChecksum* checksum = _tgentransfer_getChecksum(transfer, &transfer->theirPayloadChecksum);
+
+    TGenFrameReader reader = {body, body + length, TRUE};
+    TGenChecksumType receivedType = (TGenChecksumType)_tgentransfer_readFrameByte(&reader);
+    gsize receivedLength = 0;
+    const gchar* receivedDigest = _tgentransfer_readFrameBytes(&reader, &receivedLength);
+
+    if(!checksum) {
+        tgen_debug("transport %s transfer %s has no checksum to verify",
+                tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer));
+        return;
+    } else if(!reader.isValid) {
+        tgen_message("%s checksums failed: received a malformed checksum", checksumName);
+        return;
+    } else if(receivedType != transfer->checksumType) {
+        tgen_message("%s checksums failed: received a %s checksum", checksumName,
+                tgenchecksum_typeToString(receivedType));
+        return;
+    }
+
+    gsize computedLength = 0;
+    const guint8* computedDigest = tgenchecksum_getDigest(checksum, &computedLength);
+
+    gchar computedSum[2*TGEN_CHECKSUM_MAX_DIGEST_LENGTH + 1];
+    gchar receivedSum[2*TGEN_CHECKSUM_MAX_DIGEST_LENGTH + 1];
+    tgenchecksum_digestToString(computedDigest, computedLength, computedSum, sizeof(computedSum));
+    tgenchecksum_digestToString((const guint8*)receivedDigest, receivedLength,
+            receivedSum, sizeof(receivedSum));
+
+    if(receivedLength == computedLength && !memcmp(computedDigest, receivedDigest, computedLength)) {
+        tgen_message("transport %s transfer %s %s checksums passed: computed=%s received=%s",
+                tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer),
+                checksumName, computedSum, receivedSum);
+    } else {
+        tgen_message("%s checksums failed: computed=%s received=%s", checksumName,
+                computedSum, receivedSum);
+    }
+}
 
-        gchar* line = g_string_free(transfer->readBuffer, FALSE);
-        transfer->readBuffer = NULL;
+static void _tgentransfer_readChecksum(TGenTransfer* transfer) {
+    TGEN_ASSERT(transfer);
+    g_assert(transfer->type == TGEN_TYPE_GET
+            || transfer->type == TGEN_TYPE_GETPUT
+            || transfer->type == TGEN_TYPE_SCHEDULE);
 
-        gchar** parts = g_strsplit(line, " ", 0);
-        const gchar* receivedSum = parts[1];
+    const guchar* body = NULL;
+    gsize length = 0;
+    gboolean isComplete = (transfer->framing == TGEN_FRAMING_BINARY) ?
+            _tgentransfer_getFrame(transfer, TGEN_FRAME_CHECKSUM, &body, &length) :
+            _tgentransfer_getLine(transfer);
 
-        /* check that the sums match */
-        if(receivedSum && !g_ascii_strncasecmp(computedSum, receivedSum, (gsize)sha1Length)) {
-            tgen_message("transport %s transfer %s MD5 checksums passed: computed=%s received=%s",
-                    tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer),
-                    computedSum, receivedSum);
-        } else if (receivedSum) {
-            tgen_message("MD5 checksums failed: computed=%s received=%s", computedSum, receivedSum);
-        } else {
-            tgen_message("MD5 checksums failed: received sum is NULL");
+    if(!isComplete) {
+        /* unable to receive entire checksum, wait for next chance to read */
+        return;
+    }
+
+    if (transfer->type == TGEN_TYPE_GET) {
+        /* transfer is done */
+        _tgentransfer_changeState(transfer, TGEN_XFER_SUCCESS);
+        transfer->time.checksum = g_get_monotonic_time();
+    } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
+        transfer->getput->receivedTheirChecksum = TRUE;
+        if (transfer->getput->sentOurChecksum) {
+            _tgentransfer_changeState(transfer, TGEN_XFER_SUCCESS);
+            transfer->time.checksum = g_get_monotonic_time();
+        }
+    } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
+        transfer->schedule->receivedTheirChecksum = TRUE;
+        if (transfer->schedule->sentOurChecksum) {
+            _tgentransfer_changeState(transfer, TGEN_XFER_SUCCESS);
+            transfer->time.checksum = g_get_monotonic_time();
         }
+    } else {
+        g_assert_not_reached();
+    }
 
-        g_strfreev(parts);
-        g_free(line);
-        g_free(computedSum);
+    /* we have read the entire checksum from the other end */
+    if(transfer->framing == TGEN_FRAMING_BINARY) {
+        _tgentransfer_verifyBinaryChecksum(transfer, body, length);
+        _tgentransfer_releaseFrame(transfer);
     } else {
-        /* unable to receive entire checksum, wait for next chance to read */
+        _tgentransfer_verifyTextChecksum(transfer);
     }
 }
 
@@ -882,20 +1720,8 @@ static void _tgentransfer_onReadable(TGenTransfer* transfer) {
             _tgentransfer_toString(transfer), totalBytes);
 
     if(totalBytes > 0) {
-        transfer->time.lastProgress = g_get_monotonic_time();
-    }
-}
-
-static GString* _tgentransfer_getRandomString(gsize size) {
-    /* call rand() once to limit overhead */
-    gint r = rand() % 26;
-    gchar c = (gchar)('a' + r);
-    /* fill the buffer. this was more efficient than malloc/memset and then g_string_new  */
-    GString* buffer = g_string_new_len(NULL, (gssize)size);
-    for(gint i = 0; i < size; i++) {
-        g_string_append_c(buffer, c);
+        _tgentransfer_onProgress(transfer);
     }
-    return buffer;
 }
 
 static gsize _tgentransfer_flushOut(TGenTransfer* transfer) {
@@ -922,7 +1748,7 @@ static gsize _tgentransfer_flushOut(TGenTransfer* transfer) {
                 tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer));
     } else if(bytes > 0) {
         transfer->writeBufferOffset += bytes;
-        if(transfer->writeBufferOffset >= (transfer->writeBuffer->len - 1)) {
+        if(transfer->writeBufferOffset >= transfer->writeBuffer->len) {
             transfer->writeBufferOffset = 0;
             g_string_free(transfer->writeBuffer, TRUE);
             transfer->writeBuffer = NULL;
@@ -934,6 +1760,229 @@ static gsize _tgentransfer_flushOut(TGenTransfer* transfer) {
     return 0;
 }
 
+/* writes the pending payload straight from the payload pool until it is all
+ * written or the socket is full, and returns the number of bytes written */
+static gsize _tgentransfer_flushPayload(TGenTransfer* transfer) {
+    TGEN_ASSERT(transfer);
+
+    gsize totalBytes = 0;
+
+    while(transfer->payloadPending > 0) {
+        gsize length = MIN(transfer->payloadPending, TGEN_PAYLOAD_MAX_CHUNK);
+        const gchar* position = tgenpayload_getBytes(transfer->payloadContent,
+                transfer->payloadOffset, length);
+        gssize bytes;
+
+        if(transfer->payloadZeroCopy) {
+            /* the kernel reads the same bytes from the payload file */
+            gint fileD = tgenpayload_getDescriptor(transfer->payloadContent);
+            bytes = (fileD >= 0) ? tgentransport_sendfile(transfer->transport, fileD,
+                    transfer->payloadOffset, length) : -1;
+
+            if(fileD < 0 || (bytes < 0 && (errno == EINVAL || errno == ENOSYS))) {
+                tgen_info("transfer %s is unable to send payload without copying, "
+                        "falling back to write()", _tgentransfer_toString(transfer));
+                transfer->payloadZeroCopy = FALSE;
+                bytes = tgentransport_write(transfer->transport, (gpointer)position, length);
+            }
+        } else {
+            bytes = tgentransport_write(transfer->transport, (gpointer)position, length);
+        }
+
+        if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_WRITE);
+            tgen_critical("write(): transport %s transfer %s error %i: %s",
+                    tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer),
+                    errno, g_strerror(errno));
+            break;
+        } else if(bytes == 0) {
+            _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_WRITE);
+            tgen_critical("write(): transport %s transfer %s closed unexpectedly",
+                    tgentransport_toString(transfer->transport), _tgentransfer_toString(transfer));
+            break;
+        } else if(bytes < 0) {
+            /* the socket is full, we will write the rest later */
+            break;
+        }
+
+        /* we sum exactly the bytes that made it out */
+        _tgentransfer_updateChecksum(transfer, &transfer->ourPayloadChecksum,
+                (const guchar*)position, (gsize)bytes);
+
+        transfer->payloadOffset = (transfer->payloadOffset + (gsize)bytes) % tgenpayload_getPeriod();
+        transfer->payloadPending -= (gsize)bytes;
+        transfer->bytes.totalWrite += bytes;
+        totalBytes += (gsize)bytes;
+
+        if((gsize)bytes < length) {
+            /* the socket is full */
+            break;
+        }
+    }
+
+    return totalBytes;
+}
+
+/* appends schedule frames for the other side until it knows its delays far enough
+ * past the given pause, or its whole schedule. while it does not have the whole
+ * schedule, the other side expects a frame between each of our payload bursts,
+ * so we always append at least one frame. the last frame tells the other side
+ * how many payload bytes we write before the next frame. */
+static void _tgentransfer_schedQueueTheirSchedule(TGenTransfer* transfer,
+        gint64 pauseMicros, gsize payloadLength) {
+    TGenTransferScheduleData* schedule = transfer->schedule;
+    if(!schedule->isSendingTheirSchedule) {
+        /* we are not streaming, or already sent it all */
+        return;
+    }
+
+    if(!transfer->writeBuffer) {
+        transfer->writeBuffer = g_string_new(NULL);
+    }
+
+    gint64 horizon = (g_get_monotonic_time() - schedule->theirScheduleStart) +
+            pauseMicros + TGEN_SCHEDULE_HORIZON_USEC;
+    gboolean isLastFrame = FALSE;
+
+    while(!isLastFrame) {
+        /* a zigzag varint of a 32-bit delta takes at most 5 bytes */
+        gchar encoded[TGEN_SCHEDULE_FRAME_DELAYS*5];
+        gsize encodedLength = 0;
+
+        for(guint i = 0; i < TGEN_SCHEDULE_FRAME_DELAYS &&
+                schedule->theirScheduleSent < schedule->theirScheduleLength &&
+                schedule->theirScheduleSentMicros < horizon; i++) {
+            int32_t delay = tgenschedule_getDelay(schedule->theirSchedule,
+                    schedule->theirScheduleIdx++);
+
+            /* consecutive delays are similar, so their differences are short */
+            gint64 delta = (gint64)delay - (gint64)schedule->theirLastDelay;
+            guint64 zigzag = ((guint64)delta << 1) ^ (guint64)(delta >> 63);
+            encodedLength += _tgentransfer_encodeVarint(zigzag, &encoded[encodedLength]);
+
+            schedule->theirLastDelay = delay;
+            schedule->theirScheduleSentMicros += MAX(delay, 0);
+            if(++schedule->theirScheduleSent >= schedule->theirScheduleLength) {
+                break;
+            }
+        }
+
+        isLastFrame = (schedule->theirScheduleSent >= schedule->theirScheduleLength ||
+                schedule->theirScheduleSentMicros >= horizon) ? TRUE : FALSE;
+
+        gsize frameOffset = _tgentransfer_beginFrame(transfer->writeBuffer, TGEN_FRAME_SCHEDULE);
+        _tgentransfer_appendVarint(transfer->writeBuffer, isLastFrame ? payloadLength : 0);
+        g_string_append_len(transfer->writeBuffer, encoded, encodedLength);
+        _tgentransfer_endFrame(transfer->writeBuffer, frameOffset);
+    }
+
+    /* a generated schedule is ours alone, so we free the windows we framed.
+     * the schedule of a transfer action stays with the action. */
+    if(!tgenschedule_isShared(schedule->theirSchedule)) {
+        tgenschedule_removeFront(schedule->theirSchedule, schedule->theirScheduleIdx);
+        schedule->theirScheduleIdx = 0;
+    }
+
+    if(schedule->theirScheduleSent >= schedule->theirScheduleLength) {
+        tgen_debug("sent all %"G_GSIZE_FORMAT" delays of their schedule", schedule->theirScheduleLength);
+        schedule->isSendingTheirSchedule = FALSE;
+        tgenschedule_unref(schedule->theirSchedule);
+        schedule->theirSchedule = NULL;
+    }
+}
+
+/* returns TRUE if we still have to stream their schedule to them */
+static gboolean _tgentransfer_schedIsSendingTheirSchedule(TGenTransfer* transfer) {
+    return (transfer->schedule && transfer->schedule->isSendingTheirSchedule) ? TRUE : FALSE;
+}
+
+/* returns TRUE if we have more delays to follow, even if they did not arrive yet */
+static gboolean _tgentransfer_schedHasMoreDelays(TGenTransfer* transfer) {
+    TGenTransferScheduleData* schedule = transfer->schedule;
+    return (schedule->schedIdx < tgenschedule_getLength(schedule->sched) ||
+            (schedule->isStreamed && schedule->scheduleReceived < schedule->scheduleLength)) ?
+            TRUE : FALSE;
+}
+
+/* returns TRUE if we used all the delays we got, and wait for the commander's next frame */
+static gboolean _tgentransfer_schedIsStarved(TGenTransfer* transfer) {
+    TGenTransferScheduleData* schedule = transfer->schedule;
+    return (schedule->isStreamed && schedule->schedIdx >= tgenschedule_getLength(schedule->sched) &&
+            schedule->scheduleReceived < schedule->scheduleLength) ? TRUE : FALSE;
+}
+
+static void _tgentransfer_bufferTextCommand(TGenTransfer* transfer) {
+    g_string_printf(transfer->writeBuffer, "%s%c%s %s %"G_GSIZE_FORMAT" %s ",
+            TGEN_AUTH_PW, TGEN_AUTH_VERSION_TEXT, transfer->hostname, transfer->id,
+            transfer->count, _tgentransfer_typeToString(transfer));
+    if (transfer->type == TGEN_TYPE_GET || transfer->type == TGEN_TYPE_PUT) {
+        g_string_append_printf(transfer->writeBuffer,"%"G_GSIZE_FORMAT,
+            transfer->size);
+    } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
+        g_string_append_printf(transfer->writeBuffer,
+            "%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT,
+            transfer->getput->ourSize, transfer->getput->theirSize);
+    } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
+        /* send the other side's schedule over in the command, which is the
+         * only place where we still need it as text */
+        gchar* theirScheduleStr = transfer->schedule->theirSchedule ?
+                tgenschedule_toString(transfer->schedule->theirSchedule) : NULL;
+        g_string_append_printf(transfer->writeBuffer, "%"G_GSIZE_FORMAT"|%s",
+                transfer->schedule->scheduleSize, theirScheduleStr ? theirScheduleStr : "");
+        g_free(theirScheduleStr);
+
+        /* we don't need their schedule anymore */
+        if(transfer->schedule->theirSchedule) {
+            tgenschedule_unref(transfer->schedule->theirSchedule);
+            transfer->schedule->theirSchedule = NULL;
+        }
+    } else {
+        g_assert_not_reached();
+    }
+    g_string_append_printf(transfer->writeBuffer, " %s\n",
+            tgenchecksum_typeToString(transfer->checksumType));
+}
+
+static void _tgentransfer_bufferBinaryCommand(TGenTransfer* transfer) {
+    GString* buffer = transfer->writeBuffer;
+
+    g_string_append(buffer, TGEN_AUTH_PW);
+    g_string_append_c(buffer, TGEN_AUTH_VERSION_BINARY);
+
+    gsize frameOffset = _tgentransfer_beginFrame(buffer, TGEN_FRAME_COMMAND);
+    g_string_append_c(buffer, (gchar)transfer->type);
+    g_string_append_c(buffer, (gchar)transfer->checksumType);
+    _tgentransfer_appendVarint(buffer, transfer->count);
+    _tgentransfer_appendBytes(buffer, transfer->hostname,
+            transfer->hostname ? strlen(transfer->hostname) : 0);
+    _tgentransfer_appendBytes(buffer, transfer->id, transfer->id ? strlen(transfer->id) : 0);
+
+    if (transfer->type == TGEN_TYPE_GET || transfer->type == TGEN_TYPE_PUT) {
+        _tgentransfer_appendVarint(buffer, transfer->size);
+    } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
+        _tgentransfer_appendVarint(buffer, transfer->getput->ourSize);
+        _tgentransfer_appendVarint(buffer, transfer->getput->theirSize);
+    } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
+        /* the other side's schedule follows the command in frames of its own */
+        _tgentransfer_appendVarint(buffer, transfer->schedule->scheduleSize);
+        _tgentransfer_appendVarint(buffer, transfer->schedule->theirScheduleLength);
+    } else {
+        g_assert_not_reached();
+    }
+
+    _tgentransfer_endFrame(buffer, frameOffset);
+
+    if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule
+            && transfer->schedule->theirSchedule) {
+        /* send the start of their schedule right away, so they can start sending */
+        transfer->schedule->isSendingTheirSchedule = TRUE;
+        transfer->schedule->theirScheduleStart = g_get_monotonic_time();
+        _tgentransfer_schedQueueTheirSchedule(transfer, 0, 0);
+    }
+}
+
 static void _tgentransfer_writeCommand(TGenTransfer* transfer) {
     TGEN_ASSERT(transfer);
     g_assert(transfer->type != TGEN_TYPE_NONE);
@@ -941,28 +1990,11 @@ static void _tgentransfer_writeCommand(TGenTransfer* transfer) {
     /* buffer the command if we have not done that yet */
     if(!transfer->writeBuffer) {
         transfer->writeBuffer = g_string_new(NULL);
-        g_string_printf(transfer->writeBuffer, "%s %s %s %"G_GSIZE_FORMAT" %s ",
-                TGEN_AUTH_PW, transfer->hostname, transfer->id, transfer->count,
-                _tgentransfer_typeToString(transfer));
-        if (transfer->type == TGEN_TYPE_GET || transfer->type == TGEN_TYPE_PUT) {
-            g_string_append_printf(transfer->writeBuffer,"%"G_GSIZE_FORMAT,
-                transfer->size);
-        } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
-            g_string_append_printf(transfer->writeBuffer,
-                "%"G_GSIZE_FORMAT",%"G_GSIZE_FORMAT,
-                transfer->getput->ourSize, transfer->getput->theirSize);
-        } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
-            /* send the other side's schedule over in the command */
-            g_string_append_printf(transfer->writeBuffer, "%"G_GSIZE_FORMAT"|%s",
-                    transfer->schedule->scheduleSize, transfer->schedule->theirSchedule);
-
-            /* we don't need their schedule string anymore */
-            g_free(transfer->schedule->theirSchedule);
-            transfer->schedule->theirSchedule = NULL;
+        if(transfer->framing == TGEN_FRAMING_BINARY) {
+            _tgentransfer_bufferBinaryCommand(transfer);
         } else {
-            g_assert_not_reached();
+            _tgentransfer_bufferTextCommand(transfer);
         }
-        g_string_append_printf(transfer->writeBuffer, "\n");
     }
 
     _tgentransfer_flushOut(transfer);
@@ -984,8 +2016,20 @@ static void _tgentransfer_writeResponse(TGenTransfer* transfer) {
     /* buffer the command if we have not done that yet */
     if(!transfer->writeBuffer) {
         transfer->writeBuffer = g_string_new(NULL);
-        g_string_printf(transfer->writeBuffer, "%s %s %"G_GSIZE_FORMAT"\n",
-                TGEN_AUTH_PW, transfer->hostname, transfer->count);
+        if(transfer->framing == TGEN_FRAMING_BINARY) {
+            GString* buffer = transfer->writeBuffer;
+            g_string_append(buffer, TGEN_AUTH_PW);
+            g_string_append_c(buffer, TGEN_AUTH_VERSION_BINARY);
+
+            gsize frameOffset = _tgentransfer_beginFrame(buffer, TGEN_FRAME_RESPONSE);
+            _tgentransfer_appendVarint(buffer, transfer->count);
+            _tgentransfer_appendBytes(buffer, transfer->hostname,
+                    transfer->hostname ? strlen(transfer->hostname) : 0);
+            _tgentransfer_endFrame(buffer, frameOffset);
+        } else {
+            g_string_printf(transfer->writeBuffer, "%s%c%s %"G_GSIZE_FORMAT"\n",
+                    TGEN_AUTH_PW, TGEN_AUTH_VERSION_TEXT, transfer->hostname, transfer->count);
+        }
     }
 
     _tgentransfer_flushOut(transfer);
@@ -1006,10 +2050,14 @@ static void _tgentransfer_writePayload(TGenTransfer* transfer) {
     gboolean firstByte = transfer->bytes.payloadWrite == 0 ? TRUE : FALSE;
 
     /* try to flush any leftover bytes */
-    transfer->bytes.payloadWrite += _tgentransfer_flushOut(transfer);
+    gsize leftoverBytes = _tgentransfer_flushPayload(transfer);
+    transfer->bytes.payloadWrite += leftoverBytes;
+    if(leftoverBytes > 0) {
+        _tgentransfer_chargeIOBudget(transfer, TGEN_EVENT_WRITE, leftoverBytes);
+    }
 
-    /* we only run through the write loop once in order to give other sockets a chance for i/o */
-    if (!transfer->writeBuffer) {
+    /* with an io budget, we keep writing until EAGAIN or the budget runs out */
+    while (transfer->payloadPending == 0 && !(transfer->budget.exhausted & TGEN_EVENT_WRITE)) {
         gsize length;
         if (transfer->type == TGEN_TYPE_PUT) {
             length = MIN(DEFAULT_XFER_WRITE_BUFLEN, (transfer->size - transfer->bytes.payloadWrite));
@@ -1019,24 +2067,20 @@ static void _tgentransfer_writePayload(TGenTransfer* transfer) {
 
         if(length > 0) {
             /* we need to send more payload */
-            transfer->writeBuffer = _tgentransfer_getRandomString(length);
-            if (transfer->type == TGEN_TYPE_PUT) {
-                g_checksum_update(transfer->payloadChecksum, (guchar*)transfer->writeBuffer->str,
-                        (gssize)transfer->writeBuffer->len);
-            } else if (transfer->type == TGEN_TYPE_GETPUT) {
-                g_checksum_update(transfer->getput->ourPayloadChecksum,
-                        (guchar*)transfer->writeBuffer->str,
-                        (gssize)transfer->writeBuffer->len);
-            } else {
-                g_assert_not_reached();
-            }
+            length = _tgentransfer_clampToIOBudget(transfer, length, transfer->budget.bytesWritten);
+            transfer->payloadPending = length;
 
-            transfer->bytes.payloadWrite += _tgentransfer_flushOut(transfer);
+            gsize bytes = _tgentransfer_flushPayload(transfer);
+            transfer->bytes.payloadWrite += bytes;
 
             if(firstByte && transfer->bytes.payloadWrite > 0) {
                 firstByte = FALSE;
                 transfer->time.firstPayloadByte = g_get_monotonic_time();
             }
+
+            if(!_tgentransfer_chargeIOBudget(transfer, TGEN_EVENT_WRITE, bytes)) {
+                break;
+            }
         } else {
             if (transfer->type == TGEN_TYPE_PUT) {
                 /* payload done, send the checksum next */
@@ -1052,6 +2096,7 @@ static void _tgentransfer_writePayload(TGenTransfer* transfer) {
             } else {
                 g_assert_not_reached();
             }
+            break;
         }
     }
 }
@@ -1062,7 +2107,7 @@ _tgentransfer_getputWantsWriteEvents(TGenTransfer *transfer) {
 
     if (transfer->type != TGEN_TYPE_GETPUT) {
         return FALSE;
-    } else if (transfer->writeBuffer) {
+    } else if (transfer->writeBuffer || transfer->payloadPending > 0) {
         return TRUE;
     } else if (transfer->state == TGEN_XFER_COMMAND) {
         return TRUE;
@@ -1079,13 +2124,14 @@ _tgentransfer_schedWantsWriteEvents(TGenTransfer *transfer) {
 
     if (transfer->type != TGEN_TYPE_SCHEDULE) {
         return FALSE;
-    } else if (transfer->writeBuffer) {
+    } else if (transfer->writeBuffer || transfer->payloadPending > 0) {
         return TRUE;
     } else if (transfer->state == TGEN_XFER_COMMAND) {
         return TRUE;
     } else if (!transfer->schedule->doneWritingPayload
             && transfer->state == TGEN_XFER_PAYLOAD
-            && !transfer->schedule->timerSet) {
+            && !transfer->schedule->timerSet
+            && !_tgentransfer_schedIsStarved(transfer)) {
         return TRUE;
     } else if (!transfer->schedule->sentOurChecksum && transfer->state == TGEN_XFER_CHECKSUM) {
         return TRUE;
@@ -1115,11 +2161,12 @@ static gboolean _tgentransfer_schedOnTimerExpired(gpointer data1, gpointer data2
             schedEvents |= TGEN_EVENT_READ;
         }
         if(schedEvents > 0) {
-            tgenio_setEvents(transfer->io, tgentransport_getDescriptor(transfer->transport), schedEvents);
+            /* this does nothing if our descriptor was deregistered while we paused */
+            tgenio_setEvents(transfer->io, transfer->schedule->ioHandle, schedEvents);
         }
     }
 
-    /* Return TRUE to cancel future callbacks of this function from tgentimer_onEvent.
+    /* Return TRUE to cancel future callbacks of this function from the timer wheel.
      * The timer is already not persistent, and returning TRUE makes this explicit.
      * Once we return TRUE, the timer is disarmed and de-registered from the io
      * module so we won't pay attention to any future timer events.
@@ -1136,9 +2183,9 @@ static void _tgentransfer_schedTimerCancel(TGenTransfer *transfer) {
     }
 
     /* first tell the io module to stop paying attention to the timer. after this call
-     * if the timer fires (becomes readable) we won't notice. this will call the
-     * tgentimer_unref destructor that we passed in tgenio_register.*/
-    tgenio_deregister(transfer->io, tgentimer_getDescriptor(transfer->schedule->timer));
+     * if the timer expires we won't notice. this drops the timer reference that
+     * we passed in tgenio_registerTimer.*/
+    tgenio_deregisterTimer(transfer->io, transfer->schedule->timer);
 
     /* then tell the timer that we don't want it to fire anymore */
     tgentimer_cancel(transfer->schedule->timer);
@@ -1162,6 +2209,9 @@ static void _tgentransfer_schedPause(TGenTransfer *transfer, int32_t micros)
 
     guint64 microsecondsPause = (guint64)micros;
 
+    transfer->schedule->ioHandle = tgenio_getHandle(transfer->io,
+            tgentransport_getDescriptor(transfer->transport));
+
     if (!transfer->schedule->timer) {
         tgen_debug("Creating new Sched timer for %"G_GUINT64_FORMAT" microseconds", microsecondsPause);
 
@@ -1174,15 +2224,12 @@ static void _tgentransfer_schedPause(TGenTransfer *transfer, int32_t micros)
 
         /* Tell the io module to watch the timer so we know when it expires.
          * The io module holds a second reference to the timer.
-         * The order here is that the io module will watch the timer and then call
-         * tgentimer_onEvent when the timer expires, then the timer will call
-         * _tgentransfer_schedOnTimerExpired and adjust the timer as appropriate. */
+         * The order here is that the io module's timer wheel will call
+         * _tgentransfer_schedOnTimerExpired when the timer expires, and
+         * we adjust the timer as appropriate. */
         tgentimer_ref(transfer->schedule->timer);
         /* the ref above will be unreffed when the timer is deregistered. */
-        tgenio_register(transfer->io,
-                tgentimer_getDescriptor(transfer->schedule->timer),
-                (TGenIO_notifyEventFunc)tgentimer_onEvent, NULL,
-                transfer->schedule->timer, (GDestroyNotify)tgentimer_unref);
+        tgenio_registerTimer(transfer->io, transfer->schedule->timer);
     } else {
         tgen_debug("Arming existing Sched timer for %"G_GUINT64_FORMAT" microseconds", microsecondsPause);
         tgentimer_settime_micros(transfer->schedule->timer, microsecondsPause);
@@ -1192,15 +2239,28 @@ static void _tgentransfer_schedPause(TGenTransfer *transfer, int32_t micros)
     transfer->schedule->timerSet = TRUE;
 }
 
+static void _tgentransfer_timeoutTimerCancel(TGenTransfer *transfer) {
+    TGEN_ASSERT(transfer);
+    if(!transfer->timeoutTimer) {
+        return;
+    }
+
+    /* drop the io module's timer reference, and then ours. this releases the
+     * transfer reference held by the timer. */
+    tgenio_deregisterTimer(transfer->io, transfer->timeoutTimer);
+    tgentimer_unref(transfer->timeoutTimer);
+    transfer->timeoutTimer = NULL;
+}
+
 static gboolean
 _tgentransfer_schedAdvanceSchedule(TGenTransfer *transfer)
 {
     TGEN_ASSERT(transfer);
     g_assert(transfer->type == TGEN_TYPE_SCHEDULE);
     g_assert(transfer->schedule);
-    tgen_debug("Advancing one from idx=%d (len=%d)",
-            transfer->schedule->schedIdx, transfer->schedule->sched->len);
-    if (++transfer->schedule->schedIdx >= transfer->schedule->sched->len) {
+    tgen_debug("Advancing one from idx=%u (len=%u)",
+            transfer->schedule->schedIdx, tgenschedule_getLength(transfer->schedule->sched));
+    if (++transfer->schedule->schedIdx >= tgenschedule_getLength(transfer->schedule->sched)) {
         return FALSE;
     }
     return TRUE;
@@ -1212,9 +2272,9 @@ _tgentransfer_schedTryFlushWriteBuffer(TGenTransfer *transfer)
 {
     TGEN_ASSERT(transfer);
     g_assert(transfer->type == TGEN_TYPE_SCHEDULE);
-    g_assert(transfer->writeBuffer);
+    g_assert(transfer->payloadPending > 0);
     gboolean firstByte = transfer->bytes.payloadWrite == 0 ? TRUE : FALSE;
-    transfer->bytes.payloadWrite += _tgentransfer_flushOut(transfer);
+    transfer->bytes.payloadWrite += _tgentransfer_flushPayload(transfer);
     if (firstByte && transfer->bytes.payloadWrite > 0) {
         transfer->time.firstPayloadByte = g_get_monotonic_time();
     }
@@ -1223,7 +2283,7 @@ _tgentransfer_schedTryFlushWriteBuffer(TGenTransfer *transfer)
 static void _tgentransfer_schedWriteToBuffer(TGenTransfer *transfer) {
     TGEN_ASSERT(transfer);
     g_assert(transfer->type == TGEN_TYPE_SCHEDULE);
-    g_assert(!transfer->writeBuffer);
+    g_assert(transfer->payloadPending == 0);
 
     /* First compute how many packets we send now (i.e., how much data we write).
      * We send multiple packets that would be sent within a threshold at the same 
@@ -1235,7 +2295,7 @@ static void _tgentransfer_schedWriteToBuffer(TGenTransfer *transfer) {
         amountToWrite += (gsize)TGEN_MMODEL_PACKET_DATA_SIZE;
 
         /* delay is in microseconds */
-        int32_t delay = g_array_index(transfer->schedule->sched, int32_t,
+        int32_t delay = tgenschedule_getDelay(transfer->schedule->sched,
                 transfer->schedule->schedIdx);
         cumulativeDelay += delay;
 
@@ -1247,12 +2307,8 @@ static void _tgentransfer_schedWriteToBuffer(TGenTransfer *transfer) {
 
     transfer->schedule->nextDelay = cumulativeDelay;
 
-    /* Now get enough bytes to fill the number of packets we need. */
-    transfer->writeBuffer = _tgentransfer_getRandomString(amountToWrite);
-
-    g_checksum_update(transfer->schedule->ourPayloadChecksum,
-            (guchar*)transfer->writeBuffer->str,
-            (gssize)transfer->writeBuffer->len);
+    /* Now borrow enough bytes to fill the number of packets we need. */
+    transfer->payloadPending = amountToWrite;
 }
 
 static void _tgentransfer_writeSchedPayload(TGenTransfer* transfer)
@@ -1262,34 +2318,60 @@ static void _tgentransfer_writeSchedPayload(TGenTransfer* transfer)
 
 do_write_more:
 
+    /* schedule frames for the other side go out before the payload that follows them */
     if (transfer->writeBuffer) {
-        tgen_debug("There's an existing write buffer, so let's write it");
+        _tgentransfer_flushOut(transfer);
+        if(transfer->writeBuffer) {
+            return;
+        }
+    }
+
+    if (transfer->schedule->timerSet) {
+        /* we only sent schedule frames while we pause */
+        return;
+    }
+
+    if (transfer->payloadPending > 0) {
+        tgen_debug("There's pending payload, so let's write it");
         _tgentransfer_schedTryFlushWriteBuffer(transfer);
 
-        /* if there still is a write buffer, we still need to write more */
-        if(transfer->writeBuffer) {
+        /* if there still is pending payload, we still need to write more */
+        if(transfer->payloadPending > 0) {
             return;
         } else {
             /* we finished writing previous data, now we pause, but only if
              * we haven't finished the schedule. */
-            if((transfer->schedule->schedIdx < transfer->schedule->sched->len) &&
+            if(_tgentransfer_schedHasMoreDelays(transfer) &&
                 transfer->schedule->nextDelay > 0) {
+                /* the other side must not run out of schedule while we pause */
+                _tgentransfer_schedQueueTheirSchedule(transfer, transfer->schedule->nextDelay, 0);
                 /* we still need to send more packets after a delay */
                 _tgentransfer_schedPause(transfer, transfer->schedule->nextDelay);
                 /* now that we paused, reset the delay for the next round */
                 transfer->schedule->nextDelay = 0;
-                return;
+                goto do_write_more;
             }
         }
     }
 
-    g_assert(!transfer->writeBuffer);
+    g_assert(transfer->payloadPending == 0);
     g_assert(!transfer->schedule->timerSet);
 
-    if (transfer->schedule->schedIdx < transfer->schedule->sched->len) {
-        tgen_debug("Empty write buffer, no timer set, and not at "
+    if (transfer->schedule->schedIdx < tgenschedule_getLength(transfer->schedule->sched)) {
+        tgen_debug("No pending payload, no timer set, and not at "
                    "the end of the schedule. Writing more data.");
         _tgentransfer_schedWriteToBuffer(transfer);
+        /* tell the other side how much payload comes before the next frame */
+        _tgentransfer_schedQueueTheirSchedule(transfer, 0, transfer->payloadPending);
+        goto do_write_more;
+    } else if (_tgentransfer_schedIsStarved(transfer)) {
+        tgen_debug("We used all of the schedule we have, waiting for more from the commander");
+    } else if (_tgentransfer_schedIsSendingTheirSchedule(transfer)) {
+        /* we are done with our payload, but keep their schedule ahead of them */
+        _tgentransfer_schedQueueTheirSchedule(transfer, 0, 0);
+        if (_tgentransfer_schedIsSendingTheirSchedule(transfer)) {
+            _tgentransfer_schedPause(transfer, TGEN_SCHEDULE_HORIZON_USEC/2);
+        }
         goto do_write_more;
     } else {
         tgen_debug("We're done writing for the Schedule!");
@@ -1316,19 +2398,26 @@ static void _tgentransfer_writeChecksum(TGenTransfer* transfer) {
             || transfer->type == TGEN_TYPE_SCHEDULE);
 
     /* buffer the checksum if we have not done that yet */
-    if(!transfer->writeBuffer) {
+    if(!transfer->writeBuffer && transfer->framing == TGEN_FRAMING_BINARY) {
         transfer->writeBuffer = g_string_new(NULL);
-        if (transfer->type == TGEN_TYPE_PUT) {
-            g_string_printf(transfer->writeBuffer, "MD5 %s\n",
-                    g_checksum_get_string(transfer->payloadChecksum));
-        } else if (transfer->type == TGEN_TYPE_GETPUT && transfer->getput) {
-            g_string_printf(transfer->writeBuffer, "MD5 %s\n",
-                    g_checksum_get_string(transfer->getput->ourPayloadChecksum));
-        } else if (transfer->type == TGEN_TYPE_SCHEDULE && transfer->schedule) {
-            g_string_printf(transfer->writeBuffer, "MD5 %s\n",
-                    g_checksum_get_string(transfer->schedule->ourPayloadChecksum));
+        TGenChecksum* checksum = _tgentransfer_getChecksum(transfer, &transfer->ourPayloadChecksum);
+        gsize digestLength = 0;
+        const guint8* digest = checksum ? tgenchecksum_getDigest(checksum, &digestLength) : NULL;
+
+        gsize frameOffset = _tgentransfer_beginFrame(transfer->writeBuffer, TGEN_FRAME_CHECKSUM);
+        g_string_append_c(transfer->writeBuffer, (gchar)transfer->checksumType);
+        _tgentransfer_appendBytes(transfer->writeBuffer, (const gchar*)digest, digestLength);
+        _tgentransfer_endFrame(transfer->writeBuffer, frameOffset);
+    } else if(!transfer->writeBuffer) {
+        transfer->writeBuffer = g_string_new(NULL);
+        const gchar* sum = _tgentransfer_getChecksumString(transfer, &transfer->ourPayloadChecksum);
+        if(sum) {
+            g_string_printf(transfer->writeBuffer, "%s %s\n",
+                    tgenchecksum_typeToString(transfer->checksumType), sum);
         } else {
-            g_assert_not_reached();
+            /* the other side still waits for this line to know we are done */
+            g_string_printf(transfer->writeBuffer, "%s\n",
+                    tgenchecksum_typeToString(transfer->checksumType));
         }
     }
 
@@ -1390,7 +2479,7 @@ static void _tgentransfer_onWritable(TGenTransfer* transfer) {
         _tgentransfer_writeChecksum(transfer);
     }
 
-    if(transfer->writeBuffer ||
+    if(transfer->writeBuffer || transfer->payloadPending > 0 ||
             (transfer->type == TGEN_TYPE_PUT && transfer->state == TGEN_XFER_PAYLOAD) ||
             (_tgentransfer_getputWantsWriteEvents(transfer)) ||
             (_tgentransfer_schedWantsWriteEvents(transfer))) {
@@ -1407,7 +2496,7 @@ static void _tgentransfer_onWritable(TGenTransfer* transfer) {
                 _tgentransfer_toString(transfer), totalBytes);
 
     if(totalBytes > 0) {
-        transfer->time.lastProgress = g_get_monotonic_time();
+        _tgentransfer_onProgress(transfer);
     }
 }
 
@@ -1492,52 +2581,148 @@ static gchar* _tgentransfer_getTimeStatusReport(TGenTransfer* transfer) {
     return g_string_free(buffer, FALSE);
 }
 
-static void _tgentransfer_log(TGenTransfer* transfer, gboolean wasActive) {
+static gint64 _tgentransfer_getStepMicros(TGenTransfer* transfer, gint64 time) {
+    return (time > 0 && transfer->time.start > 0) ? (time - transfer->time.start) : -1;
+}
+
+/* the binary equivalent of the final line we log for the transfer */
+static void _tgentransfer_writeEventLog(TGenTransfer* transfer) {
+    TGEN_ASSERT(transfer);
+
+    TGenEventLogTransfer record;
+    memset(&record, 0, sizeof(TGenEventLogTransfer));
+
+    record.wasSuccess = (transfer->state == TGEN_XFER_SUCCESS) ? TRUE : FALSE;
+    record.isCommander = transfer->isCommander;
+    record.type = (guint8)transfer->type;
+    record.error = (guint8)transfer->error;
+    record.id = transfer->id;
+    record.hostname = transfer->hostname;
+    record.remoteName = transfer->remoteName;
+    record.count = transfer->count;
+    record.remoteCount = transfer->remoteCount;
+    record.size = transfer->size;
+    record.totalBytesRead = transfer->bytes.totalRead;
+    record.totalBytesWritten = transfer->bytes.totalWrite;
+    record.payloadBytesRead = transfer->bytes.payloadRead;
+    record.payloadBytesWritten = transfer->bytes.payloadWrite;
+
+    tgentransport_fillEventLogTransfer(transfer->transport, &record);
+
+    record.stepMicros[TGEN_EVENTLOG_STEP_COMMAND] =
+            _tgentransfer_getStepMicros(transfer, transfer->time.command);
+    record.stepMicros[TGEN_EVENTLOG_STEP_RESPONSE] =
+            _tgentransfer_getStepMicros(transfer, transfer->time.response);
+    record.stepMicros[TGEN_EVENTLOG_STEP_FIRST_BYTE] =
+            _tgentransfer_getStepMicros(transfer, transfer->time.firstPayloadByte);
+    record.stepMicros[TGEN_EVENTLOG_STEP_LAST_BYTE] =
+            _tgentransfer_getStepMicros(transfer, transfer->time.lastPayloadByte);
+    record.stepMicros[TGEN_EVENTLOG_STEP_CHECKSUM] =
+            _tgentransfer_getStepMicros(transfer, transfer->time.checksum);
+
+    tgeneventlog_writeTransfer(&record);
+}
+
+static void _tgentransfer_recordLatencies(TGenTransfer* transfer) {
+    TGEN_ASSERT(transfer);
+
+    TGenHistogram** histograms = transfer->latencyHistograms;
+
+    gint64 connect = -1, proxy = -1;
+    tgentransport_getLatencies(transfer->transport, &connect, &proxy);
+    if(connect >= 0) {
+        tgenhistogram_record(histograms[TGEN_LATENCY_CONNECT], (guint64)connect);
+    }
+    if(proxy >= 0) {
+        tgenhistogram_record(histograms[TGEN_LATENCY_PROXY_RESPONSE], (guint64)proxy);
+    }
+
+    /* like tgentools, we measure the payload from when the command was sent,
+     * and only for transfers that succeeded */
+    if(transfer->state == TGEN_XFER_SUCCESS && transfer->time.command > 0) {
+        if(transfer->time.firstPayloadByte >= transfer->time.command) {
+            tgenhistogram_record(histograms[TGEN_LATENCY_FIRST_BYTE],
+                    (guint64)(transfer->time.firstPayloadByte - transfer->time.command));
+        }
+        if(transfer->time.lastPayloadByte >= transfer->time.command) {
+            tgenhistogram_record(histograms[TGEN_LATENCY_LAST_BYTE],
+                    (guint64)(transfer->time.lastPayloadByte - transfer->time.command));
+        }
+    }
+}
+
+/* called once when the transfer succeeded or failed */
+static void _tgentransfer_onFinished(TGenTransfer* transfer) {
     TGEN_ASSERT(transfer);
 
+    if(transfer->latencyHistograms) {
+        _tgentransfer_recordLatencies(transfer);
+    }
+    if(tgeneventlog_isOpen()) {
+        _tgentransfer_writeEventLog(transfer);
+    }
+}
+
+static void _tgentransfer_log(TGenTransfer* transfer, gboolean wasActive) {
+    TGEN_ASSERT(transfer);
 
+    /* we only build the report strings if the line will be printed */
     if(transfer->state == TGEN_XFER_ERROR) {
         /* we had an error at some point and will unlikely be able to complete.
          * only log an error once. */
         if(transfer->time.lastTimeErrorReport == 0) {
-            gchar* bytesMessage = _tgentransfer_getBytesStatusReport(transfer);
-            gchar* timeMessage = _tgentransfer_getTimeStatusReport(transfer);
+            if(tgenlog_isLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+                gchar* bytesMessage = _tgentransfer_getBytesStatusReport(transfer);
+                gchar* timeMessage = _tgentransfer_getTimeStatusReport(transfer);
 
-            tgen_message("[transfer-error] transport %s transfer %s %s %s",
-                    tgentransport_toString(transfer->transport),
-                    _tgentransfer_toString(transfer), bytesMessage, timeMessage);
+                tgen_message("[transfer-error] transport %s transfer %s %s %s",
+                        tgentransport_toString(transfer->transport),
+                        _tgentransfer_toString(transfer), bytesMessage, timeMessage);
+
+                g_free(bytesMessage);
+                g_free(timeMessage);
+            }
+
+            _tgentransfer_onFinished(transfer);
 
             gint64 now = g_get_monotonic_time();
             transfer->time.lastBytesStatusReport = now;
             transfer->time.lastTimeErrorReport = now;
-            g_free(bytesMessage);
         }
     } else if(transfer->state == TGEN_XFER_SUCCESS) {
         /* we completed the transfer. yay. only log once. */
         if(transfer->time.lastTimeStatusReport == 0) {
-            gchar* bytesMessage = _tgentransfer_getBytesStatusReport(transfer);
-            gchar* timeMessage = _tgentransfer_getTimeStatusReport(transfer);
+            if(tgenlog_isLevelEnabled(G_LOG_LEVEL_MESSAGE)) {
+                gchar* bytesMessage = _tgentransfer_getBytesStatusReport(transfer);
+                gchar* timeMessage = _tgentransfer_getTimeStatusReport(transfer);
 
-            tgen_message("[transfer-complete] transport %s transfer %s %s %s",
-                    tgentransport_toString(transfer->transport),
-                    _tgentransfer_toString(transfer), bytesMessage, timeMessage);
+                tgen_message("[transfer-complete] transport %s transfer %s %s %s",
+                        tgentransport_toString(transfer->transport),
+                        _tgentransfer_toString(transfer), bytesMessage, timeMessage);
+
+                g_free(bytesMessage);
+                g_free(timeMessage);
+            }
+
+            _tgentransfer_onFinished(transfer);
 
             gint64 now = g_get_monotonic_time();
             transfer->time.lastBytesStatusReport = now;
             transfer->time.lastTimeStatusReport = now;
-            g_free(bytesMessage);
-            g_free(timeMessage);
         }
-    } else {
-        /* the transfer is still working. only log on new activity */
-        if(wasActive) {
+    } else if(wasActive && tgenlog_isLevelEnabled(G_LOG_LEVEL_INFO)) {
+        /* the transfer is still working. only log on new activity, and not
+         * more often than the status interval. */
+        gint64 now = g_get_monotonic_time();
+        if(transfer->time.lastBytesStatusReport == 0 ||
+                now - transfer->time.lastBytesStatusReport >= transfer->statusIntervalUSecs) {
             gchar* bytesMessage = _tgentransfer_getBytesStatusReport(transfer);
 
             tgen_info("[transfer-status] transport %s transfer %s %s",
                     tgentransport_toString(transfer->transport),
                     _tgentransfer_toString(transfer), bytesMessage);
 
-            transfer->time.lastBytesStatusReport = g_get_monotonic_time();;
+            transfer->time.lastBytesStatusReport = now;
             g_free(bytesMessage);
         }
     }
@@ -1555,7 +2740,7 @@ static TGenEvent _tgentransfer_runTransportEventLoop(TGenTransfer* transfer, TGe
         /* return DONE to the io module so it does deregistration */
         return TGEN_EVENT_DONE;
     } else {
-        transfer->time.lastProgress = g_get_monotonic_time();
+        _tgentransfer_onProgress(transfer);
         if(retEvents & TGEN_EVENT_DONE) {
             /* proxy is connected and ready, now its our turn */
             return TGEN_EVENT_READ|TGEN_EVENT_WRITE;
@@ -1570,6 +2755,13 @@ static TGenEvent _tgentransfer_runTransferEventLoop(TGenTransfer* transfer, TGen
     gsize readBytesBefore = transfer->bytes.payloadRead;
     gsize writeBytesBefore = transfer->bytes.payloadWrite;
 
+    /* every event starts with a fresh io budget */
+    transfer->budget.bytesRead = 0;
+    transfer->budget.numReads = 0;
+    transfer->budget.bytesWritten = 0;
+    transfer->budget.numWrites = 0;
+    transfer->budget.exhausted = TGEN_EVENT_NONE;
+
     /* process the events */
     if(events & TGEN_EVENT_READ) {
         _tgentransfer_onReadable(transfer);
@@ -1578,11 +2770,22 @@ static TGenEvent _tgentransfer_runTransferEventLoop(TGenTransfer* transfer, TGen
         _tgentransfer_onWritable(transfer);
     }
 
+    /* buffered bytes do not make the socket readable again, so we read them
+     * as soon as our state lets us, e.g., a checksum that arrived with payload */
+    if(_tgentransfer_getBufferedLength(transfer) > 0 && (transfer->events & TGEN_EVENT_READ)) {
+        _tgentransfer_onReadable(transfer);
+    }
+
     /* check if we want to log any progress information */
     gboolean wasActive = (transfer->bytes.payloadRead > readBytesBefore ||
             transfer->bytes.payloadWrite > writeBytesBefore) ? TRUE : FALSE;
     _tgentransfer_log(transfer, wasActive);
 
+    /* the socket may still be ready where we stopped early, so ask to be called again */
+    if(transfer->budget.exhausted & transfer->events) {
+        return transfer->events|TGEN_EVENT_PENDING;
+    }
+
     return transfer->events;
 }
 
@@ -1609,6 +2812,9 @@ TGenEvent tgentransfer_onEvent(TGenTransfer* transfer, gint descriptor, TGenEven
             _tgentransfer_schedTimerCancel(transfer);
         }
 
+        /* we are done, so we can no longer time out */
+        _tgentransfer_timeoutTimerCancel(transfer);
+
         if(transfer->notify) {
             /* execute the callback to notify that we are complete */
             gboolean wasSuccess = transfer->error == TGEN_XFER_ERR_NONE ? TRUE : FALSE;
@@ -1621,54 +2827,65 @@ TGenEvent tgentransfer_onEvent(TGenTransfer* transfer, gint descriptor, TGenEven
     return retEvents;
 }
 
-gboolean tgentransfer_onCheckTimeout(TGenTransfer* transfer, gint descriptor) {
+static gboolean _tgentransfer_onTimeoutTimerExpired(TGenTransfer* transfer, gpointer nullData) {
     TGEN_ASSERT(transfer);
 
-    /* the io module is checking to see if we are in a timeout state. if we are, then
-     * the transfer will be cancel will be de-registered and destroyed. */
+    /* our earliest deadline passed, but we may have made progress since the
+     * timer was armed. if so, we wait until the new deadline. */
+    gint64 now = g_get_monotonic_time();
     gboolean transferStalled = ((transfer->time.lastProgress > 0) &&
-            (g_get_monotonic_time() >= transfer->time.lastProgress + transfer->stalloutUSecs)) ? TRUE : FALSE;
-    gboolean transferTookTooLong = (g_get_monotonic_time() >= (transfer->time.start + transfer->timeoutUSecs)) ? TRUE : FALSE;
+            (now >= transfer->time.lastProgress + transfer->stalloutUSecs)) ? TRUE : FALSE;
+    gboolean transferTookTooLong = (now >= (transfer->time.start + transfer->timeoutUSecs)) ? TRUE : FALSE;
 
-    if(transferStalled || transferTookTooLong) {
-        /* log this transfer as a timeout */
-        transfer->events |= TGEN_EVENT_DONE;
-        _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
+    if(!transferStalled && !transferTookTooLong) {
+        /* this transfer is still in progress */
+        _tgentransfer_resetTimeoutTimer(transfer);
+        return FALSE;
+    }
 
-        if(transferStalled) {
-            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_STALLOUT);
-        } else {
-            _tgentransfer_changeError(transfer, TGEN_XFER_ERR_TIMEOUT);
-        }
+    /* log this transfer as a timeout */
+    transfer->events |= TGEN_EVENT_DONE;
+    _tgentransfer_changeState(transfer, TGEN_XFER_ERROR);
 
-        _tgentransfer_log(transfer, FALSE);
+    if(transferStalled) {
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_STALLOUT);
+    } else {
+        _tgentransfer_changeError(transfer, TGEN_XFER_ERR_TIMEOUT);
+    }
 
-        /* cancel the in-progress schedule timer if we have one */
-        if (transfer->schedule && transfer->schedule->timer) {
-            _tgentransfer_schedTimerCancel(transfer);
-        }
+    _tgentransfer_log(transfer, FALSE);
 
-        /* we have to call notify so the next transfer can start */
-        if(transfer->notify) {
-            /* execute the callback to notify that we failed with a timeout error */
-            transfer->notify(transfer->data1, transfer->data2, FALSE);
-            /* make sure we only do the notification once */
-            transfer->notify = NULL;
-        }
-        /* this transfer will be destroyed by the io module */
-        return TRUE;
-    } else {
-        /* this transfer is still in progress */
-        return FALSE;
+    /* cancel the in-progress schedule timer if we have one */
+    if (transfer->schedule && transfer->schedule->timer) {
+        _tgentransfer_schedTimerCancel(transfer);
+    }
+
+    /* we have to call notify so the next transfer can start */
+    if(transfer->notify) {
+        /* execute the callback to notify that we failed with a timeout error */
+        transfer->notify(transfer->data1, transfer->data2, FALSE);
+        /* make sure we only do the notification once */
+        transfer->notify = NULL;
     }
+
+    /* the timer still holds a transfer ref, so it is safe to release the one
+     * held by the io module for our descriptor. this transfer is destroyed
+     * once the timer wheel drops the timer after we return TRUE. */
+    if(transfer->transport) {
+        tgenio_deregister(transfer->io, tgentransport_getDescriptor(transfer->transport));
+    }
+
+    tgentimer_unref(transfer->timeoutTimer);
+    transfer->timeoutTimer = NULL;
+    return TRUE;
 }
 
 TGenTransfer* tgentransfer_new(const gchar* idStr, gsize count, TGenTransferType type,
         gsize size, gsize ourSize, gsize theirSize,
-        guint64 timeout, guint64 stallout, const gchar* localSchedule, const gchar* remoteSchedule,
+        guint64 timeout, guint64 stallout, TGenSchedule* localSchedule, TGenSchedule* remoteSchedule,
         TGenIO* io, TGenTransport* transport, TGenTransfer_notifyCompleteFunc notify,
         gpointer data1, gpointer data2, GDestroyNotify destructData1, GDestroyNotify destructData2) {
-    TGenTransfer* transfer = g_new0(TGenTransfer, 1);
+    TGenTransfer* transfer = tgenslab_alloc0(TGEN_SLAB_TRANSFER, sizeof(TGenTransfer));
     transfer->magic = TGEN_MAGIC;
     transfer->refcount = 1;
 
@@ -1686,16 +2903,15 @@ TGenTransfer* tgentransfer_new(const gchar* idStr, gsize count, TGenTransferType
     transfer->time.start = g_get_monotonic_time();
 
     transfer->events = TGEN_EVENT_READ;
-    transfer->id = g_strdup(idStr);
+    transfer->id = idStr ? g_intern_string(idStr) : NULL;
     transfer->count = count;
 
     /* the timeout after which we abandon this transfer */
     transfer->timeoutUSecs = (gint64)(timeout > 0 ? (timeout * 1000) : DEFAULT_XFER_TIMEOUT_USEC);
     transfer->stalloutUSecs = (gint64)(stallout > 0 ? (stallout * 1000) : DEFAULT_XFER_STALLOUT_USEC);
+    transfer->statusIntervalUSecs = DEFAULT_XFER_STATUS_INTERVAL_USEC;
 
-    gchar nameBuffer[256];
-    memset(nameBuffer, 0, 256);
-    transfer->hostname = (0 == tgenconfig_gethostname(nameBuffer, 255)) ? g_strdup(nameBuffer) : NULL;
+    transfer->hostname = tgenconfig_getHostname();
 
     if(type != TGEN_TYPE_NONE) {
         transfer->isCommander = TRUE;
@@ -1710,14 +2926,84 @@ TGenTransfer* tgentransfer_new(const gchar* idStr, gsize count, TGenTransferType
         _tgentransfer_initSchedData(transfer, localSchedule, remoteSchedule);
     }
 
-    transfer->payloadChecksum = g_checksum_new(G_CHECKSUM_MD5);
+    transfer->checksumType = TGEN_CHECKSUM_MD5;
+    transfer->receiveLowWatermark = 1;
+
+    /* start somewhere random so that concurrent transfers send different bytes */
+    transfer->payloadOffset = (gsize)tgenrandom_nextUInt32Bounded(tgenrandom_getThreadLocal(),
+            (guint32)tgenpayload_getPeriod());
 
     tgentransport_ref(transport);
     transfer->transport = transport;
+    if(io) {
+        /* with io_uring, the payload is read and written through the ring */
+        tgentransport_setIO(transport, io);
+    }
+
+    if(io) {
+        /* wake up at our deadline instead of having the io module poll us.
+         * the timer holds a transfer ref until we are done or time out. */
+        transfer->timeoutTimer = tgentimer_new((guint64)transfer->timeoutUSecs, TRUE,
+                (TGenTimer_notifyExpiredFunc)_tgentransfer_onTimeoutTimerExpired,
+                transfer, NULL, (GDestroyNotify)tgentransfer_unref, NULL);
+        tgentransfer_ref(transfer);
+
+        /* the io module holds a second reference to the timer */
+        tgentimer_ref(transfer->timeoutTimer);
+        tgenio_registerTimer(io, transfer->timeoutTimer);
+    }
 
     return transfer;
 }
 
+/* limits the payload bytes or read and write syscalls (a limit of 0 means no limit)
+ * we use per event. without any limits, we read or write once per event. */
+void tgentransfer_setIOBudget(TGenTransfer* transfer, guint64 bytes, guint64 syscalls) {
+    TGEN_ASSERT(transfer);
+    transfer->budget.bytesLimit = bytes;
+    transfer->budget.syscallsLimit = syscalls;
+}
+
+void tgentransfer_setPayloadContent(TGenTransfer* transfer, TGenPayloadContent content) {
+    TGEN_ASSERT(transfer);
+    transfer->payloadContent = content;
+}
+
+/* the checksum the commander uses over payload in both directions. the other
+ * side learns it from our command. */
+void tgentransfer_setChecksumType(TGenTransfer* transfer, TGenChecksumType checksumType) {
+    TGEN_ASSERT(transfer);
+    transfer->checksumType = checksumType;
+}
+
+/* the framing the commander uses for the control messages. the other side
+ * learns it from the version byte we send after the auth password. */
+void tgentransfer_setFraming(TGenTransfer* transfer, TGenTransferFraming framing) {
+    TGEN_ASSERT(transfer);
+    transfer->framing = framing;
+}
+
+/* the least time between status lines while the transfer is active. zero logs
+ * a status line on every event with progress. */
+void tgentransfer_setStatusInterval(TGenTransfer* transfer, guint64 intervalMillis) {
+    TGEN_ASSERT(transfer);
+    transfer->statusIntervalUSecs = (gint64)(intervalMillis * 1000);
+}
+
+/* the histograms, indexed by TGenTransferLatency, must outlive the transfer
+ * and only be used on the transfer's thread */
+void tgentransfer_setLatencyHistograms(TGenTransfer* transfer, TGenHistogram** histograms) {
+    TGEN_ASSERT(transfer);
+    transfer->latencyHistograms = histograms;
+}
+
+/* if TRUE, payload is sent with sendfile() from a file holding the payload
+ * pool, falling back to write() if the socket does not support it */
+void tgentransfer_setZeroCopy(TGenTransfer* transfer, gboolean zeroCopy) {
+    TGEN_ASSERT(transfer);
+    transfer->payloadZeroCopy = zeroCopy;
+}
+
 static void _tgentransfer_free(TGenTransfer* transfer) {
     TGEN_ASSERT(transfer);
 
@@ -1725,17 +3011,11 @@ static void _tgentransfer_free(TGenTransfer* transfer) {
         g_free(transfer->string);
     }
 
-    if(transfer->hostname) {
-        g_free(transfer->hostname);
-    }
-
-    if(transfer->id) {
-        g_free(transfer->id);
-    }
-
-    if(transfer->remoteName) {
-        g_free(transfer->remoteName);
+    /* the commander's id comes from our graph and is interned */
+    if(!transfer->isCommander) {
+        _tgentransfer_freeName(transfer->id, transfer->idBuffer);
     }
+    _tgentransfer_freeName(transfer->remoteName, transfer->remoteNameBuffer);
 
     if(transfer->readBuffer) {
         g_string_free(transfer->readBuffer, TRUE);
@@ -1745,8 +3025,15 @@ static void _tgentransfer_free(TGenTransfer* transfer) {
         g_string_free(transfer->writeBuffer, TRUE);
     }
 
-    if(transfer->payloadChecksum) {
-        g_checksum_free(transfer->payloadChecksum);
+    if(transfer->inBuffer) {
+        g_free(transfer->inBuffer);
+    }
+
+    if(transfer->ourPayloadChecksum) {
+        tgenchecksum_free(transfer->ourPayloadChecksum);
+    }
+    if(transfer->theirPayloadChecksum) {
+        tgenchecksum_free(transfer->theirPayloadChecksum);
     }
 
     if (transfer->getput) {
@@ -1757,6 +3044,10 @@ static void _tgentransfer_free(TGenTransfer* transfer) {
         _tgentransfer_freeSchedData(transfer);
     }
 
+    if(transfer->timeoutTimer) {
+        tgentimer_unref(transfer->timeoutTimer);
+    }
+
     if(transfer->destructData1 && transfer->data1) {
         transfer->destructData1(transfer->data1);
     }
@@ -1774,7 +3065,7 @@ static void _tgentransfer_free(TGenTransfer* transfer) {
     }
 
     transfer->magic = 0;
-    g_free(transfer);
+    tgenslab_free(TGEN_SLAB_TRANSFER, transfer);
 }
 
 void tgentransfer_ref(TGenTransfer* transfer) {
@@ -5,23 +5,43 @@
 #ifndef TGEN_TRANSFER_H_
 #define TGEN_TRANSFER_H_
 
+/* the values are sent on the wire by the binary transfer protocol */
 typedef enum _TGenTransferType {
     TGEN_TYPE_NONE, TGEN_TYPE_GET, TGEN_TYPE_PUT, TGEN_TYPE_GETPUT, TGEN_TYPE_SCHEDULE,
 } TGenTransferType;
 
+/* how the commands, responses, and checksums that frame the payload are encoded */
+typedef enum _TGenTransferFraming {
+    TGEN_FRAMING_TEXT, TGEN_FRAMING_BINARY,
+} TGenTransferFraming;
+
+/* the latencies that finished transfers record in the histograms of their driver */
+typedef enum _TGenTransferLatency {
+    TGEN_LATENCY_CONNECT, TGEN_LATENCY_PROXY_RESPONSE,
+    TGEN_LATENCY_FIRST_BYTE, TGEN_LATENCY_LAST_BYTE,
+    TGEN_LATENCY_NUM_TYPES,
+} TGenTransferLatency;
+
 typedef struct _TGenTransfer TGenTransfer;
 
 typedef void (*TGenTransfer_notifyCompleteFunc)(gpointer data1, gpointer data2, gboolean wasSuccess);
 
 TGenTransfer* tgentransfer_new(const gchar* idStr, gsize count, TGenTransferType type,
         gsize size, gsize ourSize, gsize theirSize, guint64 timeout, guint64 stallout,
-        const gchar* localSchedule, const gchar* remoteSchedule,
+        TGenSchedule* localSchedule, TGenSchedule* remoteSchedule,
         TGenIO* io, TGenTransport* transport, TGenTransfer_notifyCompleteFunc notify,
         gpointer data1, gpointer data2, GDestroyNotify destructData1, GDestroyNotify destructData2);
 void tgentransfer_ref(TGenTransfer* transfer);
 void tgentransfer_unref(TGenTransfer* transfer);
 
+void tgentransfer_setIOBudget(TGenTransfer* transfer, guint64 bytes, guint64 syscalls);
+void tgentransfer_setPayloadContent(TGenTransfer* transfer, TGenPayloadContent content);
+void tgentransfer_setZeroCopy(TGenTransfer* transfer, gboolean zeroCopy);
+void tgentransfer_setChecksumType(TGenTransfer* transfer, TGenChecksumType checksumType);
+void tgentransfer_setFraming(TGenTransfer* transfer, TGenTransferFraming framing);
+void tgentransfer_setStatusInterval(TGenTransfer* transfer, guint64 intervalMillis);
+void tgentransfer_setLatencyHistograms(TGenTransfer* transfer, TGenHistogram** histograms);
+
 TGenEvent tgentransfer_onEvent(TGenTransfer* transfer, gint descriptor, TGenEvent events);
-gboolean tgentransfer_onCheckTimeout(TGenTransfer* transfer, gint descriptor);
 
 #endif /* TGEN_TRANSFER_H_ */
@@ -3,6 +3,7 @@
  */
 
 #include <arpa/inet.h>
+#include <sys/sendfile.h>
 
 #include "tgen.h"
 
@@ -31,12 +32,15 @@ struct _TGenTransport {
 
     TGenTransportProtocol protocol;
     gint socketD;
+    /* non-null if our socket io goes through the event loop, e.g., with io_uring */
+    TGenIO* io;
 
     TGenTransport_notifyBytesFunc notify;
     gpointer data;
     GDestroyNotify destructData;
 
-    /* our local socket, our side of the transport */
+    /* our local socket, our side of the transport. we only look it up
+     * when we need it for logging. */
     TGenPeer* local;
     /* non-null if we need to connect through a proxy */
     TGenPeer* proxy;
@@ -165,6 +169,18 @@ static const gchar* _tgentransport_errorToString(TGenTransportError error) {
     }
 }
 
+static TGenPeer* _tgentransport_getLocal(TGenTransport* transport) {
+    if(!transport->local) {
+        struct sockaddr_in addrBuf;
+        memset(&addrBuf, 0, sizeof(struct sockaddr_in));
+        socklen_t addrBufLen = (socklen_t)sizeof(struct sockaddr_in);
+        if(getsockname(transport->socketD, (struct sockaddr*) &addrBuf, &addrBufLen) == 0) {
+            transport->local = tgenpeer_newFromIP(addrBuf.sin_addr.s_addr, addrBuf.sin_port);
+        }
+    }
+    return transport->local;
+}
+
 const gchar* tgentransport_toString(TGenTransport* transport) {
     TGEN_ASSERT(transport);
 
@@ -174,7 +190,7 @@ const gchar* tgentransport_toString(TGenTransport* transport) {
         const gchar* errorStr = _tgentransport_errorToString(transport->error);
 
         /* the following may be NULL, and these toString methods will handle it */
-        const gchar* localStr = tgenpeer_toString(transport->local);
+        const gchar* localStr = tgenpeer_toString(_tgentransport_getLocal(transport));
         const gchar* proxyStr = tgenpeer_toString(transport->proxy);
         const gchar* remoteStr = tgenpeer_toString(transport->remote);
 
@@ -216,7 +232,7 @@ static void _tgentransport_changeError(TGenTransport* transport, TGenTransportEr
 static TGenTransport* _tgentransport_newHelper(gint socketD, gint64 startedTime, gint64 createdTime,
         TGenPeer* proxy, gchar* username, gchar* password, TGenPeer* peer,
         TGenTransport_notifyBytesFunc notify, gpointer data, GDestroyNotify destructData) {
-    TGenTransport* transport = g_new0(TGenTransport, 1);
+    TGenTransport* transport = tgenslab_alloc0(TGEN_SLAB_TRANSPORT, sizeof(TGenTransport));
     transport->magic = TGEN_MAGIC;
     transport->refcount = 1;
 
@@ -246,13 +262,6 @@ static TGenTransport* _tgentransport_newHelper(gint socketD, gint64 startedTime,
         }
     }
 
-    struct sockaddr_in addrBuf;
-    memset(&addrBuf, 0, sizeof(struct sockaddr_in));
-    socklen_t addrBufLen = (socklen_t)sizeof(struct sockaddr_in);
-    if(getsockname(socketD, (struct sockaddr*) &addrBuf, &addrBufLen) == 0) {
-        transport->local = tgenpeer_newFromIP(addrBuf.sin_addr.s_addr, addrBuf.sin_port);
-    }
-
     transport->notify = notify;
     transport->data = data;
     transport->destructData = destructData;
@@ -360,6 +369,10 @@ static void _tgentransport_free(TGenTransport* transport) {
         g_string_free(transport->socksBuffer, TRUE);
     }
 
+    if(transport->io) {
+        tgenio_unref(transport->io);
+    }
+
     if(transport->destructData && transport->data) {
         transport->destructData(transport->data);
     }
@@ -373,7 +386,7 @@ static void _tgentransport_free(TGenTransport* transport) {
     }
 
     transport->magic = 0;
-    g_free(transport);
+    tgenslab_free(TGEN_SLAB_TRANSPORT, transport);
 }
 
 void tgentransport_ref(TGenTransport* transport) {
@@ -389,10 +402,23 @@ void tgentransport_unref(TGenTransport* transport) {
     }
 }
 
+/* only tcp sockets can be read and written through the io module */
+void tgentransport_setIO(TGenTransport* transport, TGenIO* io) {
+    TGEN_ASSERT(transport);
+
+    if(transport->io || transport->protocol != TGEN_PROTOCOL_TCP) {
+        return;
+    }
+
+    tgenio_ref(io);
+    transport->io = io;
+}
+
 gssize tgentransport_write(TGenTransport* transport, gpointer buffer, gsize length) {
     TGEN_ASSERT(transport);
 
-    gssize bytes = write(transport->socketD, buffer, length);
+    gssize bytes = transport->io ? tgenio_write(transport->io, transport->socketD, buffer, length) :
+            write(transport->socketD, buffer, length);
 
     if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
         tgen_info("write(): write to socket %i returned %"G_GSSIZE_FORMAT" error %i: %s",
@@ -412,10 +438,97 @@ gssize tgentransport_write(TGenTransport* transport, gpointer buffer, gsize leng
     return bytes;
 }
 
+/* sends length bytes of the file starting at the offset without copying them
+ * through user space. if the file or socket can not be sent from, this returns
+ * -1 with errno EINVAL or ENOSYS and leaves the transport usable, so that the
+ * caller may fall back to tgentransport_write. */
+gssize tgentransport_sendfile(TGenTransport* transport, gint fileD, gsize offset, gsize length) {
+    TGEN_ASSERT(transport);
+
+    gssize bytes = 0;
+    if(transport->io) {
+        bytes = tgenio_sendfile(transport->io, transport->socketD, fileD, offset, length);
+    } else {
+        off_t fileOffset = (off_t)offset;
+        bytes = sendfile(transport->socketD, fileD, &fileOffset, length);
+    }
+
+    if(bytes < 0 && (errno == EINVAL || errno == ENOSYS)) {
+        tgen_info("sendfile(): socket %i can not send from file %i, error %i: %s",
+                        transport->socketD, fileD, errno, g_strerror(errno));
+    } else if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        tgen_info("sendfile(): write to socket %i returned %"G_GSSIZE_FORMAT" error %i: %s",
+                        transport->socketD, bytes, errno, g_strerror(errno));
+        _tgentransport_changeState(transport, TGEN_XPORT_ERROR);
+        _tgentransport_changeError(transport, TGEN_XPORT_ERR_WRITE);
+    } else if(bytes == 0) {
+        tgen_info("sendfile(): socket %i closed unexpectedly", transport->socketD);
+        _tgentransport_changeState(transport, TGEN_XPORT_ERROR);
+        _tgentransport_changeError(transport, TGEN_XPORT_ERR_WRITE);
+    }
+
+    if(bytes > 0 && transport->notify) {
+        transport->notify(transport->data, 0, (gsize)bytes);
+    }
+
+    return bytes;
+}
+
+/* receives up to length bytes and drops them in the kernel without copying
+ * them to user space. if the socket does not support that, this returns -1
+ * with errno EINVAL or EOPNOTSUPP and leaves the transport usable, so that
+ * the caller may fall back to tgentransport_read. */
+gssize tgentransport_discard(TGenTransport* transport, gsize length) {
+    TGEN_ASSERT(transport);
+
+    if(transport->protocol != TGEN_PROTOCOL_TCP) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    gssize bytes = transport->io ? tgenio_discard(transport->io, transport->socketD, length) :
+            recv(transport->socketD, NULL, length, MSG_TRUNC);
+
+    if(bytes < 0 && (errno == EINVAL || errno == EOPNOTSUPP || errno == EFAULT)) {
+        tgen_info("recv(): socket %i can not discard bytes, error %i: %s",
+                        transport->socketD, errno, g_strerror(errno));
+        errno = EOPNOTSUPP;
+    } else if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        tgen_info("recv(): read from socket %i returned %"G_GSSIZE_FORMAT" error %i: %s",
+                        transport->socketD, bytes, errno, g_strerror(errno));
+        _tgentransport_changeState(transport, TGEN_XPORT_ERROR);
+        _tgentransport_changeError(transport, TGEN_XPORT_ERR_READ);
+    } else if(bytes == 0) {
+        tgen_info("recv(): socket %i closed unexpectedly", transport->socketD);
+        _tgentransport_changeState(transport, TGEN_XPORT_ERROR);
+        _tgentransport_changeError(transport, TGEN_XPORT_ERR_READ);
+    }
+
+    if(bytes > 0 && transport->notify) {
+        transport->notify(transport->data, (gsize)bytes, 0);
+    }
+
+    return bytes;
+}
+
+/* the socket only becomes readable once at least this many bytes arrived */
+gboolean tgentransport_setReceiveLowWatermark(TGenTransport* transport, gint numBytes) {
+    TGEN_ASSERT(transport);
+
+    gint result = setsockopt(transport->socketD, SOL_SOCKET, SO_RCVLOWAT, &numBytes, sizeof(gint));
+    if(result < 0) {
+        tgen_info("setsockopt(): SO_RCVLOWAT %i on socket %i returned error %i: %s",
+                numBytes, transport->socketD, errno, g_strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
 gssize tgentransport_read(TGenTransport* transport, gpointer buffer, gsize length) {
     TGEN_ASSERT(transport);
 
-    gssize bytes = read(transport->socketD, buffer, length);
+    gssize bytes = transport->io ? tgenio_read(transport->io, transport->socketD, buffer, length) :
+            read(transport->socketD, buffer, length);
 
     if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
         tgen_info("read(): read from socket %i returned %"G_GSSIZE_FORMAT" error %i: %s",
@@ -468,6 +581,50 @@ gchar* tgentransport_getTimeStatusReport(TGenTransport* transport) {
     return g_string_free(buffer, FALSE);
 }
 
+/* the time from creating the socket until it connected, and from starting the
+ * proxy handshake until the proxy connected us to the peer, or -1 if unknown */
+void tgentransport_getLatencies(TGenTransport* transport, gint64* connectMicros, gint64* proxyMicros) {
+    TGEN_ASSERT(transport);
+
+    if(connectMicros) {
+        *connectMicros = (transport->time.socketConnect >= 0 && transport->time.socketCreate >= 0) ?
+                (transport->time.socketConnect - transport->time.socketCreate) : -1;
+    }
+    if(proxyMicros) {
+        *proxyMicros = (transport->time.proxyResponse >= 0 && transport->time.proxyInit >= 0) ?
+                (transport->time.proxyResponse - transport->time.proxyInit) : -1;
+    }
+}
+
+static void _tgentransport_fillEventLogEndpoint(TGenPeer* peer, TGenEventLogEndpoint* endpoint) {
+    if(peer) {
+        endpoint->name = tgenpeer_getName(peer);
+        endpoint->networkIP = tgenpeer_getNetworkIP(peer);
+        endpoint->networkPort = tgenpeer_getNetworkPort(peer);
+    }
+}
+
+/* fills in the endpoints and the socket and proxy steps of the transfer's
+ * event log record. like in the text log, the steps are relative to our start. */
+void tgentransport_fillEventLogTransfer(TGenTransport* transport, TGenEventLogTransfer* record) {
+    TGEN_ASSERT(transport);
+    g_assert(record);
+
+    _tgentransport_fillEventLogEndpoint(_tgentransport_getLocal(transport), &record->local);
+    _tgentransport_fillEventLogEndpoint(transport->proxy, &record->proxy);
+    _tgentransport_fillEventLogEndpoint(transport->remote, &record->remote);
+
+    gint64 times[] = {
+        transport->time.socketCreate, transport->time.socketConnect,
+        transport->time.proxyInit, transport->time.proxyChoice,
+        transport->time.proxyRequest, transport->time.proxyResponse,
+    };
+    for(guint i = 0; i < G_N_ELEMENTS(times); i++) {
+        record->stepMicros[TGEN_EVENTLOG_STEP_SOCKET_CREATE + i] =
+                (times[i] >= 0 && transport->time.start >= 0) ? (times[i] - transport->time.start) : -1;
+    }
+}
+
 gboolean tgentransport_wantsEvents(TGenTransport* transport) {
     TGEN_ASSERT(transport);
     if(transport->state != TGEN_XPORT_SUCCESS && transport->state != TGEN_XPORT_ERROR) {
@@ -820,7 +977,7 @@ static TGenEvent _tgentransport_sendSocksRequest(TGenTransport* transport) {
             /* we wrote it all, we can move on */
             transport->time.proxyRequest = g_get_monotonic_time();
             tgen_debug("requested connection from %s through socks proxy %s to remote %s",
-                    tgenpeer_toString(transport->local), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote));
+                    tgenpeer_toString(_tgentransport_getLocal(transport)), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote));
 
             g_string_free(transport->socksBuffer, TRUE);
             transport->socksBuffer = NULL;
@@ -861,7 +1018,7 @@ static TGenEvent _tgentransport_receiveSocksResponseE(TGenTransport* transport)
 
         if(!g_ascii_strncasecmp(namebuf, "\0", (gsize) 1) && socksBindPort == 0) {
             tgen_info("connection from %s through socks proxy %s to %s successful",
-                    tgenpeer_toString(transport->local), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote));
+                    tgenpeer_toString(_tgentransport_getLocal(transport)), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote));
 
             transport->time.proxyResponse = g_get_monotonic_time();
             _tgentransport_changeState(transport, TGEN_XPORT_SUCCESS);
@@ -869,7 +1026,7 @@ static TGenEvent _tgentransport_receiveSocksResponseE(TGenTransport* transport)
         } else {
             tgen_warning("connection from %s through socks proxy %s to %s failed: "
                     "proxy requested unsupported reconnection to %s:u",
-                    tgenpeer_toString(transport->local), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote),
+                    tgenpeer_toString(_tgentransport_getLocal(transport)), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote),
                     namebuf, (guint)ntohs(socksBindPort));
 
             _tgentransport_changeState(transport, TGEN_XPORT_ERROR);
@@ -920,14 +1077,14 @@ static TGenEvent _tgentransport_receiveSocksResponseC(TGenTransport* transport)
         /* reconnect not supported */
         if(socksBindAddress == 0 && socksBindPort == 0) {
             tgen_info("connection from %s through socks proxy %s to %s successful",
-                    tgenpeer_toString(transport->local), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote));
+                    tgenpeer_toString(_tgentransport_getLocal(transport)), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote));
 
             _tgentransport_changeState(transport, TGEN_XPORT_SUCCESS);
             return TGEN_EVENT_DONE;
         } else {
             tgen_warning("connection from %s through socks proxy %s to %s failed: "
                     "proxy requested unsupported reconnection to %i:u",
-                    tgenpeer_toString(transport->local), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote),
+                    tgenpeer_toString(_tgentransport_getLocal(transport)), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote),
                     (gint)socksBindAddress, (guint)ntohs(socksBindPort));
 
             _tgentransport_changeState(transport, TGEN_XPORT_ERROR);
@@ -962,7 +1119,7 @@ static TGenEvent _tgentransport_receiveSocksResponseB(TGenTransport* transport)
             return _tgentransport_receiveSocksResponseD(transport);
         } else {
             tgen_warning("connection from %s through socks proxy %s to %s failed: unsupported address type 0x%X",
-                    tgenpeer_toString(transport->local), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote),
+                    tgenpeer_toString(_tgentransport_getLocal(transport)), tgenpeer_toString(transport->proxy), tgenpeer_toString(transport->remote),
                     addressType);
 
             _tgentransport_changeState(transport, TGEN_XPORT_ERROR);
@@ -1017,7 +1174,7 @@ static TGenEvent _tgentransport_receiveSocksResponseA(TGenTransport* transport)
 
             g_string_append_printf(messageBuffer,
                     "connection from %s through socks proxy %s to %s failed: ",
-                    tgenpeer_toString(transport->local), tgenpeer_toString(transport->proxy),
+                    tgenpeer_toString(_tgentransport_getLocal(transport)), tgenpeer_toString(transport->proxy),
                     tgenpeer_toString(transport->remote));
 
             if(version != 0x05) {
@@ -23,13 +23,19 @@ TGenTransport* tgentransport_newPassive(gint socketD, gint64 started, gint64 cre
 
 void tgentransport_ref(TGenTransport* transport);
 void tgentransport_unref(TGenTransport* transport);
+void tgentransport_setIO(TGenTransport* transport, TGenIO* io);
 
 gssize tgentransport_write(TGenTransport* transport, gpointer buffer, gsize length);
+gssize tgentransport_sendfile(TGenTransport* transport, gint fileD, gsize offset, gsize length);
 gssize tgentransport_read(TGenTransport* transport, gpointer buffer, gsize length);
+gssize tgentransport_discard(TGenTransport* transport, gsize length);
+gboolean tgentransport_setReceiveLowWatermark(TGenTransport* transport, gint numBytes);
 
 gint tgentransport_getDescriptor(TGenTransport* transport);
 const gchar* tgentransport_toString(TGenTransport* transport);
 gchar* tgentransport_getTimeStatusReport(TGenTransport* transport);
+void tgentransport_getLatencies(TGenTransport* transport, gint64* connectMicros, gint64* proxyMicros);
+void tgentransport_fillEventLogTransfer(TGenTransport* transport, TGenEventLogTransfer* record);
 
 gboolean tgentransport_wantsEvents(TGenTransport* transport);
 TGenEvent tgentransport_onEvent(TGenTransport* transport, TGenEvent events);
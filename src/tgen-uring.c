@@ -0,0 +1,684 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#include "tgen.h"
+
+#ifdef TGEN_HAVE_IO_URING
+
+#include <endian.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* the group id of our provided buffer ring, we only ever register one */
+#define TGEN_URING_BUFFER_GROUP 0
+
+/* a minimal io_uring wrapper that talks to the kernel directly, so that we
+ * do not depend on liburing. the submission ring collects readiness polls,
+ * socket reads and writes, accepts, and timeouts while the event loop runs,
+ * and they are all handed to the kernel with one io_uring_enter per loop. */
+struct _TGenURing {
+    gint ringD;
+
+    /* the submission ring, shared with the kernel */
+    guint* sqHead;
+    guint* sqTail;
+    guint* sqMask;
+    guint* sqArray;
+    guint sqEntries;
+    struct io_uring_sqe* sqes;
+    /* entries we filled but did not yet publish to the kernel */
+    guint sqLocalTail;
+
+    /* the completion ring, shared with the kernel */
+    guint* cqHead;
+    guint* cqTail;
+    guint* cqMask;
+    struct io_uring_cqe* cqes;
+
+    gpointer sqMap;
+    gsize sqMapLength;
+    gpointer cqMap;
+    gsize cqMapLength;
+    gpointer sqesMap;
+    gsize sqesMapLength;
+
+    /* TRUE if the kernel supports every opcode we use for socket io */
+    gboolean hasNetworkOps;
+
+    /* the provided buffers that socket reads complete into. the kernel picks
+     * a buffer from the ring for each read, and we give it back once consumed. */
+    struct io_uring_buf_ring* bufferRing;
+    gsize bufferRingLength;
+    guint16 bufferRingMask;
+    guint16 bufferRingTail;
+    guint8* buffers;
+    guint numBuffers;
+    guint bufferLength;
+
+#ifdef TGEN_HAVE_IO_URING_NET_OPS
+    /* the kernel copies the timeout when the request is submitted */
+    struct __kernel_timespec timeout;
+#endif
+
+    /* io_uring_enter calls since the last collection */
+    guint64 numEnters;
+
+    guint magic;
+};
+
+#ifdef TGEN_HAVE_IO_URING_NET_OPS
+/* the opcodes we use for socket io, each of which arrived in a different kernel version */
+static const guint8 tgenURingNetworkOps[] = {
+    IORING_OP_RECV, IORING_OP_SEND, IORING_OP_ACCEPT, IORING_OP_TIMEOUT,
+    IORING_OP_TIMEOUT_REMOVE, IORING_OP_ASYNC_CANCEL,
+};
+
+static gboolean _tgenuring_probeNetworkOps(TGenURing* ring, guint32 features) {
+    /* without fast poll, every read or write that would block is handed to a kernel worker thread */
+    if(!(features & IORING_FEAT_FAST_POLL)) {
+        tgen_info("io_uring %i does not support fast poll, using it for polls only", ring->ringD);
+        return FALSE;
+    }
+
+    guint numProbeOps = 256;
+    gsize probeLength = sizeof(struct io_uring_probe) + numProbeOps * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = g_malloc0(probeLength);
+
+    gint result = (gint)syscall(__NR_io_uring_register, ring->ringD, IORING_REGISTER_PROBE, probe, numProbeOps);
+    if(result < 0) {
+        tgen_info("io_uring_register(): io_uring %i probe returned %i error %i: %s, using it for polls only",
+                ring->ringD, result, errno, g_strerror(errno));
+        g_free(probe);
+        return FALSE;
+    }
+
+    gboolean isSupported = TRUE;
+    for(gsize i = 0; i < G_N_ELEMENTS(tgenURingNetworkOps); i++) {
+        guint8 op = tgenURingNetworkOps[i];
+        if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            tgen_info("io_uring %i does not support opcode %u, using it for polls only", ring->ringD, op);
+            isSupported = FALSE;
+            break;
+        }
+    }
+
+    g_free(probe);
+    return isSupported;
+}
+#endif
+
+TGenURing* tgenuring_new(guint numEntries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(struct io_uring_params));
+
+    gint ringD = (gint)syscall(__NR_io_uring_setup, numEntries, &params);
+    if(ringD < 0) {
+        tgen_warning("io_uring_setup(): returned %i error %i: %s", ringD, errno, g_strerror(errno));
+        return NULL;
+    }
+
+    /* without this the kernel drops completions when the completion ring
+     * overflows, and a dropped poll completion would stall its descriptor */
+    if(!(params.features & IORING_FEAT_NODROP)) {
+        tgen_warning("io_uring on this kernel may drop completions, refusing to use it");
+        close(ringD);
+        return NULL;
+    }
+
+    TGenURing* ring = g_new0(TGenURing, 1);
+    ring->magic = TGEN_MAGIC;
+    ring->ringD = ringD;
+
+    ring->sqMapLength = params.sq_off.array + params.sq_entries * sizeof(guint);
+    ring->cqMapLength = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesMapLength = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    gboolean isSingleMap = (params.features & IORING_FEAT_SINGLE_MMAP) ? TRUE : FALSE;
+    if(isSingleMap) {
+        ring->sqMapLength = ring->cqMapLength = MAX(ring->sqMapLength, ring->cqMapLength);
+    }
+
+    ring->sqMap = mmap(NULL, ring->sqMapLength, PROT_READ|PROT_WRITE,
+            MAP_SHARED|MAP_POPULATE, ringD, IORING_OFF_SQ_RING);
+    if(ring->sqMap == MAP_FAILED) {
+        ring->sqMap = NULL;
+        goto err;
+    }
+
+    if(isSingleMap) {
+        ring->cqMap = ring->sqMap;
+    } else {
+        ring->cqMap = mmap(NULL, ring->cqMapLength, PROT_READ|PROT_WRITE,
+                MAP_SHARED|MAP_POPULATE, ringD, IORING_OFF_CQ_RING);
+        if(ring->cqMap == MAP_FAILED) {
+            ring->cqMap = NULL;
+            goto err;
+        }
+    }
+
+    ring->sqesMap = mmap(NULL, ring->sqesMapLength, PROT_READ|PROT_WRITE,
+            MAP_SHARED|MAP_POPULATE, ringD, IORING_OFF_SQES);
+    if(ring->sqesMap == MAP_FAILED) {
+        ring->sqesMap = NULL;
+        goto err;
+    }
+
+    guint8* sq = ring->sqMap;
+    ring->sqHead = (guint*)(sq + params.sq_off.head);
+    ring->sqTail = (guint*)(sq + params.sq_off.tail);
+    ring->sqMask = (guint*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (guint*)(sq + params.sq_off.array);
+    ring->sqEntries = params.sq_entries;
+    ring->sqes = ring->sqesMap;
+    ring->sqLocalTail = *ring->sqTail;
+
+    guint8* cq = ring->cqMap;
+    ring->cqHead = (guint*)(cq + params.cq_off.head);
+    ring->cqTail = (guint*)(cq + params.cq_off.tail);
+    ring->cqMask = (guint*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+#ifdef TGEN_HAVE_IO_URING_NET_OPS
+    ring->hasNetworkOps = _tgenuring_probeNetworkOps(ring, params.features);
+#endif
+
+    tgen_info("created io_uring %i with %u submission and %u completion entries",
+            ringD, params.sq_entries, params.cq_entries);
+
+    return ring;
+
+err:
+    tgen_warning("mmap(): io_uring %i returned error %i: %s", ringD, errno, g_strerror(errno));
+    tgenuring_free(ring);
+    return NULL;
+}
+
+void tgenuring_free(TGenURing* ring) {
+    TGEN_ASSERT(ring);
+
+    if(ring->sqesMap) {
+        munmap(ring->sqesMap, ring->sqesMapLength);
+    }
+    if(ring->cqMap && ring->cqMap != ring->sqMap) {
+        munmap(ring->cqMap, ring->cqMapLength);
+    }
+    if(ring->sqMap) {
+        munmap(ring->sqMap, ring->sqMapLength);
+    }
+    if(ring->ringD > 0) {
+        close(ring->ringD);
+    }
+
+    /* the kernel drops its references to the buffers once the ring is closed */
+    if(ring->bufferRing) {
+        munmap(ring->bufferRing, ring->bufferRingLength);
+    }
+    if(ring->buffers) {
+        g_free(ring->buffers);
+    }
+
+    ring->magic = 0;
+    g_free(ring);
+}
+
+/* hands all pending submissions to the kernel. if wait is TRUE, this
+ * blocks until at least one completion is available. */
+void tgenuring_submit(TGenURing* ring, gboolean wait) {
+    TGEN_ASSERT(ring);
+
+    guint tail = *ring->sqTail;
+    guint numToSubmit = ring->sqLocalTail - tail;
+    if(numToSubmit == 0 && !wait) {
+        return;
+    }
+
+    /* we always fill the sqes in ring order, so the index array is the identity */
+    for(; tail != ring->sqLocalTail; tail++) {
+        guint idx = tail & *ring->sqMask;
+        ring->sqArray[idx] = idx;
+    }
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+
+    ring->numEnters++;
+    gint result = (gint)syscall(__NR_io_uring_enter, ring->ringD, numToSubmit,
+            wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if(result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        tgen_warning("io_uring_enter(): io_uring %i returned %i error %i: %s",
+                ring->ringD, result, errno, g_strerror(errno));
+    }
+}
+
+static struct io_uring_sqe* _tgenuring_getSQE(TGenURing* ring) {
+    guint head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+    if(ring->sqLocalTail - head >= ring->sqEntries) {
+        /* the ring is full, hand what we have to the kernel to make room */
+        tgenuring_submit(ring, FALSE);
+        head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+        if(ring->sqLocalTail - head >= ring->sqEntries) {
+            return NULL;
+        }
+    }
+
+    struct io_uring_sqe* sqe = &ring->sqes[ring->sqLocalTail & *ring->sqMask];
+    ring->sqLocalTail++;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+/* arm a one-shot poll for the events on the descriptor. its completion
+ * carries the user data and the ready events (or a negative errno). */
+gboolean tgenuring_pollAdd(TGenURing* ring, gint descriptor, guint32 pollEvents, guint64 userData) {
+    TGEN_ASSERT(ring);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to poll descriptor %i",
+                ring->ringD, descriptor);
+        return FALSE;
+    }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = descriptor;
+    sqe->user_data = userData;
+
+#ifdef TGEN_HAVE_IO_URING_POLL32
+#if __BYTE_ORDER == __BIG_ENDIAN
+    pollEvents = (pollEvents << 16) | (pollEvents >> 16);
+#endif
+    sqe->poll32_events = pollEvents;
+#else
+    /* the events we poll for all fit in the low 16 bits */
+    sqe->poll_events = (__u16)pollEvents;
+#endif
+
+    return TRUE;
+}
+
+/* cancel the poll that was armed with the user data. the canceled poll
+ * completes with -ECANCELED, and the removal itself completes with user data 0. */
+gboolean tgenuring_pollRemove(TGenURing* ring, guint64 userData) {
+    TGEN_ASSERT(ring);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to remove poll", ring->ringD);
+        return FALSE;
+    }
+
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = 0;
+    return TRUE;
+}
+
+guint tgenuring_getNumCompletions(TGenURing* ring) {
+    TGEN_ASSERT(ring);
+    return __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE) - *ring->cqHead;
+}
+
+/* pops the next completion. the buffer id is the provided buffer that a
+ * read completed into (see tgenuring_recv), or -1 if there is none. */
+gboolean tgenuring_popCompletion(TGenURing* ring, guint64* userData, gint32* result, gint32* bufferID) {
+    TGEN_ASSERT(ring);
+
+    guint head = *ring->cqHead;
+    if(head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+        return FALSE;
+    }
+
+    struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+    if(userData) {
+        *userData = (guint64)cqe->user_data;
+    }
+    if(result) {
+        *result = (gint32)cqe->res;
+    }
+    if(bufferID) {
+#ifdef TGEN_HAVE_IO_URING_NET_OPS
+        *bufferID = (cqe->flags & IORING_CQE_F_BUFFER) ? (gint32)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+#else
+        *bufferID = -1;
+#endif
+    }
+
+    __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+gboolean tgenuring_supportsNetworkOps(TGenURing* ring) {
+    TGEN_ASSERT(ring);
+    return ring->hasNetworkOps;
+}
+
+#ifdef TGEN_HAVE_IO_URING_NET_OPS
+
+static void _tgenuring_addBuffer(TGenURing* ring, guint16 bufferID, guint16 offset) {
+    struct io_uring_buf* buf = &ring->bufferRing->bufs[(ring->bufferRingTail + offset) & ring->bufferRingMask];
+    buf->addr = (__u64)(guintptr)(ring->buffers + ((gsize)bufferID * ring->bufferLength));
+    buf->len = ring->bufferLength;
+    buf->bid = bufferID;
+}
+
+/* registers numBuffers buffers (a power of 2) of bufferLength bytes each
+ * that the kernel picks from when a socket read completes. returns FALSE if
+ * the kernel does not support provided buffer rings. */
+gboolean tgenuring_registerBufferRing(TGenURing* ring, guint numBuffers, guint bufferLength) {
+    TGEN_ASSERT(ring);
+    g_assert(ring->hasNetworkOps && !ring->bufferRing);
+    g_assert(numBuffers > 0 && numBuffers <= 32768 && (numBuffers & (numBuffers - 1)) == 0);
+
+    /* the ring must be page aligned, which mmap guarantees */
+    gsize ringLength = numBuffers * sizeof(struct io_uring_buf);
+    gpointer ringMap = mmap(NULL, ringLength, PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+    if(ringMap == MAP_FAILED) {
+        tgen_warning("mmap(): io_uring %i buffer ring returned error %i: %s",
+                ring->ringD, errno, g_strerror(errno));
+        return FALSE;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(struct io_uring_buf_reg));
+    reg.ring_addr = (__u64)(guintptr)ringMap;
+    reg.ring_entries = numBuffers;
+    reg.bgid = TGEN_URING_BUFFER_GROUP;
+
+    gint result = (gint)syscall(__NR_io_uring_register, ring->ringD, IORING_REGISTER_PBUF_RING, &reg, 1);
+    if(result < 0) {
+        tgen_info("io_uring_register(): io_uring %i buffer ring returned %i error %i: %s",
+                ring->ringD, result, errno, g_strerror(errno));
+        munmap(ringMap, ringLength);
+        return FALSE;
+    }
+
+    ring->bufferRing = ringMap;
+    ring->bufferRingLength = ringLength;
+    ring->bufferRingMask = (guint16)(numBuffers - 1);
+    ring->bufferRingTail = 0;
+    ring->buffers = g_malloc((gsize)numBuffers * bufferLength);
+    ring->numBuffers = numBuffers;
+    ring->bufferLength = bufferLength;
+
+    /* hand all of the buffers to the kernel */
+    for(guint i = 0; i < numBuffers; i++) {
+        _tgenuring_addBuffer(ring, (guint16)i, (guint16)i);
+    }
+    ring->bufferRingTail = (guint16)(ring->bufferRingTail + numBuffers);
+    __atomic_store_n(&ring->bufferRing->tail, ring->bufferRingTail, __ATOMIC_RELEASE);
+
+    tgen_info("registered %u buffers of %u bytes with io_uring %i", numBuffers, bufferLength, ring->ringD);
+    return TRUE;
+}
+
+gpointer tgenuring_getBuffer(TGenURing* ring, guint16 bufferID) {
+    TGEN_ASSERT(ring);
+    g_assert(ring->buffers && bufferID < ring->numBuffers);
+    return ring->buffers + ((gsize)bufferID * ring->bufferLength);
+}
+
+guint tgenuring_getBufferLength(TGenURing* ring) {
+    TGEN_ASSERT(ring);
+    return ring->bufferLength;
+}
+
+/* gives a buffer that a read completed into back to the kernel */
+void tgenuring_recycleBuffer(TGenURing* ring, guint16 bufferID) {
+    TGEN_ASSERT(ring);
+    g_assert(ring->buffers && bufferID < ring->numBuffers);
+
+    _tgenuring_addBuffer(ring, bufferID, 0);
+    ring->bufferRingTail++;
+    __atomic_store_n(&ring->bufferRing->tail, ring->bufferRingTail, __ATOMIC_RELEASE);
+}
+
+/* read from the socket into one of the registered buffers. the completion
+ * carries the number of bytes read (0 at end of stream) and the id of the
+ * buffer it used. it fails with -ENOBUFS if all buffers are in use. */
+gboolean tgenuring_recv(TGenURing* ring, gint descriptor, guint64 userData) {
+    TGEN_ASSERT(ring);
+    g_assert(ring->bufferRing);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to read descriptor %i",
+                ring->ringD, descriptor);
+        return FALSE;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = descriptor;
+    sqe->len = ring->bufferLength;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = TGEN_URING_BUFFER_GROUP;
+    sqe->user_data = userData;
+    return TRUE;
+}
+
+/* write the buffer to the socket. the buffer must stay valid until the
+ * completion, which carries the number of bytes written. */
+gboolean tgenuring_send(TGenURing* ring, gint descriptor, gconstpointer buffer, gsize length, guint64 userData) {
+    TGEN_ASSERT(ring);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to write descriptor %i",
+                ring->ringD, descriptor);
+        return FALSE;
+    }
+
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = descriptor;
+    sqe->addr = (__u64)(guintptr)buffer;
+    sqe->len = (__u32)MIN(length, (gsize)G_MAXINT32);
+    /* a peer that closed early must not kill us */
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData;
+    return TRUE;
+}
+
+/* accept a connection on the listening socket. the address must stay valid
+ * until the completion, which carries the new socket descriptor. */
+gboolean tgenuring_accept(TGenURing* ring, gint descriptor, struct sockaddr* address,
+        socklen_t* addressLength, guint64 userData) {
+    TGEN_ASSERT(ring);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to accept on descriptor %i",
+                ring->ringD, descriptor);
+        return FALSE;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = descriptor;
+    sqe->addr = (__u64)(guintptr)address;
+    sqe->addr2 = (__u64)(guintptr)addressLength;
+    sqe->user_data = userData;
+    return TRUE;
+}
+
+/* completes with -ETIME once the time passed. the timeout is copied when it
+ * is submitted, so only one may be waiting for submission at a time. */
+gboolean tgenuring_timeout(TGenURing* ring, gint64 timeoutMicros, guint64 userData) {
+    TGEN_ASSERT(ring);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to add timeout", ring->ringD);
+        return FALSE;
+    }
+
+    ring->timeout.tv_sec = timeoutMicros / 1000000;
+    ring->timeout.tv_nsec = (timeoutMicros % 1000000) * 1000;
+
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (__u64)(guintptr)&ring->timeout;
+    sqe->len = 1;
+    sqe->user_data = userData;
+    return TRUE;
+}
+
+/* cancel the timeout that was added with the user data. the canceled timeout
+ * completes with -ECANCELED, and the removal itself completes with user data 0. */
+gboolean tgenuring_timeoutRemove(TGenURing* ring, guint64 userData) {
+    TGEN_ASSERT(ring);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to remove timeout", ring->ringD);
+        return FALSE;
+    }
+
+    sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = 0;
+    return TRUE;
+}
+
+/* cancel the read, write, or accept that was submitted with the user data.
+ * the canceled request completes with -ECANCELED unless it already finished,
+ * and the cancellation itself completes with user data 0. */
+gboolean tgenuring_cancel(TGenURing* ring, guint64 userData) {
+    TGEN_ASSERT(ring);
+
+    struct io_uring_sqe* sqe = _tgenuring_getSQE(ring);
+    if(!sqe) {
+        tgen_warning("io_uring %i submission ring is full, unable to cancel request", ring->ringD);
+        return FALSE;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = 0;
+    return TRUE;
+}
+
+#else /* TGEN_HAVE_IO_URING_NET_OPS */
+
+/* the kernel headers we were built against can not describe socket io, so
+ * tgenuring_supportsNetworkOps never returns TRUE */
+
+gboolean tgenuring_registerBufferRing(TGenURing* ring, guint numBuffers, guint bufferLength) {
+    return FALSE;
+}
+
+gpointer tgenuring_getBuffer(TGenURing* ring, guint16 bufferID) {
+    g_assert_not_reached();
+    return NULL;
+}
+
+guint tgenuring_getBufferLength(TGenURing* ring) {
+    g_assert_not_reached();
+    return 0;
+}
+
+void tgenuring_recycleBuffer(TGenURing* ring, guint16 bufferID) {
+    g_assert_not_reached();
+}
+
+gboolean tgenuring_recv(TGenURing* ring, gint descriptor, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+gboolean tgenuring_send(TGenURing* ring, gint descriptor, gconstpointer buffer, gsize length, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+gboolean tgenuring_accept(TGenURing* ring, gint descriptor, struct sockaddr* address,
+        socklen_t* addressLength, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+gboolean tgenuring_timeout(TGenURing* ring, gint64 timeoutMicros, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+gboolean tgenuring_timeoutRemove(TGenURing* ring, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+gboolean tgenuring_cancel(TGenURing* ring, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+#endif /* TGEN_HAVE_IO_URING_NET_OPS */
+
+/* the ring descriptor is readable whenever completions are waiting */
+gint tgenuring_getDescriptor(TGenURing* ring) {
+    TGEN_ASSERT(ring);
+    return ring->ringD;
+}
+
+guint64 tgenuring_collectNumEnters(TGenURing* ring) {
+    TGEN_ASSERT(ring);
+    guint64 numEnters = ring->numEnters;
+    ring->numEnters = 0;
+    return numEnters;
+}
+
+#else /* TGEN_HAVE_IO_URING */
+
+struct _TGenURing {
+    guint magic;
+};
+
+TGenURing* tgenuring_new(guint numEntries) {
+    tgen_warning("tgen was built without io_uring support");
+    return NULL;
+}
+
+void tgenuring_free(TGenURing* ring) {
+    g_assert_not_reached();
+}
+
+gboolean tgenuring_pollAdd(TGenURing* ring, gint descriptor, guint32 pollEvents, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+gboolean tgenuring_pollRemove(TGenURing* ring, guint64 userData) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+void tgenuring_submit(TGenURing* ring, gboolean wait) {
+    g_assert_not_reached();
+}
+
+guint tgenuring_getNumCompletions(TGenURing* ring) {
+    g_assert_not_reached();
+    return 0;
+}
+
+/* pops the next completion. the buffer id is the provided buffer that a
+ * read completed into (see tgenuring_recv), or -1 if there is none. */
+gboolean tgenuring_popCompletion(TGenURing* ring, guint64* userData, gint32* result, gint32* bufferID) {
+    g_assert_not_reached();
+    return FALSE;
+}
+
+gint tgenuring_getDescriptor(TGenURing* ring) {
+    g_assert_not_reached();
+    return -1;
+}
+
+guint64 tgenuring_collectNumEnters(TGenURing* ring) {
+    g_assert_not_reached();
+    return 0;
+}
+
+#endif /* TGEN_HAVE_IO_URING */
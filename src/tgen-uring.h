@@ -0,0 +1,42 @@
+/*
+ * The Shadow Simulator
+ * See LICENSE for licensing information
+ */
+
+#ifndef TGEN_URING_H_
+#define TGEN_URING_H_
+
+#include <glib.h>
+#include <sys/socket.h>
+
+typedef struct _TGenURing TGenURing;
+
+/* returns NULL if io_uring is not supported by this build or kernel */
+TGenURing* tgenuring_new(guint numEntries);
+void tgenuring_free(TGenURing* ring);
+
+gboolean tgenuring_pollAdd(TGenURing* ring, gint descriptor, guint32 pollEvents, guint64 userData);
+gboolean tgenuring_pollRemove(TGenURing* ring, guint64 userData);
+void tgenuring_submit(TGenURing* ring, gboolean wait);
+guint tgenuring_getNumCompletions(TGenURing* ring);
+gboolean tgenuring_popCompletion(TGenURing* ring, guint64* userData, gint32* result, gint32* bufferID);
+
+/* socket reads, writes, accepts, and timeouts through the ring. these may only
+ * be used if tgenuring_supportsNetworkOps returns TRUE. */
+gboolean tgenuring_supportsNetworkOps(TGenURing* ring);
+gboolean tgenuring_registerBufferRing(TGenURing* ring, guint numBuffers, guint bufferLength);
+gpointer tgenuring_getBuffer(TGenURing* ring, guint16 bufferID);
+guint tgenuring_getBufferLength(TGenURing* ring);
+void tgenuring_recycleBuffer(TGenURing* ring, guint16 bufferID);
+gboolean tgenuring_recv(TGenURing* ring, gint descriptor, guint64 userData);
+gboolean tgenuring_send(TGenURing* ring, gint descriptor, gconstpointer buffer, gsize length, guint64 userData);
+gboolean tgenuring_accept(TGenURing* ring, gint descriptor, struct sockaddr* address,
+        socklen_t* addressLength, guint64 userData);
+gboolean tgenuring_timeout(TGenURing* ring, gint64 timeoutMicros, guint64 userData);
+gboolean tgenuring_timeoutRemove(TGenURing* ring, guint64 userData);
+gboolean tgenuring_cancel(TGenURing* ring, guint64 userData);
+
+gint tgenuring_getDescriptor(TGenURing* ring);
+guint64 tgenuring_collectNumEnters(TGenURing* ring);
+
+#endif /* TGEN_URING_H_ */
@@ -27,12 +27,20 @@
 #endif
 
 #include "tgen-log.h"
-#include "tgen-io.h"
+#include "tgen-slab.h"
+#include "tgen-eventlog.h"
+#include "tgen-histogram.h"
+#include "tgen-random.h"
 #include "tgen-timer.h"
+#include "tgen-uring.h"
+#include "tgen-io.h"
 #include "tgen-pool.h"
 #include "tgen-peer.h"
 #include "tgen-server.h"
 #include "tgen-transport.h"
+#include "tgen-payload.h"
+#include "tgen-checksum.h"
+#include "tgen-schedule.h"
 #include "tgen-transfer.h"
 #include "tgen-action.h"
 #include "tgen-markovmodel.h"
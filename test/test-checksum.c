@@ -0,0 +1,216 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "tgen-log.h"
+#include "tgen-checksum.h"
+
+/* the sanity check of the reference xxhsum fills its buffer like this, and
+ * publishes the sums of its prefixes */
+#define TEST_BUFFER_LENGTH 4161
+#define TEST_PRIME32 2654435761U
+#define TEST_PRIME64 11400714785074694797ULL
+
+typedef TGenChecksum* (*NewChecksumFunc)(TGenChecksumType type);
+
+typedef struct _XXHAnswer {
+    gsize length;
+    guint64 xxh64;
+    guint64 xxh3;
+} XXHAnswer;
+
+typedef struct _CRCAnswer {
+    const gchar* name;
+    guchar input[32];
+    gsize length;
+    guint32 crc32c;
+} CRCAnswer;
+
+/* xxh3 hashes up to 16 bytes, up to 240 bytes, and longer inputs differently,
+ * and longer inputs in blocks of 1024 bytes, so we check around each edge */
+static const XXHAnswer xxhAnswers[] = {
+    {0, 0xEF46DB3751D8E999ULL, 0x2D06800538D394C2ULL},
+    {1, 0xE934A84ADB052768ULL, 0xC44BDFF4074EECDBULL},
+    {3, 0xFF7E1959CB50794AULL, 0x54247382A8D6B94DULL},
+    {4, 0x9136A0DCA57457EEULL, 0xE5DC74BC51848A51ULL},
+    {8, 0xCDBCF538E71D1348ULL, 0x24CCC9ACAA9F65E4ULL},
+    {9, 0x554B1AE991EDA6B6ULL, 0x14D5001C15DD3F2BULL},
+    {16, 0x98C90B57FDFCB55CULL, 0x981B17D36C7498C9ULL},
+    {17, 0x0D39A2D051A30C2CULL, 0x796F5ACD3A60F862ULL},
+    {128, 0x90CA021457D96DC5ULL, 0xFCFF24126754D861ULL},
+    {129, 0x41C280132D697ABAULL, 0x98F1B0A679A2CA29ULL},
+    {240, 0xB81838D483BAEE53ULL, 0x81C3C2B67F568CCFULL},
+    {241, 0x95D76C8B4D8FC4D6ULL, 0xC5A639ECD2030E5EULL},
+    {1024, 0x4775BF7CACE4D177ULL, 0xDD85C9B5C1109C5CULL},
+    {1025, 0x847FA6006D7C2AC0ULL, 0xD870C0FA13211C6AULL},
+    {2048, 0x5940F2752BC04387ULL, 0xDD59E2C3A5F038E0ULL},
+    {2367, 0xA82418DDEC0EA581ULL, 0xCB37AEB9E5D361EDULL},
+    {4161, 0xCD3D6DF2DB509A75ULL, 0xEFB6CCB06C0B206AULL},
+};
+
+/* from RFC 3720 (iSCSI) appendix B.4, and the usual check string */
+static const CRCAnswer crcAnswers[] = {
+    {"check string", "123456789", 9, 0xE3069283U},
+    {"32 bytes of zeroes", {0}, 32, 0x8A9136AAU},
+    {"32 bytes of ones", {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+            32, 0x62A8AB43U},
+    {"32 incrementing bytes", {
+            0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+            0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F},
+            32, 0x46DD794EU},
+    {"32 decrementing bytes", {
+            0x1F, 0x1E, 0x1D, 0x1C, 0x1B, 0x1A, 0x19, 0x18, 0x17, 0x16, 0x15, 0x14, 0x13, 0x12, 0x11, 0x10,
+            0x0F, 0x0E, 0x0D, 0x0C, 0x0B, 0x0A, 0x09, 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00},
+            32, 0x113FDB5CU},
+};
+
+/* the sse4.2 kernel works on 8 bytes at a time, so we also check a long odd input */
+#define TEST_CRC32C_BUFFER 0x79DCD8E3U
+
+/* odd chunk lengths, so the updates never line up with stripes or blocks */
+static const gsize chunkLengths[] = {1, 3, 7, 13, 61, 67, 255, 257};
+
+static void fillTestBuffer(guchar* buffer, gsize length) {
+    guint64 byteGen = TEST_PRIME32;
+    for(gsize i = 0; i < length; i++) {
+        buffer[i] = (guchar)(byteGen >> 56);
+        byteGen *= TEST_PRIME64;
+    }
+}
+
+static guint64 getDigest(TGenChecksum* checksum) {
+    gsize length = 0;
+    const guint8* digest = tgenchecksum_getDigest(checksum, &length);
+
+    guint64 value = 0;
+    for(gsize i = 0; i < length; i++) {
+        value = (value << 8) | digest[i];
+    }
+    return value;
+}
+
+static guint64 sumOnce(NewChecksumFunc newChecksum, TGenChecksumType type,
+        const guchar* data, gsize length) {
+    TGenChecksum* checksum = newChecksum(type);
+    tgenchecksum_update(checksum, data, length);
+    guint64 value = getDigest(checksum);
+    tgenchecksum_free(checksum);
+    return value;
+}
+
+static guint64 sumChunked(NewChecksumFunc newChecksum, TGenChecksumType type,
+        const guchar* data, gsize length) {
+    TGenChecksum* checksum = newChecksum(type);
+    gsize offset = 0;
+    for(gsize i = 0; offset < length; i++) {
+        gsize chunkLength = MIN(chunkLengths[i % G_N_ELEMENTS(chunkLengths)], length - offset);
+        tgenchecksum_update(checksum, data + offset, chunkLength);
+        offset += chunkLength;
+    }
+    guint64 value = getDigest(checksum);
+    tgenchecksum_free(checksum);
+    return value;
+}
+
+static guint64 sumSplit(NewChecksumFunc newChecksum, TGenChecksumType type,
+        const guchar* data, gsize length, gsize splitOffset) {
+    TGenChecksum* checksum = newChecksum(type);
+    tgenchecksum_update(checksum, data, splitOffset);
+    tgenchecksum_update(checksum, data + splitOffset, length - splitOffset);
+    guint64 value = getDigest(checksum);
+    tgenchecksum_free(checksum);
+    return value;
+}
+
+/* checks the sum of one update, of odd chunks, and of two updates split at every odd offset */
+static gboolean checkAnswer(NewChecksumFunc newChecksum, const gchar* kernelName,
+        TGenChecksumType type, const guchar* data, gsize length, guint64 expected) {
+    const gchar* typeName = tgenchecksum_typeToString(type);
+    gboolean isSuccess = TRUE;
+
+    guint64 value = sumOnce(newChecksum, type, data, length);
+    if(value != expected) {
+        tgen_warning("%s %s of %"G_GSIZE_FORMAT" bytes is %016"G_GINT64_MODIFIER"x, "
+                "expected %016"G_GINT64_MODIFIER"x", kernelName, typeName, length, value, expected);
+        isSuccess = FALSE;
+    }
+
+    value = sumChunked(newChecksum, type, data, length);
+    if(value != expected) {
+        tgen_warning("%s %s of %"G_GSIZE_FORMAT" bytes in odd chunks is %016"G_GINT64_MODIFIER"x, "
+                "expected %016"G_GINT64_MODIFIER"x", kernelName, typeName, length, value, expected);
+        isSuccess = FALSE;
+    }
+
+    for(gsize splitOffset = 1; splitOffset < length; splitOffset += 2) {
+        value = sumSplit(newChecksum, type, data, length, splitOffset);
+        if(value != expected) {
+            tgen_warning("%s %s of %"G_GSIZE_FORMAT" bytes split at %"G_GSIZE_FORMAT" is "
+                    "%016"G_GINT64_MODIFIER"x, expected %016"G_GINT64_MODIFIER"x",
+                    kernelName, typeName, length, splitOffset, value, expected);
+            isSuccess = FALSE;
+            break;
+        }
+    }
+
+    return isSuccess;
+}
+
+static guint checkKernels(NewChecksumFunc newChecksum, const gchar* kernelName,
+        const guchar* buffer) {
+    guint numFailed = 0;
+
+    for(gsize i = 0; i < G_N_ELEMENTS(crcAnswers); i++) {
+        const CRCAnswer* answer = &crcAnswers[i];
+        if(!checkAnswer(newChecksum, kernelName, TGEN_CHECKSUM_CRC32C,
+                answer->input, answer->length, answer->crc32c)) {
+            tgen_warning("failed crc32c vector '%s'", answer->name);
+            numFailed++;
+        }
+    }
+
+    if(!checkAnswer(newChecksum, kernelName, TGEN_CHECKSUM_CRC32C,
+            buffer, TEST_BUFFER_LENGTH, TEST_CRC32C_BUFFER)) {
+        numFailed++;
+    }
+
+    for(gsize i = 0; i < G_N_ELEMENTS(xxhAnswers); i++) {
+        const XXHAnswer* answer = &xxhAnswers[i];
+        if(!checkAnswer(newChecksum, kernelName, TGEN_CHECKSUM_XXH64,
+                buffer, answer->length, answer->xxh64)) {
+            numFailed++;
+        }
+        if(!checkAnswer(newChecksum, kernelName, TGEN_CHECKSUM_XXH3,
+                buffer, answer->length, answer->xxh3)) {
+            numFailed++;
+        }
+    }
+
+    tgen_info("%s kernels: %u failed checks", kernelName, numFailed);
+    return numFailed;
+}
+
+gint main(gint argc, gchar *argv[]) {
+    tgenlog_setLogFilterLevel(G_LOG_LEVEL_INFO);
+
+    guchar* buffer = g_malloc(TEST_BUFFER_LENGTH);
+    fillTestBuffer(buffer, TEST_BUFFER_LENGTH);
+
+    /* the fastest kernels the cpu supports, and the portable ones they must match */
+    guint numFailed = checkKernels(tgenchecksum_new, "native", buffer);
+    numFailed += checkKernels(tgenchecksum_newPortable, "portable", buffer);
+
+    g_free(buffer);
+
+    if(numFailed > 0) {
+        tgen_warning("%u checksum checks failed", numFailed);
+        return EXIT_FAILURE;
+    }
+
+    tgen_message("all checksum checks passed");
+    return EXIT_SUCCESS;
+}
@@ -81,6 +81,34 @@ static void generate(TGenMarkovModel* mmodel) {
     }
 }
 
+/* generates without logging each observation, so we measure the model and not the log */
+static void measure(TGenMarkovModel* mmodel) {
+    guint64 totalDelay = 0;
+    guint numEnds = 0;
+
+    tgenmarkovmodel_reset(mmodel);
+
+    gint64 start = g_get_monotonic_time();
+
+    for(gsize numObservations = 0; numObservations < NUM_OBS; numObservations++) {
+        guint64 delay = 0;
+        Observation obs = tgenmarkovmodel_getNextObservation(mmodel, &delay);
+        totalDelay += delay;
+
+        if(obs == OBSERVATION_END) {
+            numEnds++;
+            tgenmarkovmodel_reset(mmodel);
+        }
+    }
+
+    gint64 elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+    tgen_message("Generated %u observations with %u end observations and total delay "
+            "%"G_GUINT64_FORMAT" in %"G_GINT64_FORMAT" microseconds (%.0f observations/sec)",
+            (guint)NUM_OBS, numEnds, totalDelay, elapsed,
+            ((gdouble)NUM_OBS) * G_USEC_PER_SEC / (gdouble)elapsed);
+}
+
 gint main(gint argc, gchar *argv[]) {
     tgenlog_setLogFilterLevel(G_LOG_LEVEL_INFO);
 
@@ -122,6 +150,7 @@ gint main(gint argc, gchar *argv[]) {
     }
 
     generate(markovModel);
+    measure(markovModel);
 
     tgenmarkovmodel_unref(markovModel);
     g_string_free(graphString, TRUE);
@@ -4,7 +4,7 @@
   See LICENSE for licensing information
 '''
 
-import sys, os, re, json, datetime, logging
+import sys, os, re, json, datetime, logging, struct
 
 from multiprocessing import Pool, cpu_count
 from signal import signal, SIGINT, SIG_IGN
@@ -251,6 +251,114 @@ class TransferErrorEvent(TransferCompleteEvent):
         super(TransferErrorEvent, self).__init__(line)
         self.is_error = True
 
+class TransferRecordEvent(object):
+    ''' a transfer-complete or transfer-error event from a binary event log record '''
+
+    METHODS = {0: 'NONE', 1: 'GET', 2: 'PUT', 3: 'GETPUT', 4: 'SCHEDULE'}
+    ERRORS = {0: 'NONE', 1: 'AUTH', 2: 'READ', 3: 'WRITE', 4: 'TIMEOUT', 5: 'STALLOUT', 6: 'PROXY', 7: 'MISC'}
+    STEPS = ['socket_create', 'socket_connect', 'proxy_init', 'proxy_choice', 'proxy_request',
+             'proxy_response', 'command', 'response', 'first_byte', 'last_byte', 'checksum']
+
+    def __init__(self, fields, strings):
+        (end_micros, id_sid, hostname_sid, remote_name_sid, method, error, flags, _,
+            count, remote_count, size, total_read, total_write, payload_read, payload_write) = fields[0:15]
+        endpoints = [fields[15:19], fields[19:23], fields[23:27]]
+        steps = fields[27:]
+
+        self.is_success = (flags & 0x01) != 0
+        self.is_error = not self.is_success
+        self.is_complete = True
+        self.unix_ts_end = end_micros / 1000000.0
+
+        self.endpoint_local, self.endpoint_proxy, self.endpoint_remote = \
+            [self.__endpoint_to_string(e, strings) for e in endpoints]
+
+        self.transfer_id = "{0}:{1}".format(strings.get(id_sid), count)  # id:count
+        self.hostname_local = strings.get(hostname_sid)
+        self.method = TransferRecordEvent.METHODS.get(method, 'NONE')
+        self.filesize_bytes = size
+        self.hostname_remote = strings.get(remote_name_sid)
+        self.error_code = TransferRecordEvent.ERRORS.get(error, 'MISC')
+
+        self.total_bytes_read = total_read
+        self.total_bytes_write = total_write
+
+        self.is_commander = (flags & 0x02) != 0
+        self.payload_bytes_status = payload_write if self.method == 'PUT' else payload_read
+
+        self.elapsed_seconds = {}
+        elapsed_seconds = 0.0
+        for (k, usecs) in zip(TransferRecordEvent.STEPS, steps):
+            if usecs >= 0:
+                elapsed_seconds = usecs / 1000000.0  # usecs to secs
+                self.elapsed_seconds.setdefault(k, elapsed_seconds)
+        self.unix_ts_start = self.unix_ts_end - elapsed_seconds
+
+    def __endpoint_to_string(self, endpoint, strings):
+        # the same format as the endpoints in the text log
+        (name_sid, ip, port, _) = endpoint
+        name = strings.get(name_sid)
+        return "{0}:{1}:{2}".format(name if name is not None else "NULL",
+            ".".join([str(b) for b in bytearray(ip)]), port)
+
+class TGenEventLog(object):
+    ''' reads the records of the binary event log that tgen writes if the
+    'eventlog' start attribute is set. see doc/TGen-EventLog.md for the format. '''
+
+    MAGIC = b"TGENEVTS"
+    VERSION = 1
+
+    RECORD_STRING = 1
+    RECORD_NODE = 2
+    RECORD_TRANSFER = 3
+    RECORD_HEARTBEAT = 4
+
+    FILE_HEADER = struct.Struct("<8sII")
+    RECORD_HEADER = struct.Struct("<HH")
+    NODE = struct.Struct("<IIQ")
+    TRANSFER = struct.Struct("<Q3I4B7Q" + "I4sHH" * 3 + "11q")
+    HEARTBEAT = struct.Struct("<IQ4Q")
+
+    def __init__(self, source):
+        self.source = source
+        self.strings = {0: None}
+        self.name = None
+
+    def __iter__(self):
+        ''' yields the transfer events in the log '''
+        self.source.open()
+        f = self.source.get_file_handle()
+
+        (magic, version, _) = TGenEventLog.FILE_HEADER.unpack(f.read(TGenEventLog.FILE_HEADER.size))
+        if magic != TGenEventLog.MAGIC or version != TGenEventLog.VERSION:
+            self.source.close()
+            raise ValueError("unsupported tgen event log version {0}".format(version))
+
+        while True:
+            header = f.read(TGenEventLog.RECORD_HEADER.size)
+            if len(header) < TGenEventLog.RECORD_HEADER.size:
+                break
+            (record_type, length) = TGenEventLog.RECORD_HEADER.unpack(header)
+            body_length = length - TGenEventLog.RECORD_HEADER.size
+            body = f.read(body_length)
+            if len(body) < body_length:
+                # tgen was killed while writing the last record
+                logging.warning("TGenEventLog: ignoring truncated record at the end of the log")
+                break
+
+            if record_type == TGenEventLog.RECORD_STRING:
+                (sid,) = struct.unpack_from("<I", body)
+                self.strings[sid] = body[4:].decode('utf-8', 'replace')
+            elif record_type == TGenEventLog.RECORD_NODE:
+                (hostname_sid, _, _) = TGenEventLog.NODE.unpack_from(body)
+                if self.name is None:
+                    self.name = self.strings.get(hostname_sid)
+            elif record_type == TGenEventLog.RECORD_TRANSFER:
+                yield TransferRecordEvent(TGenEventLog.TRANSFER.unpack_from(body), self.strings)
+            # we skip heartbeats and the record types of newer versions
+
+        self.source.close()
+
 class Transfer(object):
     def __init__(self, tid):
         self.id = tid
@@ -331,40 +439,52 @@ class TGenParser(Parser):
             xfer.add_event(status)
 
         elif re.search("transfer-complete", line) is not None:
-            complete = TransferSuccessEvent(line)
+            self.__add_complete_event(TransferSuccessEvent(line), do_simple)
+
+        elif re.search("transfer-error", line) is not None:
+            self.__add_complete_event(TransferErrorEvent(line), do_simple)
+
+        return True
+
+    def __add_complete_event(self, event, do_simple):
+        if not do_simple:
+            xfer = self.state.setdefault(event.transfer_id, Transfer(event.transfer_id))
+            xfer.add_event(event)
+            self.transfers[xfer.id] = xfer.get_data()
+            self.state.pop(event.transfer_id)
 
-            if not do_simple:
-                xfer = self.state.setdefault(complete.transfer_id, Transfer(complete.transfer_id))
-                xfer.add_event(complete)
-                self.transfers[xfer.id] = xfer.get_data()
-                self.state.pop(complete.transfer_id)
+        filesize, second = event.filesize_bytes, int(event.unix_ts_end)
 
-            filesize, second = complete.filesize_bytes, int(complete.unix_ts_end)
-            fb_secs = complete.elapsed_seconds['first_byte'] - complete.elapsed_seconds['command']
-            lb_secs = complete.elapsed_seconds['last_byte'] - complete.elapsed_seconds['command']
+        if event.is_success:
+            fb_secs = event.elapsed_seconds['first_byte'] - event.elapsed_seconds['command']
+            lb_secs = event.elapsed_seconds['last_byte'] - event.elapsed_seconds['command']
 
             fb_list = self.transfers_summary['time_to_first_byte'].setdefault(filesize, {}).setdefault(second, [])
             fb_list.append(fb_secs)
             lb_list = self.transfers_summary['time_to_last_byte'].setdefault(filesize, {}).setdefault(second, [])
             lb_list.append(lb_secs)
-
-        elif re.search("transfer-error", line) is not None:
-            error = TransferErrorEvent(line)
-
-            if not do_simple:
-                xfer = self.state.setdefault(error.transfer_id, Transfer(error.transfer_id))
-                xfer.add_event(error)
-                self.transfers[xfer.id] = xfer.get_data()
-                self.state.pop(error.transfer_id)
-
-            err_code, filesize, second = error.error_code, error.filesize_bytes, int(error.unix_ts_end)
-
-            err_list = self.transfers_summary['errors'].setdefault(err_code, {}).setdefault(second, [])
+        else:
+            err_list = self.transfers_summary['errors'].setdefault(event.error_code, {}).setdefault(second, [])
             err_list.append(filesize)
 
-        return True
+    def __parse_event_log(self, source, do_simple):
+        event_log = TGenEventLog(util.DataSource(source.filename, compress=source.compress, binary=True))
+        for event in event_log:
+            if self.date_filter is not None:
+                event_date = datetime.datetime.utcfromtimestamp(event.unix_ts_end).date()
+                if not self.__is_date_valid(event_date):
+                    continue
+            self.__add_complete_event(event, do_simple)
+        if self.name is None:
+            self.name = event_log.name
 
     def parse(self, source, do_simple=True):
+        if source.is_tgen_event_log(TGenEventLog.MAGIC):
+            # the binary log only holds the final record of each transfer, so
+            # the payload progress comes from that record alone
+            self.__parse_event_log(source, do_simple)
+            return
+
         source.open()
         for line in source:
             # ignore line parsing errors
@@ -141,9 +141,10 @@ def get_random_free_port():
             return port
 
 class DataSource(object):
-    def __init__(self, filename, compress=False):
+    def __init__(self, filename, compress=False, binary=False):
         self.filename = filename
         self.compress = compress
+        self.binary = binary
         self.source = None
         self.xzproc = None
 
@@ -161,20 +162,30 @@ class DataSource(object):
     def open(self):
         if self.source is None:
             if self.filename == '-':
-                self.source = sys.stdin
+                self.source = sys.stdin.buffer if self.binary and hasattr(sys.stdin, 'buffer') else sys.stdin
             elif self.compress or self.filename.endswith(".xz"):
                 self.compress = True
                 cmd = "xz --decompress --stdout {0}".format(self.filename)
                 xzproc = Popen(cmd.split(), stdout=PIPE)
                 self.source = xzproc.stdout
             else:
-                self.source = open(self.filename, 'r')
+                self.source = open(self.filename, 'rb' if self.binary else 'r')
 
     def get_file_handle(self):
         if self.source is None:
             self.open()
         return self.source
 
+    def is_tgen_event_log(self, magic):
+        ''' returns True if the file starts with the magic of a binary tgen event log '''
+        if self.filename == '-':
+            return False
+        peek = DataSource(self.filename, compress=self.compress, binary=True)
+        peek.open()
+        head = peek.get_file_handle().read(len(magic))
+        peek.close()
+        return head == magic
+
     def close(self):
         if self.source is not None: self.source.close()
         if self.xzproc is not None: self.xzproc.wait()